@@ -138,6 +138,11 @@
 	((nic)->efhw_func->dmaq_kick ? \
 	 (nic)->efhw_func->dmaq_kick((nic), (instance)) : 0)
 
+#define efhw_nic_af_xdp_busy_poll(nic, instance, usec, budget) \
+	((nic)->efhw_func->af_xdp_busy_poll ? \
+	 (nic)->efhw_func->af_xdp_busy_poll((nic), (instance), (usec), \
+	                                    (budget)) : -EOPNOTSUPP)
+
 #define efhw_nic_af_xdp_mem(nic, instance) \
 	((nic)->efhw_func->af_xdp_mem ? \
 	 (nic)->efhw_func->af_xdp_mem((nic), (instance)) : NULL)
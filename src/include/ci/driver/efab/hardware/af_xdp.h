@@ -15,6 +15,8 @@ struct efab_af_xdp_offsets_ring
   int64_t producer;
   int64_t consumer;
   int64_t desc;
+  /* Zero if the kernel does not support XDP_USE_NEED_WAKEUP */
+  int64_t flags;
 };
 
 struct efab_af_xdp_offsets_rings
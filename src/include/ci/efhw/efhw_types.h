@@ -452,6 +452,12 @@ struct efhw_func_ops {
 	 */
 	int (*dmaq_kick)(struct efhw_nic* nic, int instance);
 
+	/*! Have the kernel busy poll the device from the VI's own kicks,
+	 * rather than relying on interrupts to schedule it.  [usec] and
+	 * [budget] are as for SO_BUSY_POLL and SO_BUSY_POLL_BUDGET. */
+	int (*af_xdp_busy_poll)(struct efhw_nic* nic, int instance,
+	                        int usec, int budget);
+
 	/*! Get the base address of the queue memory descriptor for a VI.
 	 * This is available at any time after calling init_hardware,
 	 * although the queue memory itself will not be accessible until
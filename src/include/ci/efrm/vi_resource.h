@@ -287,6 +287,8 @@ extern int efrm_vi_set_get_vi_instance(struct efrm_vi *);
 
 extern int efrm_vi_af_xdp_kick(struct efrm_vi *vi);
 
+extern int efrm_vi_af_xdp_busy_poll(struct efrm_vi *vi, int usec, int budget);
+
 extern int
 efrm_interrupt_vectors_ctor(struct efrm_nic *nic,
 			    const struct vi_resource_dimensions *res_dim);
@@ -411,6 +411,10 @@ typedef struct {
   ci_int32      sack_blocks;
   ci_uint32     ack,seq;         /* ACK and SEQ values in host endian */
   ci_uint32     hash;            /* hash for l/r addr/port */
+  /* TCP Fast Open option from a SYN; valid iff CI_TCPT_FLAG_FASTOPEN is
+   * set in [flags].  [fastopen_len] is zero for a cookie request. */
+  ci_uint8*     fastopen_cookie;
+  ci_int32      fastopen_len;
 } ciip_tcp_rx_pkt;
 
 
@@ -513,6 +517,18 @@ ci_inline void ci_netif_send(ci_netif* ni, ci_ip_pkt_fmt* pkt)
   pkt->flags |= CI_PKT_FLAG_TX_PENDING;
   __ci_netif_send(ni, pkt);
 }
+/* Like ci_netif_send(), but only queues [pkt] behind any packets already
+ * waiting for the interface.  The caller must call
+ * ci_netif_send_batch_post() once it has queued the whole batch.
+ */
+extern void __ci_netif_send_batched(ci_netif*, ci_ip_pkt_fmt* pkt) CI_HF;
+ci_inline void ci_netif_send_batched(ci_netif* ni, ci_ip_pkt_fmt* pkt)
+{
+  ci_assert_nflags(pkt->flags, CI_PKT_FLAG_TX_PENDING);
+  pkt->flags |= CI_PKT_FLAG_TX_PENDING;
+  __ci_netif_send_batched(ni, pkt);
+}
+extern void ci_netif_send_batch_post(ci_netif*) CI_HF;
 extern void ci_netif_rx_post(ci_netif* netif, int nic_index) CI_HF;
 extern int  ci_netif_set_rxq_limit(ci_netif*) CI_HF;
 #ifdef __KERNEL__
@@ -531,6 +547,16 @@ extern void ci_netif_timeout_restart(ci_netif *ni, ci_tcp_state *ts) CI_HF;
 
 extern void ci_netif_timewait_enter(ci_netif* ni, ci_tcp_state* ts) CI_HF;
 extern int  ci_netif_timewait_try_to_free_filter(ci_netif* ni) CI_HF;
+extern int  ci_netif_timewait_compact(ci_netif* ni, ci_tcp_state* ts) CI_HF;
+extern ci_tcp_timewait_t*
+ci_netif_timewait_lookup(ci_netif* ni, ci_uint32 laddr_be32,
+                         ci_uint16 lport_be16, ci_uint32 raddr_be32,
+                         ci_uint16 rport_be16) CI_HF;
+extern void ci_netif_timewait_free(ci_netif* ni, ci_tcp_timewait_t* tw) CI_HF;
+extern ci_uint32 ci_netif_timewait_reuse(ci_netif* ni, ci_uint32 laddr_be32,
+                                         ci_uint16 lport_be16,
+                                         ci_uint32 raddr_be32,
+                                         ci_uint16 rport_be16) CI_HF;
 extern void ci_netif_fin_timeout_enter(ci_netif* ni, ci_tcp_state* ts) CI_HF;
 
 extern void ci_netif_dump(ci_netif* ni) CI_HF;
@@ -686,6 +712,26 @@ extern int ci_netif_pkt_alloc_block(ci_netif*, ci_sock_cmn*,
                                     int can_block,
                                     ci_ip_pkt_fmt** p_pkt) CI_HF;
 
+/*! Allocates a packet buffer from the nonb pool without the stack lock,
+ * via the calling thread's cache if EF_TX_PKT_MAGAZINE is set.  Returns
+ * NULL if the pool is empty.
+ */
+#ifdef __KERNEL__
+# define ci_netif_pkt_alloc_nonb_cached(ni)  ci_netif_pkt_alloc_nonb(ni)
+#else
+extern ci_ip_pkt_fmt* ci_netif_pkt_alloc_nonb_cached(ci_netif*) CI_HF;
+
+/*! Fills [mag] with up to [max] buffers from the nonb pool using a single
+ * compare-and-swap, returning the number taken.  [mag] must be empty.
+ */
+extern int oo_pkt_magazine_refill(ci_netif*, struct oo_pkt_magazine* mag,
+                                  int max) CI_HF;
+
+/*! Returns all buffers in [mag] to the nonb pool in one go. */
+extern void oo_pkt_magazine_flush(ci_netif*,
+                                  struct oo_pkt_magazine* mag) CI_HF;
+#endif
+
 /*! Sleeps until a packet buffer becomes available, returning 0 on success.
  * At userlevel this function will never fail.  In the kernel it may return
  * -ERESTARTSYS if interrupted by a signal.
@@ -996,6 +1042,8 @@ extern int ci_udp_recvmmsg(ci_udp_iomsg_args *a, struct mmsghdr* mmsg,
                            unsigned int vlen, int flags, 
                            const struct timespec* timeout
                            CI_KERNEL_ARG(ci_addr_spc_t addr_spc)) CI_HF;
+extern int ci_udp_sendmmsg(ci_udp_iomsg_args *a, struct mmsghdr* mmsg,
+                           unsigned int vlen, int flags) CI_HF;
 
 struct onload_zc_mmsg;
 extern int ci_tcp_zc_send(ci_netif* ni, ci_tcp_state* ts, 
@@ -1427,6 +1475,8 @@ extern void ci_tcp_all_fds_gone(ci_netif* netif, ci_tcp_state*,
 extern void ci_tcp_all_fds_gone_common(ci_netif* netif, ci_tcp_state*) CI_HF;
 extern void ci_tcp_rx_reap_rxq_bufs(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_rx_reap_rxq_last_buf(ci_netif* netif, ci_tcp_state* ts) CI_HF;
+extern int ci_tcp_rx_enqueue_coalesce(ci_netif* netif, ci_tcp_state* ts,
+                                      ci_ip_pkt_fmt* pkt) CI_HF;
 
 static inline void
 ci_tcp_rx_reap_rxq_bufs_socklocked(ci_netif* netif, ci_tcp_state* ts)
@@ -1477,6 +1527,32 @@ extern void
 ci_tcp_syncookie_ack(ci_netif* netif, ci_tcp_socket_listen* tls,
                      ciip_tcp_rx_pkt* rxp,
                      ci_tcp_state_synrecv **tsr_p);
+extern void
+ci_tcp_syncookie_ack_batch(ci_netif* netif, struct ci_netif_poll_state* ps,
+                           ci_ip_pkt_fmt** pkts, int n_pkts);
+
+/* Siphash-2-4 keyed with 2 * ci_uint64, see tcp_syncookie.c */
+#define CI_SIP_LANES      4
+#define CI_SIP_LANES_LEN  13
+extern ci_uint64
+ci_sip_hash(ci_uint64* key, const void* data, int len);
+extern void
+ci_sip_hash_lanes(ci_uint64* key, ci_uint8 (*data)[CI_SIP_LANES_LEN],
+                  ci_uint64* out);
+
+/* TCP Fast Open, see tcp_syncookie.c */
+#define CI_TCP_FASTOPEN_COOKIE_LEN  8
+extern void
+ci_tcp_fastopen_cookie(ci_netif* netif, ci_addr_t laddr, ci_addr_t raddr,
+                       ci_uint8* cookie);
+extern int /*bool*/
+ci_tcp_fastopen_cookie_check(ci_netif* netif, ci_addr_t laddr,
+                             ci_addr_t raddr, ciip_tcp_rx_pkt* rxp);
+extern int
+ci_tcp_fastopen_cache_get(ci_netif* netif, ci_addr_t raddr, ci_uint8* cookie);
+extern void
+ci_tcp_fastopen_cache_set(ci_netif* netif, ci_addr_t raddr,
+                          const ci_uint8* cookie, int len);
 
 extern void ci_tcp_set_sndbuf(ci_netif* ni, ci_tcp_state* ts);
 extern void ci_tcp_set_sndbuf_from_sndbuf_pkts(ci_netif* ni, ci_tcp_state* ts);
@@ -1616,16 +1692,30 @@ extern const char* ci_tcp_congstate_str(unsigned state) CI_HF;
 
 extern void ci_tcp_handle_rx(ci_netif*, struct ci_netif_poll_state*,
                              ci_ip_pkt_fmt*, ci_tcp_hdr*, int ip_paylen) CI_HF;
+extern void ci_tcp_handle_rx_vec(ci_netif*, struct ci_netif_poll_state*,
+                                 ci_ip_pkt_fmt** pkts, int n_pkts) CI_HF;
 extern void ci_tcp_rx_deliver2(ci_tcp_state*,ci_netif*,ciip_tcp_rx_pkt*) CI_HF;
 
 extern void ci_tcp_tx_change_mss(ci_netif*, ci_tcp_state*, bool may_send) CI_HF;
 extern void ci_tcp_enqueue_no_data(ci_tcp_state* ts, ci_netif* netif,
                                    ci_ip_pkt_fmt* pkt) CI_HF;
+extern int ci_tcp_enqueue_syn_data(ci_tcp_state* ts, ci_netif* netif,
+                                   ci_ip_pkt_fmt* pkt, ci_iovec_ptr* piov,
+                                   int maxlen
+                                   CI_KERNEL_ARG(ci_addr_spc_t addr_spc)) CI_HF;
 extern int ci_tcp_send_sim_synack(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern int ci_tcp_synrecv_send(ci_netif* netif, ci_tcp_socket_listen* tls,
                                ci_tcp_state_synrecv* tsr, 
                                ci_ip_pkt_fmt* pkt, ci_uint8 tcp_flags,
                                ci_ip_cached_hdrs* ipcache_opt) CI_HF;
+extern const ci_tcp_syncookie_tmpl*
+ci_tcp_syncookie_tmpl_get(ci_netif* netif, ci_tcp_socket_listen* tls,
+                          ci_ip_cached_hdrs* ipcache) CI_HF;
+extern int ci_tcp_syncookie_synack_send(ci_netif* netif,
+                                        ci_tcp_socket_listen* tls,
+                                        ci_tcp_state_synrecv* tsr,
+                                        ci_ip_pkt_fmt* pkt,
+                                        ci_ip_cached_hdrs* ipcache) CI_HF;
 extern int ci_tcp_unsacked_segments_in_flight(ci_netif*, ci_tcp_state*) CI_HF;
 extern int ci_tcp_retrans_one(ci_tcp_state* ts, ci_netif* netif,
                               ci_ip_pkt_fmt* pkt) CI_HF;
@@ -1638,6 +1728,29 @@ ci_tcp_maybe_enter_fast_recovery(ci_netif* ni, ci_tcp_state* ts) CI_HF;
 
 extern void ci_tcp_recovered(ci_netif* ni, ci_tcp_state* ts) CI_HF;
 
+/* Congestion control algorithms, see tcp_cong.c.  [ts->c.cong_algo] is one
+ * of EF_TCP_CONG_ALGO_*. */
+extern void ci_tcp_cong_init(ci_netif* ni, ci_tcp_state* ts) CI_HF;
+extern void ci_tcp_cong_avoid(ci_netif* ni, ci_tcp_state* ts) CI_HF;
+extern void ci_tcp_cong_acked(ci_netif* ni, ci_tcp_state* ts,
+                              ci_uint32 acked, int /*bool*/ ece) CI_HF;
+extern ci_uint32 ci_tcp_cong_ssthresh(ci_netif* ni, ci_tcp_state* ts) CI_HF;
+extern int ci_tcp_cong_algo_from_name(const char* name) CI_HF;
+extern const char* ci_tcp_cong_algo_name(unsigned algo) CI_HF;
+
+/* Pacing, see tcp_cong.c.  Rates are in bytes per timer tick. */
+#define CI_TCP_PACING_RATE_MAX  0x3fffffff
+extern ci_uint32 ci_tcp_pacing_rate(ci_netif* ni, ci_tcp_state* ts) CI_HF;
+extern ci_int32 ci_tcp_pacing_credit(ci_netif* ni, ci_tcp_state* ts,
+                                     ci_uint32 rate) CI_HF;
+
+ci_inline int ci_tcp_is_paced(ci_netif* ni, ci_tcp_state* ts)
+{
+  return ( NI_OPTS(ni).tcp_pacing ||
+           ts->c.max_pacing_rate != CI_TCP_PACING_RATE_UNLIMITED ) &&
+         OO_SP_IS_NULL(ts->local_peer);
+}
+
 extern void ci_tcp_clear_sacks(ci_netif* ni, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_retrans_init_ptrs(ci_netif* ni, ci_tcp_state* ts,
                                      unsigned* recover_seq_out) CI_HF;
@@ -1650,6 +1763,8 @@ extern void ci_tcp_retrans_coalesce_block(ci_netif* ni, ci_tcp_state* ts,
 extern int ci_tcp_tx_coalesce(ci_netif* ni, ci_tcp_state* ts,
 			      ci_ip_pkt_queue* q, ci_ip_pkt_fmt* pkt,
                               ci_boolean_t is_sendq) CI_HF;
+extern void ci_tcp_tx_strip_syn(ci_netif* ni, ci_tcp_state* ts,
+                                ci_ip_pkt_fmt* pkt) CI_HF;
 extern void ci_tcp_tx_insert_option_space(ci_netif* ni, ci_tcp_state* ts,
                                           ci_ip_pkt_fmt* pkt, int hdrlen,
 					  int extra_opts) CI_HF;
@@ -1667,6 +1782,9 @@ extern void ci_tcp_send_rst(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void
 ci_tcp_reply_with_rst(ci_netif* netif, const struct oo_sock_cplane* sock_cp,
                       ciip_tcp_rx_pkt* rxp) CI_HF;
+extern void ci_tcp_timewait_send_ack(ci_netif* netif,
+                                     const ci_tcp_timewait_t* tw,
+                                     ciip_tcp_rx_pkt* rxp) CI_HF;
 extern int ci_tcp_reset_untrusted(ci_netif *netif, ci_tcp_state *ts) CI_HF;
 extern void ci_tcp_send_zwin_probe(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_set_established_state(ci_netif*, ci_tcp_state*) CI_HF;
@@ -1869,6 +1987,7 @@ extern void ci_tcp_timeout_zwin(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_timeout_delack(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_timeout_rto(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_timeout_cork(ci_netif* netif, ci_tcp_state* ts) CI_HF;
+extern void ci_tcp_timeout_pace(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_stop_timers(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_send_corked_packets(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 
@@ -1961,6 +2080,7 @@ extern void ci_tcp_sendmsg_enqueue_prequeue(ci_netif* ni,
                                             ci_tcp_state* ts,
                                             int/*bool*/ shutdown) CI_HF;
 extern void ci_tcp_perform_deferred_socket_work(ci_netif*, ci_tcp_state*)CI_HF;
+extern void ci_tcp_zc_record(ci_netif*, ci_tcp_state*) CI_HF;
 
 /* Guarantees that deferred work will be performed at some point in the
  * near future, either by the calling thread (in this call), or deferred to
@@ -2800,6 +2920,38 @@ ci_inline int ci_netif_need_poll_maybe_spinning(ci_netif* ni, ci_uint64 frc_now,
     return ci_netif_need_poll_frc(ni, frc_now);
 }
 
+#ifndef __KERNEL__
+/* With EF_SPIN_ADAPTIVE, a thread that has skipped spinning this many times
+ * in a row spins anyway, to find out whether waits have become shorter.
+ */
+#define OO_SPIN_ADAPT_PROBE_INTERVAL  16
+
+/* Outcome of a wait, for oo_spin_adapt_wait_done(). */
+#define OO_SPIN_ADAPT_HIT   0  /* became ready while spinning */
+#define OO_SPIN_ADAPT_MISS  1  /* spun until the timeout, then blocked */
+#define OO_SPIN_ADAPT_SKIP  2  /* blocked without spinning */
+
+/* Returns true if a thread about to wait for [sa]'s socket or epoll set
+ * should spin for up to [max_spin] cycles before blocking.
+ */
+ci_inline int oo_spin_adapt_should_spin(struct oo_spin_adapt* sa,
+                                        ci_uint64 max_spin)
+{
+  if( sa->wait_avg <= max_spin ) {
+    sa->skips = 0;
+    return 1;
+  }
+  if( ++sa->skips < OO_SPIN_ADAPT_PROBE_INTERVAL )
+    return 0;
+  sa->skips = 0;
+  return 1;
+}
+
+extern void oo_spin_adapt_wait_done(ci_netif* ni, struct oo_spin_adapt* sa,
+                                    ci_uint64 max_spin, ci_uint64 waited,
+                                    int outcome) CI_HF;
+#endif
+
 #if CI_CFG_TCP_SHARED_LOCAL_PORTS
 ci_inline int ci_netif_should_allocate_tcp_shared_local_ports(ci_netif* ni)
 {
@@ -3486,10 +3638,25 @@ ci_icmp_send_port_unreach(ci_netif *ni, ci_ip_pkt_fmt* rx_pkt)
 ********************************* UDP *********************************
 **********************************************************************/
 
-ci_inline void ci_udp_dec_tx_count(ci_udp_state* us, ci_ip_pkt_fmt* pkt) {
+/* With EF_TX_LOCK_DOMAINS, [tx_count] is also updated by senders that do
+ * not hold the stack lock, so updates must be atomic.
+ */
+ci_inline void ci_udp_add_tx_count(ci_netif* ni, ci_udp_state* us,
+                                   ci_uint32 n) {
+  if( NI_OPTS(ni).tx_lock_domains )
+    ci_atomic32_add(&us->tx_count, n);
+  else
+    us->tx_count += n;
+}
+
+ci_inline void ci_udp_dec_tx_count(ci_netif* ni, ci_udp_state* us,
+                                   ci_ip_pkt_fmt* pkt) {
   ci_assert(pkt->flags & CI_PKT_FLAG_UDP);
   ci_assert_ge((int) us->tx_count, (int) pkt->pf.udp.tx_length);
-  us->tx_count -= pkt->pf.udp.tx_length;
+  if( NI_OPTS(ni).tx_lock_domains )
+    ci_atomic32_add(&us->tx_count, -pkt->pf.udp.tx_length);
+  else
+    us->tx_count -= pkt->pf.udp.tx_length;
 }
 
 
@@ -3935,6 +4102,21 @@ static inline int ci_tcp_resend_fin(ci_tcp_state* ts, ci_netif* netif)
   return 0;
 }
 
+/* Rate limit for ACKs sent in reply to invalid segments (RFC 5961 section
+ * 7).  [t_last] holds the time that the last such ACK was sent. */
+ci_inline int/*bool*/
+ci_tcp_ack_ratelimit(ci_netif* netif, ci_iptime_t* t_last)
+{
+  if( ci_tcp_time_now(netif) - *t_last >=
+      NI_CONF(netif).tconst_invalid_ack_ratelimit ) {
+    *t_last = ci_tcp_time_now(netif);
+    return 1;
+  }
+
+  CITP_STATS_NETIF_INC(netif, invalid_ack_limited);
+  return 0;
+}
+
 
 /**********************************************************************
 ****************************** TCP socket *****************************
@@ -4177,6 +4359,7 @@ ci_inline void ci_tcp_set_initialcwnd(ci_netif* ni, ci_tcp_state* ts) {
    * processed the options, so this is OK. */
   ci_assert_le(ts->snd_wscl, CI_TCP_WSCL_MAX);
   ts->ssthresh = 65535 << ts->snd_wscl;
+  ci_tcp_cong_init(ni, ts);
 }
 
 /*! ?? \TODO should we use fackets to make things more exact ? */ 
@@ -4271,6 +4454,49 @@ ci_inline int ci_tcp_tx_send_space(ci_netif* ni, ci_tcp_state* ts)
     return ts->so_sndbuf_pkts - ci_tcp_sendq_n_pkts(ts);
 }
 
+/* Are there MSG_ZEROCOPY completions waiting to be read from the error
+ * queue? */
+ci_inline int ci_tcp_zc_compl_pending(ci_tcp_state* ts)
+{
+  return OO_ACCESS_ONCE(ts->zc.acked) != ts->zc.reported;
+}
+
+/* Give the MSG_ZEROCOPY sends from [queued] up to [next_id] the range that
+ * ends at [end_seq].  They merge with any sends that are still unacked. */
+ci_inline void ci_tcp_zc_queue(ci_tcp_state* ts, ci_uint32 next_id,
+                               ci_uint32 end_seq)
+{
+  if( ts->zc.acked == ts->zc.queued ) {
+    ts->zc.first_id = ts->zc.queued;
+    ts->zc.first_seq = end_seq;
+  }
+  ts->zc.last_seq = end_seq;
+  ts->zc.queued = next_id;
+}
+
+/* Complete MSG_ZEROCOPY sends that [ack] covers.  Only the oldest unacked
+ * send is tracked exactly; once it completes, the sends queued behind it
+ * become the new oldest and complete together.  Returns true if any send
+ * was completed. */
+ci_inline int ci_tcp_zc_ack(ci_tcp_state* ts, ci_uint32 ack)
+{
+  ci_uint32 acked = ts->zc.acked;
+
+  if( acked == ts->zc.queued || ! SEQ_GE(ack, ts->zc.first_seq) )
+    return 0;
+
+  acked = ts->zc.first_id + 1;
+  if( acked != ts->zc.queued ) {
+    ts->zc.first_id = ts->zc.queued - 1;
+    ts->zc.first_seq = ts->zc.last_seq;
+    if( SEQ_GE(ack, ts->zc.first_seq) )
+      acked = ts->zc.queued;
+  }
+  ts->zc.acked = acked;
+  return 1;
+}
+
+
 
 /* helpers for RTT sampling without TS option */
 ci_inline void ci_tcp_clear_rtt_timing(ci_tcp_state* ts) {
@@ -4298,11 +4524,22 @@ ci_inline ci_uint32 ci_tcp_listenq_max(ci_netif* ni)
 ************************** Per-socket locks ***************************
 **********************************************************************/
 
+ci_inline void ci_sock_lock_hist_maybe_start(ci_netif* ni)
+{
+#ifndef __KERNEL__
+  if(CI_UNLIKELY( NI_OPTS(ni).lat_hist ))
+    ci_sock_lock_hist_start();
+#endif
+}
+
 ci_inline int ci_sock_trylock(ci_netif* ni, citp_waitable* w)
 {
   ci_uint32 l = w->lock.wl_val;
-  return ! (l & OO_WAITABLE_LK_LOCKED) &&
-    ci_cas32u_succeed(&w->lock.wl_val, l, l | OO_WAITABLE_LK_LOCKED);
+  if( (l & OO_WAITABLE_LK_LOCKED) ||
+      ! ci_cas32u_succeed(&w->lock.wl_val, l, l | OO_WAITABLE_LK_LOCKED) )
+    return 0;
+  ci_sock_lock_hist_maybe_start(ni);
+  return 1;
 }
 
 /* Always returns 0 (success) at userland.  Returns -ERESTARTSYS if
@@ -4314,8 +4551,10 @@ ci_inline int ci_sock_lock(ci_netif*, citp_waitable*)
   OO_MUST_CHECK_RET_IN_KERNEL;
 ci_inline int ci_sock_lock(ci_netif* ni, citp_waitable* w)
 {
-  if(CI_LIKELY( ci_cas32u_succeed(&w->lock.wl_val, 0, OO_WAITABLE_LK_LOCKED) ))
+  if(CI_LIKELY( ci_cas32u_succeed(&w->lock.wl_val, 0, OO_WAITABLE_LK_LOCKED) )) {
+    ci_sock_lock_hist_maybe_start(ni);
     return 0;
+  }
 #ifdef __KERNEL__
   return ci_sock_lock_slow(ni, w);
 #else
@@ -4323,12 +4562,17 @@ ci_inline int ci_sock_lock(ci_netif* ni, citp_waitable* w)
    * any code conditional on the return value.
    */
   (void) ci_sock_lock_slow(ni, w);
+  ci_sock_lock_hist_maybe_start(ni);
   return 0;
 #endif
 }
 
 ci_inline void ci_sock_unlock(ci_netif* ni, citp_waitable* w)
 {
+#ifndef __KERNEL__
+  if(CI_UNLIKELY( NI_OPTS(ni).lat_hist ))
+    ci_sock_lock_hist_end(ni);
+#endif
   if(CI_UNLIKELY( ci_cas32u_fail(&w->lock.wl_val, OO_WAITABLE_LK_LOCKED, 0) ))
     ci_sock_unlock_slow(ni, w);
 }
@@ -4352,15 +4596,66 @@ ci_inline int  ci_sock_is_locked(ci_netif* ni, citp_waitable* w)
   (((tls)->acceptq_put >= 0) | OO_SP_NOT_NULL((tls)->acceptq_get))
 
 
+#if CI_CFG_TCP_ACCEPT_SHARDS
+/* Choose the shard for a new connection: the claimed shard with the
+ * fewest connections waiting, or -1 to use the listener's own queue.
+ * Ties are broken round-robin.
+ */
+ci_inline int ci_tcp_acceptq_shard_pick(ci_netif* ni,
+                                        ci_tcp_socket_listen* tls)
+{
+  int n_shards = NI_OPTS(ni).tcp_accept_shards;
+  int i, j, best = -1;
+  ci_uint32 n, best_n = 0;
+
+  for( j = 0; j < n_shards; ++j ) {
+    i = (tls->acceptq_n_in + j) % n_shards;
+    if( tls->acceptq_shards[i].owner == 0 )
+      continue;
+    n = tls->acceptq_shards[i].n_in - tls->acceptq_shards[i].n_out;
+    if( best < 0 || n < best_n ) {
+      best = i;
+      best_n = n;
+    }
+  }
+  return best;
+}
+
+
+/* Use this if you don't own the [busy] lock of any shard. */
+ci_inline int ci_tcp_acceptq_shards_not_empty(ci_netif* ni,
+                                              ci_tcp_socket_listen* tls)
+{
+  int i;
+  for( i = 0; i < CI_CFG_TCP_ACCEPT_SHARDS; ++i )
+    if( tls->acceptq_shards[i].put >= 0 ||
+        OO_SP_NOT_NULL(tls->acceptq_shards[i].get) )
+      return 1;
+  return 0;
+}
+#endif
+
+
 ci_inline void ci_tcp_acceptq_put(ci_netif* ni,
                                   ci_tcp_socket_listen* tls,
 				  citp_waitable* w) {
+  ci_int32* put = &tls->acceptq_put;
+#if CI_CFG_TCP_ACCEPT_SHARDS
+  int i;
+#endif
+
   ci_assert(OO_SP_IS_NULL(w->wt_next));
   ci_assert(ci_netif_is_locked(ni));
+#if CI_CFG_TCP_ACCEPT_SHARDS
+  if( NI_OPTS(ni).tcp_accept_shards &&
+      (i = ci_tcp_acceptq_shard_pick(ni, tls)) >= 0 ) {
+    put = &tls->acceptq_shards[i].put;
+    ++tls->acceptq_shards[i].n_in;
+  }
+#endif
   do
-    w->wt_next = OO_SP_FROM_INT(ni, tls->acceptq_put);
-  while( ci_cas32_fail(&tls->acceptq_put,
-                       OO_SP_TO_INT(w->wt_next), W_ID(w)) );
+    w->wt_next = OO_SP_FROM_INT(ni, *put);
+  while( ci_cas32_fail(put, OO_SP_TO_INT(w->wt_next), W_ID(w)) );
   ++tls->acceptq_n_in;
 }
 
@@ -4375,41 +4670,52 @@ ci_inline void ci_tcp_acceptq_put_back_tail(ci_netif* ni,
     w->wt_next = OO_SP_FROM_INT(ni, tls->acceptq_put);
   while( ci_cas32_fail(&tls->acceptq_put,
                        OO_SP_TO_INT(w->wt_next), W_ID(w)) );
-  --tls->acceptq_n_out;
+  ci_atomic32_dec(&tls->acceptq_n_out);
 }
 
 
-/* Should not be called directly, use ci_tcp_acceptq_get() and
- * ci_tcp_acceptq_peek(). */
-ci_inline void ci_tcp_acceptq_get_swizzle(ci_netif* ni,
-					  ci_tcp_socket_listen* tls) {
+/* Atomically grab the contents of a [put] list and reverse it onto the
+ * empty [get] list. */
+ci_inline void __ci_tcp_acceptq_swizzle(ci_netif* ni, ci_int32* put,
+                                        oo_sp* get) {
   ci_int32 from;
   oo_sp from_sp;
   ci_tcp_state* ts;
-  /* Atomically grab the contents of the [put] list. */
   do
-    from = tls->acceptq_put;
-  while( ci_cas32_fail(&tls->acceptq_put, from, CI_ILL_END) );
-  /* Reverse the list onto [get]. */
+    from = *put;
+  while( ci_cas32_fail(put, from, CI_ILL_END) );
   ci_assert(from >= 0);
-  ci_assert(OO_SP_IS_NULL(tls->acceptq_get));
+  ci_assert(OO_SP_IS_NULL(*get));
   from_sp = OO_SP_FROM_INT(ni, from);
   do {
     ts = SP_TO_TCP(ni, from_sp);
     from_sp = ts->s.b.wt_next;
-    ts->s.b.wt_next = tls->acceptq_get;
-    tls->acceptq_get = S_SP(ts);
+    ts->s.b.wt_next = *get;
+    *get = S_SP(ts);
   } while( OO_SP_NOT_NULL(from_sp) );
 }
 
 
-/* Only call this if ci_tcp_acceptq_not_empty() is true. */
+/* Should not be called directly, use ci_tcp_acceptq_get() and
+ * ci_tcp_acceptq_peek(). */
+ci_inline void ci_tcp_acceptq_get_swizzle(ci_netif* ni,
+					  ci_tcp_socket_listen* tls) {
+  __ci_tcp_acceptq_swizzle(ni, &tls->acceptq_put, &tls->acceptq_get);
+}
+
+
+/* Only call this if ci_tcp_acceptq_not_empty() is true.
+ *
+ * [acceptq_n_out] is updated atomically here and in the put-back functions
+ * because threads taking connections from the shards do so without the
+ * socket lock.
+ */
 ci_inline citp_waitable* ci_tcp_acceptq_get(ci_netif* ni,
 					   ci_tcp_socket_listen* tls) {
   citp_waitable* w;
   ci_assert(ci_sock_is_locked(ni, &tls->s.b) ||
             (tls->s.b.sb_aflags & CI_SB_AFLAG_ORPHAN));
-  ++tls->acceptq_n_out;
+  ci_atomic32_inc(&tls->acceptq_n_out);
   if( OO_SP_IS_NULL(tls->acceptq_get) )  ci_tcp_acceptq_get_swizzle(ni, tls);
   ci_assert(OO_SP_NOT_NULL(tls->acceptq_get));
   w = SP_TO_WAITABLE(ni, tls->acceptq_get);
@@ -4436,12 +4742,60 @@ ci_inline void ci_tcp_acceptq_put_back(ci_netif* ni, ci_tcp_socket_listen* tls,
                                        citp_waitable* w) {
   ci_assert(ci_sock_is_locked(ni, &tls->s.b));
   ci_assert(w->sb_aflags & CI_SB_AFLAG_TCP_IN_ACCEPTQ);
-  --tls->acceptq_n_out;
+  ci_atomic32_dec(&tls->acceptq_n_out);
   w->wt_next = tls->acceptq_get;
   tls->acceptq_get = W_SP(w);
 }
 
 
+#if CI_CFG_TCP_ACCEPT_SHARDS
+/* Take the next connection off [sh], unless it is empty or another thread
+ * is taking one.  This is lock-free with respect to the listening socket
+ * and the stack: [busy] is held only while the lists are updated.
+ */
+ci_inline citp_waitable*
+ci_tcp_acceptq_shard_try_get(ci_netif* ni, ci_tcp_socket_listen* tls,
+                             ci_tcp_acceptq_shard* sh)
+{
+  citp_waitable* w = NULL;
+
+  if( (sh->put < 0 && OO_SP_IS_NULL(sh->get)) ||
+      ci_cas32u_fail(&sh->busy, 0, 1) )
+    return NULL;
+  if( OO_SP_IS_NULL(sh->get) && sh->put >= 0 )
+    __ci_tcp_acceptq_swizzle(ni, &sh->put, &sh->get);
+  if( OO_SP_NOT_NULL(sh->get) ) {
+    w = SP_TO_WAITABLE(ni, sh->get);
+    sh->get = w->wt_next;
+    CI_DEBUG(w->wt_next = OO_SP_NULL);
+    ++sh->n_out;
+    ci_atomic32_inc(&tls->acceptq_n_out);
+  }
+  ci_wmb();
+  sh->busy = 0;
+  return w;
+}
+
+
+/* Return [w], taken from [sh] by ci_tcp_acceptq_shard_try_get(), to the
+ * head of [sh]. */
+ci_inline void
+ci_tcp_acceptq_shard_put_back(ci_netif* ni, ci_tcp_socket_listen* tls,
+                              ci_tcp_acceptq_shard* sh, citp_waitable* w)
+{
+  ci_assert(w->sb_aflags & CI_SB_AFLAG_TCP_IN_ACCEPTQ);
+  while( ci_cas32u_fail(&sh->busy, 0, 1) )
+    ci_spinloop_pause();
+  w->wt_next = sh->get;
+  sh->get = W_SP(w);
+  --sh->n_out;
+  ci_atomic32_dec(&tls->acceptq_n_out);
+  ci_wmb();
+  sh->busy = 0;
+}
+#endif
+
+
 ci_inline void ci_tcp_acceptq_drop_stats_inc(ci_netif* ni,
                                              ci_tcp_socket_listen* tls,
                                              const char* lpf) {
@@ -4654,19 +5008,83 @@ ci_sb_epoll_ready_link(ci_netif* ni, ci_sb_epoll_state* epoll, int i)
   ci_assert_lt((bitmask), 1u << CI_CFG_N_READY_LISTS); \
   OO_FOR_EACH_BIT(bitmask, tmp, i)
 
+#if CI_CFG_EPOLL3
+/* Pushes [epoll]'s socket onto ready ring [i].  Returns false if the ring
+ * is full, in which case the caller must use the ready list instead.  A
+ * socket already in the ring is not added again.
+ */
+ci_inline int
+ci_netif_ready_ring_put(ci_netif* ni, ci_sb_epoll_state* epoll, int i)
+{
+  struct oo_ready_ring* ring = &ni->state->ready_rings[i];
+  ci_uint32 added = ring->added;
+
+  if( epoll->ring_queued & (1u << i) )
+    return 1;
+  if( added - OO_ACCESS_ONCE(ring->removed) >= CI_NI_READY_RING_SIZE ) {
+    CITP_STATS_NETIF_INC(ni, epoll_ring_overflows);
+    return 0;
+  }
+  ci_atomic32_or(&epoll->ring_queued, 1u << i);
+  ring->ids[added % CI_NI_READY_RING_SIZE] = epoll->sock_id;
+  ci_wmb();
+  ring->added = added + 1;
+  CITP_STATS_NETIF_INC(ni, epoll_ring_pushes);
+  return 1;
+}
+
+/* Takes the next socket id off ready ring [i], or returns OO_SP_NULL if the
+ * ring is empty.  Only the owner of the ready list may call this, and it
+ * does not need the stack lock.  The caller is responsible for clearing
+ * the socket's bit in [ring_queued].
+ */
+ci_inline oo_sp ci_netif_ready_ring_get(ci_netif* ni, int i)
+{
+  struct oo_ready_ring* ring = &ni->state->ready_rings[i];
+  ci_uint32 removed = ring->removed;
+  oo_sp id;
+
+  if( OO_ACCESS_ONCE(ring->added) == removed )
+    return OO_SP_NULL;
+  ci_rmb();
+  id = ring->ids[removed % CI_NI_READY_RING_SIZE];
+  /* Finish reading the slot before the producer can reuse it. */
+  ci_mb();
+  ring->removed = removed + 1;
+  return id;
+}
+
+/* Tells the owner of ready list [i] that [epoll]'s socket may be ready. */
+ci_inline void
+ci_netif_ready_list_put(ci_netif* ni, ci_sb_epoll_state* epoll, int i)
+{
+  struct oo_p_dllink_state link;
+
+  if( NI_OPTS(ni).epoll_ready_ring && ci_netif_ready_ring_put(ni, epoll, i) )
+    return;
+  link = ci_sb_epoll_ready_link(ni, epoll, i);
+  oo_p_dllink_del(ni, link);
+  oo_p_dllink_add_tail(ni, oo_p_dllink_ptr(ni, &ni->state->ready_lists[i]),
+                       link);
+}
+
+ci_inline int ci_netif_ready_list_is_empty(ci_netif* ni, int i)
+{
+  return oo_p_dllink_is_empty(ni,
+                      oo_p_dllink_ptr(ni, &ni->state->ready_lists[i])) &&
+         OO_ACCESS_ONCE(ni->state->ready_rings[i].added) ==
+         OO_ACCESS_ONCE(ni->state->ready_rings[i].removed);
+}
+#endif
+
 ci_inline void
 ci_netif_put_on_post_poll_epoll(ci_netif* ni, citp_waitable* sb)
 {
 #if CI_CFG_EPOLL3
   ci_sb_epoll_state* epoll = ci_ni_aux_p2epoll(ni, sb->epoll);
   ci_uint32 tmp, i;
-  CI_READY_LIST_EACH(sb->ready_lists_in_use, tmp, i) {
-    struct oo_p_dllink_state link = ci_sb_epoll_ready_link(ni, epoll, i);
-    oo_p_dllink_del(ni, link);
-    oo_p_dllink_add_tail(ni,
-                         oo_p_dllink_ptr(ni, &ni->state->ready_lists[i]),
-                         link);
-  }
+  CI_READY_LIST_EACH(sb->ready_lists_in_use, tmp, i)
+    ci_netif_ready_list_put(ni, epoll, i);
 #endif
 }
 
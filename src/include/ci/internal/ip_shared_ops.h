@@ -54,15 +54,43 @@ ci_netif_unlock_slow_common(ci_netif*, ci_uint64 lock_val,
  * called at userlevel, this is the only possible outcome.  In the kernel,
  * they return -EINTR if interrupted by a signal.
  */
-#if ! defined(__KERNEL__) || ! CI_CFG_UL_INTERRUPT_HELPER
+#ifndef __KERNEL__
+/* With EF_LATENCY_HIST, note when user-level code takes the stack lock so
+ * that ci_netif_unlock() can record the hold time.
+ */
+ci_inline void ci_netif_lock_hist_start(ci_netif* ni)
+{
+  if(CI_UNLIKELY( ni->state->opts.lat_hist ))
+    ci_frc64(&ni->lock_frc);
+}
+
+ci_inline int ci_netif_lock_ul(ci_netif* ni)
+{
+  ef_eplock_lock(ni);
+  ci_netif_lock_hist_start(ni);
+  return 0;
+}
+
+ci_inline int ci_netif_trylock_ul(ci_netif* ni)
+{
+  if( ! ef_eplock_trylock(&ni->state->lock) )
+    return 0;
+  ci_netif_lock_hist_start(ni);
+  return 1;
+}
+
+#define ci_netif_lock(ni)        ci_netif_lock_ul(ni)
+#define ci_netif_lock_id(ni,id)  ci_netif_lock_ul(ni)
+#define ci_netif_trylock(ni)     ci_netif_trylock_ul(ni)
+#else
+#if ! CI_CFG_UL_INTERRUPT_HELPER
 #define ci_netif_lock(ni)        ef_eplock_lock(ni)
 #endif
 
-#ifdef __KERNEL__
 #define ci_netif_lock_maybe_wedged(ni) ef_eplock_lock_maybe_wedged(ni)
-#endif
 #define ci_netif_lock_id(ni,id)  ef_eplock_lock(ni)
 #define ci_netif_trylock(ni)     ef_eplock_trylock(&(ni)->state->lock)
+#endif
 
 #define ci_netif_lock_fdi(epi)   ci_netif_lock_id((epi)->sock.netif,    \
                                                   SC_SP((epi)->sock.s))
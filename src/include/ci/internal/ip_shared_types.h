@@ -523,6 +523,35 @@ typedef struct {
 } ci_netif_stats;
 
 
+/*!
+** ci_lat_hist
+**
+** Log-linear latency histogram of values in CPU cycles.  Values below
+** 2^CI_LAT_HIST_SUB_BITS have a bucket each, and each larger power of two
+** is split into 2^CI_LAT_HIST_SUB_BITS buckets, so a bucket's width is at
+** most 1/8 of its lower bound.  Values of 2^CI_LAT_HIST_MAX_ORDER or more
+** are counted in the last bucket.  Updated with atomic operations so that
+** recording does not need the stack lock.
+*/
+#define CI_LAT_HIST_SUB_BITS   3
+#define CI_LAT_HIST_MAX_ORDER  40
+#define CI_LAT_HIST_BUCKETS                                             \
+  ((CI_LAT_HIST_MAX_ORDER - CI_LAT_HIST_SUB_BITS + 1) << CI_LAT_HIST_SUB_BITS)
+
+typedef struct {
+  ci_uint64             sum;
+  ci_uint64             max;
+  ci_uint64             bucket[CI_LAT_HIST_BUCKETS];
+} ci_lat_hist;
+
+typedef struct {
+#undef OO_LAT_HIST
+#define OO_LAT_HIST(name, desc)  ci_lat_hist name;
+#include <ci/internal/lat_hist_def.h>
+#undef OO_LAT_HIST
+} ci_netif_lat_hists;
+
+
 /*!
 ** ci_netif_filter_table
 **
@@ -554,11 +583,13 @@ typedef struct {
    * "array-index-out-of-bounds" warnings. Instead declare it as table[] with
    * CI_DECLARE_FLEX_ARRAY macro.
    * Use a union here (and in other similar places) to keep the same size
-   * of the structure to avoid any potential side effects. */
+   * of the structure to avoid any potential side effects.
+   * The table is cache-line aligned so that the buckets of the cuckoo layout
+   * (EF_FILTER_TABLE_CUCKOO) each occupy exactly one cache line. */
   union {
     ci_netif_filter_table_entry_fast padding;
     CI_DECLARE_FLEX_ARRAY(ci_netif_filter_table_entry_fast, table);
-  };
+  } CI_ALIGN(CI_CACHE_LINE_SIZE);
 } ci_netif_filter_table;
 
 
@@ -575,6 +606,31 @@ typedef struct {
 #define CI_TCP_PREV_SEQ_IS_FREE(prev_seq)     (CI_IPX_ADDR_IS_ANY((prev_seq).laddr))
 #define CI_TCP_PREV_SEQ_IS_TERMINAL(prev_seq) ((prev_seq).route_count == 0)
 
+
+/* A connection in TIME_WAIT whose endpoint has been freed, see
+ * EF_TCP_TIMEWAIT_TABLE.  Holds just enough to answer segments from the
+ * peer and to decide when the four-tuple may be reused.  IPv4 only. */
+typedef struct {
+  ci_uint32 laddr_be32;
+  ci_uint32 raddr_be32;
+  ci_uint16 lport_be16;
+  ci_uint16 rport_be16;
+  ci_uint32 snd_nxt;
+  ci_uint32 rcv_nxt;
+  ci_uint32 tsrecent; /* peer's timestamp, if CI_TCP_TIMEWAIT_FLAG_TSO */
+  ci_iptime_t expiry; /* time (ticks) the connection leaves TIME_WAIT */
+  ci_uint16 route_count; /* for handling tombstones */
+  ci_uint16 flags;
+} ci_tcp_timewait_t;
+
+#define CI_TCP_TIMEWAIT_FLAG_TSO  0x1  /* timestamps in use */
+
+/* Number of RFC 5961 ACK rate limits shared by the timewait table. */
+#define CI_TCP_TIMEWAIT_ACK_BUCKETS  64
+
+#define CI_TCP_TIMEWAIT_IS_FREE(tw)     ((tw).laddr_be32 == 0)
+#define CI_TCP_TIMEWAIT_IS_TERMINAL(tw) ((tw).route_count == 0)
+
 #if CI_CFG_IPV6
 typedef struct {
   ci_int32  id;
@@ -734,6 +790,12 @@ typedef struct {
   ci_uint64   ci_ip_time_ms2tick_fxp CI_ALIGN(8);
   /* list of timers currently firing */
   struct oo_p_dllink fire_list;
+  /* timers cascaded out of a wheel but not yet reinserted; see
+   * EF_TIMER_CASCADE_BUDGET */
+  struct oo_p_dllink cascade_list;
+  /* pending TCP timers whose expiry is tracked by their socket's
+   * coalesce_tid rather than by the wheel; see EF_TCP_TIMER_COALESCE */
+  struct oo_p_dllink coalesce_list;
   /* holds the timer wheels in a flat array */
   struct oo_p_dllink warray[CI_IPTIME_WHEELSIZE];  
 
@@ -765,6 +827,8 @@ typedef struct {
 # define CI_IP_TIMER_DEBUG_HOOK         0x9  /* Hook for timer debugging */
 # define CI_IP_TIMER_NETIF_STATS        0xa  /* netif statistics timer   */
 # define CI_IP_TIMER_TCP_CORK           0xb  /* TCP_CORK timer           */
+# define CI_IP_TIMER_TCP_PACE           0xc  /* TCP pacing timer         */
+# define CI_IP_TIMER_TCP_COALESCE       0xd  /* earliest TCP socket timer*/
 } ci_ip_timer;
 
 
@@ -799,6 +863,7 @@ typedef struct {
                                          containing page allocation, e.g. if
                                          packet buffers are 2K and pages are
                                          2MB then 10. */
+  CI_ULCONST ci_int8    numa_node; /**< NUMA node of the memory, or -1 */
 } oo_pktbuf_set;
 
 typedef struct {
@@ -1001,6 +1066,12 @@ typedef struct {
   ci_uint32             tx_dmaq_insert_seq_last_poll;
   /* Incremented when transmission of a packet completes. */
   ci_uint32             tx_dmaq_done_seq;
+  /* With EF_TX_LOCK_DOMAINS, protects the TX ring of this interface's VI
+   * and the TX counters above.  See ci_netif_tx_lock().  Zero when free,
+   * CI_NETIF_TX_LOCK_STACK when the stack lock holder has it, and otherwise
+   * the pid of a sender that has it without the stack lock. */
+  ci_uint32             tx_lock;
+#define CI_NETIF_TX_LOCK_STACK  0xffffffffu
   /* Holds partially received RX packet fragments. */
   oo_pkt_p              rx_frags;
   /* Owner of EFRM PD */
@@ -1201,6 +1272,7 @@ struct ci_netif_state_s {
   CI_ULCONST ci_uint32  sw_filter_ofs;  /**< offset of sw filter operations */
 #endif
   CI_ULCONST ci_uint32  seq_table_ofs;   /**< offset of seq no table */
+  CI_ULCONST ci_uint32  timewait_table_ofs; /**< offset of timewait table */
   CI_ULCONST ci_uint32  deferred_pkts_ofs; /**< offset of deferred pkts array */
   CI_ULCONST ci_uint32  buf_ofs;         /**< offset of packet metadata */
   CI_ULCONST ci_uint32  dma_ofs;         /**< offset of dma_addrs */
@@ -1226,6 +1298,19 @@ struct ci_netif_state_s {
     ci_uint16            added;
   } tcp_rst_cooldowns;
 
+  /* TCP Fast Open client cookie cache (RFC7413 section 4.1.2), direct
+   * mapped by peer address.  A zero [len] marks an empty slot. */
+#define CI_TCP_FASTOPEN_CACHE_SIZE      (16)
+  struct {
+    ci_addr_t            addr;
+    ci_uint8             len;
+    ci_uint8             cookie[CI_TCP_FASTOPEN_COOKIE_MAX];
+  } tcp_fastopen_cache[CI_TCP_FASTOPEN_CACHE_SIZE];
+
+  /* Time until which ACKs are expected for SYN-ACKs sent with syncookies.
+   * Until then, EF_RX_BATCH bursts have their cookies hashed up front. */
+  ci_iptime_t           syncookie_flood_until;
+
   ci_ip_timer_state     iptimer_state CI_ALIGN(8);
 
   ci_ip_timer           timeout_tid CI_ALIGN(8); /**< time-out timer */
@@ -1266,6 +1351,19 @@ struct ci_netif_state_s {
 #endif
 
 #if CI_CFG_EPOLL3
+  /* With EF_EPOLL_READY_RING the stack hands the ids of sockets that have
+   * become ready to the epoll set through this ring rather than
+   * [ready_lists], so that epoll_wait() need not take the stack lock.
+   * Single producer (the stack lock holder), single consumer (the set's
+   * epoll_wait(), under the UL epoll lock).  Sockets that do not fit go on
+   * [ready_lists] as usual.
+   */
+#define CI_NI_READY_RING_SIZE 512
+  struct oo_ready_ring {
+    ci_uint32           added CI_ALIGN(CI_CACHE_LINE_SIZE);
+    ci_uint32           removed CI_ALIGN(CI_CACHE_LINE_SIZE);
+    oo_sp               ids[CI_NI_READY_RING_SIZE] CI_ALIGN(CI_CACHE_LINE_SIZE);
+  } ready_rings[CI_CFG_N_READY_LISTS];
   ci_int32              ready_list_pid[CI_CFG_N_READY_LISTS];
   struct oo_p_dllink    ready_lists[CI_CFG_N_READY_LISTS];
   struct oo_p_dllink    unready_lists[CI_CFG_N_READY_LISTS];
@@ -1353,6 +1451,8 @@ struct ci_netif_state_s {
 #if CI_CFG_STATS_NETIF
   ci_netif_stats        stats;
 #endif
+  /* Recorded only when EF_LATENCY_HIST is set. */
+  ci_netif_lat_hists    lat_hist CI_ALIGN(CI_CACHE_LINE_SIZE);
 
 #define OO_INTF_I_SEND_VIA_OS   CI_CFG_MAX_INTERFACES
 #define OO_INTF_I_LOOPBACK      (CI_CFG_MAX_INTERFACES+1)
@@ -1374,6 +1474,9 @@ struct ci_netif_state_s {
   CI_ULCONST ci_uint32  packet_alloc_numa_nodes;
   CI_ULCONST ci_uint32  sock_alloc_numa_nodes;
   CI_ULCONST ci_uint32  interrupt_numa_nodes;
+  /* Preferred NUMA node for packet buffers: local to the NIC, or to the
+   * interrupt core if the NIC's node is not known.  -1 if neither is. */
+  CI_ULCONST ci_int32   pkt_numa_node;
 
 #if CI_CFG_FD_CACHING
   ci_socket_cache_t     active_cache;
@@ -1396,6 +1499,15 @@ struct ci_netif_state_s {
   /* Number of entries in the table of previously-used sequence numbers. */
   CI_ULCONST ci_uint32  seq_table_entries_n;
 
+  /* Number of entries in the table of compacted TIME_WAIT connections. */
+  CI_ULCONST ci_uint32  timewait_table_entries_n;
+  /* Times of the last ACKs sent on behalf of the timewait table in reply
+   * to unexpected segments.  The entries are too small to hold one each,
+   * so those whose index in the table is the same modulo
+   * CI_TCP_TIMEWAIT_ACK_BUCKETS share a ci_tcp_ack_ratelimit() budget. */
+  ci_iptime_t           timewait_t_last_invalid_ack
+                                          [CI_TCP_TIMEWAIT_ACK_BUCKETS];
+
   CI_ULCONST ci_uint16  rss_instance;
   CI_ULCONST ci_uint16  cluster_size;
 
@@ -1886,6 +1998,10 @@ struct ci_sock_cmn_s {
 #define CI_SOCK_AFLAG_NEED_ACK_BIT      10u
 #define CI_SOCK_AFLAG_SELECT_ERR_QUEUE  0x800
 #define CI_SOCK_AFLAG_SELECT_ERR_QUEUE_BIT 11u
+#define CI_SOCK_AFLAG_FASTOPEN_CONNECT  0x1000       /* TCP_FASTOPEN_CONNECT */
+#define CI_SOCK_AFLAG_FASTOPEN_CONNECT_BIT 12u
+#define CI_SOCK_AFLAG_ZEROCOPY          0x2000       /* SO_ZEROCOPY  */
+#define CI_SOCK_AFLAG_ZEROCOPY_BIT      13u
 
 
   /*! Which socket flags should be inherited by accepted connections? */
@@ -1896,7 +2012,7 @@ struct ci_sock_cmn_s {
    CI_SOCK_FLAG_AUTOFLOWLABEL_REQ | CI_SOCK_FLAG_AUTOFLOWLABEL_OPT |        \
    CI_SOCK_FLAG_IP6_PMTU_DO | CI_SOCK_FLAG_IP6_ALWAYS_DF)
 #define CI_SOCK_AFLAG_TCP_INHERITED \
-    (CI_SOCK_AFLAG_CORK | CI_SOCK_AFLAG_NODELAY)
+    (CI_SOCK_AFLAG_CORK | CI_SOCK_AFLAG_NODELAY | CI_SOCK_AFLAG_ZEROCOPY)
 
   /* Bound-to local address.
    * - s.laddr is the bound-to address, unmodified.  Used by the filters.
@@ -2212,6 +2328,10 @@ struct  ci_udp_state_s {
    * overflow queue) and not yet had TX event.
    */
   ci_uint32 tx_count;
+  /* Datagrams posted by senders with EF_TX_LOCK_DOMAINS that the stack lock
+   * holder has not yet added to the stats.  Manipulated atomically.
+   */
+  ci_uint32 tx_direct_count;
 
   /* Cache for IP_PKTINFO and IPV6_PKTINFO */
   struct {
@@ -2390,6 +2510,10 @@ typedef struct ci_sb_epoll_state_s {
 #define CI_EPOLL_SETS_PER_AUX_BUF 4
   oo_sb_epoll e[CI_EPOLL_SETS_PER_AUX_BUF];
   oo_sp       sock_id;
+  /* Bitmask of the ready rings that hold this socket (EF_EPOLL_READY_RING).
+   * Set by the stack lock holder and cleared by the ring's consumer, so
+   * only ever modified atomically. */
+  ci_uint32   ring_queued;
 } ci_sb_epoll_state;
 CI_BUILD_ASSERT(CI_CFG_N_READY_LISTS <= CI_EPOLL_SETS_PER_AUX_BUF);
 
@@ -2434,6 +2558,12 @@ typedef struct {
   ci_uint16            user_mss;            /* user-provided maximum MSS */
   ci_uint8             tcp_defer_accept;    /* TCP_DEFER_ACCEPT sockopt  */
 #define OO_TCP_DEFER_ACCEPT_OFF 0xff
+  ci_uint8             cong_algo;           /* TCP_CONGESTION sockopt    */
+  ci_uint32            fastopen_qlen;       /* TCP_FASTOPEN sockopt      */
+
+  /* SO_MAX_PACING_RATE in bytes per second.  Setting it enables pacing. */
+  ci_uint64            max_pacing_rate CI_ALIGN(8);
+#define CI_TCP_PACING_RATE_UNLIMITED  (~(ci_uint64) 0)
 
 } ci_tcp_socket_cmn;
 
@@ -2448,6 +2578,7 @@ struct oo_tcp_socket_stats {
 #if CI_CFG_BURST_CONTROL
   ci_uint32  tx_stop_burst;   /* TX stopped by burst control       */
 #endif
+  ci_uint32  tx_stop_pace;    /* TX stopped by pacing              */
   ci_uint32  tx_nomac_defer;  /* Deferred send waiting for ARP     */
   ci_uint32  tx_defer;        /* Deferred send to avoid lock contention */
   ci_uint32  tx_msg_warm_abort;/* Number of MSG_WARM aborted early */
@@ -2511,6 +2642,11 @@ struct ci_tcp_state_s {
    * EF_TCP_SERVER_LOOPBACK=2 mode */
 #define CI_TCPT_FLAG_LOOP_FAKE          0x20000
 
+  /* TCP Fast Open (RFC7413): the TFO option is carried on our SYN or
+   * SYN-ACK.  On an active open this means we are requesting a cookie or
+   * sending data in the SYN. */
+#define CI_TCPT_FLAG_FASTOPEN           0x40000
+
   /* Timer is running (rto timer is used) */
 #define CI_TCPT_FLAG_TAIL_DROP_TIMING   0x80000
   /* Probe sent */
@@ -2528,6 +2664,17 @@ struct ci_tcp_state_s {
    * because packet allocation failed.  Must send FIN, really. */
 #define CI_TCPT_FLAG_FIN_PENDING        0x800000
 
+  /* ECN (RFC3168): congestion was experienced by data from the peer, so
+   * set ECE on outgoing segments until the peer responds with CWR. */
+#define CI_TCPT_FLAG_ECN_ECE            0x1000000
+  /* ECN: cwnd has been reduced in response to ECE, so set CWR on the next
+   * new data segment. */
+#define CI_TCPT_FLAG_ECN_CWR            0x2000000
+
+  /* TCP Fast Open: connect() has completed without sending the SYN; it
+   * goes out together with the data from the first send call. */
+#define CI_TCPT_FLAG_FASTOPEN_DEFER     0x4000000
+
   /* flags advertised on SYN */
 # define CI_TCPT_SYN_FLAGS \
         (CI_TCPT_FLAG_WSCL | CI_TCPT_FLAG_TSO | CI_TCPT_FLAG_SACK)
@@ -2603,6 +2750,26 @@ struct ci_tcp_state_s {
                                        lock */
 #endif
 
+  /* MSG_ZEROCOPY completion notifications.  The data of these sends is
+   * copied like any other; only the notifications are provided.  Each
+   * MSG_ZEROCOPY send takes the next id from [next_id], without the stack
+   * lock, once its data has been queued.  Under the stack lock, ids from
+   * [queued] up to [next_id] are given the range that ends at
+   * tcp_enq_nxt; see ci_tcp_zc_record().  Sends below [acked] have been
+   * acknowledged by the peer, and those from [reported] up to [acked] are
+   * yet to be read from the error queue.  The oldest unacked send
+   * completes when snd_una passes [first_seq]; all later ones are merged
+   * and complete at [last_seq].  See ci_tcp_zc_ack(). */
+  struct {
+    ci_uint32          next_id;
+    ci_uint32          queued;
+    ci_uint32          acked;
+    ci_uint32          reported;
+    ci_uint32          first_id;
+    ci_uint32          first_seq;
+    ci_uint32          last_seq;
+  } zc;
+
   /* Next field is needed to support PathMTU discovery functionality */
   ci_uint32            snd_check;   /* equal to snd_nxt at beginning of
                                        tested interval */
@@ -2670,7 +2837,26 @@ struct ci_tcp_state_s {
   ci_uint32            cwnd_extra;  /* adjustments when congested         */
   ci_uint32            ssthresh;    /* slow-start threshold               */
   ci_uint32            bytes_acked; /* bytes acked but not yet added to cwnd */
-  
+
+  /* Private state of the congestion control algorithm selected by
+   * [c.cong_algo].  See tcp_cong.c. */
+  union {
+    struct {
+      ci_uint32        w_max;       /* cwnd before the last reduction     */
+      ci_uint32        origin;      /* plateau of the current epoch       */
+      ci_uint32        w_est;       /* Reno-friendly cwnd estimate        */
+      ci_uint32        k_ms;        /* time to reach [origin], in ms      */
+      ci_iptime_t      epoch_start; /* start of the epoch, 0 if none      */
+    } cubic;
+    struct {
+      ci_uint32        alpha;       /* marked fraction, scaled by 2^10    */
+      ci_uint32        window_end;  /* snd_nxt at start of observation    */
+      ci_uint32        acked;       /* bytes acked in observation window  */
+      ci_uint32        acked_ece;   /* ...of which acked with ECE         */
+    } dctcp;
+  } cong;
+  ci_uint32            ecn_recover; /* snd_nxt at last ECN cwnd reduction */
+
 #if CI_CFG_TCP_FASTSTART  
   ci_uint32            faststart_acks; /* Bytes to ack before leaving faststart */
 #endif
@@ -2768,6 +2954,14 @@ struct ci_tcp_state_s {
   ci_ip_timer          stats_tid;   /* Statistics report timer            */
 #endif
   ci_ip_timer          cork_tid;    /* TCP timer for TCP_CORK/MSG_MORE   */
+  ci_ip_timer          pace_tid;    /* releases segments held by pacing  */
+  ci_ip_timer          coalesce_tid;/* earliest of the above, when
+                                     * EF_TCP_TIMER_COALESCE is enabled    */
+
+  /* Pacing: bytes that may be sent now, replenished at the pacing rate
+   * since [pace_stamp].  May be negative as whole segments are sent. */
+  ci_int32             pace_credit;
+  ci_iptime_t          pace_stamp;
 
 
 #if CI_CFG_TCP_SOCK_STATS
@@ -2830,6 +3024,8 @@ typedef struct {
   ci_uint32            n_syncookie_ack_ts_rej;
   ci_uint32            n_syncookie_ack_hash_rej;
   ci_uint32            n_syncookie_ack_answ;
+  ci_uint32            n_syncookie_flood;
+  ci_uint32            n_syncookie_synack_tmpl;
 #if CI_CFG_FD_CACHING
   ci_uint32            n_sockcache_hit;
 #endif
@@ -2837,18 +3033,58 @@ typedef struct {
 } ci_tcp_socket_listen_stats;
 
 
+/* Bytes of options in the SYN-ACK template: MSS, timestamps, window scale
+ * and SACK-permitted, in that order, padded to a dword. */
+#define CI_TCP_SYNCOOKIE_TMPL_OPTS  24
+
+/* SYN-ACK sent in answer to a SYN while the listener is using syncookies,
+ * for ci_tcp_syncookie_synack_send().  Fields that vary from one SYN-ACK
+ * to another are left zero.  The template is built for one advertised MSS
+ * and receive buffer size, and rebuilt when either changes.
+ */
+typedef struct {
+  ci_uint32            rcvbuf;
+  ci_uint16            amss;     /* zero until the template is built */
+  ci_uint8             rcv_wscl;
+  ci_uint8             flood;    /* answering SYNs with syncookies */
+  ci_uint8             hdr[sizeof(ci_tcp_hdr) + CI_TCP_SYNCOOKIE_TMPL_OPTS];
+} ci_tcp_syncookie_tmpl;
+
+
+#if CI_CFG_TCP_ACCEPT_SHARDS
+/* Per-thread accept queue (EF_TCP_ACCEPT_SHARDS).  The stack lock holder
+ * pushes connections onto [put] as for the listener's own accept queue.
+ * They are taken off by whichever thread sets [busy], which is normally
+ * the thread that claimed the shard by setting [owner] to its thread id.
+ * [n_in] and [n_out] only guide the choice of shard.
+ */
+typedef struct {
+  ci_int32             put;
+  oo_sp                get;
+  ci_uint32            n_in;
+  ci_uint32            n_out;
+  ci_uint32            owner;
+  ci_uint32            busy;
+} ci_tcp_acceptq_shard;
+#endif
+
+
 struct ci_tcp_socket_listen_s {
   ci_sock_cmn          s;
   ci_tcp_socket_cmn    c;
 
   /* Accept queue of established connections.  This is a concurrent fifo
-  ** (ie. reader and writer need not synchronise).
+  ** (ie. reader and writer need not synchronise).  [acceptq_n_in] and
+  ** [acceptq_n_out] also count connections on the shards.
   */
   ci_uint32            acceptq_max;
   ci_int32             acceptq_put;
   ci_uint32            acceptq_n_in;
   oo_sp                acceptq_get;
   ci_uint32            acceptq_n_out;
+#if CI_CFG_TCP_ACCEPT_SHARDS
+  ci_tcp_acceptq_shard acceptq_shards[CI_CFG_TCP_ACCEPT_SHARDS];
+#endif
 
   /* For each listening socket we have a list of SYNRECV buffs, one for each
    * SYN we've received for which there hasn't yet been an ACK.  i.e. on
@@ -2880,6 +3116,8 @@ struct ci_tcp_socket_listen_s {
   /* timer to poll the listen queue for retransmits */
   ci_ip_timer          listenq_tid;
 
+  ci_tcp_syncookie_tmpl syncookie_tmpl;
+
 #if CI_CFG_STATS_TCP_LISTEN
   ci_tcp_socket_listen_stats  stats;
 #endif
@@ -47,6 +47,64 @@ extern void ci_netif_stats_action(__NI_STRUCT__ *ni,
 
 #endif
 
+/**********************************************************************
+ * Latency histograms (EF_LATENCY_HIST)
+ */
+
+/* Index of the bucket counting [cycles]. */
+ci_inline unsigned ci_lat_hist_bucket(ci_uint64 cycles)
+{
+  unsigned order;
+
+  if( cycles < (1u << CI_LAT_HIST_SUB_BITS) )
+    return cycles;
+  order = 63 - __builtin_clzll(cycles);
+  if( order >= CI_LAT_HIST_MAX_ORDER )
+    return CI_LAT_HIST_BUCKETS - 1;
+  return ((order - CI_LAT_HIST_SUB_BITS + 1) << CI_LAT_HIST_SUB_BITS) +
+         ((cycles >> (order - CI_LAT_HIST_SUB_BITS)) &
+          ((1u << CI_LAT_HIST_SUB_BITS) - 1));
+}
+
+ci_inline void ci_lat_hist_add(volatile ci_uint64* p, ci_uint64 v)
+{
+  ci_uint64 old;
+  do
+    old = *p;
+  while( ci_cas64u_fail(p, old, old + v) );
+}
+
+/* Samples may be recorded concurrently by any thread of any process
+ * sharing the stack, with or without the stack lock.
+ */
+ci_inline void ci_lat_hist_record(ci_lat_hist* h, ci_uint64 cycles)
+{
+  ci_uint64 max;
+
+  ci_lat_hist_add(&h->bucket[ci_lat_hist_bucket(cycles)], 1);
+  ci_lat_hist_add(&h->sum, cycles);
+  while( cycles > (max = h->max) && ci_cas64u_fail(&h->max, max, cycles) )
+    ;
+}
+
+#define CI_LAT_HIST_RECORD(ni, name, cycles)                    \
+  ci_lat_hist_record(&(ni)->state->lat_hist.name, (cycles))
+
+#ifndef __KERNEL__
+/* Percentiles are given in millionths.  Results are in cycles, rounded up
+ * to the top of the bucket (but no higher than the maximum recorded).
+ */
+extern ci_uint64 ci_lat_hist_bucket_min(unsigned bucket) CI_HF;
+extern ci_uint64 ci_lat_hist_count(const ci_lat_hist* h) CI_HF;
+extern ci_uint64 ci_lat_hist_percentile(const ci_lat_hist* h, ci_uint64 count,
+                                        unsigned ppm) CI_HF;
+
+/* Hooks for timing socket lock hold times in the calling thread. */
+extern void ci_sock_lock_hist_start(void) CI_HF;
+extern void ci_sock_lock_hist_end(__NI_STRUCT__* ni) CI_HF;
+#endif
+
+
 /* Clear ci_ip_stats structure */
 ci_inline void
 ci_ip_stats_clear(ci_ip_stats *stats)
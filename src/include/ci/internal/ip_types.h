@@ -67,9 +67,38 @@ typedef char* ci_pkt_bufs;
 #endif
 
 #ifndef __KERNEL__
+/* Per-process state for EF_SPIN_ADAPTIVE, kept for each socket and each
+ * epoll set. */
+struct oo_spin_adapt {
+  /* Moving average of recent waits for readiness, in cycles. */
+  ci_uint64 wait_avg;
+  /* Consecutive waits for which spinning was skipped. */
+  ci_uint32 skips;
+};
+
 struct ci_extra_ep {
   /* stores the current process cached FD to the endpoint or CI_FD_BAD */
   ci_fd_t fd;
+  struct oo_spin_adapt spin_adapt;
+};
+
+/* Per-thread cache of packet buffers taken from a stack's nonb pool
+ * (EF_TX_PKT_MAGAZINE).  Cached buffers keep CI_PKT_FLAG_NONB_POOL and
+ * are counted in [n_async_pkts], just as in the pool itself.
+ */
+#define OO_PKT_MAGAZINE_MAX  64
+
+struct oo_pkt_magazine {
+  /* Stack that the cached buffers belong to, or NULL. */
+  struct ci_netif_s*       ni;
+  int                      n;
+  /* Buffers handed out since [pkt_mag_hits] was last updated. */
+  ci_uint32                hits;
+  /* Linkage in the list of all threads' magazines; [pprev] is NULL when
+   * not in the list. */
+  struct oo_pkt_magazine*  next;
+  struct oo_pkt_magazine** pprev;
+  oo_pkt_p                 pkts[OO_PKT_MAGAZINE_MAX];
 };
 #endif
 
@@ -181,6 +210,7 @@ struct ci_netif_s {
   struct oo_p_dllink* active_wild_table;
 #endif
   ci_tcp_prev_seq_t*   seq_table;
+  ci_tcp_timewait_t*   timewait_table;
 
   struct oo_deferred_pkt* deferred_pkts;
 
@@ -318,6 +348,9 @@ struct ci_netif_s {
 #define S_TO_EPS(ni,s) ID_TO_EPS(ni,S_ID(s))
 #define SC_TO_EPS(ni,s) ID_TO_EPS(ni,SC_ID(s))
   struct ci_extra_ep* eps;
+
+  /* When this process took the stack lock, if EF_LATENCY_HIST is set. */
+  ci_uint64           lock_frc;
 #endif
 };
 
@@ -370,10 +403,21 @@ typedef struct ci_udp_iomsg_args {
 #endif
 } ci_udp_iomsg_args;
 
+/* Maximum number of TCP packets held back for delivery by EF_RX_BATCH. */
+#define CI_NETIF_RX_BATCH_MAX  32
+
 struct ci_netif_poll_state {
   oo_pkt_p  tx_pkt_free_list;
   oo_pkt_p* tx_pkt_free_list_insert;
   int       tx_pkt_free_list_n;
+  /* IPv4 TCP packets awaiting delivery at the end of the event burst */
+  int       rx_batch_n;
+  oo_pkt_p  rx_batch[CI_NETIF_RX_BATCH_MAX];
+  /* Syncookie hashes of the ACKs in the burst being delivered, see
+   * ci_tcp_syncookie_ack_batch() */
+  int       syncookie_n;
+  oo_pkt_p  syncookie_pkt[CI_NETIF_RX_BATCH_MAX];
+  ci_uint32 syncookie_hash[CI_NETIF_RX_BATCH_MAX];
 };
 
 
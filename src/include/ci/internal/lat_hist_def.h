@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/**************************************************************************\
+*//*! \file
+** <L5_PRIVATE L5_HEADER >
+**  \brief  Definition of stack latency histograms
+** </L5_PRIVATE>
+*//*
+\**************************************************************************/
+
+/*
+ * OO_LAT_HIST(name, description)
+ *
+ * Each histogram is recorded only when EF_LATENCY_HIST is enabled.
+ */
+
+OO_LAT_HIST(poll_deliver,
+            "Time from taking a burst of events from an event queue to "
+            "the end of delivering the received packets to their sockets.")
+OO_LAT_HIST(send_doorbell,
+            "Time from entry to ci_tcp_sendmsg() to ringing the NIC's "
+            "doorbell, for sends that fit in the send queue and are not "
+            "held back by Nagle's algorithm.")
+OO_LAT_HIST(netif_lock,
+            "Time for which the stack lock is held by user-level code.")
+OO_LAT_HIST(sock_lock,
+            "Time for which a socket lock is held by user-level code.")
+OO_LAT_HIST(spin,
+            "Time spent spinning in recv() for data before giving up and "
+            "sleeping or returning EAGAIN.")
@@ -11,5 +11,6 @@
 #define OO_VI_FLAGS_TX_CTPIO_ONLY 0x40
 #define OO_VI_FLAGS_RX_SHARED 0x80
 #define OO_VI_FLAGS_HW_MULTICAST_REPLICATION 0x100
+#define OO_VI_FLAGS_AF_XDP_BUSY_POLL 0x200
 
 #endif /* __CI_INTERNAL_OO_VI_FLAGS_H__ */
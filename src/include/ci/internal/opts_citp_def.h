@@ -83,6 +83,20 @@ CI_CFG_OPT("EF_POLL_FAST", ul_poll_fast, ci_uint32,
 "practice a vast majority of applications work fine with this option.",
            1, , 1, 0, 1, yesno)
 
+CI_CFG_OPT("EF_URING", ul_uring, ci_uint32,
+"Clear to disable acceleration of io_uring requests at user-level.  When "
+"set, SEND, RECV, ACCEPT and single-shot POLL_ADD requests submitted "
+"through io_uring_enter() against accelerated sockets are serviced by "
+"Onload, and their completions are posted to the ring with "
+"IORING_OP_MSG_RING.  Rings created with SQPOLL, IOPOLL, DEFER_TASKRUN or "
+"large SQE/CQE formats, and requests that are linked, use fixed files or "
+"provided buffers, are left to the kernel.  Requires Linux 5.18 or later.  "
+"Only io_uring_setup() and io_uring_enter() calls made through libc's "
+"syscall() are intercepted; liburing issues these system calls directly by "
+"default, so it must be built to use libc (e.g. configured with "
+"--use-libc) for its rings to be accelerated.",
+           1, , 1, 0, 1, yesno)
+
 #define CITP_EPOLL_KERNEL        0
 #define CITP_EPOLL_UL            1
 #define CITP_EPOLL_KERNEL_ACCEL  2
@@ -155,6 +169,32 @@ CI_CFG_OPT("EF_EPOLL_MT_SAFE", ul_epoll_mt_safe, ci_uint32,
 "EF_UL_EPOLL=2 and EF_EPOLL_CTL_FAST=1.",
            1, , 0, 0, 1, yesno)
 
+CI_CFG_OPT("EF_EPOLL_POLL_STACKS", ul_epoll_poll_stacks, ci_uint32,
+"Have each accelerated epoll set poll the Onload stacks of its member "
+"sockets itself, for up to this many stacks per set.  epoll_wait() takes "
+"turns polling each stack, so that no stack is starved when a set's "
+"sockets span several stacks.  The home stack (EF_UL_EPOLL=3) gets "
+"EF_EPOLL_HOME_WEIGHT turns per round, and the others one each.  "
+"EF_EPOLL_POLL_BUDGET_USEC limits the time spent polling stacks in each "
+"pass over the set; the next pass resumes with the next stack in turn.  "
+"An epoll set keeps a reference to each stack it polls until it is closed."
+"\n"
+"0 disables this feature, and stacks are polled on behalf of each member "
+"socket as it is checked.",
+           4, , 0, 0, 8, count)
+
+CI_CFG_OPT("EF_EPOLL_HOME_WEIGHT", ul_epoll_home_weight, ci_uint32,
+"With EF_EPOLL_POLL_STACKS, the number of turns the home stack of an epoll "
+"set gets in each round of polling, relative to one turn for each other "
+"stack.",
+           8, , 2, 1, 16, count)
+
+CI_CFG_OPT("EF_EPOLL_POLL_BUDGET_USEC", ul_epoll_poll_budget_usec, ci_uint32,
+"With EF_EPOLL_POLL_STACKS, the time in microseconds that epoll_wait() "
+"may spend polling stacks in each pass over the epoll set.  At least one "
+"stack is always polled.  0 means no limit.",
+           , , 10, MIN, MAX, time:usec)
+
 CI_CFG_OPT("EF_WODA_SINGLE_INTERFACE", woda_single_if, ci_uint32,
 "This option alters the behaviour of onload_ordered_epoll_wait().  This "
 "function would normally ensure correct ordering across multiple interfaces. "
@@ -495,6 +535,18 @@ CI_CFG_OPT("EF_SLEEP_SPIN_USEC", sleep_spin_usec, ci_uint32,
 OO_SPIN_BLURB,
            , , 0, MIN, MAX, time:usec)
 
+CI_CFG_OPT("EF_SPIN_ADAPTIVE", ul_spin_adaptive, ci_uint32,
+"When enabled, Onload keeps a moving average of how long recent blocking "
+"receive calls on each socket, and epoll_wait() calls on each epoll set, "
+"have waited for data.  If it is longer than the spin timeout, the next "
+"wait blocks straight away instead of spinning first, so that mostly idle "
+"threads do not burn CPU time.  Every 16th such wait spins anyway, to "
+"notice when traffic picks up.  Applies to TCP and UDP recv() and to "
+"epoll_wait() with EF_UL_EPOLL=1.  The spin_adapt_* stack statistics "
+"report how often spinning succeeded, timed out or was skipped, and the "
+"CPU time saved.",
+           1, , 0, 0, 1, yesno)
+
 CI_CFG_OPT("EF_POLL_FAST_USEC", ul_poll_fast_usec, ci_uint32,
 "When spinning in a poll() call, causes accelerated sockets to be polled for N "
 "usecs before unaccelerated sockets are polled.  This reduces "
@@ -157,6 +157,15 @@ CI_CFG_OPT("EF_POLL_ON_DEMAND", poll_on_demand, ci_uint32,
 "events are (mostly) processed in response to interrupts.",
            1, , 1, 0, 1, yesno)
 
+CI_CFG_OPT("EF_EPOLL_READY_RING", epoll_ready_ring, ci_uint32,
+"When EF_UL_EPOLL=3, have the stack tell each epoll set which of its "
+"sockets have become ready through a ring in shared memory, rather than "
+"a list protected by the stack lock.  epoll_wait() then collects the "
+"ready sockets without taking the stack lock, so its cost depends on the "
+"number of events rather than the number of sockets in the set.  A socket "
+"that does not fit in the ring is put on the list as usual.",
+           1, , 0, 0, 1, yesno)
+
 CI_CFG_OPT("EF_INT_DRIVEN", int_driven, ci_uint32,
 "Put the stack into an 'interrupt driven' mode of operation.  When this "
 "option is not enabled Onload uses heuristics to decide when to enable "
@@ -292,6 +301,17 @@ CI_CFG_OPT("EF_UDP_SEND_UNLOCKED", udp_send_unlocked, ci_uint32,
 "concurrency when multiple threads are performing UDP sends.",
            1, , 1, 0, 1, yesno)
 
+CI_CFG_OPT("EF_TX_LOCK_DOMAINS", tx_lock_domains, ci_uint32,
+"Gives each interface its own TX lock, separate from the stack lock.  When "
+"enabled, a thread doing a UDP send on a connected socket while another "
+"thread holds the stack lock (for example to poll the event queue) posts "
+"the datagram straight to the interface's TX ring instead of deferring it "
+"to the lock holder.  Only plain DMA sends are made this way: PIO, CTPIO, "
+"timestamping, multicast and tcpdump all fall back to the deferred path.  "
+"The stack lock holder takes the TX lock for the short periods in which it "
+"touches the TX ring, so this adds a small cost to every send and poll.",
+           1, , 0, 0, 1, yesno)
+
 CI_CFG_OPT("EF_UNCONFINE_SYN", unconfine_syn, ci_uint32,
 "Accept TCP connections that cross into or out-of a private network.",
            1, , 1, 0, 1, yesno)
@@ -450,6 +470,20 @@ CI_CFG_OPT("EF_TCP_COMBINE_SENDS_MODE", tcp_combine_sends_mode, ci_uint32,
            "explicit need to avoid combined or split sends.",
            1, , 0, 0, 1, yesno)
 
+CI_CFG_OPT("EF_TCP_RX_COALESCE", tcp_rx_coalesce, ci_uint32,
+           "When enabled, an in-order TCP segment whose payload fits in the "
+           "last packet buffer on the socket's receive queue is copied "
+           "there, and its own buffer is freed straight away.  Data already "
+           "read from that buffer is discarded to make room, so full-sized "
+           "segments are combined when the application keeps up with the "
+           "stream.  This reduces the number of packet buffers held by "
+           "receiving sockets, and lets recv() copy larger contiguous runs "
+           "of small segments.  Segments are only combined "
+           "when the socket is not locked by a concurrent receive, and "
+           "never on sockets that request receive timestamps.  The "
+           "tcp_rx_coalesce_* counters report how much was combined.",
+           1, , 0, 0, 1, yesno)
+
 CI_CFG_OPT("EF_TCP_SOCKBUF_MAX_FRACTION", tcp_sockbuf_max_fraction, ci_uint32,
            "This option controls the maximum fraction of the TX buffers "
            "that may be allocated to a single socket with EF_TCP_SNDBUF_MODE=2.  "
@@ -461,7 +495,10 @@ CI_CFG_OPT("EF_TCP_SOCKBUF_MAX_FRACTION", tcp_sockbuf_max_fraction, ci_uint32,
            4, , 1, 1, 10, count)
 
 CI_CFG_OPT("EF_TCP_SYNCOOKIES", tcp_syncookies, ci_uint32,
-"Use TCP syncookies to protect from SYN flood attack",
+"Use TCP syncookies to protect from SYN flood attack.  While a listening "
+"socket's listen queue is full, SYNs are answered with SYN-ACKs built from "
+"a template kept by the socket, without keeping any state.  With "
+"EF_RX_BATCH, the syncookies of the ACKs in a burst are checked together.",
            1, , 0, 0, 1, yesno)
 
 CI_CFG_OPT("EF_TCP_SEND_NONBLOCK_NO_PACKETS_MODE", 
@@ -631,6 +668,28 @@ CI_CFG_OPT("EF_COMPOUND_PAGES_MODE", compound_pages, ci_uint32,
 "  2 - do not use compound pages at all.\n",
           2, , 0, 0, 2, oneof:always;small;never)
 
+CI_CFG_OPT("EF_TX_PKT_MAGAZINE", tx_pkt_magazine, ci_uint32,
+"Number of packet buffers that each thread may cache for sending without "
+"the stack lock.  When a thread sends without the stack lock it normally "
+"takes each packet buffer from a pool shared by all threads (the nonb "
+"pool).  With this option, a thread takes up to this many buffers from the "
+"pool at once and then uses them without touching shared state.  This "
+"reduces contention when many threads send through a shared stack.\n"
+"Cached buffers are not available to other threads.  They are returned "
+"when the thread exits, forks or starts sending through another stack.  0 "
+"(the default) disables the cache.",
+          8, , 0, 0, 64, count)
+
+CI_CFG_OPT("EF_PACKET_NUMA_LOCAL", packet_numa_local, ci_uint32,
+"Keep packet buffers on the NUMA node local to the stack's NICs.  When "
+"enabled, new packet sets are allocated on the NIC's node (or on the node of "
+"EF_IRQ_CORE if the NIC's node is not known), and packets are taken from "
+"sets on that node in preference to sets on other nodes.\n"
+"Huge-page-backed sets are placed according to the NUMA policy of the "
+"allocating thread.\n"
+"onload_stackdump shows the node of each packet set and usage per node.",
+          1, , 0, 0, 1, yesno)
+
 #if CI_CFG_PIO
 CI_CFG_OPT("EF_PIO", pio, ci_uint32,
 "Control of whether Programmed I/O is used instead of DMA for small packets:\n"
@@ -694,8 +753,9 @@ CI_CFG_OPT("EF_TCP_SYN_OPTS", syn_opts, ci_uint32,
 "bit 0 (0x1) is set to 1 to enable PAWS and RTTM timestamps (RFC1323),\n"
 "bit 1 (0x2) is set to 1 to enable window scaling (RFC1323),\n"
 "bit 2 (0x4) is set to 1 to enable SACK (RFC2018),\n"
-"bit 3 (0x8) is set to 1 to enable ECN (RFC3128).\n"
-"The values from /proc/sys/net/ipv4/tcp_{sack,timestamp,window_scaling} "
+"bit 3 (0x8) is set to 1 to enable ECN (RFC3168), both on outgoing "
+"connections and when requested by the peer on incoming connections.\n"
+"The values from /proc/sys/net/ipv4/tcp_{sack,timestamp,window_scaling,ecn} "
 "are used to find the default.",
            4, , CI_TCPT_SYN_FLAGS, MIN, MAX, bitmask)
 
@@ -710,6 +770,25 @@ CI_CFG_OPT("EF_TCP_TCONST_MSL", msl_seconds, ci_uint32,
 "causes connections to spend less time in the TIME_WAIT state.",
            8, , CI_CFG_TCP_TCONST_MSL, MIN, MAX, time:sec)
 
+CI_CFG_OPT("EF_TCP_TIMEWAIT_TABLE", tcp_timewait_table, ci_uint32,
+"Number of entries in a table of compact records for TCP connections in "
+"the TIME_WAIT state.  When non-zero, an IPv4 connection in TIME_WAIT "
+"is moved into this table once its socket has been closed, and its "
+"endpoint is freed straight away, rather than being held until "
+"EF_TCP_TCONST_MSL expires.  "
+"The table answers retransmitted FINs and other segments from the peer, "
+"and allows the four-tuple to be reused as it would be for a socket in "
+"TIME_WAIT.  Answers to unexpected segments are limited as set by "
+"EF_INVALID_ACK_RATELIMIT, but the limit is shared by the entries in each of "
+"64 buckets rather than kept per connection.  "
+"Each entry uses 32 bytes, and the size is rounded up to a "
+"power of two.  When the table is full the oldest entries are "
+"overwritten.\n"
+"Connections that use their own hardware filter, loopback connections "
+"and IPv6 connections keep their endpoint in TIME_WAIT as before.\n"
+"The default of 0 disables the table.",
+           , , 0, MIN, CI_CFG_NETIF_MAX_ENDPOINTS_MAX, count)
+
 CI_CFG_OPT("EF_TCP_FIN_TIMEOUT", fin_timeout, ci_uint32,
 "Time in seconds to wait for an orphaned connection to be closed properly "
 "by the network partner (e.g. FIN in the TCP FIN_WAIT2 state; zero window "
@@ -816,6 +895,14 @@ CI_CFG_OPT("EF_UDP_SEND_UNLOCK_THRESH", udp_send_unlock_thresh, ci_uint16,
 "increase lock contention in multi-threaded applications.",
            , , 1500, MIN, MAX, count)
 
+CI_CFG_OPT("EF_UDP_SENDMMSG_BATCH", udp_sendmmsg_batch, ci_uint32,
+"When enabled, sendmmsg() on a UDP socket builds all of the datagrams "
+"before posting any of them to the NIC, so that the whole call costs one "
+"doorbell per interface rather than one per datagram.  The first datagram "
+"of a call is not sent until the last has been built, so this trades a "
+"little latency for message rate.",
+           1, , 0, 0, 1, yesno)
+
 CI_CFG_OPT("EF_UDP_PORT_HANDOVER_MIN", udp_port_handover_min, ci_uint16,
 "When set (together with EF_UDP_PORT_HANDOVER_MAX), this causes UDP sockets "
 "explicitly bound to a port in the given range to be handed over to the "
@@ -904,6 +991,16 @@ CI_CFG_OPT("EF_ACCEPTQ_MAX_BACKLOG", acceptq_max_backlog, ci_uint32,
 "size). The value from /proc/sys/core/somaxconn is used by default.",
            , , SOMAXCONN, MIN, MAX, count)
 
+CI_CFG_OPT("EF_TCP_ACCEPT_SHARDS", tcp_accept_shards, ci_uint32,
+"Gives each listening socket this many extra accept queues, for use by "
+"applications that call accept() on one socket from several threads.  Each "
+"thread that calls accept() claims one of the queues for itself, and "
+"established connections are queued on whichever claimed queue holds the "
+"fewest.  A thread takes connections from its own queue without locking "
+"the listening socket, and from the other queues when its own is empty.\n"
+"The default of 0 keeps a single accept queue per listening socket.",
+           , , 0, MIN, CI_CFG_TCP_ACCEPT_SHARDS, count)
+
 CI_CFG_OPT("EF_NONAGLE_INFLIGHT_MAX", nonagle_inflight_max, ci_uint16,
 "This option affects the behaviour of TCP sockets with the TCP_NODELAY socket "
 "option.  Nagle's algorithm is enabled when the number of packets in-flight "
@@ -972,6 +1069,26 @@ CI_CFG_OPT("EF_EVS_PER_POLL", evs_per_poll, ci_uint32,
 "value is 192, to increasing batching efficiency.",
            , , 64, 0, 0x7fffffff, level)
 
+CI_CFG_OPT("EF_RX_BATCH", rx_batch, ci_uint32,
+"When enabled, IPv4 TCP packets received in one burst of events are held "
+"back until the end of the burst, grouped by connection and delivered one "
+"connection at a time.  Each group needs a single software filter table "
+"lookup, and consecutive segments of a flow are processed while the socket "
+"is hot in cache.  Packets of different connections may be handled in a "
+"different order to that in which they arrived, but order within each "
+"connection is preserved.  The net_stats rx_batch_* counters report the "
+"distribution of burst and group sizes.",
+           1, , 0, 0, 1, yesno)
+
+CI_CFG_OPT("EF_LATENCY_HIST", lat_hist, ci_uint32,
+"When enabled, the stack records histograms of the time taken to deliver "
+"received packets to sockets after polling, the time from entry to a TCP "
+"send call to ringing the NIC's doorbell, the hold times of the stack and "
+"socket locks and the time spent spinning before sleeping.  Each sample "
+"costs a few timestamp reads and atomic updates of shared memory.  View "
+"the histograms with 'onload_stackdump histograms'.",
+           1, , 0, 0, 1, yesno)
+
 #if CI_CFG_PORT_STRIPING
 CI_CFG_OPT("EF_STRIPE_NETMASK", stripe_netmask_be32, ci_uint32,
 "Port striping is only negotiated with hosts whose IP address is on the same "
@@ -989,6 +1106,10 @@ CI_CFG_OPT("EF_SPIN_USEC", spin_usec, ci_uint32,
            "" /* documented in opts_citp_def.h */,
            ,  poll_cycles, 0, MIN, MAX, time:usec)
 
+CI_CFG_OPT("EF_SPIN_ADAPTIVE", spin_adaptive, ci_uint32,
+           "" /* documented in opts_citp_def.h */,
+           1, , 0, 0, 1, yesno)
+
 CI_CFG_OPT("EF_BUZZ_USEC", buzz_usec, ci_uint32,
 "Sets the timeout in microseconds for lock buzzing options.  Set to zero to "
 "disable lock buzzing (spinning).  Will buzz forever if set to -1.  Also set "
@@ -1096,6 +1217,18 @@ CI_CFG_OPT("EF_MAX_ENDPOINTS", max_ep_bufs, ci_uint32,
            , , CI_CFG_NETIF_MAX_ENDPOINTS, 4, CI_CFG_NETIF_MAX_ENDPOINTS_MAX,
            count)
 
+CI_CFG_OPT("EF_FILTER_TABLE_CUCKOO", filter_table_cuckoo, ci_uint32,
+"Selects the layout of the IPv4 software filter table that demultiplexes "
+"received packets to sockets.  When disabled, the table uses open addressing "
+"with double hashing, in which long probe chains and tombstones can build up "
+"in stacks with heavy connection churn.\n"
+"When enabled, the table is organised as cache-line sized buckets using "
+"bucketized cuckoo hashing.  Each socket filter can live in one of two "
+"buckets, and lookups usually touch just one cache line regardless of the "
+"history of the table.  In this mode at most 14 filters may share an "
+"identical address, port and protocol tuple.",
+           1, , 0, 0, 1, yesno)
+
 
 CI_CFG_OPT("EF_ENDPOINT_PACKET_RESERVE", endpoint_packet_reserve, ci_uint16,
 "This option enables reservation of packets per endpoint.  No other endpoints"
@@ -1287,6 +1420,66 @@ CI_CFG_OPT("EF_TCP_FASTSTART_LOSS", tcp_faststart_loss, ci_uint32,
            ,  , 64*1024, 0, MAX, count)
 #endif
 
+#define EF_TCP_CONG_ALGO_RENO  0
+#define EF_TCP_CONG_ALGO_CUBIC 1
+#define EF_TCP_CONG_ALGO_DCTCP 2
+CI_CFG_OPT("EF_TCP_CONG_ALGO", tcp_cong_algo, ci_uint32,
+"Selects the default TCP congestion control algorithm for sockets in this "
+"stack.  Applications may override it per socket with the TCP_CONGESTION "
+"socket option.\n"
+"reno  - NewReno with Appropriate Byte Counting (RFC 3465).\n"
+"cubic - CUBIC (RFC 9438), better suited to long fat networks.\n"
+"dctcp - Data Center TCP (RFC 8257).  Reacts to the extent of ECN marking "
+"and so is only useful when ECN is negotiated with the peer.",
+           2, , EF_TCP_CONG_ALGO_RENO, 0, 2, oneof:reno;cubic;dctcp)
+
+CI_CFG_OPT("EF_TCP_PACING", tcp_pacing, ci_uint32,
+"Enables pacing for all TCP sockets in this stack.  Rather than sending "
+"whatever the congestion window allows in one burst, segments are spread "
+"over the round trip at a rate derived from the congestion window and the "
+"smoothed RTT: 200% of cwnd/srtt in slow start and 120% afterwards.  "
+"Segments held back are released from the send queue by a timer, so the "
+"smoothing achieved is limited by the timer granularity of about 1ms.\n"
+"Sockets on which SO_MAX_PACING_RATE has been set are always paced, and "
+"never faster than the rate given.",
+           1, , 0, 0, 1, yesno)
+
+#define EF_TCP_FASTOPEN_CLIENT          0x1
+#define EF_TCP_FASTOPEN_SERVER          0x2
+#define EF_TCP_FASTOPEN_SERVER_NO_QLEN  0x400
+CI_CFG_OPT("EF_TCP_FASTOPEN", tcp_fastopen, ci_uint32,
+"Enables TCP Fast Open (RFC 7413), which lets data be carried on the SYN of "
+"a connection to a server that has handed out a cookie on an earlier "
+"connection.  This is a bit mask with the same meaning as "
+"/proc/sys/net/ipv4/tcp_fastopen, from which the default is taken:\n"
+"  0x1   - client: send data in the SYN when MSG_FASTOPEN or "
+"TCP_FASTOPEN_CONNECT is used and a cookie is cached for the server;\n"
+"  0x2   - server: accept data in the SYN on listening sockets with the "
+"TCP_FASTOPEN socket option set;\n"
+"  0x400 - server: as 0x2, without the TCP_FASTOPEN socket option.\n"
+"Clients request a cookie with a plain SYN the first time they connect to a "
+"server.",
+           , , 1, 0, MAX, bitmask)
+
+CI_CFG_OPT("EF_TCP_TIMER_COALESCE", tcp_timer_coalesce, ci_uint32,
+"Keep a single entry in the timer wheel for each TCP socket, set to the "
+"earliest deadline of the socket's retransmit, delayed ACK, zero window, "
+"keepalive, cork and pacing timers, rather than one entry per timer.  "
+"This reduces the work done by the timer wheel in stacks with very large "
+"numbers of connections.  Clearing a timer is lazy: the socket's entry may "
+"fire early and is then rearmed for the next deadline.",
+           1, , 0, 0, 1, yesno)
+
+CI_CFG_OPT("EF_TIMER_CASCADE_BUDGET", timer_cascade_budget, ci_uint32,
+"Limits the number of timers moved between the levels of the timer wheel "
+"in each poll of the stack.  When a bucket of a coarse-grained wheel comes "
+"due its timers are moved to a holding list, and at most this many of "
+"them are redistributed to the finer-grained wheels per poll, so that a "
+"large bucket does not stall the polling thread.  Timers that become due "
+"while still on the holding list fire in a later poll.\n"
+"0 means no limit: whole buckets are cascaded at once.",
+           , , 0, 0, MAX, count)
+
 CI_CFG_OPT("EF_TCP_EARLY_RETRANSMIT", tcp_early_retransmit, ci_uint32,
 "Enables the Early Retransmit (RFC 5827) algorithm for TCP, and also the "
 "Limited Transmit (RFC 3042) algorithm, on which Early Retransmit depends.\n"
@@ -1740,6 +1933,21 @@ CI_CFG_OPT("EF_AF_XDP_ZEROCOPY", af_xdp_zerocopy, ci_uint32,
 "Enables zerocopy on AF_XDP NICs. Support for zerocopy is required. ",
            1, , 0, 0, 1, yesno)
 
+CI_CFG_OPT("EF_AF_XDP_BUSY_POLL", af_xdp_busy_poll, ci_uint32,
+"When non-zero, AF_XDP sockets are set up with SO_PREFER_BUSY_POLL and "
+"SO_BUSY_POLL set to this many microseconds, and each poll of the stack "
+"that finds no events asks the kernel to run the interface's NAPI context "
+"at once, rather than waiting for an interrupt to schedule it.  This costs "
+"a system call per idle poll.  Values above the net.core.busy_read sysctl "
+"need CAP_NET_ADMIN; if the kernel refuses, a warning is logged and the "
+"option has no effect.  Requires Linux 5.11 or later.",
+           , , 0, MIN, MAX, time:usec)
+
+CI_CFG_OPT("EF_AF_XDP_BUSY_POLL_BUDGET", af_xdp_busy_poll_budget, ci_uint32,
+"Maximum number of packets the kernel handles in each busy poll of an "
+"AF_XDP interface (SO_BUSY_POLL_BUDGET).  See EF_AF_XDP_BUSY_POLL.",
+           , , 64, 1, 65535, count)
+
 CI_CFG_OPT("EF_ICMP_PKTS", icmp_msg_max, ci_uint32,
            "Maximum number of ICMP messages which can be queued to "
            "one Onload stack.",
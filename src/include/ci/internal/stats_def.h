@@ -51,6 +51,9 @@ OO_STAT("Number of times event queue was polled from user-level.",
         ci_uint32, u_polls, count)
 OO_STAT("Number of times event queue was polled from user-level with ioctl.",
         ci_uint32, ioctl_evq_polls, count)
+OO_STAT("Number of times an idle poll asked the kernel to busy poll an "
+        "AF_XDP interface (EF_AF_XDP_BUSY_POLL).",
+        ci_uint32, af_xdp_busy_polls, count)
 OO_STAT("Number of RX events handled.  Not always 1:1 with number of "
         "packets received, an event can cover a batch of packets in "
         "high-throughput mode.",
@@ -58,6 +61,36 @@ OO_STAT("Number of RX events handled.  Not always 1:1 with number of "
 OO_STAT("Number of TX events handled.  Not always 1:1 with number of "
         "packets sent - batching is done at higher rates.",
         ci_uint32, tx_evs, count)
+OO_STAT("Number of bursts of 1 TCP packet delivered with EF_RX_BATCH.",
+        ci_uint32, rx_batch_size_1, count)
+OO_STAT("Number of bursts of 2-3 TCP packets delivered with EF_RX_BATCH.",
+        ci_uint32, rx_batch_size_2_3, count)
+OO_STAT("Number of bursts of 4-7 TCP packets delivered with EF_RX_BATCH.",
+        ci_uint32, rx_batch_size_4_7, count)
+OO_STAT("Number of bursts of 8-15 TCP packets delivered with EF_RX_BATCH.",
+        ci_uint32, rx_batch_size_8_15, count)
+OO_STAT("Number of bursts of 16 or more TCP packets delivered with "
+        "EF_RX_BATCH.",
+        ci_uint32, rx_batch_size_16_plus, count)
+OO_STAT("Number of groups of 1 packet of the same connection delivered "
+        "with EF_RX_BATCH.",
+        ci_uint32, rx_batch_group_1, count)
+OO_STAT("Number of groups of 2-3 packets of the same connection delivered "
+        "with EF_RX_BATCH.",
+        ci_uint32, rx_batch_group_2_3, count)
+OO_STAT("Number of groups of 4-7 packets of the same connection delivered "
+        "with EF_RX_BATCH.",
+        ci_uint32, rx_batch_group_4_7, count)
+OO_STAT("Number of groups of 8-15 packets of the same connection delivered "
+        "with EF_RX_BATCH.",
+        ci_uint32, rx_batch_group_8_15, count)
+OO_STAT("Number of groups of 16 or more packets of the same connection "
+        "delivered with EF_RX_BATCH.",
+        ci_uint32, rx_batch_group_16_plus, count)
+OO_STAT("Number of packets in EF_RX_BATCH groups that could not reuse the "
+        "socket found for the first packet of the group, and so were "
+        "looked up individually.",
+        ci_uint32, rx_batch_fallback, count)
 OO_STAT("Number of times periodic timer has polled for events.  Indicates "
         "your application has not made accelerated calls for a long period.",
         ci_uint32, periodic_polls, count)
@@ -140,6 +173,21 @@ OO_STAT("Times a thread has blocked on a single socket.",
         ci_uint32, sock_sleeps, count)
 OO_STAT("Times a thread has enabled interrupts before blocking on a socket.",
         ci_uint32, sock_sleep_primes, count)
+OO_STAT("Waits with EF_SPIN_ADAPTIVE in which the socket or epoll set "
+        "became ready while spinning.",
+        ci_uint32, spin_adapt_hits, count)
+OO_STAT("Waits with EF_SPIN_ADAPTIVE that spun until the spin timeout and "
+        "then blocked.",
+        ci_uint32, spin_adapt_misses, count)
+OO_STAT("Waits with EF_SPIN_ADAPTIVE that blocked without spinning because "
+        "recent waits on the socket or epoll set were longer than the spin "
+        "timeout.",
+        ci_uint32, spin_adapt_skips, count)
+OO_STAT("Estimated CPU time, in microseconds, not spent spinning because "
+        "EF_SPIN_ADAPTIVE skipped a spin.  This is the time that would "
+        "have been spent spinning until the wait ended or the spin timeout "
+        "expired.",
+        ci_uint64, spin_adapt_saved_usec, count)
 OO_STAT("Times Onload has woken threads waiting on a socket for receive.",
         ci_uint32, sock_wakes_rx, count)
 OO_STAT("Times Onload has woken threads waiting on a socket for transmit.",
@@ -154,6 +202,12 @@ OO_STAT("Times Onload has potentially sent a signal due to O_ASYNC.",
 OO_STAT("Number of huge pages allocated for packet sets.",
         ci_uint32, pkt_huge_pages, count)
 #endif
+OO_STAT("Number of packet sets allocated on a NUMA node other than the "
+        "stack's preferred one (see EF_PACKET_NUMA_LOCAL).",
+        ci_uint32, pkt_numa_remote_sets, count)
+OO_STAT("Times a packet set on a remote NUMA node was used because no set on "
+        "the preferred node had free packets (see EF_PACKET_NUMA_LOCAL).",
+        ci_uint32, pkt_numa_remote_picks, count)
 OO_STAT("Usually an indication of contention (and thus jitter) - the "
         "(slower, but threadsafe) nonb pool is used when a send is unable to "
         "take the stack lock.  But it has other uses too; "
@@ -163,6 +217,22 @@ OO_STAT("Indicates that we've reclaimed from the pkt_nonb (e.g. due to "
         "memory pressure; but may be just contention with the ring refill "
         "path).  Check for memory_pressure.",
         ci_uint32, pkt_nonb_steal, count)
+OO_STAT("Packet buffers taken from a thread's own cache without touching "
+        "the nonb pool (see EF_TX_PKT_MAGAZINE).  Published in batches, so "
+        "may lag slightly.",
+        ci_uint64, pkt_mag_hits, count)
+OO_STAT("Times a thread's packet buffer cache was empty and was refilled "
+        "from the nonb pool (see EF_TX_PKT_MAGAZINE).",
+        ci_uint32, pkt_mag_misses, count)
+OO_STAT("Times a thread's packet buffer cache could not be refilled because "
+        "the nonb pool was empty (see EF_TX_PKT_MAGAZINE).",
+        ci_uint32, pkt_mag_empty, count)
+OO_STAT("Times refilling a thread's packet buffer cache raced with another "
+        "thread and had to retry.  Indicates contention on the nonb pool.",
+        ci_uint32, pkt_mag_contends, count)
+OO_STAT("Times a thread returned its cached packet buffers to the nonb pool, "
+        "on switching stack, fork() or thread exit.",
+        ci_uint32, pkt_mag_flushes, count)
 OO_STAT("Times we've woken threads waiting for free packet buffers.  Can "
         "occur during memory_pressure.",
         ci_uint32, pkt_wakes, count)
@@ -437,6 +507,13 @@ OO_STAT("We received a SYN packet, but the accept queue was full, so we drop "
 OO_STAT("We received a SYN, but we don't have an accelerated outgoing route "
         "for the SYN-ACK.  So we drop the connection attempt.",
         ci_uint32, syn_drop_no_return_route, count)
+OO_STAT("Number of times a listening socket built the template it uses "
+        "for SYN-ACKs while answering SYNs with syncookies.",
+        ci_uint32, syncookie_tmpl_builds, count)
+OO_STAT("Number of ACKs whose would-be syncookie was hashed in a batch with "
+        "others from the same EF_RX_BATCH burst.  This includes ACKs on "
+        "established connections.",
+        ci_uint32, syncookie_ack_batched, count)
 OO_STAT("Number of times a LISTEN socket has started a new half-open socket"
         "(in the listen queue; the SYN-RECV state)",
         ci_uint32, listen2synrecv, count)
@@ -447,6 +524,12 @@ OO_STAT("Number of times accept() was accelerated.",
         ci_uint32, ul_accepts, count)
 OO_STAT("Number of times accept() returned EAGAIN.",
         ci_uint32, accept_eagain, count)
+OO_STAT("Connections taken by accept() from the calling thread's own accept "
+        "queue (EF_TCP_ACCEPT_SHARDS).",
+        ci_uint32, accept_shard_own, count)
+OO_STAT("Connections taken by accept() from another thread's accept queue "
+        "(EF_TCP_ACCEPT_SHARDS).",
+        ci_uint32, accept_shard_steals, count)
 OO_STAT("Number of failed aux-buffer allocations.",
         ci_uint32, aux_alloc_fails, count)
 OO_STAT("Number of failed bucket-aux-buffer allocations.",
@@ -569,6 +652,19 @@ OO_STAT("Indicates that you're sending faster than we can push packets on to "
         ci_uint32, tx_dma_max, val)
 OO_STAT("Number of TX DMA doorbells.",
         ci_uint32, tx_dma_doorbells, count)
+OO_STAT("UDP datagrams posted to the TX ring under the interface TX lock "
+        "while another thread held the stack lock (EF_TX_LOCK_DOMAINS).",
+        ci_uint32, udp_tx_direct, count)
+OO_STAT("UDP sends that found the stack lock busy but could not be posted "
+        "directly, and so were deferred to the lock holder "
+        "(EF_TX_LOCK_DOMAINS).",
+        ci_uint32, udp_tx_direct_fallbacks, count)
+OO_STAT("UDP datagrams queued by sendmmsg() to be posted to the NIC "
+        "together with the rest of the call (EF_UDP_SENDMMSG_BATCH).",
+        ci_uint32, udp_tx_batched, count)
+OO_STAT("Times a thread had to wait for an interface TX lock "
+        "(EF_TX_LOCK_DOMAINS).",
+        ci_uint32, tx_lock_contends, count)
 OO_STAT("Unable to allocate more packet buffers.  It's possible that this is "
         "transient; or due to needing memory in a context where allocating "
         "is forbidden.  It's also posisble we're about to enter "
@@ -781,6 +877,15 @@ OO_STAT("Number of times a socket could be added to a epoll set with "
         "You probably want to increase EF_MAX_ENDPOINTS if this count "
         "is non-zero.",
         ci_uint32, epoll_sb_state_alloc_failed, count)
+OO_STAT("Number of sockets queued on an epoll ready ring "
+        "(EF_EPOLL_READY_RING).",
+        ci_uint32, epoll_ring_pushes, count)
+OO_STAT("Number of sockets put on an epoll ready list because the ready "
+        "ring was full.",
+        ci_uint32, epoll_ring_overflows, count)
+OO_STAT("Number of times epoll_wait() stopped polling stacks after this one "
+        "because EF_EPOLL_POLL_BUDGET_USEC was used up.",
+        ci_uint32, epoll_poll_budget_stops, count)
 OO_STAT("Number of times that fd allocation failed for a socket in this stack.",
         ci_uint32, sock_attach_fd_alloc_fail, count)
 OO_STAT("Number of times that a socket has used a MAC filter.",
@@ -828,6 +933,66 @@ OO_STAT("Number of active-opened connections dropped with ECONNREFUSED error.  "
         "In most cases, this value is equal to tcp_connect_refused.",
         ci_uint32, tcp_connect_econnrefused, count)
 
+OO_STAT("Number of active-opened connections which negotiated ECN.",
+        ci_uint32, tcp_ecn_active, count)
+OO_STAT("Number of active-opened connections which requested ECN but the "
+        "peer did not agree, or the ECN-setup SYN had to be retransmitted.",
+        ci_uint32, tcp_ecn_active_refused, count)
+OO_STAT("Number of passive-opened connections which negotiated ECN.",
+        ci_uint32, tcp_ecn_passive, count)
+OO_STAT("Number of received segments marked Congestion Experienced.",
+        ci_uint32, tcp_ecn_ce_rx, count)
+OO_STAT("Number of received ACKs with ECE set.",
+        ci_uint32, tcp_ecn_ece_rx, count)
+OO_STAT("Number of congestion window reductions in response to ECE.",
+        ci_uint32, tcp_ecn_cwnd_reduce, count)
+OO_STAT("Number of segments sent with CWR set.",
+        ci_uint32, tcp_ecn_cwr_tx, count)
+OO_STAT("Number of segments received with CWR set.",
+        ci_uint32, tcp_ecn_cwr_rx, count)
+
+OO_STAT("Number of TCP payload bytes sent by sockets subject to pacing.",
+        ci_uint64, tcp_paced_bytes, count)
+OO_STAT("Number of TCP payload bytes sent by sockets not subject to pacing.",
+        ci_uint64, tcp_unpaced_bytes, count)
+OO_STAT("Number of times transmission was deferred by pacing.",
+        ci_uint32, tcp_pace_deferred, count)
+OO_STAT("Number of times the pacing timer released deferred segments.",
+        ci_uint32, tcp_pace_timeouts, count)
+
+OO_STAT("Number of SYNs received with a TCP Fast Open cookie request.",
+        ci_uint32, tcp_fastopen_cookie_req, count)
+OO_STAT("Number of SYNs received with a valid TCP Fast Open cookie.",
+        ci_uint32, tcp_fastopen_cookie_hit, count)
+OO_STAT("Number of SYNs received with an invalid TCP Fast Open cookie.  "
+        "Any data in such a SYN is dropped and a fresh cookie returned.",
+        ci_uint32, tcp_fastopen_cookie_miss, count)
+OO_STAT("Number of passive-opened connections which accepted data in the SYN.",
+        ci_uint32, tcp_fastopen_passive, count)
+OO_STAT("Number of active-opened connections which sent data in the SYN.",
+        ci_uint32, tcp_fastopen_active, count)
+OO_STAT("Number of active-opened connections whose SYN data was not "
+        "acknowledged by the peer and had to be retransmitted.",
+        ci_uint32, tcp_fastopen_active_fail, count)
+OO_STAT("Number of sends with MSG_ZEROCOPY on sockets with SO_ZEROCOPY set.  "
+        "Onload copies the data of these sends like any other.",
+        ci_uint32, tcp_zerocopy_sends, count)
+OO_STAT("Number of MSG_ZEROCOPY completion notifications read from socket "
+        "error queues.  Each may cover a range of sends, and all are "
+        "flagged SO_EE_CODE_ZEROCOPY_COPIED.",
+        ci_uint32, tcp_zerocopy_notify, count)
+
+OO_STAT("Number of in-order TCP segments copied into the previous packet "
+        "buffer on the receive queue with EF_TCP_RX_COALESCE.",
+        ci_uint32, tcp_rx_coalesce_segs, count)
+OO_STAT("Number of payload bytes copied into the previous packet buffer on "
+        "the receive queue with EF_TCP_RX_COALESCE.",
+        ci_uint64, tcp_rx_coalesce_bytes, count)
+OO_STAT("Number of in-order TCP segments that would have fitted in the "
+        "previous packet buffer but were queued separately because the "
+        "socket was locked.",
+        ci_uint32, tcp_rx_coalesce_busy, count)
+
 OO_STAT("Number of active-opened connections dropped with an error "
         "not mentioned above.",
         ci_uint32, tcp_connect_eother, count)
@@ -851,6 +1016,19 @@ OO_STAT("Number of insertions with short expiry.",
 OO_STAT("Number of times there was no need to create entry.",
         ci_uint32, tcp_seq_table_avoided, count)
 
+OO_STAT("Number of connections in TIME_WAIT moved to the timewait table, "
+        "freeing their endpoints.",
+        ci_uint32, tcp_timewait_table_insertions, count)
+OO_STAT("Number of segments answered from the timewait table.",
+        ci_uint32, tcp_timewait_table_hits, count)
+OO_STAT("Number of timewait-table entries released so that their four-tuple "
+        "could be reused.",
+        ci_uint32, tcp_timewait_table_reuses, count)
+OO_STAT("Number of timewait-table entries found to have expired.",
+        ci_uint32, tcp_timewait_table_expiries, count)
+OO_STAT("Number of timewait-table entries purged as oldest in set.",
+        ci_uint32, tcp_timewait_table_purgations, count)
+
 OO_STAT("Number of times the urgent flag was ignored in received packets",
         ci_uint32, tcp_urgent_ignore_rx, count)
 OO_STAT("Number of times the urgent flag was processed in received packets",
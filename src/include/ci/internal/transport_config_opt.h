@@ -454,6 +454,11 @@
 /* Maximum number of retransmit for SYN-ACKs */
 #define CI_CFG_TCP_SYNACK_RETRANS_MAX 10
 
+/* Maximum number of per-thread accept queues for each listening socket
+ * (EF_TCP_ACCEPT_SHARDS).  Set to 0 to compile them out.
+ */
+#define CI_CFG_TCP_ACCEPT_SHARDS      8
+
 /* Enable inspection of packets before delivery */
 #define CI_CFG_ZC_RECV_FILTER    1
 
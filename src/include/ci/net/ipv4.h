@@ -191,6 +191,13 @@ ci_inline ci_uint32 ci_ip_mask2prefix(ci_uint32 mask_he32)
 /*! type of service */
 typedef ci_uint8 ci_ip_tos_t;
 
+/* ECN codepoints in the low bits of the TOS / traffic class (RFC3168) */
+#define CI_IP_ECN_MASK      0x03
+#define CI_IP_ECN_NOT_ECT   0x00
+#define CI_IP_ECN_ECT1      0x01
+#define CI_IP_ECN_ECT0      0x02
+#define CI_IP_ECN_CE        0x03
+
 
 /**********************************************************************
  ** TCP
@@ -260,6 +267,11 @@ typedef struct ci_tcp_hdr_s {
 #define CI_TCP_OPT_SACK_PERM           0x4
 #define CI_TCP_OPT_SACK                0x5
 #define CI_TCP_OPT_TIMESTAMP           0x8
+#define CI_TCP_OPT_FASTOPEN            0x22   /* RFC7413 */
+
+/* TCP Fast Open cookie length limits (RFC7413 section 4.1.1) */
+#define CI_TCP_FASTOPEN_COOKIE_MIN     4
+#define CI_TCP_FASTOPEN_COOKIE_MAX     16
 
 
 /**********************************************************************
@@ -27,3 +27,18 @@ extern unsigned ci_ip_checksum(const struct ci_ip4_hdr_s* ip) CI_HF;
   */
 extern unsigned ci_ip_csum_partial(unsigned sum, const volatile void* in_buf,
 				   int bytes) CI_HF;
+
+#if ! defined(__KERNEL__)
+/*! Vector implementations of ci_ip_csum_partial() and ci_ip_csum_copy2().
+  ** [ci_ip_csum_simd] holds the one in use, chosen from the CPU features on
+  ** first call.  It may be lowered (e.g. to compare implementations) but
+  ** must not be raised above what ci_ip_csum_simd_level() picked.
+  */
+enum {
+  CI_IP_CSUM_SCALAR,
+  CI_IP_CSUM_AVX2,
+  CI_IP_CSUM_AVX512,
+};
+extern int ci_ip_csum_simd CI_HV;
+extern int ci_ip_csum_simd_level(void) CI_HF;
+#endif
@@ -119,6 +119,14 @@ extern ci_uint32 ci_toeplitz_hash(const ci_uint8 *key, const ci_uint8 *input,
 extern ci_uint32
 ci_toeplitz_hash_ul(const ci_uint8 *key, const ci_uint8* sse_key,
                     const ci_uint8 *input, int n);
+
+extern void
+ci_toeplitz_hash_batch(const ci_uint8 *key, const ci_uint8 *sse_key,
+                       const ci_uint8 *inputs, int n, int n_inputs,
+                       ci_uint32 *hashes);
+  /*!< Toeplitz hash of [n_inputs] consecutive [n]-byte tuples, for
+   * classifying a burst of packets.  As with ci_toeplitz_hash_ul(), only
+   * the least significant byte of each hash is accurate. */
 #endif
 
 
@@ -147,6 +147,8 @@ void oo_iobufset_kfree(struct oo_buffer_pages *pages);
  * \param flags         see OO_IOBUFSET_FLAG_*, in/out
  * \param pages_out     pointer to return the allocated pages
  * \param hugetlb_alloc pointer to the allocator, can be NULL
+ * \param numa_node     node for non-huge pages, or NUMA_NO_NODE for the
+ *                      current node
  *
  * \return              status code; if non-zero, pages_out is unchanged
  *
@@ -157,7 +159,8 @@ void oo_iobufset_kfree(struct oo_buffer_pages *pages);
 extern int
 oo_iobufset_pages_alloc(int nic_order, int min_nic_order, int *flags,
                         struct oo_buffer_pages **pages_out,
-                        struct oo_hugetlb_allocator *hugetlb_alloc);
+                        struct oo_hugetlb_allocator *hugetlb_alloc,
+                        int numa_node);
 extern void oo_iobufset_pages_release(struct oo_buffer_pages *);
 
 /*!
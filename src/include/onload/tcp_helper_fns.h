@@ -397,9 +397,7 @@ efab_tcp_helper_ready_list_events(tcp_helper_resource_t* trs,
 {
 #if CI_CFG_EPOLL3
   ci_netif* ni = &trs->netif;
-  return oo_p_dllink_is_empty(ni,
-                oo_p_dllink_ptr(ni, &ni->state->ready_lists[ready_list]))
-         ?  0 : POLLIN;
+  return ci_netif_ready_list_is_empty(ni, ready_list) ? 0 : POLLIN;
 #else
   return 0;
 #endif
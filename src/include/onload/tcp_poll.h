@@ -22,16 +22,18 @@ ci_tcp_poll_events_listen(ci_netif *ni, ci_tcp_socket_listen *tls)
   return 0;
 }
 
-/* The timestamp_q is subtly managed to ensure that tx_pending packets do not
- * appear to be visible. See doc at ci_tcp_state::timestamp_q */
+/* Is there anything to read with MSG_ERRQUEUE: TX timestamps or
+ * MSG_ZEROCOPY completions?  The timestamp_q is subtly managed to ensure
+ * that tx_pending packets do not appear to be visible. See doc at
+ * ci_tcp_state::timestamp_q */
 ci_inline bool
-ci_tcp_poll_timestamp_q_nonempty(ci_netif *ni, ci_tcp_state *ts)
+ci_tcp_poll_errqueue_nonempty(ci_netif *ni, ci_tcp_state *ts)
 {
 #if CI_CFG_TIMESTAMPING
-  return ! ci_udp_recv_q_is_empty(&ts->timestamp_q);
-#else
-  return 0;
+  if( ! ci_udp_recv_q_is_empty(&ts->timestamp_q) )
+    return 1;
 #endif
+  return ci_tcp_zc_compl_pending(ts);
 }
 
 ci_inline int/*bool*/
@@ -39,7 +41,7 @@ ci_tcp_poll_events_nolisten_haspri(ci_netif *ni, ci_tcp_state *ts)
 {
   return ( tcp_urg_data(ts) & CI_TCP_URG_IS_HERE )
          || ( (ts->s.s_aflags & CI_SOCK_AFLAG_SELECT_ERR_QUEUE)
-              && ci_tcp_poll_timestamp_q_nonempty(ni, ts) );
+              && ci_tcp_poll_errqueue_nonempty(ni, ts) );
 }
 
 /* This function should not be used for listening sockets.
@@ -59,7 +61,7 @@ ci_tcp_poll_events_nolisten(ci_netif *ni, ci_tcp_state *ts)
   if( ts->s.tx_errno && TCP_RX_DONE(ts) )
     revents |= POLLHUP; /* SHUT_RDWR */
   /* Errors */
-  if( ts->s.so_error || ci_tcp_poll_timestamp_q_nonempty(ni, ts) )
+  if( ts->s.so_error || ci_tcp_poll_errqueue_nonempty(ni, ts) )
     revents |= POLLERR;
 
   /* synchronised: !CLOSED !SYN_SENT */
@@ -78,8 +80,13 @@ ci_tcp_poll_events_nolisten(ci_netif *ni, ci_tcp_state *ts)
       revents |= POLLIN | POLLRDNORM;
 
   }
-  else if( ts->s.b.state == CI_TCP_SYN_SENT )
-    revents = 0;
+  else if( ts->s.b.state == CI_TCP_SYN_SENT ) {
+    /* A TCP Fast Open connect is writable before the SYN has gone. */
+    if( ts->tcpflags & CI_TCPT_FLAG_FASTOPEN_DEFER )
+      revents = POLLOUT | POLLWRNORM;
+    else
+      revents = 0;
+  }
 
   return revents;
 }
@@ -36,6 +36,15 @@
 #endif
 
 
+/* An accept shard claimed by a thread (EF_TCP_ACCEPT_SHARDS). */
+#define OO_PER_THREAD_ACCEPT_SHARDS  4
+struct oo_accept_shard_claim {
+  ci_uint32                  stack_id;
+  ci_int32                   listener_id;
+  ci_int32                   shard;
+};
+
+
 struct oo_per_thread {
   ci_netif_config_opts*      thread_local_netif_opts;
   int                        initialised;
@@ -44,10 +53,17 @@ struct oo_per_thread {
   struct oo_stackname_state  stackname;
   ci_uint64                  poll_nonblock_fast_frc;
   ci_uint64                  select_nonblock_fast_frc;
+  ci_uint64                  sock_lock_frc;
   struct oo_timesync         timesync;
   unsigned                   spinstate; 
   int                        in_vfork_child;
   void*                      vfork_scratch[OO_VFORK_SCRATCH_SIZE];
+  struct oo_pkt_magazine     pkt_magazine;
+  /* Thread id used to claim accept shards, or 0 if not yet known. */
+  ci_uint32                  tid;
+  /* Accept shards claimed by this thread, given up when it exits. */
+  struct oo_accept_shard_claim accept_shards[OO_PER_THREAD_ACCEPT_SHARDS];
+  int                        n_accept_shards;
 };
 
 
@@ -61,6 +77,16 @@ extern __thread struct oo_per_thread oo_per_thread CI_HV;
 /* Initialise this thread's per-thread state. */
 extern void oo_per_thread_init_thread(void);
 
+/* Return the calling thread's cached packet buffers to their stack, and
+ * keep the list of caches consistent across fork(). */
+extern void oo_pkt_magazine_pre_fork(void);
+extern void oo_pkt_magazine_parent_fork(void);
+extern void oo_pkt_magazine_child_fork(void);
+
+/* Return all threads' cached packet buffers to [ni], which this process
+ * is about to release. */
+extern void oo_pkt_magazine_forget_stack(struct ci_netif_s* ni);
+
 /* Get pointer to per-thread state.  The per-thread state may not be
  * initialised, so only use for members that don't require explicit
  * initialisation (and when performance really matters).
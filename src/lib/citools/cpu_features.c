@@ -152,6 +152,28 @@ get_cpuid(int op, int *eax, int *ebx, int *ecx, int *edx)
                         : "a" (op));
 }
 
+ci_inline void
+get_cpuid_count(int op, int count, int *eax, int *ebx, int *ecx, int *edx)
+{
+  __asm__ __volatile__ ("cpuid\n\t"
+                        : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+                        : "a" (op), "c" (count));
+}
+
+/* AVX instructions also need the OS to save the wider register state on
+ * context switch: check the XCR0 bits in [mask] are all set. */
+static int xsave_enabled(unsigned mask)
+{
+  int eax, ebx, ecx, edx;
+  unsigned lo, hi;
+
+  get_cpuid(1, &eax, &ebx, &ecx, &edx);
+  if( ! (ecx & 0x08000000) )  /* OSXSAVE */
+    return 0;
+  __asm__ __volatile__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+  return (lo & mask) == mask;
+}
+
 #else
 
 /*****************************************************************************
@@ -177,6 +199,28 @@ int ci_cpu_has_feature(char* feature)
 
   if( ! strcmp(feature, "pclmul") )
     return ecx & 0x00000002;
+  if( ! strcmp(feature, "sse4.2") )
+    return ecx & 0x00100000;
+#endif
+
+#if defined(__x86_64__)
+  if( ! strcmp(feature, "avx2") || ! strcmp(feature, "avx512bw") ||
+      ! strcmp(feature, "vpclmulqdq") ) {
+    get_cpuid(0, &eax, &ebx, &ecx, &edx);
+    if( eax < 7 )
+      return 0;
+
+    /* Leaf 7 = structured extended feature flags */
+    get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx);
+
+    if( ! strcmp(feature, "avx2") )
+      return (ebx & 0x00000020) && xsave_enabled(0x06);
+    if( ! strcmp(feature, "vpclmulqdq") )
+      return (ecx & 0x00000400) && xsave_enabled(0x06);
+    /* AVX512BW implies AVX512F, but check both to be safe; ZMM state needs
+     * the opmask and upper ZMM bits of XCR0 as well as YMM. */
+    return (ebx & 0x40010000) == 0x40010000 && xsave_enabled(0xe6);
+  }
 #endif
 
   /* Not supported on platforms that don't implement the CPUID instruction */
@@ -14,6 +14,7 @@
 /*! \cidoxg_lib_citools */
 
 #include "citools_internal.h"
+#include <ci/tools/ipcsum_base.h>
 
 
 typedef union {
@@ -22,6 +23,80 @@ typedef union {
 } ci_uint16_bytes;
 
 
+#if !defined(__KERNEL__) && defined(CI_HAVE_X86INTRIN)
+
+#include <x86intrin.h>
+
+#define CSUM_COPY_SIMD_MIN  64
+
+/* The scalar loop adds 32-bit words with end-around carry, which is addition
+ * modulo 2^32-1 giving zero only if every word (and the initial sum) is
+ * zero.  Summing the words into 64-bit lanes and folding the total gives the
+ * same value, so the result is bit-exact.  [n] is far too small for the
+ * 64-bit lanes to overflow.
+ *
+ * Both consume whole vectors only and return the number of bytes done.
+ */
+ci_inline unsigned csum_fold64(ci_uint64 sum)
+{
+  while( sum >> 32 )
+    sum = (sum & 0xffffffffu) + (sum >> 32);
+  return (unsigned) sum;
+}
+
+__attribute__((target("avx2"))) static int
+ip_csum_copy_avx2(unsigned* psum, ci_uint8* d, const ci_uint8* s, int n)
+{
+  const __m256i lo32 = _mm256_set1_epi64x(0xffffffff);
+  __m256i a0 = _mm256_setzero_si256(), a1 = _mm256_setzero_si256();
+  __m128i a;
+  int done = 0;
+
+  for( ; n - done >= 64; done += 64 ) {
+    __m256i v0 = _mm256_loadu_si256((const __m256i*) (s + done));
+    __m256i v1 = _mm256_loadu_si256((const __m256i*) (s + done + 32));
+    _mm256_storeu_si256((__m256i*) (d + done), v0);
+    _mm256_storeu_si256((__m256i*) (d + done + 32), v1);
+    a0 = _mm256_add_epi64(a0, _mm256_and_si256(v0, lo32));
+    a1 = _mm256_add_epi64(a1, _mm256_srli_epi64(v0, 32));
+    a0 = _mm256_add_epi64(a0, _mm256_and_si256(v1, lo32));
+    a1 = _mm256_add_epi64(a1, _mm256_srli_epi64(v1, 32));
+  }
+
+  a0 = _mm256_add_epi64(a0, a1);
+  a = _mm_add_epi64(_mm256_castsi256_si128(a0),
+                    _mm256_extracti128_si256(a0, 1));
+  a = _mm_add_epi64(a, _mm_unpackhi_epi64(a, a));
+  *psum = csum_fold64((ci_uint64) *psum + (ci_uint64) _mm_cvtsi128_si64(a));
+  return done;
+}
+
+__attribute__((target("avx512bw"))) static int
+ip_csum_copy_avx512(unsigned* psum, ci_uint8* d, const ci_uint8* s, int n)
+{
+  const __m512i lo32 = _mm512_set1_epi64(0xffffffff);
+  __m512i a0 = _mm512_setzero_si512(), a1 = _mm512_setzero_si512();
+  int done = 0;
+
+  for( ; n - done >= 128; done += 128 ) {
+    __m512i v0 = _mm512_loadu_si512(s + done);
+    __m512i v1 = _mm512_loadu_si512(s + done + 64);
+    _mm512_storeu_si512(d + done, v0);
+    _mm512_storeu_si512(d + done + 64, v1);
+    a0 = _mm512_add_epi64(a0, _mm512_and_si512(v0, lo32));
+    a1 = _mm512_add_epi64(a1, _mm512_srli_epi64(v0, 32));
+    a0 = _mm512_add_epi64(a0, _mm512_and_si512(v1, lo32));
+    a1 = _mm512_add_epi64(a1, _mm512_srli_epi64(v1, 32));
+  }
+
+  *psum = csum_fold64((ci_uint64) *psum + (ci_uint64)
+                      _mm512_reduce_add_epi64(_mm512_add_epi64(a0, a1)));
+  return done;
+}
+
+#endif /* !__KERNEL__ && CI_HAVE_X86INTRIN */
+
+
 /* Length must be a multiple of half-words */
 unsigned ci_ip_csum_copy2(void* dest, const void* src, int n, unsigned sum)
 {
@@ -34,6 +109,25 @@ unsigned ci_ip_csum_copy2(void* dest, const void* src, int n, unsigned sum)
   ci_assert(n >= 0);
   ci_assert(CI_OFFSET(n, 2) == 0);
 
+#if !defined(__KERNEL__) && defined(CI_HAVE_X86INTRIN)
+  if( n >= CSUM_COPY_SIMD_MIN ) {
+    int done = 0;
+    switch( ci_ip_csum_simd_level() ) {
+    case CI_IP_CSUM_AVX512:
+      done = ip_csum_copy_avx512(&sum, dest, src, n);
+      /* Finish off with the narrower vectors */
+      ci_fallthrough;
+    case CI_IP_CSUM_AVX2:
+      done += ip_csum_copy_avx2(&sum, (ci_uint8*) dest + done,
+                                (const ci_uint8*) src + done, n - done);
+      break;
+    }
+    d4 = (ci_uint32*) ((ci_uint8*) d4 + done);
+    s4 = (const ci_uint32*) ((const ci_uint8*) s4 + done);
+    n -= done;
+  }
+#endif
+
   es4 = s4 + (n >> 2);
 
   while( s4 != es4 ) {
@@ -14,9 +14,95 @@
 /*! \cidoxg_lib_citools */
  
 #include "citools_internal.h"
+#include <ci/tools/ipcsum_base.h>
 #include <ci/net/ipv4.h>
 
 
+#if !defined(__KERNEL__)
+
+int ci_ip_csum_simd = -1;
+
+int ci_ip_csum_simd_level(void)
+{
+  if(CI_UNLIKELY( ci_ip_csum_simd < 0 )) {
+#if defined(CI_HAVE_X86INTRIN)
+    if( ci_cpu_has_feature("avx512bw") )
+      ci_ip_csum_simd = CI_IP_CSUM_AVX512;
+    else if( ci_cpu_has_feature("avx2") )
+      ci_ip_csum_simd = CI_IP_CSUM_AVX2;
+    else
+#endif
+      ci_ip_csum_simd = CI_IP_CSUM_SCALAR;
+  }
+  return ci_ip_csum_simd;
+}
+
+
+#if defined(CI_HAVE_X86INTRIN)
+
+#include <x86intrin.h>
+
+/* Below this the scalar loop is as quick as setting up the vector one. */
+#define CSUM_SIMD_MIN  64
+
+/* The scalar loop adds 16-bit words into a 32-bit sum without folding
+ * carries, so the result is the sum of the words modulo 2^32.  That is
+ * associative, so the words can be split between 32-bit lanes (with the same
+ * wrap-around) and the lanes added at the end to give an identical result.
+ *
+ * Both consume whole vectors only and return the number of bytes done.
+ */
+__attribute__((target("avx2"))) static int
+ip_csum_partial_avx2(unsigned* psum, const ci_uint8* p, int bytes)
+{
+  const __m256i lo16 = _mm256_set1_epi32(0xffff);
+  __m256i a0 = _mm256_setzero_si256(), a1 = _mm256_setzero_si256();
+  __m128i a;
+  int done = 0;
+
+  for( ; bytes - done >= 64; done += 64 ) {
+    __m256i v0 = _mm256_loadu_si256((const __m256i*) (p + done));
+    __m256i v1 = _mm256_loadu_si256((const __m256i*) (p + done + 32));
+    a0 = _mm256_add_epi32(a0, _mm256_and_si256(v0, lo16));
+    a1 = _mm256_add_epi32(a1, _mm256_srli_epi32(v0, 16));
+    a0 = _mm256_add_epi32(a0, _mm256_and_si256(v1, lo16));
+    a1 = _mm256_add_epi32(a1, _mm256_srli_epi32(v1, 16));
+  }
+
+  a0 = _mm256_add_epi32(a0, a1);
+  a = _mm_add_epi32(_mm256_castsi256_si128(a0),
+                    _mm256_extracti128_si256(a0, 1));
+  a = _mm_add_epi32(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)));
+  a = _mm_add_epi32(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(2, 3, 0, 1)));
+  *psum += (unsigned) _mm_cvtsi128_si32(a);
+  return done;
+}
+
+__attribute__((target("avx512bw"))) static int
+ip_csum_partial_avx512(unsigned* psum, const ci_uint8* p, int bytes)
+{
+  const __m512i lo16 = _mm512_set1_epi32(0xffff);
+  __m512i a0 = _mm512_setzero_si512(), a1 = _mm512_setzero_si512();
+  int done = 0;
+
+  for( ; bytes - done >= 128; done += 128 ) {
+    __m512i v0 = _mm512_loadu_si512(p + done);
+    __m512i v1 = _mm512_loadu_si512(p + done + 64);
+    a0 = _mm512_add_epi32(a0, _mm512_and_si512(v0, lo16));
+    a1 = _mm512_add_epi32(a1, _mm512_srli_epi32(v0, 16));
+    a0 = _mm512_add_epi32(a0, _mm512_and_si512(v1, lo16));
+    a1 = _mm512_add_epi32(a1, _mm512_srli_epi32(v1, 16));
+  }
+
+  *psum += (unsigned) _mm512_reduce_add_epi32(_mm512_add_epi32(a0, a1));
+  return done;
+}
+
+#endif /* CI_HAVE_X86INTRIN */
+
+#endif /* __KERNEL__ */
+
+
 unsigned ci_ip_csum_partial(unsigned sum, const volatile void* in_buf,
 			    int bytes)
 {
@@ -25,6 +111,24 @@ unsigned ci_ip_csum_partial(unsigned sum, const volatile void* in_buf,
   ci_assert(in_buf || bytes == 0);
   ci_assert(bytes >= 0);
 
+#if !defined(__KERNEL__) && defined(CI_HAVE_X86INTRIN)
+  if( bytes >= CSUM_SIMD_MIN ) {
+    int done = 0;
+    switch( ci_ip_csum_simd_level() ) {
+    case CI_IP_CSUM_AVX512:
+      done = ip_csum_partial_avx512(&sum, (const ci_uint8*) buf, bytes);
+      /* Finish off with the narrower vectors */
+      ci_fallthrough;
+    case CI_IP_CSUM_AVX2:
+      done += ip_csum_partial_avx2(&sum, (const ci_uint8*) buf + done,
+                                   bytes - done);
+      break;
+    }
+    buf = (const ci_uint16*) ((const ci_uint8*) buf + done);
+    bytes -= done;
+  }
+#endif
+
   while( bytes > 1 ) {
     sum += *buf++;
     bytes -= 2;
@@ -89,6 +89,33 @@ ci_toeplitz_hash_sse_ip6(const uint32_t *key, const uint32_t *input, int size)
 }
 #endif
 
+/* As ci_toeplitz_hash_sse_finish() on eight folded tuples at once.  Each
+ * 128-bit lane of the carry-less multiply handles two tuples (one per
+ * qword), and the byte reversal is done with a nibble lookup.
+ */
+__attribute__((target("avx512bw,vpclmulqdq"))) static void
+ci_toeplitz_hash_avx512_finish(const ci_uint32 *key, const ci_uint32 *folded,
+                               ci_uint32 *hashes)
+{
+  const __m512i rev4 = _mm512_broadcast_i32x4(
+      _mm_setr_epi8(0x0, 0x8, 0x4, 0xc, 0x2, 0xa, 0x6, 0xe,
+                    0x1, 0x9, 0x5, 0xd, 0x3, 0xb, 0x7, 0xf));
+  const __m512i lo4 = _mm512_set1_epi64(0xf);
+  __m512i vkey = _mm512_set1_epi64(((ci_uint64) key[0] << 32) | key[1]);
+  __m512i in, lo, hi, b;
+
+  in = _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i*) folded));
+  lo = _mm512_clmulepi64_epi128(in, vkey, 0x00);
+  hi = _mm512_clmulepi64_epi128(in, vkey, 0x01);
+  b = _mm512_mask_blend_epi64(0xaa, lo, _mm512_bslli_epi128(hi, 8));
+  b = _mm512_and_si512(_mm512_srli_epi64(b, 40), _mm512_set1_epi64(0xff));
+  b = _mm512_or_si512(
+        _mm512_slli_epi64(_mm512_shuffle_epi8(rev4,
+                                              _mm512_and_si512(b, lo4)), 4),
+        _mm512_shuffle_epi8(rev4, _mm512_srli_epi64(b, 4)));
+  _mm256_storeu_si256((__m256i*) hashes, _mm512_cvtepi64_epi32(b));
+}
+
 #endif /* CI_HAVE_X86INTRIN */
 
 ci_uint32 ci_toeplitz_hash_ul(const ci_uint8 *key, const ci_uint8 *sse_key,
@@ -115,6 +142,48 @@ ci_uint32 ci_toeplitz_hash_ul(const ci_uint8 *key, const ci_uint8 *sse_key,
     return ci_toeplitz_hash(key, input, size);
 }
 
+
+void ci_toeplitz_hash_batch(const ci_uint8 *key, const ci_uint8 *sse_key,
+                            const ci_uint8 *inputs, int n, int n_inputs,
+                            ci_uint32 *hashes)
+{
+  int i = 0;
+
+#if defined(CI_HAVE_X86INTRIN)
+  static int avx512_support = -1;
+
+  if(CI_UNLIKELY( avx512_support < 0 ))
+    avx512_support = ci_cpu_has_feature("pclmul") &&
+                     ci_cpu_has_feature("avx512bw") &&
+                     ci_cpu_has_feature("vpclmulqdq");
+
+  if( avx512_support && (n == 12
+#if defined(CI_CFG_IPV6) && CI_CFG_IPV6
+                         || n == IPV6_TUPLE_SIZE
+#endif
+                         ) ) {
+    ci_uint32 folded[8];
+    int j, k;
+
+    for( ; n_inputs - i >= 8; i += 8 ) {
+      /* The key has a 32-bit period, so each tuple reduces to the XOR of
+       * its words, as in ci_toeplitz_hash_sse_ip4() and _ip6(). */
+      for( j = 0; j < 8; ++j ) {
+        const ci_uint32* in = (const ci_uint32*) (inputs + (i + j) * n);
+        folded[j] = 0;
+        for( k = 0; k < n / 4; ++k )
+          folded[j] ^= in[k];
+      }
+      ci_toeplitz_hash_avx512_finish((const ci_uint32*) sse_key, folded,
+                                     hashes + i);
+    }
+  }
+#endif /* CI_HAVE_X86INTRIN */
+
+  for( ; i < n_inputs; ++i )
+    hashes[i] = ci_toeplitz_hash_ul(key, sse_key, inputs + i * n, n);
+}
+
 #endif /* __KERNEL__ */
 
 /*! \cidoxg_end */
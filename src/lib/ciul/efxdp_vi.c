@@ -20,28 +20,6 @@
 #include "af_xdp_defs.h"
 #include "logging.h"
 
-/* Currently, AF_XDP requires a system call to start transmitting.
- *
- * There is a limit (undocumented, so we can't rely on it being 16) to the
- * number of packets which will be sent each time. We use the "previous"
- * field to store the last packet known to be sent; if this does not cover
- * all those in the queue, we will try again once a send has completed.
- */
-#define AF_XDP_TX_BATCH_MAX 16
-static int efxdp_tx_need_kick(ef_vi* vi)
-{
-  ef_vi_txq_state* qs = &vi->ep_state->txq;
-  return qs->previous != qs->added;
-}
-
-static void efxdp_tx_kick(ef_vi* vi)
-{
-  if( vi->xdp_kick(vi) == 0 ) {
-    ef_vi_txq_state* qs = &vi->ep_state->txq;
-    qs->previous = qs->added;
-  }
-}
-
 /* Access the AF_XDP rings, using the offsets provided in the mapped memory.
  * The (fake) event queue pointer must be initialised to point to the start
  * of this memory in order to access the offsets.
@@ -62,6 +40,51 @@ static struct efab_af_xdp_offsets* xdp_offsets(ef_vi* vi)
 
 #define RING_DESC(vi, ring) RING_THING(vi, ring, desc)
 
+/* With XDP_USE_NEED_WAKEUP the kernel sets a flag on a ring when it will
+ * not look at the ring again until kicked.  Older kernels don't provide
+ * the flag, and always need a kick.
+ */
+#ifndef XDP_RING_NEED_WAKEUP
+# define XDP_RING_NEED_WAKEUP 1
+#endif
+
+#define RING_HAS_FLAGS(vi, ring) (xdp_offsets(vi)->rings.ring.flags != 0)
+
+#define RING_FLAGS(vi, ring) \
+  ((volatile uint32_t*)RING_THING(vi, ring, flags))
+
+#define RING_NEEDS_WAKEUP(vi, ring) \
+  (RING_HAS_FLAGS(vi, ring) && (*RING_FLAGS(vi, ring) & XDP_RING_NEED_WAKEUP))
+
+/* Currently, AF_XDP may require a system call to start transmitting.
+ *
+ * There is a limit (undocumented, so we can't rely on it being 16) to the
+ * number of packets which will be sent each time. We use the "previous"
+ * field to store the last packet known to be sent; if this does not cover
+ * all those in the queue, we will try again once a send has completed.
+ */
+#define AF_XDP_TX_BATCH_MAX 16
+static int efxdp_tx_need_kick(ef_vi* vi)
+{
+  ef_vi_txq_state* qs = &vi->ep_state->txq;
+  return qs->previous != qs->added;
+}
+
+static void efxdp_tx_kick(ef_vi* vi)
+{
+  ef_vi_txq_state* qs = &vi->ep_state->txq;
+
+  /* The kernel sets the flag before its final check of the ring, so once
+   * our producer update is visible, a clear flag means that it will see
+   * the new descriptors without a kick.  (In copy mode the flag is always
+   * set.)
+   */
+  ci_mb();
+  if( (RING_HAS_FLAGS(vi, tx) && ! RING_NEEDS_WAKEUP(vi, tx)) ||
+      vi->xdp_kick(vi) == 0 )
+    qs->previous = qs->added;
+}
+
 static int efxdp_ef_vi_transmitv_init(ef_vi* vi, const ef_iovec* iov,
                                       int iov_len, ef_request_id dma_id)
 {
@@ -259,6 +282,11 @@ static void efxdp_ef_vi_receive_push(ef_vi* vi)
 {
   wmb();
   *RING_PRODUCER(vi, fr) = vi->ep_state->rxq.added;
+  /* A zerocopy driver that ran out of buffers waits for a kick once the
+   * fill ring has been replenished. */
+  ci_mb();
+  if( RING_NEEDS_WAKEUP(vi, fr) )
+    vi->xdp_kick(vi);
 }
 
 static int efxdp_ef_vi_receive_get_timestamp(struct ef_vi* vi, const void* pkt,
@@ -580,6 +580,11 @@ static int xdp_create_ring(struct socket* sock,
   user_offset->consumer = user_base + xdp_offset->consumer;
   user_offset->desc     = user_base + xdp_offset->desc;
 
+#ifdef XDP_USE_NEED_WAKEUP
+  kern_offset->flags    = kern_base + xdp_offset->flags;
+  user_offset->flags    = user_base + xdp_offset->flags;
+#endif
+
   return 0;
 }
 
@@ -823,15 +828,75 @@ static int af_xdp_init(struct efhw_nic* nic, int instance,
   return rc;
 }
 
+#ifdef XDP_USE_NEED_WAKEUP
+static bool xdp_ring_needs_wakeup(struct efhw_af_xdp_vi* vi,
+                                  struct efab_af_xdp_offsets_ring* ring)
+{
+  /* Kernel offsets are relative to the offsets structure itself */
+  return ring->flags != 0 &&
+         (READ_ONCE(*(u32*)((char*)&vi->kernel_offsets + ring->flags)) &
+          XDP_RING_NEED_WAKEUP);
+}
+#endif
+
 static int af_xdp_dmaq_kick(struct efhw_nic *nic, int instance)
 {
   struct efhw_af_xdp_vi* vi;
   struct msghdr msg = {.msg_flags = MSG_DONTWAIT};
+  int rc;
+
   vi = vi_by_instance(nic, instance);
   if( vi == NULL )
     return -ENODEV;
 
-  return kernel_sendmsg(vi->sock, &msg, NULL, 0, 0);
+  /* Sending wakes TX, and busy polls the device if that is enabled. */
+  rc = kernel_sendmsg(vi->sock, &msg, NULL, 0, 0);
+#ifdef XDP_USE_NEED_WAKEUP
+  /* A zerocopy driver that ran out of fill ring buffers waits to be woken
+   * by a receive once they have been replenished. */
+  if( rc >= 0 && xdp_ring_needs_wakeup(vi, &vi->kernel_offsets.rings.fr) )
+    rc = kernel_recvmsg(vi->sock, &msg, NULL, 0, 0, MSG_DONTWAIT);
+#endif
+  return rc;
+}
+
+static int xdp_sock_setsockopt_int(struct socket* sock, int optname, int val)
+{
+#ifndef EFRM_HAS_SOCKPTR
+  mm_segment_t oldfs = get_fs();
+  int rc;
+
+  set_fs(KERNEL_DS);
+  rc = sock_setsockopt(sock, SOL_SOCKET, optname, (char*)&val, sizeof(val));
+  set_fs(oldfs);
+  return rc;
+#else
+  return sock_setsockopt(sock, SOL_SOCKET, optname,
+                         KERNEL_SOCKPTR(&val), sizeof(val));
+#endif
+}
+
+static int af_xdp_busy_poll(struct efhw_nic *nic, int instance,
+                            int usec, int budget)
+{
+#ifdef SO_PREFER_BUSY_POLL
+  struct efhw_af_xdp_vi* vi;
+  int rc;
+
+  vi = vi_by_instance(nic, instance);
+  if( vi == NULL || vi->sock == NULL )
+    return -ENODEV;
+
+  /* Raising either limit above the system default needs CAP_NET_ADMIN. */
+  rc = xdp_sock_setsockopt_int(vi->sock, SO_PREFER_BUSY_POLL, 1);
+  if( rc == 0 )
+    rc = xdp_sock_setsockopt_int(vi->sock, SO_BUSY_POLL, usec);
+  if( rc == 0 )
+    rc = xdp_sock_setsockopt_int(vi->sock, SO_BUSY_POLL_BUDGET, budget);
+  return rc;
+#else
+  return -EOPNOTSUPP;
+#endif
 }
 
 /*----------------------------------------------------------------------------
@@ -1149,6 +1214,11 @@ af_xdp_dmaq_rx_q_init(struct efhw_nic *nic, struct efhw_dmaq_params *params)
   vi->owner_id = params->owner;
   vi->rxq_capacity = params->dmaq_size;
   vi->flags |= (params->flags & EFHW_VI_RX_ZEROCOPY) ? XDP_ZEROCOPY : XDP_COPY;
+#ifdef XDP_USE_NEED_WAKEUP
+  /* Have the kernel tell us when it needs a kick, so that we can avoid
+   * the system call the rest of the time. */
+  vi->flags |= XDP_USE_NEED_WAKEUP;
+#endif
   params->qid_out = params->dmaq;
 
   return 0;
@@ -1494,6 +1564,7 @@ struct efhw_func_ops af_xdp_char_functional_units = {
 	.filter_remove = af_xdp_filter_remove,
 	.filter_redirect = af_xdp_filter_redirect,
 	.dmaq_kick = af_xdp_dmaq_kick,
+	.af_xdp_busy_poll = af_xdp_busy_poll,
 	.af_xdp_mem = af_xdp_mem,
 	.af_xdp_init = af_xdp_init,
 	.vi_io_region = af_xdp_vi_io_region,
@@ -432,6 +432,14 @@ int efrm_vi_af_xdp_kick(struct efrm_vi *virs)
 EXPORT_SYMBOL(efrm_vi_af_xdp_kick);
 
 
+int efrm_vi_af_xdp_busy_poll(struct efrm_vi *virs, int usec, int budget)
+{
+	return efhw_nic_af_xdp_busy_poll(virs->rs.rs_client->nic,
+					 virs->rs.rs_instance, usec, budget);
+}
+EXPORT_SYMBOL(efrm_vi_af_xdp_busy_poll);
+
+
 /* Try to allocate an instance out of the VIset.  If no free instances
  * and some instances are flushing, block.  Else return error.
  */
@@ -73,6 +73,7 @@ static int efab_file_move_supported_tcp(ci_netif *ni, ci_tcp_state *ts,
       ci_ip_timer_pending(ni, &ts->rto_tid) ||
       ci_ip_timer_pending(ni, &ts->zwin_tid) ||
       ci_ip_timer_pending(ni, &ts->cork_tid) ||
+      ci_ip_timer_pending(ni, &ts->pace_tid) ||
       OO_PP_NOT_NULL(ts->pmtus) ) {
     if( do_assert ) {
       ci_assert(ci_ip_queue_is_empty(&ts->send));
@@ -82,6 +83,7 @@ static int efab_file_move_supported_tcp(ci_netif *ni, ci_tcp_state *ts,
       ci_assert(! ci_ip_timer_pending(ni, &ts->rto_tid));
       ci_assert(! ci_ip_timer_pending(ni, &ts->zwin_tid));
       ci_assert(! ci_ip_timer_pending(ni, &ts->cork_tid));
+      ci_assert(! ci_ip_timer_pending(ni, &ts->pace_tid));
       ci_assert(OO_PP_IS_NULL(ts->pmtus));
     }
     return false;
@@ -341,6 +343,8 @@ int efab_file_move_to_alien_stack(ci_private_t *priv, ci_netif *alien_ni,
     mid_ts->zwin_tid = new_ts->zwin_tid;
     mid_ts->kalive_tid = new_ts->kalive_tid;
     mid_ts->cork_tid = new_ts->cork_tid;
+    mid_ts->pace_tid = new_ts->pace_tid;
+    mid_ts->coalesce_tid = new_ts->coalesce_tid;
 #if CI_CFG_TCP_SOCK_STATS
     mid_ts->stats_tid = new_ts->stats_tid;
 #endif
@@ -321,9 +321,7 @@ oo_trusted_lock_drop(tcp_helper_resource_t* trs,
 #if CI_CFG_EPOLL3
       CI_READY_LIST_EACH(trs->netif.state->ready_lists_in_use, tmp, i) {
         get_os_ready_list(trs, i);
-        if( ! oo_p_dllink_is_empty(&trs->netif,
-                oo_p_dllink_ptr(&trs->netif,
-                                &trs->netif.state->ready_lists[i])) )
+        if( ! ci_netif_ready_list_is_empty(&trs->netif, i) )
           ci_waitable_wakeup_all(&trs->ready_list_waitqs[i]);
       }
 #endif
@@ -1957,6 +1955,20 @@ static int deferred_vis(tcp_helper_resource_t* trs)
     trs->buf_mmap_bytes += mmap_bytes;
     trs_nic->thn_vi_mmap_bytes = mmap_bytes;
 
+    /* The AF_XDP socket exists only now that the VI is complete. */
+    if( NI_OPTS(ni).af_xdp_busy_poll &&
+        ci_netif_vi(ni, intf_i)->nic_type.arch == EF_VI_ARCH_AF_XDP ) {
+      rc = efrm_vi_af_xdp_busy_poll(tcp_helper_vi(trs, intf_i),
+                                    NI_OPTS(ni).af_xdp_busy_poll,
+                                    NI_OPTS(ni).af_xdp_busy_poll_budget);
+      if( rc == 0 )
+        ni->state->nic[intf_i].oo_vi_flags |= OO_VI_FLAGS_AF_XDP_BUSY_POLL;
+      else
+        NI_LOG(ni, CONFIG_WARNINGS,
+               "[%s]: WARNING: EF_AF_XDP_BUSY_POLL ignored on interface %d "
+               "(rc=%d)", ni->state->pretty_name, intf_i, rc);
+    }
+
     /* We used the info we were told - check that's consistent with what someone
      * else would get if they checked separately.
      */
@@ -2193,6 +2205,7 @@ allocate_netif_resources(ci_resource_onload_alloc_t* alloc,
   int no_active_wild_pools, no_active_wild_table_entries;
 #endif
   int no_seq_table_entries;
+  int no_timewait_table_entries;
   unsigned vi_state_bytes = 0;
   unsigned dma_addrs_bytes;
 #if CI_CFG_PIO
@@ -2232,6 +2245,12 @@ allocate_netif_resources(ci_resource_onload_alloc_t* alloc,
     no_seq_table_entries = 0;
   }
 
+  if( NI_OPTS(ni).tcp_timewait_table != 0 )
+    no_timewait_table_entries =
+      1u << ci_log2_ge(NI_OPTS(ni).tcp_timewait_table, 1);
+  else
+    no_timewait_table_entries = 0;
+
   /* pkt_sets_n should be zeroed before possible NIC reset */
   if( NI_OPTS(ni).max_packets > max_packets_per_stack ) {
     OO_DEBUG_ERR(ci_log("WARNING: EF_MAX_PACKETS reduced from %d to %d due to "
@@ -2344,6 +2363,8 @@ allocate_netif_resources(ci_resource_onload_alloc_t* alloc,
 #endif
   sz = CI_ROUND_UP(sz, __alignof__(ci_tcp_prev_seq_t));
   sz += sizeof(ci_tcp_prev_seq_t) * no_seq_table_entries;
+  sz = CI_ROUND_UP(sz, __alignof__(ci_tcp_timewait_t));
+  sz += sizeof(ci_tcp_timewait_t) * no_timewait_table_entries;
   sz = CI_ROUND_UP(sz, __alignof__(struct oo_deferred_pkt));
   sz += sizeof(struct oo_deferred_pkt) * NI_OPTS(ni).defer_arp_pkts;
   sz = CI_ROUND_UP(sz, __alignof__(ci_netif_filter_table));
@@ -2459,6 +2480,11 @@ allocate_netif_resources(ci_resource_onload_alloc_t* alloc,
   ns->seq_table_entries_n = no_seq_table_entries;
   ns_ofs += sizeof(ci_tcp_prev_seq_t) * ns->seq_table_entries_n;
 
+  ns_ofs = CI_ROUND_UP(ns_ofs, __alignof__(ci_tcp_timewait_t));
+  ns->timewait_table_ofs = ns_ofs;
+  ns->timewait_table_entries_n = no_timewait_table_entries;
+  ns_ofs += sizeof(ci_tcp_timewait_t) * ns->timewait_table_entries_n;
+
   ns_ofs = CI_ROUND_UP(ns_ofs, __alignof__(struct oo_deferred_pkt));
   ns->deferred_pkts_ofs = ns_ofs;
   ns_ofs += sizeof(struct oo_deferred_pkt) * NI_OPTS(ni).defer_arp_pkts;
@@ -2499,6 +2525,7 @@ allocate_netif_resources(ci_resource_onload_alloc_t* alloc,
   ni->active_wild_table = (void*) ((char*) ns + ns->active_wild_ofs);
 #endif
   ni->seq_table = (void*) ((char*) ns + ns->seq_table_ofs);
+  ni->timewait_table = (void*) ((char*) ns + ns->timewait_table_ofs);
   ni->deferred_pkts = (void*) ((char*) ns + ns->deferred_pkts_ofs);
   ni->filter_table = (void*) ((char*) ns + ns->table_ofs);
   ni->filter_table_ext = (void*) ((char*) ns + ns->table_ext_ofs);
@@ -4185,6 +4212,19 @@ static void put_namespaces(tcp_helper_resource_t* rs)
 #endif
 }
 
+/* Returns the NUMA node that [nic] is attached to, or -1 if not known. */
+static int tcp_helper_nic_numa_node(struct efhw_nic* nic)
+{
+  struct device* dev = efhw_nic_get_dev(nic);
+  int node = NUMA_NO_NODE;
+
+  if( dev != NULL ) {
+    node = dev_to_node(dev);
+    put_device(dev);
+  }
+  return node;
+}
+
 static void generate_efct_filter_irqmask(cpumask_t* result)
 {
   /* The goal here is to maintain NUMA-locality, but avoid contention between
@@ -4505,6 +4545,8 @@ int tcp_helper_rm_alloc(ci_resource_onload_alloc_t* alloc,
   ci_netif_state_init(&rs->netif, oo_timesync_cpu_khz, alloc->in_name);
   OO_STACK_FOR_EACH_INTF_I(&rs->netif, intf_i) {
     nic = efrm_client_get_nic(rs->nic[intf_i].thn_oo_nic->efrm_client);
+    if( ni->state->pkt_numa_node < 0 )
+      ni->state->pkt_numa_node = tcp_helper_nic_numa_node(nic);
     if( nic->devtype.arch == EFHW_ARCH_AF_XDP )
       ni->flags |= CI_NETIF_FLAG_AF_XDP;
     if( nic->devtype.arch == EFHW_ARCH_EFCT )
@@ -4514,6 +4556,9 @@ int tcp_helper_rm_alloc(ci_resource_onload_alloc_t* alloc,
       tcp_helper_suspend_interface(ni, intf_i);
 #endif
   }
+  if( ni->state->pkt_numa_node < 0 && NI_OPTS(ni).irq_core >= 0 &&
+      cpu_possible(NI_OPTS(ni).irq_core) )
+    ni->state->pkt_numa_node = cpu_to_node(NI_OPTS(ni).irq_core);
   if( oof_use_all_local_ip_addresses || cplane_use_prefsrc_as_local )
     ni->state->flags |= CI_NETIF_FLAG_USE_ALIEN_LADDRS;
 
@@ -4828,6 +4873,8 @@ thr_reset_stack_tx_cb_state_init(struct thr_reset_stack_tx_cb_state* cb_state,
   cb_state->thr = thr;
   cb_state->ps.tx_pkt_free_list_insert = &cb_state->ps.tx_pkt_free_list;
   cb_state->ps.tx_pkt_free_list_n = 0;
+  cb_state->ps.rx_batch_n = 0;
+  cb_state->ps.syncookie_n = 0;
 }
 
 static void thr_reset_stack_tx_cb(ef_request_id id, void* arg)
@@ -6246,7 +6293,9 @@ efab_tcp_helper_iobufset_alloc(tcp_helper_resource_t* trs,
   }
 #endif
   rc = oo_iobufset_pages_alloc(HW_PAGES_PER_SET_S, min_nics_order, &flags,
-                               &pages, trs->thc_pktbuf_alloc);
+                               &pages, trs->thc_pktbuf_alloc,
+                               NI_OPTS(ni).packet_numa_local ?
+                               ni->state->pkt_numa_node : NUMA_NO_NODE);
   if( rc != 0 )
     return rc;
 #if CI_CFG_PKTS_AS_HUGE_PAGES
@@ -6386,6 +6435,10 @@ efab_tcp_helper_more_bufs(tcp_helper_resource_t* trs)
   else
     page_order += ci_log2_ge(PAGE_SIZE / CI_CFG_PKT_BUF_SIZE, 0);
   ni->packets->set[bufset_id].page_order = page_order;
+  ni->packets->set[bufset_id].numa_node = page_to_nid(pages->pages[0]);
+  if( ni->state->pkt_numa_node >= 0 &&
+      ni->packets->set[bufset_id].numa_node != ni->state->pkt_numa_node )
+    CITP_STATS_NETIF_INC(ni, pkt_numa_remote_sets);
   ni->dma_addr_next += (PKTS_PER_SET >> page_order) * CI_CFG_MAX_INTERFACES;
   ni->packets->n_free += PKTS_PER_SET;
 
@@ -6413,7 +6466,8 @@ efab_tcp_helper_more_bufs(tcp_helper_resource_t* trs)
   }
   ci_vfree(hw_addrs);
 
-  trs->netif.state->packet_alloc_numa_nodes |= 1 << numa_node_id();
+  trs->netif.state->packet_alloc_numa_nodes |=
+                              1 << ni->packets->set[bufset_id].numa_node;
   CHECK_FREEPKTS(ni);
   return 0;
 }
@@ -7375,7 +7429,6 @@ get_os_ready_list(tcp_helper_resource_t* thr, int ready_list)
 
   spin_lock_irqsave(&thr->os_ready_list_lock, lock_flags);
   while( ci_dllist_not_empty(&thr->os_ready_lists[ready_list]) ) {
-    struct oo_p_dllink_state ready_link;
     ci_sb_epoll_state* epoll;
 
     lnk = ci_dllist_head(&thr->os_ready_lists[ready_list]);
@@ -7391,11 +7444,7 @@ get_os_ready_list(tcp_helper_resource_t* thr, int ready_list)
       continue;
 
     epoll = ci_ni_aux_p2epoll(ni, w->epoll);
-    ready_link = ci_sb_epoll_ready_link(ni, epoll, ready_list);
-    oo_p_dllink_del(ni, ready_link);
-    oo_p_dllink_add_tail(ni,
-                oo_p_dllink_ptr(ni, &ni->state->ready_lists[ready_list]),
-                ready_link);
+    ci_netif_ready_list_put(ni, epoll, ready_list);
   }
   spin_unlock_irqrestore(&thr->os_ready_list_lock, lock_flags);
 }
@@ -7435,8 +7484,7 @@ wakeup_post_poll_list(tcp_helper_resource_t* thr)
 #if CI_CFG_EPOLL3
   CI_READY_LIST_EACH(ni->state->ready_lists_in_use, tmp, n) {
     get_os_ready_list(thr, n);
-    if( ! oo_p_dllink_is_empty(ni, oo_p_dllink_ptr(ni,
-                                        &ni->state->ready_lists[n])) )
+    if( ! ci_netif_ready_list_is_empty(ni, n) )
       efab_tcp_helper_ready_list_wakeup(thr, n);
   }
 #endif
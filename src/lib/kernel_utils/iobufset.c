@@ -134,7 +134,8 @@ static int oo_bufpage_init(struct oo_buffer_pages **pages_out,
 static int oo_bufpage_alloc(struct oo_buffer_pages **pages_out,
                             int user_order, int low_order, int min_nic_order,
                             int *flags, int gfp_flag,
-                            struct oo_hugetlb_allocator *hugetlb_alloc)
+                            struct oo_hugetlb_allocator *hugetlb_alloc,
+                            int numa_node)
 {
   struct oo_buffer_pages *pages;
   int n_bufs = 1 << (user_order - low_order);
@@ -187,7 +188,7 @@ static int oo_bufpage_alloc(struct oo_buffer_pages **pages_out,
   }
 
   for( i = 0; i < n_bufs; ++i ) {
-    pages->pages[i] = alloc_pages_node(numa_node_id(), gfp_flag, low_order);
+    pages->pages[i] = alloc_pages_node(numa_node, gfp_flag, low_order);
     if( pages->pages[i] == NULL ) {
       EFRM_ERR("%s: failed to allocate page (i=%u) "
                            "user_order=%d page_order=%d",
@@ -215,7 +216,8 @@ EXPORT_SYMBOL(oo_iobufset_pages_release);
 int
 oo_iobufset_pages_alloc(int nic_order, int min_nic_order, int *flags,
                         struct oo_buffer_pages **pages_out,
-                        struct oo_hugetlb_allocator *hugetlb_alloc)
+                        struct oo_hugetlb_allocator *hugetlb_alloc,
+                        int numa_node)
 {
   int rc;
   int gfp_flag = (in_atomic() || in_interrupt()) ? GFP_ATOMIC : GFP_KERNEL;
@@ -225,11 +227,14 @@ oo_iobufset_pages_alloc(int nic_order, int min_nic_order, int *flags,
   EFRM_ASSERT(pages_out);
   EFRM_ASSERT(order >= min_order);
 
+  if( numa_node == NUMA_NO_NODE || ! node_online(numa_node) )
+    numa_node = numa_node_id();
+
 #if CI_CFG_PKTS_AS_HUGE_PAGES
   if( *flags & OO_IOBUFSET_FLAG_HUGE_PAGE_FORCE ) {
 # ifdef OO_DO_HUGE_PAGES
     rc = oo_bufpage_alloc(pages_out, order, order, min_order, flags,
-                          gfp_flag, hugetlb_alloc);
+                          gfp_flag, hugetlb_alloc, numa_node);
 # else
     rc = -ENOMEM;
 # endif
@@ -254,11 +259,11 @@ oo_iobufset_pages_alloc(int nic_order, int min_nic_order, int *flags,
       low_order = HPAGE_SHIFT - PAGE_SHIFT;
 
     rc = oo_bufpage_alloc(pages_out, order, low_order, min_order, flags,
-                          gfp_flag, hugetlb_alloc);
+                          gfp_flag, hugetlb_alloc, numa_node);
 
     if( rc != 0 && rc != -EINTR && low_order != 0 )
       rc = oo_bufpage_alloc(pages_out, order, 0, min_order, flags, gfp_flag,
-                            hugetlb_alloc);
+                            hugetlb_alloc, numa_node);
   }
 
   if( rc == -EMSGSIZE ) {
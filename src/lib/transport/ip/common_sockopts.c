@@ -43,6 +43,7 @@
 #ifndef __KERNEL__
 #include <limits.h>
 #include <net/if.h>
+#include <netinet/tcp.h>
 
 /* Emulate Linux mapping between priority and TOS field */
 #include <linux/types.h>
@@ -1879,6 +1880,11 @@ int ci_setsockopt_os_fail_ignore(ci_netif* ni, ci_sock_cmn* s, int err,
   if( level == SOL_SOCKET && optname == ONLOAD_SO_BUSY_POLL &&
            optlen >= sizeof(int) ) 
     return 1;
+  /* Onload implements congestion control algorithms that the kernel may
+   * not have loaded. */
+  else if( (s->b.state & CI_TCP_STATE_TCP) && level == IPPROTO_TCP &&
+           optname == TCP_CONGESTION )
+    return 1;
 #if CI_CFG_TIMESTAMPING
   else if( (s->b.state & CI_TCP_STATE_TCP) && level == SOL_SOCKET &&
            ( optname == SO_TIMESTAMP || optname == SO_TIMESTAMPNS ||
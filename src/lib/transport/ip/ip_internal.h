@@ -429,6 +429,20 @@ struct oo_sock_extended_err {
  */
 #define ONLOAD_SO_BUSY_POLL 46
 
+/* MSG_ZEROCOPY and friends could be undefined in older headers. */
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
 /* check [ov] is a non-NULL ptr & [ol] indicates the right space for
  * type [ty] */
 #define opt_ok(ov,ol,ty)     ((ov) && (ol) >= sizeof(ty))
@@ -813,8 +827,8 @@ ci_netif_pkt_release_in_poll(ci_netif* netif, ci_ip_pkt_fmt* pkt,
 }
                              
 
-#ifdef __KERNEL__
 extern void ci_netif_set_merge_atomic_flag(ci_netif* ni);
+#ifdef __KERNEL__
 #define CI_NETIF_STATE_MOD(ni, is_locked, field, mod) \
   do {                                                                      \
     if( is_locked ) {                                                       \
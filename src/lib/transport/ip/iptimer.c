@@ -140,6 +140,8 @@ void ci_ip_timer_state_init(ci_netif* netif, unsigned cpu_khz)
   ci_tcp_timer_init(netif);
 
   oo_p_dllink_init(netif, oo_p_dllink_ptr(netif, &ipts->fire_list));
+  oo_p_dllink_init(netif, oo_p_dllink_ptr(netif, &ipts->cascade_list));
+  oo_p_dllink_init(netif, oo_p_dllink_ptr(netif, &ipts->coalesce_list));
 
   /* Initialise the wheel lists. */
   for( i=0; i < CI_IPTIME_WHEELSIZE; i++)
@@ -149,6 +151,78 @@ void ci_ip_timer_state_init(ci_netif* netif, unsigned cpu_khz)
 
 
 #if OO_DO_STACK_POLL
+
+/* With EF_TCP_TIMER_COALESCE, these timers of a TCP socket are not placed
+ * in the wheel themselves.  A pending timer is instead linked on
+ * coalesce_list (so that ci_ip_timer_pending() and ci_ip_timer_clear()
+ * work unchanged), and the socket's coalesce_tid is kept in the wheel at
+ * a time no later than the earliest of them.  Clearing is lazy, so
+ * coalesce_tid may fire with nothing due, in which case it is rearmed.
+ */
+ci_inline int ci_ip_timer_is_coalesced(ci_netif* netif, ci_ip_timer* ts)
+{
+  switch( ts->fn ) {
+  case CI_IP_TIMER_TCP_RTO:
+  case CI_IP_TIMER_TCP_DELACK:
+  case CI_IP_TIMER_TCP_ZWIN:
+  case CI_IP_TIMER_TCP_KALIVE:
+  case CI_IP_TIMER_TCP_CORK:
+  case CI_IP_TIMER_TCP_PACE:
+    return NI_OPTS(netif).tcp_timer_coalesce;
+  default:
+    return 0;
+  }
+}
+
+
+#define CI_TCP_COALESCED_TIMERS(ts)                                     \
+  { &(ts)->rto_tid, &(ts)->delack_tid, &(ts)->zwin_tid,                 \
+    &(ts)->kalive_tid, &(ts)->cork_tid, &(ts)->pace_tid }
+
+
+/* Make sure coalesce_tid fires no later than the earliest pending timer
+ * of [ts]. */
+static void ci_tcp_timer_coalesce_arm(ci_netif* netif, ci_tcp_state* ts)
+{
+  ci_ip_timer* timers[] = CI_TCP_COALESCED_TIMERS(ts);
+  ci_ip_timer* master = &ts->coalesce_tid;
+  ci_iptime_t t = 0;
+  int i, found = 0;
+
+  for( i = 0; i < CI_ARRAY_SIZE(timers); ++i )
+    if( ci_ip_timer_pending(netif, timers[i]) &&
+        (! found || TIME_LT(timers[i]->time, t)) ) {
+      t = timers[i]->time;
+      found = 1;
+    }
+  if( ! found )
+    return;
+
+  if( ! ci_ip_timer_pending(netif, master) )
+    __ci_ip_timer_set(netif, master, t);
+  else if( TIME_LT(t, master->time) )
+    ci_ip_timer_modify(netif, master, t);
+}
+
+
+static void ci_ip_timer_coalesce_set(ci_netif* netif, ci_ip_timer* ts,
+                                     ci_iptime_t t)
+{
+  ci_tcp_state* tcp = SP_TO_TCP(netif, oo_statep_to_sockp(netif, ts->statep));
+  ci_ip_timer* master = &tcp->coalesce_tid;
+
+  ts->time = t;
+  oo_p_dllink_add_tail(netif,
+                   oo_p_dllink_ptr(netif, &IPTIMER_STATE(netif)->coalesce_list),
+                   oo_p_dllink_statep(netif, ts->statep));
+
+  if( ! ci_ip_timer_pending(netif, master) )
+    __ci_ip_timer_set(netif, master, t);
+  else if( TIME_LT(t, master->time) )
+    ci_ip_timer_modify(netif, master, t);
+}
+
+
 /* insert a non-pending timer into the scheduler */
 void __ci_ip_timer_set(ci_netif *netif, ci_ip_timer *ts, ci_iptime_t t)
 {
@@ -157,6 +231,12 @@ void __ci_ip_timer_set(ci_netif *netif, ci_ip_timer *ts, ci_iptime_t t)
   ci_iptime_t stime = IPTIMER_STATE(netif)->sched_ticks;
 
   ci_assert(TIME_GT(t, stime));
+
+  if( ci_ip_timer_is_coalesced(netif, ts) ) {
+    ci_ip_timer_coalesce_set(netif, ts, t);
+    return;
+  }
+
   /* this is absolute time */
   ts->time = t;
 
@@ -226,6 +306,16 @@ static int ci_ip_timer_cascadewheel(ci_netif* netif, int wheelno,
   LOG_ITV(log(LN_FMT "cascading wheel=%u sched_ticks=0x%x bucket=%i",
 	      LN_PRI_ARGS(netif), wheelno, stime, IPTIMER_BUCKETNO(wheelno, stime)));
 
+  /* With a cascade budget, just park the whole bucket for
+   * ci_ip_timer_cascade_drain() to redistribute a bit at a time. */
+  if( NI_OPTS(netif).timer_cascade_budget ) {
+    oo_p_dllink_splice_tail(netif, bucket,
+                            oo_p_dllink_ptr(netif,
+                                    &IPTIMER_STATE(netif)->cascade_list));
+    oo_p_dllink_init(netif, bucket);
+    return 0;
+  }
+
   /* ditch the timers in this dll, pointers held in cur & lastp */
   cur = oo_p_dllink_statep(netif, bucket.l->next);
   lastp = bucket.p;
@@ -276,6 +366,74 @@ static int ci_ip_timer_cascadewheel(ci_netif* netif, int wheelno,
   return changed;
 }
 
+/* Reinsert up to *budget timers from the cascade list into the wheels.
+ * Timers that have become due while waiting are made to fire at the
+ * current tick if [firing] (i.e. its bucket is yet to be run), else at the
+ * next.  Returns true if anything was added to wheel0.
+ */
+static int ci_ip_timer_cascade_drain(ci_netif* netif, int* budget,
+                                     int firing)
+{
+  ci_ip_timer_state* ipts = IPTIMER_STATE(netif);
+  ci_iptime_t stime = ipts->sched_ticks;
+  struct oo_p_dllink_state list = oo_p_dllink_ptr(netif, &ipts->cascade_list);
+  struct oo_p_dllink_state link;
+  ci_ip_timer* ts;
+  int changed = 0;
+
+  while( *budget > 0 && ! oo_p_dllink_is_empty(netif, list) ) {
+    link = oo_p_dllink_statep(netif, list.l->next);
+    oo_p_dllink_del(netif, link);
+    ts = LINK2TIMER(link.l);
+    --*budget;
+
+    if( TIME_GT(ts->time, stime) ) {
+      __ci_ip_timer_set(netif, ts, ts->time);
+      changed |= (ts->time & IPTIMER_WHEEL0_MASK) ==
+                 (stime & IPTIMER_WHEEL0_MASK);
+    }
+    else if( firing ) {
+      ts->time = stime;
+      oo_p_dllink_add_tail(netif, IPTIMER_BUCKET(netif, 0, stime), link);
+      __ci_timer_busy_set(netif, stime);
+      changed = 1;
+    }
+    else {
+      __ci_ip_timer_set(netif, ts, stime + 1);
+      changed = 1;
+    }
+  }
+  return changed;
+}
+
+
+static void ci_ip_timer_docallback(ci_netif *netif, ci_ip_timer* ts);
+
+/* The coalesced timer of a TCP socket has fired: run whichever of its
+ * timers are due, and rearm for the rest. */
+static void ci_tcp_timeout_coalesce(ci_netif* netif, ci_tcp_state* ts)
+{
+  ci_ip_timer* timers[] = CI_TCP_COALESCED_TIMERS(ts);
+  ci_iptime_t stime = IPTIMER_STATE(netif)->sched_ticks;
+  int i;
+
+  for( i = 0; i < CI_ARRAY_SIZE(timers); ++i ) {
+    ci_ip_timer* t = timers[i];
+    if( ci_ip_timer_pending(netif, t) && TIME_LE(t->time, stime) ) {
+      oo_p_dllink_del_init(netif, oo_p_dllink_statep(netif, t->statep));
+      /* May be late if we were held up on the cascade list. */
+      t->time = stime;
+      ci_ip_timer_docallback(netif, t);
+      /* The callback may have dropped the connection, and even freed the
+       * socket, in which case its timers have been stopped. */
+      if( ts->s.b.state & CI_TCP_STATE_NO_TIMERS )
+        return;
+    }
+  }
+  ci_tcp_timer_coalesce_arm(netif, ts);
+}
+
+
 /* unpick the ci_ip_timer structure to actually do the callback */ 
 static void ci_ip_timer_docallback(ci_netif *netif, ci_ip_timer* ts)
 {
@@ -313,6 +471,16 @@ static void ci_ip_timer_docallback(ci_netif *netif, ci_ip_timer* ts)
     sp = oo_statep_to_sockp(netif, ts->statep);
     ci_tcp_timeout_cork(netif, SP_TO_TCP(netif, sp));
     break;
+  case CI_IP_TIMER_TCP_PACE:
+    sp = oo_statep_to_sockp(netif, ts->statep);
+    CHECK_TS(netif, SP_TO_TCP(netif, sp));
+    ci_tcp_timeout_pace(netif, SP_TO_TCP(netif, sp));
+    break;
+  case CI_IP_TIMER_TCP_COALESCE:
+    sp = oo_statep_to_sockp(netif, ts->statep);
+    CHECK_TS(netif, SP_TO_TCP(netif, sp));
+    ci_tcp_timeout_coalesce(netif, SP_TO_TCP(netif, sp));
+    break;
   case CI_IP_TIMER_NETIF_TIMEOUT:
     ci_netif_timeout_state(netif);
     break;
@@ -361,6 +529,9 @@ void ci_ip_timer_poll(ci_netif *netif) {
                                                        &ipts->fire_list);
   struct oo_p_dllink_state bucket;
   struct oo_p_dllink_state link;
+  struct oo_p_dllink_state cascade_list = oo_p_dllink_ptr(netif,
+                                                     &ipts->cascade_list);
+  int budget = NI_OPTS(netif).timer_cascade_budget;
 
   /* The caller is expected to ensure that the current time is sufficiently
   ** up-to-date.
@@ -390,6 +561,9 @@ void ci_ip_timer_poll(ci_netif *netif) {
       changed = ci_ip_timer_cascadewheel(netif, 1, *stime);
     }
 
+    if( ! oo_p_dllink_is_empty(netif, cascade_list) )
+      changed |= ci_ip_timer_cascade_drain(netif, &budget, 1);
+
 
     /* We need to be careful here ... because:
         - ci_ip_timer_docallback can set/clear timers
@@ -427,6 +601,15 @@ void ci_ip_timer_poll(ci_netif *netif) {
 
   OO_P_DLLINK_ASSERT_EMPTY(netif, fire_list);
 
+  if( ! oo_p_dllink_is_empty(netif, cascade_list) ) {
+    changed |= ci_ip_timer_cascade_drain(netif, &budget, 0);
+    /* Keep polling until the cascade list is empty. */
+    if( ! oo_p_dllink_is_empty(netif, cascade_list) ) {
+      ipts->closest_timer = ipts->sched_ticks + 1;
+      return;
+    }
+  }
+
   /* What is our next timer?
    * Let's update if our previous "closest" timer have already been
    * handled, or we have cascaded some more timers into wheel0. */
@@ -556,6 +739,8 @@ static const char* ci_ip_timer_dump(const ci_ip_timer* ts)
     MAKECASE(CI_IP_TIMER_TCP_KALIVE,   "kalive")
     MAKECASE(CI_IP_TIMER_TCP_LISTEN,   "listen")
     MAKECASE(CI_IP_TIMER_TCP_CORK,     "cork")
+    MAKECASE(CI_IP_TIMER_TCP_PACE,     "pace")
+    MAKECASE(CI_IP_TIMER_TCP_COALESCE, "coalesce")
     MAKECASE(CI_IP_TIMER_NETIF_TIMEOUT, "netif")
     MAKECASE(CI_IP_TIMER_PMTU_DISCOVER, "pmtu")
 #if CI_CFG_SUPPORT_STATS_COLLECTION
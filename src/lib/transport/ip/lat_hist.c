@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/**************************************************************************\
+*//*! \file
+** <L5_PRIVATE L5_SOURCE>
+**  \brief  Stack latency histograms (EF_LATENCY_HIST)
+** </L5_PRIVATE>
+*//*
+\**************************************************************************/
+
+#include "ip_internal.h"
+
+
+ci_uint64 ci_lat_hist_bucket_min(unsigned bucket)
+{
+  unsigned order, sub;
+
+  if( bucket < (1u << CI_LAT_HIST_SUB_BITS) )
+    return bucket;
+  order = (bucket >> CI_LAT_HIST_SUB_BITS) + CI_LAT_HIST_SUB_BITS - 1;
+  sub = bucket & ((1u << CI_LAT_HIST_SUB_BITS) - 1);
+  return (ci_uint64) ((1u << CI_LAT_HIST_SUB_BITS) + sub) <<
+         (order - CI_LAT_HIST_SUB_BITS);
+}
+
+
+ci_uint64 ci_lat_hist_count(const ci_lat_hist* h)
+{
+  ci_uint64 count = 0;
+  unsigned i;
+
+  for( i = 0; i < CI_LAT_HIST_BUCKETS; ++i )
+    count += h->bucket[i];
+  return count;
+}
+
+
+ci_uint64 ci_lat_hist_percentile(const ci_lat_hist* h, ci_uint64 count,
+                                 unsigned ppm)
+{
+  /* Rank of the sample we want, counting from 1. */
+  ci_uint64 rank = (count * ppm + 999999) / 1000000;
+  ci_uint64 seen = 0, top;
+  unsigned i;
+
+  if( count == 0 )
+    return 0;
+  if( rank == 0 )
+    rank = 1;
+  for( i = 0; i < CI_LAT_HIST_BUCKETS - 1; ++i ) {
+    seen += h->bucket[i];
+    if( seen >= rank )
+      break;
+  }
+  if( i == CI_LAT_HIST_BUCKETS - 1 )
+    return h->max;
+  top = ci_lat_hist_bucket_min(i + 1) - 1;
+  return CI_MIN(top, h->max);
+}
@@ -50,6 +50,7 @@ LIB_SRCS	:=		\
 		common_sockopts.c \
 		tcp_sockopts.c	\
 		tcp_syncookie.c	\
+		tcp_cong.c	\
 		active_wild.c	\
 		pkt_checksum.c	\
 		netif_dtor.c	\
@@ -68,7 +69,9 @@ LIB_SRCS	+=		\
 		tcp_helper.c	\
 		syscall.c	\
 		per_thread.c	\
-		rwlock.c
+		rwlock.c	\
+		lat_hist.c	\
+		spin_adapt.c
 endif
 
 ifeq ($(DRIVER),1)
@@ -118,6 +121,7 @@ _UK_INTF_HDRS	:= ci/internal/ip_shared_types.h	\
 		ci/internal/opts_netif_def.h		\
 		ci/internal/tcp_stats_count_def.h	\
 		ci/internal/tcp_ext_stats_count_def.h	\
+		ci/internal/lat_hist_def.h		\
 		onload/oo_p_dllist.h			\
 		onload/common.h				\
 		onload/primitive_types.h		\
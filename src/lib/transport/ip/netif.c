@@ -325,6 +325,260 @@ int ci_netif_timewait_try_to_free_filter(ci_netif* ni)
 }
 
 
+/*--------------------------------------------------------------------
+ *
+ * Timewait table (EF_TCP_TIMEWAIT_TABLE)
+ *
+ * An orphaned connection that enters TIME_WAIT can be moved into this
+ * table, which frees its endpoint.  The table is open-addressed with
+ * double hashing, in the same way as the table of previous sequence
+ * numbers, and entries are expired lazily when the lookup path crosses
+ * them.
+ *
+ *--------------------------------------------------------------------*/
+
+#define TCP_TIMEWAIT_DEPTH_LIMIT 16
+
+
+ci_inline unsigned
+ci_netif_timewait_hash1(ci_netif* ni, ci_uint32 laddr_be32,
+                        ci_uint16 lport_be16, ci_uint32 raddr_be32,
+                        ci_uint16 rport_be16)
+{
+  return __onload_hash1(ni->state->timewait_table_entries_n - 1,
+                        laddr_be32, lport_be16, raddr_be32, rport_be16,
+                        IPPROTO_TCP);
+}
+
+
+ci_inline unsigned
+ci_netif_timewait_hash2(ci_uint32 laddr_be32, ci_uint16 lport_be16,
+                        ci_uint32 raddr_be32, ci_uint16 rport_be16)
+{
+  return __onload_hash2(laddr_be32, lport_be16, raddr_be32, rport_be16,
+                        IPPROTO_TCP);
+}
+
+
+/* Removes route_count indexes along the look-up path of [tw_val] up to and
+ * including [tw_entry]. */
+static void
+__ci_netif_timewait_free(ci_netif* ni, const ci_tcp_timewait_t* tw_val,
+                         const ci_tcp_timewait_t* tw_entry)
+{
+  unsigned hash, hash2 = 0;
+  int depth = 0;
+
+  hash = ci_netif_timewait_hash1(ni, tw_val->laddr_be32, tw_val->lport_be16,
+                                 tw_val->raddr_be32, tw_val->rport_be16);
+
+  do {
+    ci_tcp_timewait_t* tw = &ni->timewait_table[hash];
+    ci_assert_lt(hash, ni->state->timewait_table_entries_n);
+
+    ci_assert_gt(tw->route_count, 0);
+    --tw->route_count;
+
+    if( tw == tw_entry )
+      return;
+    if( hash2 == 0 )
+      hash2 = ci_netif_timewait_hash2(tw_val->laddr_be32, tw_val->lport_be16,
+                                      tw_val->raddr_be32, tw_val->rport_be16);
+    hash = (hash + hash2) & (ni->state->timewait_table_entries_n - 1);
+    depth++;
+    ci_assert_le(depth, TCP_TIMEWAIT_DEPTH_LIMIT);
+    if(CI_UNLIKELY( depth > TCP_TIMEWAIT_DEPTH_LIMIT )) {
+      LOG_U(ci_log("%s: reached search depth", __FUNCTION__));
+      break;
+    }
+  } while( 1 );
+}
+
+
+void ci_netif_timewait_free(ci_netif* ni, ci_tcp_timewait_t* tw)
+{
+  __ci_netif_timewait_free(ni, tw, tw);
+  tw->laddr_be32 = 0;
+}
+
+
+static void
+__ci_netif_timewait_insert(ci_netif* ni, const ci_tcp_timewait_t* tw_val)
+{
+  unsigned hash, hash2 = 0;
+  /* Oldest amongst the entries that we've traversed. */
+  ci_tcp_timewait_t* oldest = NULL;
+  ci_tcp_timewait_t* tw;
+  int depth;
+
+  hash = ci_netif_timewait_hash1(ni, tw_val->laddr_be32, tw_val->lport_be16,
+                                 tw_val->raddr_be32, tw_val->rport_be16);
+
+  for( depth = 0; depth < TCP_TIMEWAIT_DEPTH_LIMIT; ++depth ) {
+    tw = &ni->timewait_table[hash];
+    ci_assert_lt(hash, ni->state->timewait_table_entries_n);
+
+    ci_assert_impl(CI_TCP_TIMEWAIT_IS_TERMINAL(*tw),
+                   CI_TCP_TIMEWAIT_IS_FREE(*tw));
+    ++tw->route_count;
+
+    if( CI_TCP_TIMEWAIT_IS_FREE(*tw) ) {
+      break;
+    }
+    else if( TIME_LE(tw->expiry, ci_ip_time_now(ni)) ) {
+      ci_netif_timewait_free(ni, tw);
+      CITP_STATS_NETIF_INC(ni, tcp_timewait_table_expiries);
+      break;
+    }
+    else if( oldest == NULL || TIME_LT(tw->expiry, oldest->expiry) ) {
+      oldest = tw;
+    }
+
+    if( hash2 == 0 )
+      hash2 = ci_netif_timewait_hash2(tw_val->laddr_be32, tw_val->lport_be16,
+                                      tw_val->raddr_be32, tw_val->rport_be16);
+    hash = (hash + hash2) & (ni->state->timewait_table_entries_n - 1);
+  }
+
+  if( depth >= TCP_TIMEWAIT_DEPTH_LIMIT ) {
+    ci_assert(oldest);
+    /* Roll back the route count updates made above, purge the oldest entry
+     * on the path and try again.  This time there is a free entry. */
+    __ci_netif_timewait_free(ni, tw_val, tw);
+    ci_netif_timewait_free(ni, oldest);
+    CITP_STATS_NETIF_INC(ni, tcp_timewait_table_purgations);
+    __ci_netif_timewait_insert(ni, tw_val);
+    return;
+  }
+
+  tw->laddr_be32 = tw_val->laddr_be32;
+  tw->raddr_be32 = tw_val->raddr_be32;
+  tw->lport_be16 = tw_val->lport_be16;
+  tw->rport_be16 = tw_val->rport_be16;
+  tw->snd_nxt = tw_val->snd_nxt;
+  tw->rcv_nxt = tw_val->rcv_nxt;
+  tw->tsrecent = tw_val->tsrecent;
+  tw->expiry = tw_val->expiry;
+  tw->flags = tw_val->flags;
+}
+
+
+/* Returns the entry for the given four-tuple, or NULL if there is none or
+ * it has expired. */
+ci_tcp_timewait_t*
+ci_netif_timewait_lookup(ci_netif* ni, ci_uint32 laddr_be32,
+                         ci_uint16 lport_be16, ci_uint32 raddr_be32,
+                         ci_uint16 rport_be16)
+{
+  unsigned hash, hash2 = 0;
+  int depth;
+
+  ci_assert(ci_netif_is_locked(ni));
+
+  if( ni->state->timewait_table_entries_n == 0 )
+    return NULL;
+
+  hash = ci_netif_timewait_hash1(ni, laddr_be32, lport_be16,
+                                 raddr_be32, rport_be16);
+
+  for( depth = 0; depth < TCP_TIMEWAIT_DEPTH_LIMIT; ++depth ) {
+    ci_tcp_timewait_t* tw = &ni->timewait_table[hash];
+    ci_assert_lt(hash, ni->state->timewait_table_entries_n);
+
+    if( CI_TCP_TIMEWAIT_IS_TERMINAL(*tw) )
+      return NULL;
+    if( tw->laddr_be32 == laddr_be32 && tw->lport_be16 == lport_be16 &&
+        tw->raddr_be32 == raddr_be32 && tw->rport_be16 == rport_be16 ) {
+      if( TIME_LE(tw->expiry, ci_ip_time_now(ni)) ) {
+        ci_netif_timewait_free(ni, tw);
+        CITP_STATS_NETIF_INC(ni, tcp_timewait_table_expiries);
+        return NULL;
+      }
+      return tw;
+    }
+
+    if( hash2 == 0 )
+      hash2 = ci_netif_timewait_hash2(laddr_be32, lport_be16,
+                                      raddr_be32, rport_be16);
+    hash = (hash + hash2) & (ni->state->timewait_table_entries_n - 1);
+  }
+
+  return NULL;
+}
+
+
+/* If the four-tuple is in the timewait table, removes it and returns the
+ * sequence number to base the next connection's ISN on, as for reuse of a
+ * socket in TIME_WAIT.  Otherwise returns 0. */
+ci_uint32 ci_netif_timewait_reuse(ci_netif* ni, ci_uint32 laddr_be32,
+                                  ci_uint16 lport_be16, ci_uint32 raddr_be32,
+                                  ci_uint16 rport_be16)
+{
+  ci_tcp_timewait_t* tw;
+  ci_uint32 seq;
+
+  tw = ci_netif_timewait_lookup(ni, laddr_be32, lport_be16,
+                                raddr_be32, rport_be16);
+  if( tw == NULL )
+    return 0;
+
+  seq = tw->snd_nxt + NI_OPTS(ni).tcp_isn_offset;
+  if( seq == 0 )
+    seq = 1;
+  ci_netif_timewait_free(ni, tw);
+  CITP_STATS_NETIF_INC(ni, tcp_timewait_table_reuses);
+  return seq;
+}
+
+
+/* Called for a connection in TIME_WAIT.  If the connection can be kept in
+ * the timewait table then moves it there and drops [ts], which must not be
+ * touched again.  Returns true if that happened.
+ *
+ * Packets for the four-tuple must still reach this stack once the socket's
+ * filters are gone, so connections with their own hardware filter keep
+ * their endpoint, as do loopback connections.  We also leave alone those
+ * whose sequence number is in the table of previous sequence numbers, so
+ * that the four-tuple is known to only one of the tables.
+ */
+int ci_netif_timewait_compact(ci_netif* ni, ci_tcp_state* ts)
+{
+  ci_tcp_timewait_t tw;
+
+  CI_BUILD_ASSERT(sizeof(ci_tcp_timewait_t) == 32);
+  ci_assert(ci_netif_is_locked(ni));
+  ci_assert_equal(ts->s.b.state, CI_TCP_TIME_WAIT);
+
+  if( ni->state->timewait_table_entries_n == 0 ||
+      (ts->s.b.sb_aflags & (CI_SB_AFLAG_ORPHAN |
+                            CI_SB_AFLAG_TCP_IN_ACCEPTQ))
+        != CI_SB_AFLAG_ORPHAN ||
+      (ts->s.s_flags & CI_SOCK_FLAG_FILTER) ||
+      (ts->tcpflags & CI_TCPT_FLAG_SEQNO_REMEMBERED) ||
+      OO_SP_NOT_NULL(ts->local_peer) ||
+      ipcache_af(&ts->s.pkt) != AF_INET )
+    return 0;
+
+  tw.laddr_be32 = tcp_laddr_be32(ts);
+  tw.raddr_be32 = tcp_raddr_be32(ts);
+  tw.lport_be16 = tcp_lport_be16(ts);
+  tw.rport_be16 = tcp_rport_be16(ts);
+  tw.snd_nxt = tcp_snd_nxt(ts);
+  tw.rcv_nxt = tcp_rcv_nxt(ts);
+  tw.tsrecent = ts->tsrecent;
+  tw.expiry = ts->t_last_sent;
+  tw.flags = (ts->tcpflags & CI_TCPT_FLAG_TSO) ? CI_TCP_TIMEWAIT_FLAG_TSO : 0;
+  ci_assert(tw.laddr_be32 != 0);
+
+  __ci_netif_timewait_insert(ni, &tw);
+  CITP_STATS_NETIF_INC(ni, tcp_timewait_table_insertions);
+  LOG_TC(log(LPF "%d TIME_WAIT moved to timewait table", S_FMT(ts)));
+
+  ci_tcp_drop(ni, ts, 0);
+  return 1;
+}
+
+
 /*--------------------------------------------------------------------
  *
  * FIN_WAIT2 handling
@@ -1290,6 +1544,14 @@ void ci_netif_unlock(ci_netif* ni)
   ci_assert_nflags(ni->state->flags, CI_NETIF_FLAG_PKT_ACCOUNT_PENDING);
 
   ci_assert_equal(ni->state->in_poll, 0);
+#ifndef __KERNEL__
+  if(CI_UNLIKELY( ni->lock_frc != 0 )) {
+    ci_uint64 now_frc;
+    ci_frc64(&now_frc);
+    CI_LAT_HIST_RECORD(ni, netif_lock, now_frc - ni->lock_frc);
+    ni->lock_frc = 0;
+  }
+#endif
   if(CI_LIKELY( ni->state->lock.lock == CI_EPLOCK_LOCKED &&
                 ci_cas64u_succeed(&ni->state->lock.lock,
                                   CI_EPLOCK_LOCKED, 0) ))
@@ -1368,6 +1630,7 @@ ci_netif_put_ready_list_one(ci_netif* ni, struct oo_p_dllink_state list,
     oo_p_dllink_del(ni, lnk);
     oo_p_dllink_init(ni, lnk);
     SP_TO_WAITABLE(ni, epoll->sock_id)->ready_lists_in_use &=~ (1 << id);
+    ci_atomic32_and(&epoll->ring_queued, ~(1u << id));
   }
 }
 
@@ -1377,6 +1640,8 @@ static void ci_netif_put_ready_list_locked(ci_netif* ni, int id)
                                         &ni->state->ready_lists[id]), id);
   ci_netif_put_ready_list_one(ni, oo_p_dllink_ptr(ni,
                                         &ni->state->unready_lists[id]), id);
+  /* Nothing consumes the ring now, so discard whatever is left in it. */
+  ni->state->ready_rings[id].removed = ni->state->ready_rings[id].added;
   ni->state->ready_lists_in_use &= ~(1 << id);
   ni->state->ready_list_pid[id] = 0;
 }
@@ -259,6 +259,7 @@ static void ci_netif_dump_pkt_summary(ci_netif* ni, oo_dump_log_fn_t logger,
                                       void* log_arg)
 {
   int intf_i, rx_ring = 0, tx_ring = 0, tx_oflow = 0, used, rx_queued, i;
+  int node;
   ci_netif_state* ns = ni->state;
 
   logger(log_arg, "  pkt_sets: pkt_size=%d set_size=%d max=%d alloc=%d",
@@ -266,10 +267,26 @@ static void ci_netif_dump_pkt_summary(ci_netif* ni, oo_dump_log_fn_t logger,
          ni->packets->sets_n);
 
   for( i = 0; i < ni->packets->sets_n; i++ ) {
-    logger(log_arg, "  pkt_set[%d]: free=%d%s", i, ni->packets->set[i].n_free,
+    logger(log_arg, "  pkt_set[%d]: free=%d node=%d%s", i,
+           ni->packets->set[i].n_free, ni->packets->set[i].numa_node,
            i == ni->packets->id ? " current" : "");
   }
 
+  /* Per-node usage.  Nodes are limited to the width of the mask. */
+  for( node = 0; node < 32; node++ ) {
+    int sets = 0, n_free = 0;
+    if( ! (ns->packet_alloc_numa_nodes & (1u << node)) )
+      continue;
+    for( i = 0; i < ni->packets->sets_n; i++ )
+      if( ni->packets->set[i].numa_node == node ) {
+        ++sets;
+        n_free += ni->packets->set[i].n_free;
+      }
+    logger(log_arg, "  pkt_node[%d]: sets=%d alloc=%d free=%d%s", node, sets,
+           sets * PKTS_PER_SET, n_free,
+           node == ns->pkt_numa_node ? " preferred" : "");
+  }
+
   rx_ring = 0;
   tx_ring = 0;
   OO_STACK_FOR_EACH_INTF_I(ni, intf_i) {
@@ -294,6 +311,15 @@ static void ci_netif_dump_pkt_summary(ci_netif* ni, oo_dump_log_fn_t logger,
   logger(log_arg, "  pkt_bufs: in_loopback=%d in_sock=%d", ns->n_looppkts,
          used - ns->n_rx_pkts - ns->n_looppkts - tx_ring - tx_oflow);
   logger(log_arg, "  pkt_bufs: rx_reserved=%d", ns->reserved_pktbufs);
+  if( NI_OPTS(ni).tx_pkt_magazine ) {
+    ci_uint64 allocs = ns->stats.pkt_mag_hits + ns->stats.pkt_mag_misses;
+    logger(log_arg, "  pkt_mag: hits=%"CI_PRIu64" misses=%u hit_ratio=%u%% "
+           "empty=%u contends=%u flushes=%u", ns->stats.pkt_mag_hits,
+           ns->stats.pkt_mag_misses,
+           allocs ? (unsigned) (ns->stats.pkt_mag_hits * 100 / allocs) : 0,
+           ns->stats.pkt_mag_empty, ns->stats.pkt_mag_contends,
+           ns->stats.pkt_mag_flushes);
+  }
 }
 
 
@@ -552,8 +578,8 @@ void ci_netif_dump_extra_to_logger(ci_netif* ni, oo_dump_log_fn_t logger,
   logger(log_arg, "  hwport_to_intf_i=%s intf_i_to_hwport=%s", hp2i, i2hp);
   logger(log_arg, "  uk_intf_ver=%s", OO_UK_INTF_VER);
   logger(log_arg, "  deferred count %d/%d", ns->defer_work_count, NI_OPTS(ni).defer_work_limit);
-  logger(log_arg, "  numa nodes: creation=%d load=%d",
-         ns->creation_numa_node, ns->load_numa_node);
+  logger(log_arg, "  numa nodes: creation=%d load=%d packet=%d",
+         ns->creation_numa_node, ns->load_numa_node, ns->pkt_numa_node);
   logger(log_arg, "  numa node masks: packet alloc=%x sock alloc=%x interrupt=%x",
          ns->packet_alloc_numa_nodes, ns->sock_alloc_numa_nodes,
          ns->interrupt_numa_nodes);
@@ -915,6 +941,19 @@ void ci_netif_dump_to_logger(ci_netif* ni, oo_dump_log_fn_t logger,
 
   logger(log_arg, "  sock_bufs: max=%u n_allocated=%u free=%u",
          NI_OPTS(ni).max_ep_bufs, ns->n_ep_bufs, ns->free_eps_num);
+  if( ns->timewait_table_entries_n != 0 ) {
+    unsigned j, n_used = 0, n_live = 0;
+    for( j = 0; j < ns->timewait_table_entries_n; ++j ) {
+      const ci_tcp_timewait_t* tw = &ni->timewait_table[j];
+      if( ! CI_TCP_TIMEWAIT_IS_FREE(*tw) ) {
+        ++n_used;
+        if( TIME_GT(tw->expiry, ci_ip_time_now(ni)) )
+          ++n_live;
+      }
+    }
+    logger(log_arg, "  timewait_table: entries=%u used=%u live=%u",
+           ns->timewait_table_entries_n, n_used, n_live);
+  }
   /* aux buffers number is limited by tcp_synrecv_max*2 */
   logger(log_arg, "  aux_bufs: free=%u",
          ns->n_free_aux_bufs);
@@ -967,13 +1006,16 @@ void ci_netif_dump_to_logger(ci_netif* ni, oo_dump_log_fn_t logger,
   {
     int i, tmp;
     CI_READY_LIST_EACH(ns->ready_lists_in_use, tmp, i)
-      logger(log_arg, "  readylist: id=%d pid=%d ready=%s unready=%s flags=%x", i,
+      logger(log_arg, "  readylist: id=%d pid=%d ready=%s unready=%s flags=%x "
+             "ring=%u/%d", i,
            ns->ready_list_pid[i],
            oo_p_dllink_is_empty(ni, oo_p_dllink_ptr(ni, &ns->ready_lists[i]))
                                                 ? "EMPTY":"yes",
            oo_p_dllink_is_empty(ni, oo_p_dllink_ptr(ni, &ns->unready_lists[i]))
                                                 ? "EMPTY":"yes",
-           ns->ready_list_flags[i]);
+           ns->ready_list_flags[i],
+           ns->ready_rings[i].added - ns->ready_rings[i].removed,
+           CI_NI_READY_RING_SIZE);
   }
 #endif
   OO_STACK_FOR_EACH_INTF_I(ni, intf_i)
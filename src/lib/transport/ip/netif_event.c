@@ -245,6 +245,92 @@ static inline unsigned unexpected_rx_log_flag(ci_ip_pkt_fmt* pkt)
          CI_TP_LOG_NR : CI_TP_LOG_U;
 }
 
+#if CI_CFG_STATS_NETIF
+/* Count [n] in the histogram of stats [name]_1 to [name]_16_plus. */
+#define RX_BATCH_HIST_INC(ni, name, n)                                  \
+  do {                                                                  \
+    if( (n) < 2 )        ++(ni)->state->stats.name##_1;                 \
+    else if( (n) < 4 )   ++(ni)->state->stats.name##_2_3;               \
+    else if( (n) < 8 )   ++(ni)->state->stats.name##_4_7;               \
+    else if( (n) < 16 )  ++(ni)->state->stats.name##_8_15;              \
+    else                 ++(ni)->state->stats.name##_16_plus;           \
+  } while( 0 )
+#else
+#define RX_BATCH_HIST_INC(ni, name, n)  do{}while(0)
+#endif
+
+ci_inline int rx_batch_same_flow(ci_ip_pkt_fmt* a, ci_ip_pkt_fmt* b)
+{
+  ci_ip4_hdr* ip_a = oo_ip_hdr(a);
+  ci_ip4_hdr* ip_b = oo_ip_hdr(b);
+  ci_tcp_hdr* tcp_a = (ci_tcp_hdr*) ((char*) ip_a + CI_IP4_IHL(ip_a));
+  ci_tcp_hdr* tcp_b = (ci_tcp_hdr*) ((char*) ip_b + CI_IP4_IHL(ip_b));
+
+  return tcp_a->tcp_source_be16 == tcp_b->tcp_source_be16 &&
+         tcp_a->tcp_dest_be16 == tcp_b->tcp_dest_be16 &&
+         ip_a->ip_saddr_be32 == ip_b->ip_saddr_be32 &&
+         ip_a->ip_daddr_be32 == ip_b->ip_daddr_be32 &&
+         a->intf_i == b->intf_i && a->vlan == b->vlan;
+}
+
+/* Deliver the TCP packets held back by handle_rx_pkt() when EF_RX_BATCH is
+ * set.  Packets are grouped by 4-tuple, interface and VLAN, as the filter
+ * lookup depends on all of them, taking the groups in order of their
+ * first packet, so that order within a connection is preserved.  Each group
+ * is handed to ci_tcp_handle_rx_vec(), which looks up the socket once.
+ *
+ * While the stack is answering SYNs with syncookies, the packets that are
+ * alone in their group are first passed to ci_tcp_syncookie_ack_batch(),
+ * which hashes every pure ACK among them.  That includes any lone ACK on
+ * an established connection, not only those that complete a handshake.
+ */
+static void ci_netif_rx_batch_flush(ci_netif* ni,
+                                    struct ci_netif_poll_state* ps)
+{
+  ci_ip_pkt_fmt* pkts[CI_NETIF_RX_BATCH_MAX];
+  ci_ip_pkt_fmt* singles[CI_NETIF_RX_BATCH_MAX];
+  int group_n[CI_NETIF_RX_BATCH_MAX];
+  int i, j, n = ps->rx_batch_n, n_pkts = 0, n_groups = 0, n_singles = 0;
+
+  if( n == 0 )
+    return;
+  ps->rx_batch_n = 0;
+  RX_BATCH_HIST_INC(ni, rx_batch_size, n);
+
+  /* Packets already taken into an earlier group are nulled. */
+  for( i = 0; i < n; ++i ) {
+    if( OO_PP_IS_NULL(ps->rx_batch[i]) )
+      continue;
+    pkts[n_pkts] = PKT_CHK(ni, ps->rx_batch[i]);
+    group_n[n_groups] = 1;
+    for( j = i + 1; j < n; ++j ) {
+      ci_ip_pkt_fmt* pkt;
+      if( OO_PP_IS_NULL(ps->rx_batch[j]) )
+        continue;
+      pkt = PKT_CHK(ni, ps->rx_batch[j]);
+      if( rx_batch_same_flow(pkts[n_pkts], pkt) ) {
+        pkts[n_pkts + group_n[n_groups]++] = pkt;
+        ps->rx_batch[j] = OO_PP_NULL;
+      }
+    }
+    /* The ACK that completes a handshake is usually alone in the burst.
+     * If data follows it, its cookie is checked by the usual path. */
+    if( group_n[n_groups] == 1 )
+      singles[n_singles++] = pkts[n_pkts];
+    n_pkts += group_n[n_groups++];
+  }
+
+  if( NI_OPTS(ni).tcp_syncookies && n_singles != 0 &&
+      TIME_LT(ci_ip_time_now(ni), ni->state->syncookie_flood_until) )
+    ci_tcp_syncookie_ack_batch(ni, ps, singles, n_singles);
+
+  for( i = 0, j = 0; i < n_groups; j += group_n[i++] ) {
+    RX_BATCH_HIST_INC(ni, rx_batch_group, group_n[i]);
+    ci_tcp_handle_rx_vec(ni, ps, &pkts[j], group_n[i]);
+  }
+  ps->syncookie_n = 0;
+}
+
 static void handle_rx_pkt(ci_netif* netif, struct ci_netif_poll_state* ps,
                           ci_ip_pkt_fmt* pkt)
 {
@@ -321,7 +407,14 @@ static void handle_rx_pkt(ci_netif* netif, struct ci_netif_poll_state* ps,
 
       /* Demux to appropriate protocol. */
       if( ip->ip_protocol == IPPROTO_TCP ) {
-        ci_tcp_handle_rx(netif, ps, pkt, (ci_tcp_hdr*) payload, ip_paylen);
+        if( NI_OPTS(netif).rx_batch ) {
+          if( ps->rx_batch_n == CI_NETIF_RX_BATCH_MAX )
+            ci_netif_rx_batch_flush(netif, ps);
+          ps->rx_batch[ps->rx_batch_n++] = OO_PKT_P(pkt);
+        }
+        else {
+          ci_tcp_handle_rx(netif, ps, pkt, (ci_tcp_hdr*) payload, ip_paylen);
+        }
         CI_IPV4_STATS_INC_IN_DELIVERS( netif );
         return;
       }
@@ -567,9 +660,11 @@ int ci_netif_evq_poll(ci_netif* ni, int intf_i)
    * poll_in_kernel). Note that this whole function is for poll-in-kernel
    * mode, so by default we tune evs_per_poll to be notably larger than the
    * normal default. */
+  ci_netif_tx_lock(ni, intf_i);
   n_evs = ef_eventq_poll(evq, ni->state->events,
              CI_MIN(sizeof(ni->state->events) / sizeof(ni->state->events[0]),
                     evs_per_poll));
+  ci_netif_tx_unlock(ni, intf_i);
 
   /* Converting EVENT_TYPE_RX_REF to EVENT_TYPE_RX is a dirty trick, but we're
    * faced with two problems with X3:
@@ -1353,6 +1448,13 @@ static void process_post_poll_list(ci_netif* ni)
 
 #if CI_CFG_EPOLL3
       lists_need_wake |= sb->ready_lists_in_use;
+      /* The owner of a ready ring may have taken this socket off the ring
+       * and found it not ready before the events that put it on this list
+       * were processed, and then we would have skipped it as already
+       * queued.  Queue it again now that its state is final.
+       */
+      if( NI_OPTS(ni).epoll_ready_ring && sb->ready_lists_in_use != 0 )
+        ci_netif_put_on_post_poll_epoll(ni, sb);
 #endif
 
       if( ! (sb->sb_flags & sb->wake_request) ) {
@@ -1455,7 +1557,7 @@ static void ci_netif_tx_pkt_complete_udp(ci_netif* netif,
 
   us = SP_TO_UDP(netif, pkt->pf.udp.tx_sock_id);
 
-  ci_udp_dec_tx_count(us, pkt);
+  ci_udp_dec_tx_count(netif, us, pkt);
 
   if( ci_udp_tx_advertise_space(us) ) {
     if( ! (us->s.b.sb_aflags & CI_SB_AFLAG_ORPHAN) ) {
@@ -1506,7 +1608,7 @@ static void ci_netif_rx_pkt_complete_tcp(ci_netif* ni,
   if( pkt->flags & (CI_PKT_FLAG_TX_TIMESTAMPED | CI_PKT_FLAG_INDIRECT) ) {
     /* This packet is destined for the timestamp_q. We need to check if our
      * removal of the TX_PENDING flag will have caused the return value of
-     * ci_tcp_poll_timestamp_q_nonempty() to have changed. If so, we need to
+     * ci_tcp_poll_errqueue_nonempty() to have changed. If so, we need to
      * wake. The above if() is technically lax, but it's a very quick way of
      * detecting when we can avoid the rest of this code. */
     oo_sp sp = pkt->pf.tcp_tx.sock_id;
@@ -1628,6 +1730,8 @@ static int ci_netif_poll_evq(ci_netif* ni, struct ci_netif_poll_state* ps,
   int i;
   oo_pkt_p pp;
   int completed_tx = 0;
+  ci_uint64 burst_frc = 0;
+  CITP_STATS_NETIF(ci_uint32 burst_rx_evs = 0;)
 #ifdef OO_HAS_POLL_IN_KERNEL
   int poll_in_kernel;
 #endif
@@ -1649,6 +1753,15 @@ static int ci_netif_poll_evq(ci_netif* ni, struct ci_netif_poll_state* ps,
   if( n_evs != 0 )
     goto have_events;
 
+  /* With EF_AF_XDP_BUSY_POLL, have the kernel run the interface's NAPI
+   * context for us when there's nothing to do, instead of waiting for it
+   * to be scheduled.  Anything it finds is picked up below. */
+  if( (ni->state->nic[intf_i].oo_vi_flags & OO_VI_FLAGS_AF_XDP_BUSY_POLL) &&
+      ! ef_eventq_has_event(evq) ) {
+    evq->xdp_kick(evq);
+    CITP_STATS_NETIF_INC(ni, af_xdp_busy_polls);
+  }
+
   do {
 #ifdef OO_HAS_POLL_IN_KERNEL
     if( poll_in_kernel ) {
@@ -1658,7 +1771,12 @@ static int ci_netif_poll_evq(ci_netif* ni, struct ci_netif_poll_state* ps,
     }
     else
 #endif
+    {
+      /* Polling may update the state of the TX ring. */
+      ci_netif_tx_lock(ni, intf_i);
       n_evs = ef_eventq_poll(evq, ev, 16);
+      ci_netif_tx_unlock(ni, intf_i);
+    }
     /* The 16 above is a heuristic. We want a big number for efficiency, but
      * if we go too big then we can totally drain the rxq in one go (made even
      * easier when rx merging is on). We don't refill until after this
@@ -1670,6 +1788,11 @@ static int ci_netif_poll_evq(ci_netif* ni, struct ci_netif_poll_state* ps,
       break;
 
 have_events:
+    if(CI_UNLIKELY( NI_OPTS(ni).lat_hist )) {
+      ci_frc64(&burst_frc);
+      CITP_STATS_NETIF(burst_rx_evs = ni->state->stats.rx_evs);
+    }
+
     /* This loop is implemented with a 1 packet lag on processing (i.e.
      * __handle_rx_pkt() is called for the packet from the previous loop
      * iteration just as the next packet is being picked up, due to a
@@ -1723,7 +1846,9 @@ have_events:
         int n_ids, j;
         ef_vi* vi = CI_NETIF_TX_VI(ni, intf_i, ev[i].tx.q_id);
         CITP_STATS_NETIF_INC(ni, tx_evs);
+        ci_netif_tx_lock(ni, intf_i);
         n_ids = ef_vi_transmit_unbundle(vi, &ev[i], ids);
+        ci_netif_tx_unlock(ni, intf_i);
         ci_assert_ge(n_ids, 0);
         ci_assert_le(n_ids, sizeof(ni->tx_events) / sizeof(ids[0]));
         for( j = 0; j < n_ids; ++j ) {
@@ -1820,6 +1945,7 @@ have_events:
 
       else if( EF_EVENT_TYPE(ev[i]) == EF_EVENT_TYPE_OFLOW ) {
         LOG_E(CI_RLLOG(1, LPF "***** EVENT QUEUE OVERFLOW *****"));
+        ci_netif_rx_batch_flush(ni, ps);
         return 0;
       }
 
@@ -1834,7 +1960,9 @@ have_events:
     }
 
 #ifndef NDEBUG
-    {
+    /* Senders that don't hold the stack lock may be part way through
+     * posting with EF_TX_LOCK_DOMAINS. */
+    if( ! NI_OPTS(ni).tx_lock_domains ) {
       ef_vi* vi = CI_NETIF_TX_VI(ni, intf_i, ev[i].tx_timestamp.q_id);
       if( vi->nic_type.arch != EF_VI_ARCH_AF_XDP ) {
         ci_assert_equiv((ef_vi_transmit_fill_level(vi) == 0 &&
@@ -1846,14 +1974,26 @@ have_events:
 #endif
 
     __handle_rx_pkt(ni, ps, &s.rx_pkt);
+    ci_netif_rx_batch_flush(ni, ps);
+
+    /* Time to deliver the burst, if it contained any received packets. */
+    if(CI_UNLIKELY( burst_frc != 0 )
+       CITP_STATS_NETIF(&& ni->state->stats.rx_evs != burst_rx_evs) ) {
+      ci_uint64 now_frc;
+      ci_frc64(&now_frc);
+      CI_LAT_HIST_RECORD(ni, poll_deliver, now_frc - burst_frc);
+    }
 
     total_evs += n_evs;
   } while( total_evs < NI_OPTS(ni).evs_per_poll );
 
   /* If we've drained the TXQ, we can start trying CTPIO again. */
-  if( completed_tx &&
-      ef_vi_transmit_fill_level(ci_netif_vi(ni, intf_i)) == 0 )
-    ci_netif_ctpio_resume(ni, intf_i);
+  if( completed_tx ) {
+    ci_netif_tx_lock(ni, intf_i);
+    if( ef_vi_transmit_fill_level(ci_netif_vi(ni, intf_i)) == 0 )
+      ci_netif_ctpio_resume(ni, intf_i);
+    ci_netif_tx_unlock(ni, intf_i);
+  }
 
   if( s.frag_pkt != NULL ) {
     s.frag_pkt->pay_len = s.frag_bytes;
@@ -1878,6 +2018,8 @@ ci_inline int ci_netif_poll_intf(ci_netif* ni, int intf_i, int max_evs)
   ci_assert(ci_netif_is_locked(ni));
   ps.tx_pkt_free_list_insert = &ps.tx_pkt_free_list;
   ps.tx_pkt_free_list_n = 0;
+  ps.rx_batch_n = 0;
+  ps.syncookie_n = 0;
 
   do {
     rc = ci_netif_poll_evq(ni, &ps, intf_i, 0);
@@ -1975,6 +2117,8 @@ int ci_netif_poll_intf_future(ci_netif* ni, int intf_i, ci_uint64 start_frc)
 
   ps.tx_pkt_free_list_insert = &ps.tx_pkt_free_list;
   ps.tx_pkt_free_list_n = 0;
+  ps.rx_batch_n = 0;
+  ps.syncookie_n = 0;
 
   /* We expect the completion event within a microsecond or so. The timeout
    * of 10us is to avoid wedging the stack in the case of hardware
@@ -1982,7 +2126,12 @@ int ci_netif_poll_intf_future(ci_netif* ni, int intf_i, ci_uint64 start_frc)
    */
   max_spin = IPTIMER_STATE(ni)->khz / 100;
   ci_prefetch(pkt->dma_start + CI_CACHE_LINE_SIZE);
-  while( (rc = future_poll(evq, ev, EF_VI_EVENT_POLL_MIN_EVS)) == 0 ) {
+  while( 1 ) {
+    ci_netif_tx_lock(ni, intf_i);
+    rc = future_poll(evq, ev, EF_VI_EVENT_POLL_MIN_EVS);
+    ci_netif_tx_unlock(ni, intf_i);
+    if( rc != 0 )
+      break;
     ci_frc64(&now_frc);
     if( now_frc - start_frc > max_spin ) {
       CITP_STATS_NETIF_INC(ni, rx_future_rollback_timeout);
@@ -196,6 +196,7 @@ void ci_netif_state_init(ci_netif* ni, int cpu_khz, const char* name)
     oo_p_dllink_init(ni, oo_p_dllink_ptr(ni, &nis->ready_lists[i]));
     oo_p_dllink_init(ni, oo_p_dllink_ptr(ni, &nis->unready_lists[i]));
     nis->ready_list_flags[i] = 0;
+    nis->ready_rings[i].added = nis->ready_rings[i].removed = 0;
   }
 #endif
 
@@ -210,10 +211,13 @@ void ci_netif_state_init(ci_netif* ni, int cpu_khz, const char* name)
 
   for( i = 0; i < nis->seq_table_entries_n; ++i )
     assert_zero(ni->seq_table[i].route_count);
+  for( i = 0; i < nis->timewait_table_entries_n; ++i )
+    assert_zero(ni->timewait_table[i].route_count);
 
   nis->packet_alloc_numa_nodes = 0;
   nis->sock_alloc_numa_nodes = 0;
   nis->interrupt_numa_nodes = 0;
+  nis->pkt_numa_node = -1;
   nis->creation_numa_node = numa_node_id();
   nis->load_numa_node = efab_tcp_driver.load_numa_node;
 
@@ -247,6 +251,7 @@ void ci_netif_state_init(ci_netif* ni, int cpu_khz, const char* name)
 #endif
 
   ci_tcp_rst_cooldown_init(ni);
+  memset(nis->tcp_fastopen_cache, 0, sizeof(nis->tcp_fastopen_cache));
 }
 
 #endif
@@ -283,6 +288,7 @@ static ci_uint32 citp_tcp_time_wait_assassinate = CI_CFG_TIME_WAIT_ASSASSINATE;
 static ci_uint32 citp_tcp_early_retransmit = 3;  /* default as of 3.10 */
 static ci_uint32 citp_tcp_invalid_ratelimit =
                         CI_CFG_TCP_OUT_OF_WINDOW_ACK_RATELIMIT;
+static ci_uint32 citp_tcp_fastopen = EF_TCP_FASTOPEN_CLIENT;
 
 #if CI_CFG_IPV6
 static ci_uint32 citp_auto_flowlabels = CI_AUTO_FLOWLABELS_DEFAULT;
@@ -436,6 +442,14 @@ ci_setup_ipstack_params(void)
     else
       citp_syn_opts &=~ CI_TCPT_FLAG_WSCL;
   }
+  /* Only 1 asks for ECN on outgoing connections.  We don't distinguish
+   * the default of 2, which accepts ECN on incoming connections only. */
+  if (ci_sysctl_get_values("net/ipv4/tcp_ecn", opt, 1) == 0) {
+    if( opt[0] == 1 )
+      citp_syn_opts |= CI_TCPT_FLAG_ECN;
+    else
+      citp_syn_opts &=~ CI_TCPT_FLAG_ECN;
+  }
 
   if (ci_sysctl_get_values("net/ipv4/tcp_dsack", opt, 1) == 0)
     citp_tcp_dsack = opt[0];
@@ -449,6 +463,9 @@ ci_setup_ipstack_params(void)
   if (ci_sysctl_get_values("net/ipv4/tcp_invalid_ratelimit", opt, 1) == 0)
     citp_tcp_invalid_ratelimit = opt[0];
 
+  if (ci_sysctl_get_values("net/ipv4/tcp_fastopen", opt, 1) == 0)
+    citp_tcp_fastopen = opt[0];
+
 #if CI_CFG_IPV6
   if( ci_sysctl_get_values("net/ipv6/auto_flowlabels", opt, 1) == 0 )
     citp_auto_flowlabels = opt[0];
@@ -525,6 +542,7 @@ void ci_netif_config_opts_defaults(ci_netif_config_opts* opts)
                                  citp_tcp_early_retransmit < 4;
     opts->tail_drop_probe = citp_tcp_early_retransmit >= 3;
     opts->oow_ack_ratelimit = citp_tcp_invalid_ratelimit;
+    opts->tcp_fastopen = citp_tcp_fastopen;
 
     opts->acceptq_max_backlog = citp_somaxconn;
 #if CI_CFG_IPV6
@@ -737,6 +755,8 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
     if( opts->spin_usec != 0 )
       opts->int_driven = 0;
   }
+  if( (s = getenv("EF_SPIN_ADAPTIVE")) )
+    opts->spin_adaptive = atoi(s);
 
   if( (s = getenv("EF_INT_DRIVEN")) )
     opts->int_driven = atoi(s);
@@ -810,8 +830,14 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
   else if( opts->poll_in_kernel )
     opts->evs_per_poll = 192;     /* See EF_EVS_PER_POLL documentation */
 #endif
+  if( (s = getenv("EF_RX_BATCH")) )
+    opts->rx_batch = atoi(s);
+  if( (s = getenv("EF_LATENCY_HIST")) )
+    opts->lat_hist = atoi(s);
   if( (s = getenv("EF_TCP_TCONST_MSL")) )
     opts->msl_seconds = atoi(s);
+  if( (s = getenv("EF_TCP_TIMEWAIT_TABLE")) )
+    opts->tcp_timewait_table = atoi(s);
   if( (s = getenv("EF_TCP_FIN_TIMEOUT")) )
     opts->fin_timeout = atoi(s);
   if( (s = getenv("EF_TCP_ADV_WIN_SCALE_MAX")) )
@@ -853,6 +879,8 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
     opts->prefault_packets = atoi(s);
   if ( (s = getenv("EF_MAX_ENDPOINTS")) )
     opts->max_ep_bufs = atoi(s);
+  if ( (s = getenv("EF_FILTER_TABLE_CUCKOO")) )
+    opts->filter_table_cuckoo = atoi(s);
   if ( (s = getenv("EF_ENDPOINT_PACKET_RESERVE")) )
     opts->endpoint_packet_reserve = atoi(s);
   if ( (s = getenv("EF_DEFER_ARP_MAX")) )
@@ -872,6 +900,10 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
 #endif
   if ( (s = getenv("EF_COMPOUND_PAGES_MODE")) )
     opts->compound_pages = atoi(s);
+  if ( (s = getenv("EF_PACKET_NUMA_LOCAL")) )
+    opts->packet_numa_local = atoi(s);
+  if ( (s = getenv("EF_TX_PKT_MAGAZINE")) )
+    opts->tx_pkt_magazine = atoi(s);
   if ( (s = getenv("EF_RXQ_SIZE")) )
     opts->rxq_size = atoi(s);
   if ( (s = getenv("EF_RXQ_LIMIT")) )
@@ -888,6 +920,8 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
     opts->defer_work_limit = atoi(s);
   if( (s = getenv("EF_UDP_SEND_UNLOCK_THRESH")) )
     opts->udp_send_unlock_thresh = atoi(s);
+  if( (s = getenv("EF_UDP_SENDMMSG_BATCH")) )
+    opts->udp_sendmmsg_batch = atoi(s) != 0;
   if( (s = getenv("EF_UDP_PORT_HANDOVER_MIN")) )
     opts->udp_port_handover_min = atoi(s);
   if( (s = getenv("EF_UDP_PORT_HANDOVER_MAX")) )
@@ -958,8 +992,12 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
     opts->tcp_rcvbuf_strict = atoi(s);
   if( (s = getenv("EF_TCP_RCVBUF_MODE")) )
     opts->tcp_rcvbuf_mode = atoi(s);
+  if( (s = getenv("EF_TCP_RX_COALESCE")) )
+    opts->tcp_rx_coalesce = atoi(s);
   if( (s = getenv("EF_POLL_ON_DEMAND")) )
     opts->poll_on_demand = atoi(s);
+  if( (s = getenv("EF_EPOLL_READY_RING")) )
+    opts->epoll_ready_ring = atoi(s);
   if( (s = getenv("EF_INT_REPRIME")) )
     opts->int_reprime = atoi(s);
   if( (s = getenv("EF_NONAGLE_INFLIGHT_MAX")) )
@@ -980,6 +1018,8 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
     opts->udp_send_unlocked = atoi(s);
   if( (s = getenv("EF_UDP_SEND_NONBLOCK_NO_PACKETS_MODE")) )
     opts->udp_nonblock_no_pkts_mode = atoi(s);
+  if( (s = getenv("EF_TX_LOCK_DOMAINS")) )
+    opts->tx_lock_domains = atoi(s);
   if( (s = getenv("EF_UNCONFINE_SYN")) )
     opts->unconfine_syn = atoi(s) != 0;
   if( (s = getenv("EF_BINDTODEVICE_HANDOVER")) )
@@ -1014,6 +1054,8 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
     opts->acceptq_min_backlog = atoi(s);
   if( (s = getenv("EF_ACCEPTQ_MAX_BACKLOG")) )
     opts->acceptq_max_backlog = atoi(s);
+  if( (s = getenv("EF_TCP_ACCEPT_SHARDS")) )
+    opts->tcp_accept_shards = atoi(s);
 
   if ( (s = getenv("EF_TCP_SNDBUF")) )
     opts->tcp_sndbuf_user = atoi(s);
@@ -1115,6 +1157,18 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
     opts->tcp_faststart_loss = atoi(s);
 #endif
 
+  static const char* const cong_algo_opts[] = { "reno", "cubic", "dctcp", 0 };
+  opts->tcp_cong_algo = parse_enum(opts, "EF_TCP_CONG_ALGO", cong_algo_opts,
+                                   "reno");
+  if ( (s = getenv("EF_TCP_PACING")) )
+    opts->tcp_pacing = atoi(s);
+  if ( (s = getenv("EF_TCP_FASTOPEN")) )
+    opts->tcp_fastopen = strtoul(s, NULL, 0);
+  if ( (s = getenv("EF_TCP_TIMER_COALESCE")) )
+    opts->tcp_timer_coalesce = atoi(s);
+  if ( (s = getenv("EF_TIMER_CASCADE_BUDGET")) )
+    opts->timer_cascade_budget = atoi(s);
+
   if ( (s = getenv("EF_RFC_RTO_INITIAL")))
     opts->rto_initial = atoi(s);
   if ( (s = getenv("EF_RFC_RTO_MIN")))
@@ -1316,6 +1370,10 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
 
   if( (s = getenv("EF_AF_XDP_ZEROCOPY")) )
     opts->af_xdp_zerocopy = atoi(s);
+  if( (s = getenv("EF_AF_XDP_BUSY_POLL")) )
+    opts->af_xdp_busy_poll = atoi(s);
+  if( (s = getenv("EF_AF_XDP_BUSY_POLL_BUDGET")) )
+    opts->af_xdp_busy_poll_budget = atoi(s);
 
   if( (s = getenv("EF_ICMP_PKTS")) )
     opts->icmp_msg_max = atoi(s);
@@ -1707,6 +1765,8 @@ static void netif_tcp_helper_build2(ci_netif* ni)
 #endif
   ni->seq_table =
     (ci_tcp_prev_seq_t*) ((char*) ni->state + ni->state->seq_table_ofs);
+  ni->timewait_table =
+    (ci_tcp_timewait_t*) ((char*) ni->state + ni->state->timewait_table_ofs);
   ni->deferred_pkts =
     (struct oo_deferred_pkt*) ((char*) ni->state +
                                ni->state->deferred_pkts_ofs);
@@ -2684,6 +2744,7 @@ static int ci_netif_init(ci_netif* ni, ef_driver_handle fd)
   CI_MAGIC_SET(ni, NETIF_MAGIC);
   ni->flags = 0;
   ni->error_flags = 0;
+  ni->lock_frc = 0;
   ni->cplane_init_net = NULL;
 
   ni->cplane = malloc(sizeof(struct oo_cplane_handle));
@@ -101,15 +101,15 @@ ci_ip_pkt_fmt* __ci_netif_pkt(ci_netif* ni, unsigned id)
 #endif
 
 
-int ci_netif_pktset_best(ci_netif* ni)
+/* Finds the set with the most free packets among those on [numa_node], or
+ * among all sets if [numa_node] is -1. */
+static int ci_netif_pktset_best_on_node(ci_netif* ni, int numa_node)
 {
   int i, ret = -1, n_free = 0;
-  
-  /* Skip search if we know upfront there's no bufset with free packets. */
-  if( ! ni->packets->n_free )
-    return ret;
 
   for( i = 0; i < ni->packets->sets_n; i ++ ) {
+    if( numa_node >= 0 && ni->packets->set[i].numa_node != numa_node )
+      continue;
     if( ni->packets->set[i].n_free > n_free ) {
       n_free = ni->packets->set[i].n_free;
       ret = i;
@@ -125,6 +125,24 @@ int ci_netif_pktset_best(ci_netif* ni)
 }
 
 
+int ci_netif_pktset_best(ci_netif* ni)
+{
+  int ret;
+
+  /* Skip search if we know upfront there's no bufset with free packets. */
+  if( ! ni->packets->n_free )
+    return -1;
+
+  if( NI_OPTS(ni).packet_numa_local && ni->state->pkt_numa_node >= 0 ) {
+    ret = ci_netif_pktset_best_on_node(ni, ni->state->pkt_numa_node);
+    if( ret >= 0 )
+      return ret;
+    CITP_STATS_NETIF_INC(ni, pkt_numa_remote_picks);
+  }
+  return ci_netif_pktset_best_on_node(ni, -1);
+}
+
+
 ci_ip_pkt_fmt* ci_netif_pkt_alloc_slow_ptrerr(ci_netif* ni, int flags)
 {
   /* This is the slow path of ci_netif_pkt_alloc() and
@@ -202,7 +220,7 @@ ci_inline void __ci_dbg_poison_header(ci_ip_pkt_fmt* pkt, ci_uint32 pattern)
 }
 
 
-#if defined(__KERNEL__) && OO_DO_STACK_POLL
+#if OO_DO_STACK_POLL
 void ci_netif_set_merge_atomic_flag(ci_netif* ni)
 {
   ci_uint64 val;
@@ -339,7 +357,7 @@ int ci_netif_pkt_alloc_block(ci_netif* ni, ci_sock_cmn* s,
 
  again:
   if( *p_netif_locked == 0 ) {
-    if( (pkt = ci_netif_pkt_alloc_nonb(ni)) ) {
+    if( (pkt = ci_netif_pkt_alloc_nonb_cached(ni)) ) {
       *p_pkt = pkt;
       return 0;
     }
@@ -378,6 +396,71 @@ int ci_netif_pkt_alloc_block(ci_netif* ni, ci_sock_cmn* s,
 }
 
 
+#ifndef __KERNEL__
+int oo_pkt_magazine_refill(ci_netif* ni, struct oo_pkt_magazine* mag,
+                           int max)
+{
+  volatile ci_uint64* nonb_pkt_pool_ptr = &ni->state->nonb_pkt_pool;
+  ci_uint64 link, new_link;
+  ci_ip_pkt_fmt* pkt;
+  unsigned id;
+  int n;
+
+  ci_assert_equal(mag->n, 0);
+  ci_assert_le(max, OO_PKT_MAGAZINE_MAX);
+
+ again:
+  link = *nonb_pkt_pool_ptr;
+  id = link & 0xffffffff;
+  for( n = 0; n < max && id != 0xffffffff; ++n ) {
+    /* Another thread may be popping these buffers concurrently, in which
+     * case the links we read are stale and the compare-and-swap below will
+     * fail.  Just make sure that we don't follow a link out of range. */
+    if(CI_UNLIKELY( id >= (unsigned) ni->packets->n_pkts_allocated )) {
+      CITP_STATS_NETIF_INC(ni, pkt_mag_contends);
+      goto again;
+    }
+    OO_PP_INIT(ni, mag->pkts[n], id);
+    pkt = PKT(ni, mag->pkts[n]);
+    id = (unsigned) OO_PP_ID(pkt->next);
+  }
+  if( n == 0 ) {
+    CITP_STATS_NETIF_INC(ni, pkt_mag_empty);
+    return 0;
+  }
+
+  /* Pushes to the pool bump the tag in the top half of [link], so the links
+   * that we followed are still valid if this succeeds. */
+  new_link = id | (link & 0xffffffff00000000llu);
+  if( ci_cas64u_fail(nonb_pkt_pool_ptr, link, new_link) ) {
+    CITP_STATS_NETIF_INC(ni, pkt_mag_contends);
+    goto again;
+  }
+  mag->n = n;
+  return n;
+}
+
+
+void oo_pkt_magazine_flush(ci_netif* ni, struct oo_pkt_magazine* mag)
+{
+  ci_ip_pkt_fmt* pkt;
+  int i;
+
+  CITP_STATS_NETIF_ADD(ni, pkt_mag_hits, mag->hits);
+  mag->hits = 0;
+  if( mag->n == 0 )
+    return;
+
+  for( i = 0; i < mag->n - 1; ++i )
+    PKT(ni, mag->pkts[i])->next = mag->pkts[i + 1];
+  pkt = PKT(ni, mag->pkts[mag->n - 1]);
+  ci_netif_pkt_free_nonb_list(ni, mag->pkts[0], pkt);
+  mag->n = 0;
+  CITP_STATS_NETIF_INC(ni, pkt_mag_flushes);
+}
+#endif
+
+
 int ci_netif_pkt_pass_to_kernel(ci_netif* ni, ci_ip_pkt_fmt* pkt)
 {
   ci_assert(ci_netif_is_locked(ni));
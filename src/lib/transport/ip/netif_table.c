@@ -17,6 +17,9 @@
 #include "ip_internal.h"
 #include <onload/hash.h>
 #include "netif_table.h"
+#if ! defined(__KERNEL__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
 
 /* A filter-table entry can be in one of four states:
  *   A. empty non-tombstone;
@@ -65,6 +68,141 @@ set_entry_state(ci_netif_filter_table_entry_fast* entry, ci_uint32 state)
   entry->__id_and_state = __CI_TBL_ID(entry) | state;
 }
 
+
+/* With EF_FILTER_TABLE_CUCKOO the table is instead treated as an array of
+ * cache-line sized buckets, each overlaying eight fast entries.  A bucket
+ * holds seven ways in struct-of-arrays form, so that all of them can be
+ * probed with a couple of vector compares, plus a header word.  A tuple lives
+ * either in its primary bucket, selected by the low bits of __onload_hash3(),
+ * or in an alternate bucket derived from the primary and an 8-bit tag taken
+ * from the same hash.  As the alternate can be found from the tag alone,
+ * entries can be displaced to make room without knowing their tuple.
+ *
+ * Each way is encoded as [state:2][tag:8][id:22], with an all-zero word
+ * meaning empty.  The header word in the eighth lane counts the entries whose
+ * primary bucket is this one but which live in their alternate.  Its state
+ * bits are always zero so that it never matches a probe, and when it is zero
+ * a miss in the primary bucket is final, so that a lookup touches a single
+ * cache line of the table in the common case.
+ *
+ * Candidate entries are verified against the laddr held in the bucket and the
+ * remote address, remote port and protocol of the socket.  The tag is built
+ * so that the bucket index and tag together determine the low 16 bits of
+ * __onload_hash3(); its upper 16 bits are independent of the local port, and
+ * the function has the LPRP (see onload/hash.h), so the local port need not be
+ * checked.  It is kept in the extra state only for ci_netif_filter_dump(). */
+typedef struct {
+#define CUCKOO_WAYS  7
+  ci_uint32 slot[CUCKOO_WAYS + 1];
+  ci_uint32 laddr[CUCKOO_WAYS + 1];
+} ci_netif_filter_bucket;
+
+#define CUCKOO_BUCKET_SHIFT 3
+#define CUCKOO_ID_BITS      22
+#define CUCKOO_ID_MASK      ((1u << CUCKOO_ID_BITS) - 1)
+#define CUCKOO_KEY_MASK     (~CUCKOO_ID_MASK)
+#define CUCKOO_PRIMARY      (1u << 30)
+#define CUCKOO_ALTERNATE    (2u << 30)
+#define CUCKOO_SPILL        CUCKOO_WAYS
+
+#define CUCKOO_ID(slot)     ((slot) & CUCKOO_ID_MASK)
+#define CUCKOO_TAG(slot)    (((slot) >> CUCKOO_ID_BITS) & 0xff)
+
+ci_inline ci_netif_filter_bucket*
+cuckoo_bucket(ci_netif_filter_table* tbl, unsigned bucket)
+{
+  CI_BUILD_ASSERT(sizeof(ci_netif_filter_bucket) ==
+                  sizeof(ci_netif_filter_table_entry_fast) <<
+                  CUCKOO_BUCKET_SHIFT);
+  CI_BUILD_ASSERT(CI_CFG_NETIF_MAX_ENDPOINTS_MAX <= CUCKOO_ID_MASK + 1);
+  return (void*) &tbl->table[bucket << CUCKOO_BUCKET_SHIFT];
+}
+
+ci_inline unsigned cuckoo_bucket_mask(ci_netif_filter_table* tbl)
+{
+  return tbl->table_size_mask >> CUCKOO_BUCKET_SHIFT;
+}
+
+/* The table has at least 2^16 entries and so 2^13 buckets, so the bucket
+ * index always gives bits 0-12 of the hash.  Mixing bits 13-20 with the top
+ * byte, which does not depend on the local port, keeps the tag well
+ * distributed within a bucket while still determining bits 13-15 for the
+ * purposes of the LPRP. */
+ci_inline unsigned cuckoo_tag(unsigned hash)
+{
+  return ((hash >> 13) ^ (hash >> 24)) & 0xff;
+}
+
+/* The offset is odd and so never zero, and the relation is symmetric. */
+ci_inline unsigned
+cuckoo_alt(unsigned bucket, unsigned tag, unsigned bucket_mask)
+{
+  return bucket ^ ((((tag + 1) * 0x5bd1e995u) >> 8 | 1) & bucket_mask);
+}
+
+ci_inline ci_uint32 cuckoo_key(unsigned tag, ci_uint32 state)
+{
+  return state | tag << CUCKOO_ID_BITS;
+}
+
+/* Returns a bitmask of the ways of [bkt] holding [key] for [laddr]. */
+ci_inline unsigned
+cuckoo_match(const ci_netif_filter_bucket* bkt, ci_uint32 key, ci_uint32 laddr)
+{
+#if defined(__AVX2__) && ! defined(__KERNEL__)
+  __m256i slot = _mm256_loadu_si256((const __m256i*) bkt->slot);
+  __m256i addr = _mm256_loadu_si256((const __m256i*) bkt->laddr);
+  slot = _mm256_and_si256(slot, _mm256_set1_epi32(CUCKOO_KEY_MASK));
+  slot = _mm256_cmpeq_epi32(slot, _mm256_set1_epi32(key));
+  addr = _mm256_cmpeq_epi32(addr, _mm256_set1_epi32(laddr));
+  return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(slot, addr)));
+#elif defined(__SSE2__) && ! defined(__KERNEL__)
+  const __m128i key_mask = _mm_set1_epi32(CUCKOO_KEY_MASK);
+  const __m128i key_v = _mm_set1_epi32(key);
+  const __m128i laddr_v = _mm_set1_epi32(laddr);
+  __m128i lo, hi;
+  lo = _mm_and_si128(_mm_loadu_si128((const __m128i*) bkt->slot), key_mask);
+  hi = _mm_and_si128(_mm_loadu_si128((const __m128i*) bkt->slot + 1),
+                     key_mask);
+  lo = _mm_and_si128(_mm_cmpeq_epi32(lo, key_v),
+                     _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)
+                                                     bkt->laddr), laddr_v));
+  hi = _mm_and_si128(_mm_cmpeq_epi32(hi, key_v),
+                     _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)
+                                                     bkt->laddr + 1),
+                                     laddr_v));
+  return _mm_movemask_ps(_mm_castsi128_ps(lo)) |
+         _mm_movemask_ps(_mm_castsi128_ps(hi)) << 4;
+#else
+  unsigned way, mask = 0;
+  for( way = 0; way < CUCKOO_WAYS; ++way )
+    if( (bkt->slot[way] & CUCKOO_KEY_MASK) == key &&
+        bkt->laddr[way] == laddr )
+      mask |= 1u << way;
+  return mask;
+#endif
+}
+
+ci_inline int cuckoo_free_way(const ci_netif_filter_bucket* bkt)
+{
+  int way;
+  for( way = 0; way < CUCKOO_WAYS; ++way )
+    if( bkt->slot[way] == 0 )
+      return way;
+  return -1;
+}
+
+ci_inline ci_uint32 filter_table_id(ci_netif* ni, int filter_id)
+{
+  if( NI_OPTS(ni).filter_table_cuckoo ) {
+    ci_netif_filter_bucket* bkt;
+    bkt = cuckoo_bucket(ni->filter_table, filter_id >> CUCKOO_BUCKET_SHIFT);
+    return CUCKOO_ID(bkt->slot[filter_id & ((1u << CUCKOO_BUCKET_SHIFT) - 1)]);
+  }
+  return ID(&ni->filter_table->table[filter_id]);
+}
+
+
 #if OO_DO_STACK_POLL
 ci_inline void
 set_entry_id(ci_netif_filter_table_entry_fast* entry, ci_uint32 id)
@@ -74,7 +212,7 @@ set_entry_id(ci_netif_filter_table_entry_fast* entry, ci_uint32 id)
 }
 
 #define CI_NETIF_FILTER_ID_TO_SOCK_ID(ni, filter_id)            \
-  OO_SP_FROM_INT((ni), ID(&(ni)->filter_table->table[filter_id]))
+  OO_SP_FROM_INT((ni), filter_table_id((ni), (filter_id)))
 
 #if CI_CFG_IPV6
 #define CI_NETIF_IP6_FILTER_ID_TO_SOCK_ID(ni, filter_id)            \
@@ -82,6 +220,46 @@ set_entry_id(ci_netif_filter_table_entry_fast* entry, ci_uint32 id)
 #endif
 
 
+ci_inline int /*bool*/
+cuckoo_sock_match(ci_sock_cmn* s, unsigned raddr, unsigned rport,
+                  unsigned protocol)
+{
+  return ((raddr    - sock_raddr_be32(s)) |
+          (rport    - sock_rport_be16(s)) |
+          (protocol - sock_protocol(s)  )) == 0;
+}
+
+
+/* Returns table entry index, or -ENOENT if lookup failed. */
+static int
+cuckoo_lookup(ci_netif* netif, unsigned laddr, unsigned lport,
+              unsigned raddr, unsigned rport, unsigned protocol)
+{
+  ci_netif_filter_table* tbl = netif->filter_table;
+  unsigned bucket_mask = cuckoo_bucket_mask(tbl);
+  unsigned hash = __onload_hash3(laddr, lport, raddr, rport, protocol);
+  unsigned bucket = hash & bucket_mask;
+  unsigned tag = cuckoo_tag(hash);
+  ci_netif_filter_bucket* bkt = cuckoo_bucket(tbl, bucket);
+  ci_uint32 key = cuckoo_key(tag, CUCKOO_PRIMARY);
+  unsigned match;
+
+  while( 1 ) {
+    for( match = cuckoo_match(bkt, key, laddr); match; match &= match - 1 ) {
+      int way = ci_ffs64(match) - 1;
+      ci_sock_cmn* s = ID_TO_SOCK(netif, CUCKOO_ID(bkt->slot[way]));
+      if( cuckoo_sock_match(s, raddr, rport, protocol) )
+        return (bucket << CUCKOO_BUCKET_SHIFT) + way;
+    }
+    if( key & CUCKOO_ALTERNATE || bkt->slot[CUCKOO_SPILL] == 0 )
+      return -ENOENT;
+    bucket = cuckoo_alt(bucket, tag, bucket_mask);
+    bkt = cuckoo_bucket(tbl, bucket);
+    key = cuckoo_key(tag, CUCKOO_ALTERNATE);
+  }
+}
+
+
 /* Returns table entry index, or -1 if lookup failed. */
 static int
 ci_ip4_netif_filter_lookup(ci_netif* netif, unsigned laddr, unsigned lport,
@@ -95,6 +273,9 @@ ci_ip4_netif_filter_lookup(ci_netif* netif, unsigned laddr, unsigned lport,
   ci_assert(ci_netif_is_locked(netif));
   ci_assert(netif->filter_table);
 
+  if( NI_OPTS(netif).filter_table_cuckoo )
+    return cuckoo_lookup(netif, laddr, lport, raddr, rport, protocol);
+
   tbl = netif->filter_table;
   hash1 = __onload_hash1(tbl->table_size_mask, laddr, lport,
                        raddr, rport, protocol);
@@ -231,6 +412,51 @@ handle_entry(ci_netif* ni, ci_netif_filter_table_entry_fast* entry,
 }
 
 
+static int
+cuckoo_for_each_match(ci_netif* ni,
+                      unsigned laddr, unsigned lport,
+                      unsigned raddr, unsigned rport,
+                      unsigned protocol, int intf_i, int vlan,
+                      int (*callback)(ci_sock_cmn*, void*),
+                      void* callback_arg, ci_uint32* hash_out)
+{
+  ci_netif_filter_table* tbl = ni->filter_table;
+  unsigned bucket_mask = cuckoo_bucket_mask(tbl);
+  unsigned hash = __onload_hash3(laddr, lport, raddr, rport, protocol);
+  unsigned bucket = hash & bucket_mask;
+  unsigned tag = cuckoo_tag(hash);
+  ci_netif_filter_bucket* bkt = cuckoo_bucket(tbl, bucket);
+  ci_uint32 key = cuckoo_key(tag, CUCKOO_PRIMARY);
+  unsigned match;
+
+  if( hash_out != NULL )
+    *hash_out = hash;
+
+  LOG_NV(log("%s: %s %s:%u->%s:%u bucket=%u tag=%u", __FUNCTION__,
+             CI_IP_PROTOCOL_STR(protocol),
+             ip_addr_str(laddr), (unsigned) CI_BSWAP_BE16(lport),
+             ip_addr_str(raddr), (unsigned) CI_BSWAP_BE16(rport),
+             bucket, tag));
+
+  while( 1 ) {
+    for( match = cuckoo_match(bkt, key, laddr); match; match &= match - 1 ) {
+      int way = ci_ffs64(match) - 1;
+      ci_sock_cmn* s = ID_TO_SOCK(ni, CUCKOO_ID(bkt->slot[way]));
+      if( cuckoo_sock_match(s, raddr, rport, protocol) &&
+          CI_LIKELY((s->rx_bind2dev_ifindex == CI_IFID_BAD ||
+                     ci_sock_intf_check(ni, s, intf_i, vlan))) &&
+          callback(s, callback_arg) != 0 )
+        return 1;
+    }
+    if( key & CUCKOO_ALTERNATE || bkt->slot[CUCKOO_SPILL] == 0 )
+      return 0;
+    bucket = cuckoo_alt(bucket, tag, bucket_mask);
+    bkt = cuckoo_bucket(tbl, bucket);
+    key = cuckoo_key(tag, CUCKOO_ALTERNATE);
+  }
+}
+
+
 int
 ci_netif_filter_for_each_match(ci_netif* ni,
                                unsigned laddr, unsigned lport,
@@ -244,6 +470,11 @@ ci_netif_filter_for_each_match(ci_netif* ni,
   unsigned first, table_size_mask;
   ci_netif_filter_table_entry_fast* entry;
 
+  if( NI_OPTS(ni).filter_table_cuckoo )
+    return cuckoo_for_each_match(ni, laddr, lport, raddr, rport, protocol,
+                                 intf_i, vlan, callback, callback_arg,
+                                 hash_out);
+
   tbl = ni->filter_table;
   table_size_mask = tbl->table_size_mask;
 
@@ -319,6 +550,140 @@ ci_netif_filter_for_each_match(ci_netif* ni,
 }
 
 
+static void
+cuckoo_table_full(ci_netif* netif, oo_sp tcp_id, unsigned laddr,
+                  unsigned lport, unsigned raddr, unsigned rport,
+                  unsigned protocol, unsigned hops)
+{
+  ci_sock_cmn *s = SP_TO_SOCK_CMN(netif, tcp_id);
+  if( ! (s->s_flags & CI_SOCK_FLAG_SW_FILTER_FULL) ) {
+    LOG_E(ci_log(FN_FMT "%d FULL %s %s:%u->%s:%u hops=%u",
+                 FN_PRI_ARGS(netif),
+                 OO_SP_FMT(tcp_id), CI_IP_PROTOCOL_STR(protocol),
+                 ip_addr_str(laddr), (unsigned) CI_BSWAP_BE16(lport),
+                 ip_addr_str(raddr), (unsigned) CI_BSWAP_BE16(rport),
+                 hops));
+    s->s_flags |= CI_SOCK_FLAG_SW_FILTER_FULL;
+  }
+  CITP_STATS_NETIF_INC(netif, sw_filter_insert_table_full);
+}
+
+
+/* Moves the entry in [from_way] of [from] to its other bucket [to]. */
+static void
+cuckoo_move(ci_netif* netif, ci_netif_filter_table* tbl,
+            unsigned from, int from_way, unsigned to, int to_way)
+{
+  ci_netif_filter_bucket* src = cuckoo_bucket(tbl, from);
+  ci_netif_filter_bucket* dst = cuckoo_bucket(tbl, to);
+  ci_uint32 slot = src->slot[from_way];
+
+  ci_assert_equal(dst->slot[to_way], 0);
+  ci_assert_equal(to, cuckoo_alt(from, CUCKOO_TAG(slot),
+                                 cuckoo_bucket_mask(tbl)));
+
+  /* An entry leaving its primary bucket spills from it, and one returning
+   * to its primary bucket no longer does. */
+  if( slot & CUCKOO_PRIMARY )
+    ++src->slot[CUCKOO_SPILL];
+  else
+    --dst->slot[CUCKOO_SPILL];
+  dst->slot[to_way] = slot ^ (CUCKOO_PRIMARY | CUCKOO_ALTERNATE);
+  dst->laddr[to_way] = src->laddr[from_way];
+  netif->filter_table_ext[(to << CUCKOO_BUCKET_SHIFT) + to_way].lport =
+    netif->filter_table_ext[(from << CUCKOO_BUCKET_SHIFT) + from_way].lport;
+  src->slot[from_way] = 0;
+  src->laddr[from_way] = 0;
+}
+
+
+/* Inserts into the cuckoo layout.  If neither of the tuple's buckets has a
+ * free way, a breadth-first search over the alternates of the entries they
+ * hold looks for the shortest chain of displacements that frees one.  The
+ * table is only modified once such a chain has been found. */
+static int
+cuckoo_insert(ci_netif_filter_table* tbl, ci_netif* netif, oo_sp tcp_id,
+              unsigned laddr, unsigned lport, unsigned raddr, unsigned rport,
+              unsigned protocol)
+{
+#define CUCKOO_BFS_MAX  (2 + 2 * CUCKOO_WAYS + 2 * CUCKOO_WAYS * CUCKOO_WAYS)
+  struct {
+    unsigned bucket;
+    int parent;
+    int way;
+  } q[CUCKOO_BFS_MAX];
+  unsigned bucket_mask = cuckoo_bucket_mask(tbl);
+  unsigned hash = __onload_hash3(laddr, lport, raddr, rport, protocol);
+  unsigned tag = cuckoo_tag(hash);
+  ci_netif_filter_bucket* bkt;
+  int head, tail, way = -1, w;
+  unsigned hops = 1;
+
+  q[0].bucket = hash & bucket_mask;
+  q[1].bucket = cuckoo_alt(q[0].bucket, tag, bucket_mask);
+  q[0].parent = q[1].parent = -1;
+  for( head = 0, tail = 2; head < tail; ++head ) {
+    bkt = cuckoo_bucket(tbl, q[head].bucket);
+    if( (way = cuckoo_free_way(bkt)) >= 0 )
+      break;
+    if( tail + CUCKOO_WAYS > CUCKOO_BFS_MAX )
+      continue;
+    for( w = 0; w < CUCKOO_WAYS; ++w ) {
+      q[tail].bucket = cuckoo_alt(q[head].bucket, CUCKOO_TAG(bkt->slot[w]),
+                                  bucket_mask);
+      q[tail].parent = head;
+      q[tail].way = w;
+      ++tail;
+    }
+  }
+  if( head == tail ) {
+    cuckoo_table_full(netif, tcp_id, laddr, lport, raddr, rport, protocol,
+                      tail);
+    return -ENOBUFS;
+  }
+
+  /* Walk back up the chain, moving each entry into the hole below it. */
+  for( ; q[head].parent >= 0; head = q[head].parent ) {
+    cuckoo_move(netif, tbl, q[q[head].parent].bucket, q[head].way,
+                q[head].bucket, way);
+    way = q[head].way;
+    ++hops;
+  }
+
+  bkt = cuckoo_bucket(tbl, q[head].bucket);
+  if( head == 0 ) {
+    bkt->slot[way] = cuckoo_key(tag, CUCKOO_PRIMARY) | OO_SP_TO_INT(tcp_id);
+  }
+  else {
+    bkt->slot[way] = cuckoo_key(tag, CUCKOO_ALTERNATE) | OO_SP_TO_INT(tcp_id);
+    ++cuckoo_bucket(tbl, q[0].bucket)->slot[CUCKOO_SPILL];
+  }
+  bkt->laddr[way] = laddr;
+  netif->filter_table_ext[(q[head].bucket << CUCKOO_BUCKET_SHIFT) + way].lport =
+    lport;
+
+  LOG_TC(ci_log(FN_FMT "%d INSERT %s %s:%u->%s:%u bucket=%u:%u way=%d "
+                "hops=%u", FN_PRI_ARGS(netif), OO_SP_FMT(tcp_id),
+                CI_IP_PROTOCOL_STR(protocol),
+                ip_addr_str(laddr), (unsigned) CI_BSWAP_BE16(lport),
+                ip_addr_str(raddr), (unsigned) CI_BSWAP_BE16(rport),
+                q[0].bucket, q[1].bucket, way, hops));
+
+#if CI_CFG_STATS_NETIF
+  if( hops > netif->state->stats.table_max_hops )
+    netif->state->stats.table_max_hops = hops;
+  if( netif->state->stats.table_mean_hops == 0 )
+    netif->state->stats.table_mean_hops = 1;
+  netif->state->stats.table_mean_hops =
+    (netif->state->stats.table_mean_hops * 9 + hops) / 10;
+  ++netif->state->stats.table_n_slots;
+  ++netif->state->stats.table_n_entries;
+#endif
+  return 0;
+#undef CUCKOO_BFS_MAX
+}
+
+
 /* Insert for either TCP or UDP */
 static int
 ci_ip4_netif_filter_insert(ci_netif_filter_table* tbl,
@@ -335,6 +700,10 @@ ci_ip4_netif_filter_insert(ci_netif_filter_table* tbl,
 #endif
   unsigned first;
 
+  if( NI_OPTS(netif).filter_table_cuckoo )
+    return cuckoo_insert(tbl, netif, tcp_id, laddr, lport,
+                         raddr, rport, protocol);
+
   hash1 = __onload_hash1(tbl->table_size_mask, laddr, lport,
                          raddr, rport, protocol);
   hash2 = __onload_hash2(laddr, lport, raddr, rport, protocol);
@@ -444,6 +813,49 @@ __ci_ip4_netif_filter_remove(ci_netif_filter_table* tbl, ci_netif* ni,
 }
 
 
+static void
+cuckoo_remove(ci_netif_filter_table* tbl, ci_netif* netif, oo_sp sock_p,
+              unsigned laddr, unsigned lport, unsigned raddr, unsigned rport,
+              unsigned protocol)
+{
+  unsigned bucket_mask = cuckoo_bucket_mask(tbl);
+  unsigned hash = __onload_hash3(laddr, lport, raddr, rport, protocol);
+  unsigned tag = cuckoo_tag(hash);
+  ci_netif_filter_bucket* primary = cuckoo_bucket(tbl, hash & bucket_mask);
+  ci_netif_filter_bucket* bkt = primary;
+  ci_uint32 key = cuckoo_key(tag, CUCKOO_PRIMARY);
+  unsigned match;
+
+  LOG_TC(ci_log("%s: [%d:%d] REMOVE %s %s:%u->%s:%u bucket=%u tag=%u",
+                __FUNCTION__, NI_ID(netif), OO_SP_FMT(sock_p),
+                CI_IP_PROTOCOL_STR(protocol),
+                ip_addr_str(laddr), (unsigned) CI_BSWAP_BE16(lport),
+                ip_addr_str(raddr), (unsigned) CI_BSWAP_BE16(rport),
+                hash & bucket_mask, tag));
+
+  while( 1 ) {
+    for( match = cuckoo_match(bkt, key, laddr); match; match &= match - 1 ) {
+      int way = ci_ffs64(match) - 1;
+      if( CUCKOO_ID(bkt->slot[way]) == OO_SP_TO_INT(sock_p) ) {
+        bkt->slot[way] = 0;
+        bkt->laddr[way] = 0;
+        if( bkt != primary )
+          --primary->slot[CUCKOO_SPILL];
+        CITP_STATS_NETIF(--netif->state->stats.table_n_slots);
+        CITP_STATS_NETIF(--netif->state->stats.table_n_entries);
+        return;
+      }
+    }
+    /* We allow multiple removes of the same filter, as below. */
+    if( bkt != primary || primary->slot[CUCKOO_SPILL] == 0 )
+      return;
+    bkt = cuckoo_bucket(tbl, cuckoo_alt(hash & bucket_mask, tag,
+                                        bucket_mask));
+    key = cuckoo_key(tag, CUCKOO_ALTERNATE);
+  }
+}
+
+
 static void
 ci_ip4_netif_filter_remove(ci_netif_filter_table* tbl,
                            ci_netif* netif, oo_sp sock_p,
@@ -464,6 +876,11 @@ ci_ip4_netif_filter_remove(ci_netif_filter_table* tbl,
 #endif
             );
 
+  if( NI_OPTS(netif).filter_table_cuckoo ) {
+    cuckoo_remove(tbl, netif, sock_p, laddr, lport, raddr, rport, protocol);
+    return;
+  }
+
   hash1 = __onload_hash1(tbl->table_size_mask, laddr, lport,
                          raddr, rport, protocol);
   hash2 = __onload_hash2(laddr, lport, raddr, rport, protocol);
@@ -603,7 +1020,11 @@ void ci_netif_filter_init(ci_netif* ni, int size_lg2)
   ni->filter_table->table_size_mask = size - 1;
 
   for( i = 0; i < size; ++i ) {
-    set_entry_state(&ni->filter_table->table[i], EMPTY);
+    /* Empty ways in the cuckoo layout are all-zero. */
+    if( NI_OPTS(ni).filter_table_cuckoo )
+      ni->filter_table->table[i].__id_and_state = 0;
+    else
+      set_entry_state(&ni->filter_table->table[i], EMPTY);
     ni->filter_table_ext[i].route_count = 0;
     ni->filter_table_ext[i].lport = 0;
     ni->filter_table->table[i].laddr = 0;
@@ -667,7 +1088,7 @@ __ci_netif_filter_lookup(ci_netif* netif, int af_space,
     rc = __ci_ip4_netif_filter_lookup(netif, laddr.ip4, lport, raddr.ip4, rport,
                                       protocol);
     if(CI_LIKELY( rc >= 0 ))
-      return ID_TO_SOCK(netif, ID(&netif->filter_table->table[rc]));
+      return ID_TO_SOCK(netif, filter_table_id(netif, rc));
   }
 
   return 0;
@@ -678,6 +1099,42 @@ __ci_netif_filter_lookup(ci_netif* netif, int af_space,
  **********************************************************************
  **********************************************************************/
 
+static void cuckoo_dump(ci_netif* ni)
+{
+  ci_netif_filter_table* tbl = ni->filter_table;
+  unsigned bucket_mask = cuckoo_bucket_mask(tbl);
+  unsigned b;
+  int way;
+
+  for( b = 0; b <= bucket_mask; ++b ) {
+    ci_netif_filter_bucket* bkt = cuckoo_bucket(tbl, b);
+    for( way = 0; way < CUCKOO_WAYS; ++way ) {
+      ci_uint32 slot = bkt->slot[way];
+      ci_netif_filter_table_entry_ext* entry_ext;
+      ci_sock_cmn* s;
+      unsigned laddr, raddr;
+      int lport, rport, protocol;
+
+      if( slot == 0 )
+        continue;
+      entry_ext = &ni->filter_table_ext[(b << CUCKOO_BUCKET_SHIFT) + way];
+      s = ID_TO_SOCK(ni, CUCKOO_ID(slot));
+      laddr = bkt->laddr[way];
+      lport = entry_ext->lport;
+      raddr = sock_raddr_be32(s);
+      rport = sock_rport_be16(s);
+      protocol = sock_protocol(s);
+      log("%08u:%u %s tag=%02x id=%-10d spill=%u %s "CI_IP_PRINTF_FORMAT":%d "
+          CI_IP_PRINTF_FORMAT":%d", b, way,
+          (slot & CUCKOO_PRIMARY) ? "pri" : "alt", CUCKOO_TAG(slot),
+          CUCKOO_ID(slot), bkt->slot[CUCKOO_SPILL],
+          CI_IP_PROTOCOL_STR(protocol),
+          CI_IP_PRINTF_ARGS(&laddr), CI_BSWAP_BE16(lport),
+          CI_IP_PRINTF_ARGS(&raddr), CI_BSWAP_BE16(rport));
+    }
+  }
+}
+
 void ci_netif_filter_dump(ci_netif* ni)
 {
   unsigned i;
@@ -694,6 +1151,11 @@ void ci_netif_filter_dump(ci_netif* ni)
       ni->state->stats.table_mean_hops);
 #endif
 
+  if( NI_OPTS(ni).filter_table_cuckoo ) {
+    cuckoo_dump(ni);
+    goto out;
+  }
+
   for( i = 0; i <= tbl->table_size_mask; ++i ) {
     ci_netif_filter_table_entry_fast* entry = &tbl->table[i];
     ci_netif_filter_table_entry_ext* entry_ext = &ni->filter_table_ext[i];
@@ -715,6 +1177,7 @@ void ci_netif_filter_dump(ci_netif* ni)
 	  CI_IP_PRINTF_ARGS(&raddr), CI_BSWAP_BE16(rport), hash1, hash2);
     }
   }
+ out:
 #if CI_CFG_IPV6
   ci_ip6_netif_filter_dump(ni);
 #endif
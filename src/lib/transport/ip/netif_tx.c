@@ -165,23 +165,86 @@ static void __ci_netif_dmaq_shove(ci_netif* ni, int intf_i, int is_fresh)
 }
 
 
+/* Returns true if the sender that holds a TX lock as [owner] is gone. */
+static int ci_netif_tx_lock_owner_dead(ci_netif* ni, ci_uint32 owner)
+{
+#ifdef __ci_driver__
+  int dead;
+  rcu_read_lock();
+  dead = ci_netif_pid_lookup(ni, owner) == NULL;
+  rcu_read_unlock();
+  return dead;
+#else
+  return kill(owner, 0) < 0 && errno == ESRCH;
+#endif
+}
+
+
+void ci_netif_tx_lock_slow(ci_netif* ni, int intf_i)
+{
+  ci_uint32* lock = &ni->state->nic[intf_i].tx_lock;
+  ci_uint64 start_frc, now_frc;
+  ci_uint32 owner;
+
+  CITP_STATS_NETIF_INC(ni, tx_lock_contends);
+  ci_frc64(&start_frc);
+  while( 1 ) {
+    owner = OO_ACCESS_ONCE(*lock);
+    if( owner == 0 ) {
+      if( ci_cas32u_succeed(lock, 0, CI_NETIF_TX_LOCK_STACK) )
+        return;
+      continue;
+    }
+    if( owner == CI_NETIF_TX_LOCK_STACK ) {
+      /* We hold the stack lock, and no stack lock holder keeps a TX lock
+       * after dropping it, so this one was left by a holder that died.
+       */
+      ci_log("%s: [%d] intf %d: recovering TX lock from dead stack lock "
+             "holder", __FUNCTION__, NI_ID(ni), intf_i);
+      if( ci_cas32u_succeed(lock, owner, CI_NETIF_TX_LOCK_STACK) )
+        return;
+      continue;
+    }
+    /* A sender holds it.  Posting takes a few descriptors, so if it has
+     * held the lock for more than a millisecond then check it is alive.
+     */
+    ci_frc64(&now_frc);
+    if( now_frc - start_frc > IPTIMER_STATE(ni)->khz ) {
+      if( ci_netif_tx_lock_owner_dead(ni, owner) ) {
+        ci_log("%s: [%d] intf %d: recovering TX lock from dead pid %u",
+               __FUNCTION__, NI_ID(ni), intf_i, owner);
+        if( ci_cas32u_succeed(lock, owner, CI_NETIF_TX_LOCK_STACK) )
+          return;
+        continue;
+      }
+      start_frc = now_frc;
+    }
+    ci_spinloop_pause();
+  }
+}
+
+
 void ci_netif_dmaq_shove1(ci_netif* ni, int intf_i)
 {
   ef_vi* vi = ci_netif_vi(ni, intf_i);
+  ci_netif_tx_lock(ni, intf_i);
   if( ef_vi_transmit_space(vi) >= (ef_vi_transmit_capacity(vi) >> 1) )
     __ci_netif_dmaq_shove(ni, intf_i, 0 /*is_fresh*/);
+  ci_netif_tx_unlock(ni, intf_i);
 }
 
 
 void ci_netif_dmaq_shove2(ci_netif* ni, int intf_i, int is_fresh)
 {
   ef_vi* vi = ci_netif_vi(ni, intf_i);
+  ci_netif_tx_lock(ni, intf_i);
   if( ef_vi_transmit_space(vi) > CI_IP_PKT_SEGMENTS_MAX )
     __ci_netif_dmaq_shove(ni, intf_i, is_fresh);
+  ci_netif_tx_unlock(ni, intf_i);
 }
 
 
-void __ci_netif_send(ci_netif* netif, ci_ip_pkt_fmt* pkt)
+static void ci_netif_send_tx_locked(ci_netif* netif, ci_ip_pkt_fmt* pkt)
 {
   int intf_i, rc;
   oo_pktq* dmaq;
@@ -299,5 +362,73 @@ void __ci_netif_send(ci_netif* netif, ci_ip_pkt_fmt* pkt)
   __ci_netif_dmaq_put(netif, dmaq, pkt);
 }
 
+
+#ifndef __KERNEL__
+/* Posts [pkt] to its interface's TX ring, without pushing, for a sender
+ * that holds the TX lock but not the stack lock.  The caller has checked
+ * that the overflow queue is empty and that the ring has space.
+ */
+void ci_netif_tx_post_unlocked(ci_netif* ni, ci_ip_pkt_fmt* pkt)
+{
+  ef_vi* vi = ci_netif_vi(ni, pkt->intf_i);
+  ef_iovec iov[CI_IP_PKT_SEGMENTS_MAX];
+  int iov_len, rc;
+
+  ci_assert(ci_netif_dmaq_is_empty(ni, pkt->intf_i));
+  __ci_netif_dmaq_insert_prep_pkt(ni, pkt);
+  calc_csum_if_needed(ni, vi, pkt);
+  iov_len = ci_netif_pkt_to_iovec(ni, pkt, iov,
+                                  sizeof(iov) / sizeof(iov[0]));
+  ci_assert_gt(iov_len, 0);
+  rc = ef_vi_transmitv_init(vi, iov, iov_len, OO_PKT_ID(pkt));
+  ci_assert_equal(rc, 0);
+  (void) rc;
+}
+#endif
+
+
+void __ci_netif_send(ci_netif* netif, ci_ip_pkt_fmt* pkt)
+{
+  int intf_i = pkt->intf_i;
+
+  ci_assert(intf_i >= 0);
+  ci_assert(intf_i < CI_CFG_MAX_INTERFACES);
+  ci_netif_tx_lock(netif, intf_i);
+  ci_netif_send_tx_locked(netif, pkt);
+  ci_netif_tx_unlock(netif, intf_i);
+}
+
+
+void __ci_netif_send_batched(ci_netif* netif, ci_ip_pkt_fmt* pkt)
+{
+  int intf_i = pkt->intf_i;
+
+  ci_assert(intf_i >= 0);
+  ci_assert(intf_i < CI_CFG_MAX_INTERFACES);
+  ci_assert_flags(pkt->flags, CI_PKT_FLAG_TX_PENDING);
+  ci_check( ! ci_eth_addr_is_zero((ci_uint8 *)oo_ether_dhost(pkt)));
+
+  ci_netif_tx_lock(netif, intf_i);
+  ___ci_netif_dmaq_insert_prep_pkt(netif, pkt);
+  LOG_NT(log("%s: ENQ id=%d", __FUNCTION__, OO_PKT_FMT(pkt)));
+  __ci_netif_dmaq_put(netif, ci_netif_dmaq(netif, intf_i), pkt);
+  ci_netif_tx_unlock(netif, intf_i);
+}
+
+
+/* Posts everything queued by ci_netif_send_batched(), with one doorbell per
+ * interface.  Packets that don't fit in the TX ring stay queued until
+ * completions make room, as for any other send.
+ */
+void ci_netif_send_batch_post(ci_netif* ni)
+{
+  int intf_i;
+
+  ci_assert(ci_netif_is_locked(ni));
+  OO_STACK_FOR_EACH_INTF_I(ni, intf_i)
+    if( ci_netif_dmaq_not_empty(ni, intf_i) )
+      ci_netif_dmaq_shove2(ni, intf_i, 0 /*is_fresh*/);
+}
+
 #endif
 /*! \cidoxg_end */
@@ -136,6 +136,57 @@ ci_inline void ci_netif_ctpio_resume(ci_netif* ni, int intf_i)
 #endif
 }
 
+/**********************************************************************
+ * TX lock domains (EF_TX_LOCK_DOMAINS).
+ */
+
+extern void ci_netif_tx_lock_slow(ci_netif* ni, int intf_i) CI_HF;
+
+/* Takes the TX lock of interface [intf_i].  This protects the VI's TX ring
+ * and the TX counters in ci_netif_state_nic_t against senders that do not
+ * hold the stack lock.  Only the stack lock holder may call this, and only
+ * around code that touches the TX ring, never while holding another TX
+ * lock.  Senders without the stack lock use ci_netif_tx_trylock() and defer
+ * to the lock holder if it fails, so this waits only for a sender part way
+ * through a post.  A no-op unless EF_TX_LOCK_DOMAINS is set.
+ */
+ci_inline void ci_netif_tx_lock(ci_netif* ni, int intf_i)
+{
+  ci_assert(ci_netif_is_locked(ni));
+  if(CI_LIKELY( ! NI_OPTS(ni).tx_lock_domains ))
+    return;
+  if(CI_LIKELY( ci_cas32u_succeed(&ni->state->nic[intf_i].tx_lock,
+                                  0, CI_NETIF_TX_LOCK_STACK) ))
+    return;
+  ci_netif_tx_lock_slow(ni, intf_i);
+}
+
+/* Tries once to take the TX lock of interface [intf_i] for a sender that
+ * does not hold the stack lock.  [owner] is the sender's pid, so that the
+ * lock can be recovered if the sender dies while holding it.
+ */
+ci_inline int ci_netif_tx_trylock(ci_netif* ni, int intf_i, ci_uint32 owner)
+{
+  ci_assert(NI_OPTS(ni).tx_lock_domains);
+  ci_assert_nequal(owner, 0);
+  ci_assert_nequal(owner, CI_NETIF_TX_LOCK_STACK);
+  return ci_cas32u_succeed(&ni->state->nic[intf_i].tx_lock, 0, owner);
+}
+
+ci_inline void ci_netif_tx_unlock(ci_netif* ni, int intf_i)
+{
+  if(CI_LIKELY( ! NI_OPTS(ni).tx_lock_domains ))
+    return;
+  ci_assert_nequal(ni->state->nic[intf_i].tx_lock, 0);
+  ci_mb();
+  ni->state->nic[intf_i].tx_lock = 0;
+}
+
+#ifndef __KERNEL__
+extern void ci_netif_tx_post_unlocked(ci_netif* ni, ci_ip_pkt_fmt* pkt) CI_HF;
+#endif
+
+
 /**********************************************************************
  * DMA queues.
  */
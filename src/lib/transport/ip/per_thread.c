@@ -40,3 +40,167 @@ void oo_per_thread_init_thread(void)
   }
 }
 
+
+/* Socket locks are nearly always released by the thread that took them,
+ * so keep the start time in per-thread state rather than growing the
+ * socket.  If a thread holds more than one socket lock, the first taken
+ * is timed until the first released.
+ */
+void ci_sock_lock_hist_start(void)
+{
+  struct oo_per_thread* pt = __oo_per_thread_get();
+  if( pt->sock_lock_frc == 0 )
+    ci_frc64(&pt->sock_lock_frc);
+}
+
+
+void ci_sock_lock_hist_end(ci_netif* ni)
+{
+  struct oo_per_thread* pt = __oo_per_thread_get();
+  ci_uint64 now_frc;
+
+  if( pt->sock_lock_frc == 0 )
+    return;
+  ci_frc64(&now_frc);
+  CI_LAT_HIST_RECORD(ni, sock_lock, now_frc - pt->sock_lock_frc);
+  pt->sock_lock_frc = 0;
+}
+
+
+/* Every thread's packet buffer cache is kept on a list, so that the buffers
+ * can be given back when a stack is released.  A thread may read and
+ * update its own cache for [ni] without the lock, because [ni] cannot be
+ * released while the thread is using it.  Changing a cache's stack, and
+ * anything done to another thread's cache, needs the lock.
+ */
+static pthread_mutex_t oo_pkt_magazine_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct oo_pkt_magazine* oo_pkt_magazines;
+static pthread_key_t oo_pkt_magazine_key;
+static pthread_once_t oo_pkt_magazine_once = PTHREAD_ONCE_INIT;
+
+
+static void oo_pkt_magazine_release(struct oo_pkt_magazine* mag)
+{
+  if( mag->ni != NULL )
+    oo_pkt_magazine_flush(mag->ni, mag);
+  mag->ni = NULL;
+}
+
+
+static void oo_pkt_magazine_unlink(struct oo_pkt_magazine* mag)
+{
+  if( mag->next != NULL )
+    mag->next->pprev = mag->pprev;
+  *mag->pprev = mag->next;
+  mag->next = NULL;
+  mag->pprev = NULL;
+}
+
+
+/* Called at thread exit. */
+static void oo_pkt_magazine_dtor(void* arg)
+{
+  struct oo_pkt_magazine* mag = arg;
+
+  pthread_mutex_lock(&oo_pkt_magazine_lock);
+  oo_pkt_magazine_release(mag);
+  if( mag->pprev != NULL )
+    oo_pkt_magazine_unlink(mag);
+  pthread_mutex_unlock(&oo_pkt_magazine_lock);
+}
+
+
+static void oo_pkt_magazine_key_init(void)
+{
+  CI_TRY(pthread_key_create(&oo_pkt_magazine_key, oo_pkt_magazine_dtor));
+}
+
+
+static void oo_pkt_magazine_switch(struct oo_pkt_magazine* mag, ci_netif* ni)
+{
+  pthread_once(&oo_pkt_magazine_once, oo_pkt_magazine_key_init);
+
+  pthread_mutex_lock(&oo_pkt_magazine_lock);
+  oo_pkt_magazine_release(mag);
+  if( mag->pprev == NULL ) {
+    mag->next = oo_pkt_magazines;
+    if( mag->next != NULL )
+      mag->next->pprev = &mag->next;
+    mag->pprev = &oo_pkt_magazines;
+    oo_pkt_magazines = mag;
+    pthread_setspecific(oo_pkt_magazine_key, mag);
+  }
+  mag->ni = ni;
+  pthread_mutex_unlock(&oo_pkt_magazine_lock);
+}
+
+
+ci_ip_pkt_fmt* ci_netif_pkt_alloc_nonb_cached(ci_netif* ni)
+{
+  struct oo_pkt_magazine* mag;
+  ci_ip_pkt_fmt* pkt;
+
+  if( NI_OPTS(ni).tx_pkt_magazine == 0 )
+    return ci_netif_pkt_alloc_nonb(ni);
+
+  mag = &__oo_per_thread_get()->pkt_magazine;
+  if(CI_UNLIKELY( mag->ni != ni ))
+    oo_pkt_magazine_switch(mag, ni);
+
+  if( mag->n > 0 ) {
+    ++mag->hits;
+  }
+  else {
+    CITP_STATS_NETIF_INC(ni, pkt_mag_misses);
+    CITP_STATS_NETIF_ADD(ni, pkt_mag_hits, mag->hits);
+    mag->hits = 0;
+    if( oo_pkt_magazine_refill(ni, mag, NI_OPTS(ni).tx_pkt_magazine) == 0 )
+      return NULL;
+  }
+
+  pkt = PKT(ni, mag->pkts[--mag->n]);
+  ci_assert_equal(pkt->refcount, 0);
+  ci_assert_flags(pkt->flags, CI_PKT_FLAG_NONB_POOL);
+  pkt->refcount = 1;
+  CI_DEBUG(pkt->intf_i = -1);
+  return pkt;
+}
+
+
+void oo_pkt_magazine_forget_stack(ci_netif* ni)
+{
+  struct oo_pkt_magazine* mag;
+
+  pthread_mutex_lock(&oo_pkt_magazine_lock);
+  for( mag = oo_pkt_magazines; mag != NULL; mag = mag->next )
+    if( mag->ni == ni )
+      oo_pkt_magazine_release(mag);
+  pthread_mutex_unlock(&oo_pkt_magazine_lock);
+}
+
+
+void oo_pkt_magazine_pre_fork(void)
+{
+  /* Only this thread survives in the child, which must not share its
+   * cache with the parent, so give the buffers back first. */
+  pthread_mutex_lock(&oo_pkt_magazine_lock);
+  oo_pkt_magazine_release(&__oo_per_thread_get()->pkt_magazine);
+}
+
+
+void oo_pkt_magazine_parent_fork(void)
+{
+  pthread_mutex_unlock(&oo_pkt_magazine_lock);
+}
+
+
+void oo_pkt_magazine_child_fork(void)
+{
+  struct oo_pkt_magazine* mag = &__oo_per_thread_get()->pkt_magazine;
+
+  /* Other threads' caches belong to the parent. */
+  pthread_mutex_init(&oo_pkt_magazine_lock, NULL);
+  oo_pkt_magazines = NULL;
+  mag->next = NULL;
+  mag->pprev = NULL;
+}
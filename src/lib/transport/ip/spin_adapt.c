@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/**************************************************************************\
+*//*! \file
+** <L5_PRIVATE L5_SOURCE>
+**  \brief  Adaptive spinning before blocking (EF_SPIN_ADAPTIVE)
+** </L5_PRIVATE>
+*//*
+\**************************************************************************/
+
+#include "ip_internal.h"
+
+
+/* Weight of a new sample in the moving average is 1/(2^this). */
+#define OO_SPIN_ADAPT_AVG_SHIFT  3
+
+
+/* Records a wait for readiness on [sa]'s socket or epoll set that lasted
+ * [waited] cycles, where [max_spin] is the spin timeout.  Statistics are
+ * counted against [ni], which may be NULL.
+ */
+void oo_spin_adapt_wait_done(ci_netif* ni, struct oo_spin_adapt* sa,
+                             ci_uint64 max_spin, ci_uint64 waited,
+                             int outcome)
+{
+  /* Clamp samples, so that a single long idle period does not disable
+   * spinning for the many waits that it would take to decay. */
+  ci_uint64 cap = max_spin > (((ci_uint64) -1) >> 1) ? max_spin : max_spin * 2;
+  ci_uint64 sample = CI_MIN(waited, cap);
+
+  if( sa->wait_avg == 0 )
+    sa->wait_avg = sample;
+  else
+    sa->wait_avg = sa->wait_avg - (sa->wait_avg >> OO_SPIN_ADAPT_AVG_SHIFT) +
+                   (sample >> OO_SPIN_ADAPT_AVG_SHIFT);
+
+  if( ni == NULL )
+    return;
+  switch( outcome ) {
+  case OO_SPIN_ADAPT_HIT:
+    CITP_STATS_NETIF_INC(ni, spin_adapt_hits);
+    break;
+  case OO_SPIN_ADAPT_MISS:
+    CITP_STATS_NETIF_INC(ni, spin_adapt_misses);
+    break;
+  case OO_SPIN_ADAPT_SKIP:
+    CITP_STATS_NETIF_INC(ni, spin_adapt_skips);
+    CITP_STATS_NETIF_ADD(ni, spin_adapt_saved_usec,
+                         CI_MIN(waited, max_spin) * 1000 /
+                         IPTIMER_STATE(ni)->khz);
+    break;
+  }
+}
@@ -574,8 +574,13 @@ int ci_tcp_close(ci_netif* netif, ci_tcp_state* ts)
   if( CI_UNLIKELY( ts->tcpflags & CI_TCPT_FLAG_FIN_PENDING ) )
     ci_tcp_resend_fin(ts, netif);
 
-  if( (ts->s.b.state == CI_TCP_TIME_WAIT) ||
-      (ts->s.b.state == CI_TCP_CLOSING)   ||
+  if( ts->s.b.state == CI_TCP_TIME_WAIT ) {
+    /* It reached TIME_WAIT before the last fd went, for example after
+     * shutdown() and draining, so no segment may come to compact it. */
+    ci_netif_timewait_compact(netif, ts);
+    return 0;
+  }
+  if( (ts->s.b.state == CI_TCP_CLOSING) ||
       (ts->s.b.state == CI_TCP_LAST_ACK) )
     return 0;
 
@@ -638,6 +643,56 @@ int ci_tcp_close(ci_netif* netif, ci_tcp_state* ts)
 
 
 #if (defined(__KERNEL__) && ! CI_CFG_UL_INTERRUPT_HELPER) || (! defined(__KERNEL__) && CI_CFG_UL_INTERRUPT_HELPER) 
+#if CI_CFG_TCP_ACCEPT_SHARDS
+/* Move the connections on the accept shards to the listener's own accept
+ * queue, so that they are dropped with it.  We hold the stack lock, so
+ * nothing is being added to the shards.
+ */
+static void ci_tcp_acceptq_shards_drain(ci_netif* netif,
+                                        ci_tcp_socket_listen* tls)
+{
+  ci_tcp_acceptq_shard* sh;
+  citp_waitable* w;
+  int i, spins;
+
+  for( i = 0; i < CI_CFG_TCP_ACCEPT_SHARDS; ++i ) {
+    sh = &tls->acceptq_shards[i];
+    sh->owner = 0;
+    if( sh->put < 0 && OO_SP_IS_NULL(sh->get) )
+      continue;
+
+    /* A thread in accept() holds [busy] only while it updates the lists.
+     * If it does not let go, it died there and we leak the connections.
+     */
+    for( spins = 0; ci_cas32u_fail(&sh->busy, 0, 1); ++spins ) {
+      if( spins == 1000000 ) {
+        LOG_E(ci_log("%s: [%d:%d] accept shard %d is stuck", __FUNCTION__,
+                     NI_ID(netif), S_FMT(tls), i));
+        break;
+      }
+      ci_spinloop_pause();
+    }
+    if( spins == 1000000 )
+      continue;
+
+    while( OO_SP_NOT_NULL(sh->get) || sh->put >= 0 ) {
+      if( OO_SP_IS_NULL(sh->get) )
+        __ci_tcp_acceptq_swizzle(netif, &sh->put, &sh->get);
+      w = SP_TO_WAITABLE(netif, sh->get);
+      sh->get = w->wt_next;
+      do
+        w->wt_next = OO_SP_FROM_INT(netif, tls->acceptq_put);
+      while( ci_cas32_fail(&tls->acceptq_put,
+                           OO_SP_TO_INT(w->wt_next), W_ID(w)) );
+    }
+    sh->n_in = sh->n_out = 0;
+    ci_wmb();
+    sh->busy = 0;
+  }
+}
+#endif
+
+
 void ci_tcp_listen_shutdown_queues(ci_netif* netif, ci_tcp_socket_listen* tls)
 {
   int synrecvs;
@@ -664,6 +719,9 @@ void ci_tcp_listen_shutdown_queues(ci_netif* netif, ci_tcp_socket_listen* tls)
   LOG_TV(log("%s: %d clear out accept queue (%d entries)", __FUNCTION__,
              S_FMT(tls), ci_tcp_acceptq_n(tls)));
 
+#if CI_CFG_TCP_ACCEPT_SHARDS
+  ci_tcp_acceptq_shards_drain(netif, tls);
+#endif
   while( ci_tcp_acceptq_not_empty(tls) ) {
     citp_waitable* w;
     ci_tcp_state* ats;    /* accepted ts */
@@ -0,0 +1,443 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/* TCP congestion control algorithms.
+ *
+ * Slow start, fast recovery and RTO handling are common to all algorithms
+ * and live in tcp_rx.c and tcp_timer.c.  The algorithms here decide how
+ * the congestion window grows in congestion avoidance and how far it is
+ * reduced by a congestion event.
+ *
+ * [ci_tcp_state] lives in shared memory, so a socket records its algorithm
+ * as an index into [cong_ops] rather than as a pointer to its operations.
+ * Per-connection private state is in [ts->cong].
+ *
+ * The pacing rate, being derived from the congestion window, is also
+ * computed here.  The pacer itself is in ci_tcp_tx_advance().
+ */
+
+#include "ip_internal.h"
+
+#define LPF "TCP CONG "
+
+
+struct ci_tcp_cong_ops {
+  const char* name;
+  /* Reset private state at connection start or when the algorithm is
+   * changed on a live connection. */
+  void (*init)(ci_netif* ni, ci_tcp_state* ts);
+  /* Grow cwnd in congestion avoidance by consuming [ts->bytes_acked]. */
+  void (*cong_avoid)(ci_netif* ni, ci_tcp_state* ts);
+  /* Observe newly acknowledged data.  Optional: by default ECE is treated
+   * as loss, as RFC3168 requires. */
+  void (*acked)(ci_netif* ni, ci_tcp_state* ts, ci_uint32 acked, int ece);
+  /* Slow start threshold following loss. */
+  ci_uint32 (*ssthresh)(ci_netif* ni, ci_tcp_state* ts);
+};
+
+
+/**********************************************************************
+ * ECN (RFC3168).
+ */
+
+/* The window is reduced in response to ECE at most once per window of
+ * data, and not at all if loss recovery is already under way. */
+ci_inline int ci_tcp_cong_ecn_may_reduce(ci_tcp_state* ts, ci_uint32 una)
+{
+  return ts->congstate == CI_TCP_CONG_OPEN &&
+         SEQ_GT(una, ts->ecn_recover);
+}
+
+
+static void ci_tcp_cong_ecn_reduce(ci_netif* ni, ci_tcp_state* ts,
+                                   ci_uint32 ssthresh)
+{
+  ts->ssthresh = ssthresh;
+  ts->cwnd = CI_MAX(ts->ssthresh, NI_OPTS(ni).min_cwnd);
+  ts->bytes_acked = 0;
+  ts->ecn_recover = tcp_snd_nxt(ts);
+  /* Tell the peer that we've responded. */
+  ts->tcpflags |= CI_TCPT_FLAG_ECN_CWR;
+  CITP_STATS_NETIF_INC(ni, tcp_ecn_cwnd_reduce);
+}
+
+
+/**********************************************************************
+ * NewReno, with Appropriate Byte Counting (RFC3465).
+ */
+
+static void reno_init(ci_netif* ni, ci_tcp_state* ts)
+{
+}
+
+
+static void reno_cong_avoid(ci_netif* ni, ci_tcp_state* ts)
+{
+  /* Hack - Increase less aggresively on small round trip times */
+#if CI_CFG_CONG_AVOID_SCALE_BACK
+  unsigned tmp = 0, cwnd_scaled;
+  /* tcp_srtt(ts) would relatively easy exceed 32 for a round trip time
+   * on longer links */
+  if( tcp_srtt(ts) < 32 )
+    tmp = NI_OPTS(ni).cong_avoid_scale_back >> tcp_srtt(ts);
+  cwnd_scaled = CI_MAX(1U, tmp) * ts->cwnd;
+#else
+  unsigned cwnd_scaled = ts->cwnd;
+#endif
+  /* Congestion avoidance.  RFC3465 says: increase the congestion window
+  ** by one segment each RTT.  i.e. wait for bytes_acked to be > cwnd
+  ** (which takes one RTT), then reset bytes_acked by subtracting the
+  ** cwnd from it, and add one segment to cwnd.
+  */
+  if( ts->bytes_acked >= cwnd_scaled ) {
+    ts->bytes_acked -= cwnd_scaled;
+    ts->cwnd += tcp_eff_mss(ts);
+  }
+}
+
+
+static ci_uint32 reno_ssthresh(ci_netif* ni, ci_tcp_state* ts)
+{
+  return ci_tcp_losswnd(ts);
+}
+
+
+/**********************************************************************
+ * CUBIC (RFC9438).
+ *
+ * Windows are kept in bytes and time in milliseconds.  The cubic
+ * function is W(t) = C * (t - K)^3 + W_max with C = 0.4 segments/s^3, so
+ * for t - K in ms the offset from W_max is 4 * (t - K)^3 / 10^10 segments.
+ */
+
+/* Multiplicative decrease factor, beta = 0.7. */
+#define CUBIC_BETA_NUM       7
+#define CUBIC_BETA_DEN       10
+/* W_max following fast convergence, (1 + beta) / 2. */
+#define CUBIC_FC_NUM         17
+#define CUBIC_FC_DEN         20
+/* Reno-friendly additive increase, 3 * (1 - beta) / (1 + beta) segments
+ * per RTT. */
+#define CUBIC_ALPHA_NUM      9
+#define CUBIC_ALPHA_DEN      17
+/* Bound on |t - K| so that its cube fits in 64 bits. */
+#define CUBIC_DELTA_MAX_MS   (1u << 20)
+/* Growth beyond the plateau is at most 1% of cwnd per RTT, as Linux. */
+#define CUBIC_PROBE_DEN      100
+/* Update the window every 1/8th of a window of ACKed data. */
+#define CUBIC_ACK_BATCH_SHIFT 3
+
+
+/* Integer cube root, rounded down. */
+static ci_uint32 cubic_root(ci_uint64 a)
+{
+  ci_uint64 y = 0, b;
+  int s;
+
+  for( s = 63; s >= 0; s -= 3 ) {
+    y <<= 1;
+    b = 3 * y * (y + 1) + 1;
+    if( (a >> s) >= b ) {
+      a -= b << s;
+      ++y;
+    }
+  }
+  return (ci_uint32) y;
+}
+
+
+/* C * delta^3 in bytes, for delta in ms. */
+static ci_uint64 cubic_offset(ci_uint32 mss, ci_uint32 delta_ms)
+{
+  ci_uint64 d = CI_MIN(delta_ms, CUBIC_DELTA_MAX_MS);
+  return (d * d * d / 1000000) * 4 * mss / 10000;
+}
+
+
+static void cubic_init(ci_netif* ni, ci_tcp_state* ts)
+{
+  ts->cong.cubic.w_max = 0;
+  ts->cong.cubic.origin = 0;
+  ts->cong.cubic.w_est = 0;
+  ts->cong.cubic.k_ms = 0;
+  ts->cong.cubic.epoch_start = 0;
+}
+
+
+static void cubic_cong_avoid(ci_netif* ni, ci_tcp_state* ts)
+{
+  ci_uint32 mss = tcp_eff_mss(ts);
+  ci_iptime_t now = ci_tcp_time_now(ni);
+  ci_uint32 t_ms, target, inc;
+  ci_uint64 off;
+
+  /* Work in batches of a fraction of a window: it bounds the rounding
+   * error in the increments below, and saves some arithmetic per ACK. */
+  if( ts->bytes_acked < (ts->cwnd >> CUBIC_ACK_BATCH_SHIFT) )
+    return;
+
+  /* [origin] is zero when there is no epoch in progress. */
+  if( ts->cong.cubic.origin == 0 ) {
+    ts->cong.cubic.epoch_start = now;
+    ts->cong.cubic.w_est = ts->cwnd;
+    if( ts->cwnd < ts->cong.cubic.w_max ) {
+      /* K = cbrt((W_max - cwnd) / C), converted to ms. */
+      ci_uint64 x = ts->cong.cubic.w_max - ts->cwnd;
+      ts->cong.cubic.k_ms = cubic_root(x * 2500000000ull / mss);
+      ts->cong.cubic.origin = ts->cong.cubic.w_max;
+    }
+    else {
+      ts->cong.cubic.k_ms = 0;
+      ts->cong.cubic.origin = ts->cwnd;
+    }
+    LOG_TV(log(LPF "%d CUBIC: epoch cwnd=%u w_max=%u K=%ums", S_FMT(ts),
+               ts->cwnd, ts->cong.cubic.w_max, ts->cong.cubic.k_ms));
+  }
+
+  /* Target is the window one RTT from now. */
+  t_ms = ci_ip_time_ticks2ms(ni, now - ts->cong.cubic.epoch_start +
+                             tcp_srtt(ts));
+  if( t_ms < ts->cong.cubic.k_ms ) {
+    off = cubic_offset(mss, ts->cong.cubic.k_ms - t_ms);
+    target = ts->cong.cubic.origin - CI_MIN(off, ts->cong.cubic.origin);
+  }
+  else {
+    off = cubic_offset(mss, t_ms - ts->cong.cubic.k_ms);
+    target = ts->cong.cubic.origin + CI_MIN(off, (ci_uint64) ts->cwnd);
+  }
+
+  /* In the Reno-friendly region follow the Reno estimate instead. */
+  target = CI_MAX(target, ts->cong.cubic.w_est);
+
+  /* Spread the growth towards [target] over one window of ACKs, and never
+   * grow by more than half of cwnd per RTT. */
+  if( target > ts->cwnd )
+    inc = (ci_uint64) CI_MIN(target - ts->cwnd, ts->cwnd >> 1) *
+          ts->bytes_acked / ts->cwnd;
+  else
+    inc = (ci_uint64) mss * ts->bytes_acked /
+          ((ci_uint64) ts->cwnd * CUBIC_PROBE_DEN);
+
+  /* Leave [bytes_acked] to accumulate until it is worth something. */
+  if( inc == 0 )
+    return;
+
+  ts->cong.cubic.w_est += (ci_uint64) mss * ts->bytes_acked *
+                          CUBIC_ALPHA_NUM / ((ci_uint64) ts->cwnd *
+                                             CUBIC_ALPHA_DEN);
+  ts->bytes_acked = 0;
+  ts->cwnd += inc;
+}
+
+
+static ci_uint32 cubic_ssthresh(ci_netif* ni, ci_tcp_state* ts)
+{
+  /* Fast convergence: if we did not get back to the previous plateau,
+   * release some bandwidth for new flows. */
+  if( ts->cwnd < ts->cong.cubic.w_max )
+    ts->cong.cubic.w_max = (ci_uint64) ts->cwnd * CUBIC_FC_NUM / CUBIC_FC_DEN;
+  else
+    ts->cong.cubic.w_max = ts->cwnd;
+  ts->cong.cubic.origin = 0;
+
+  return CI_MAX((ci_uint64) ci_tcp_inflight(ts) * CUBIC_BETA_NUM /
+                CUBIC_BETA_DEN, (ci_uint32) tcp_eff_mss(ts) << 1u);
+}
+
+
+/**********************************************************************
+ * DCTCP (RFC8257).
+ *
+ * Keeps an estimate [alpha] of the fraction of bytes that were ECN marked,
+ * updated once per window of data, and on ECN feedback reduces cwnd in
+ * proportion to it.  Responds to loss as Reno does.
+ */
+
+#define DCTCP_ALPHA_SHIFT    10
+#define DCTCP_ALPHA_MAX      (1u << DCTCP_ALPHA_SHIFT)
+/* Estimation gain, g = 1/16. */
+#define DCTCP_G_SHIFT        4
+
+
+static void dctcp_init(ci_netif* ni, ci_tcp_state* ts)
+{
+  /* Start out pessimistic, as Linux does. */
+  ts->cong.dctcp.alpha = DCTCP_ALPHA_MAX;
+  ts->cong.dctcp.window_end = tcp_snd_nxt(ts);
+  ts->cong.dctcp.acked = 0;
+  ts->cong.dctcp.acked_ece = 0;
+}
+
+
+static void dctcp_acked(ci_netif* ni, ci_tcp_state* ts, ci_uint32 acked,
+                        int ece)
+{
+  ci_uint32 una = tcp_snd_una(ts) + acked;
+
+  ts->cong.dctcp.acked += acked;
+  if( ece )
+    ts->cong.dctcp.acked_ece += acked;
+
+  if( SEQ_GE(una, ts->cong.dctcp.window_end) ) {
+    /* End of the observation window: alpha = (1 - g) * alpha + g * F */
+    ci_uint32 f = 0;
+    if( ts->cong.dctcp.acked != 0 )
+      f = ((ci_uint64) ts->cong.dctcp.acked_ece << DCTCP_ALPHA_SHIFT) /
+          ts->cong.dctcp.acked;
+    ts->cong.dctcp.alpha += (f >> DCTCP_G_SHIFT) -
+                            (ts->cong.dctcp.alpha >> DCTCP_G_SHIFT);
+    ts->cong.dctcp.alpha = CI_MIN(ts->cong.dctcp.alpha, DCTCP_ALPHA_MAX);
+    ts->cong.dctcp.window_end = tcp_snd_nxt(ts);
+    ts->cong.dctcp.acked = 0;
+    ts->cong.dctcp.acked_ece = 0;
+  }
+
+  if( ece && ci_tcp_cong_ecn_may_reduce(ts, una) ) {
+    ci_uint32 cut = ((ci_uint64) ts->cwnd * ts->cong.dctcp.alpha) >>
+                    (DCTCP_ALPHA_SHIFT + 1);
+    ci_tcp_cong_ecn_reduce(ni, ts, CI_MAX(ts->cwnd - cut,
+                                          (ci_uint32) tcp_eff_mss(ts) << 1u));
+    LOG_TL(log(LNT_FMT "DCTCP: ECE alpha=%u cwnd=%u ssthresh=%u",
+               LNT_PRI_ARGS(ni, ts), ts->cong.dctcp.alpha, ts->cwnd,
+               ts->ssthresh));
+  }
+}
+
+
+/**********************************************************************
+ * Dispatch.
+ */
+
+static const struct ci_tcp_cong_ops cong_ops[] = {
+  [EF_TCP_CONG_ALGO_RENO] = {
+    .name       = "reno",
+    .init       = reno_init,
+    .cong_avoid = reno_cong_avoid,
+    .ssthresh   = reno_ssthresh,
+  },
+  [EF_TCP_CONG_ALGO_CUBIC] = {
+    .name       = "cubic",
+    .init       = cubic_init,
+    .cong_avoid = cubic_cong_avoid,
+    .ssthresh   = cubic_ssthresh,
+  },
+  [EF_TCP_CONG_ALGO_DCTCP] = {
+    .name       = "dctcp",
+    .init       = dctcp_init,
+    .cong_avoid = reno_cong_avoid,
+    .acked      = dctcp_acked,
+    .ssthresh   = reno_ssthresh,
+  },
+};
+
+
+ci_inline const struct ci_tcp_cong_ops* ci_tcp_cong_ops(ci_tcp_state* ts)
+{
+  ci_assert_lt(ts->c.cong_algo, CI_ARRAY_SIZE(cong_ops));
+  return &cong_ops[ts->c.cong_algo];
+}
+
+
+void ci_tcp_cong_init(ci_netif* ni, ci_tcp_state* ts)
+{
+  ts->ecn_recover = tcp_snd_una(ts);
+  /* Start with a full burst allowance; see ci_tcp_pacing_credit(). */
+  ts->pace_credit = CI_TCP_PACING_RATE_MAX;
+  ci_tcp_cong_ops(ts)->init(ni, ts);
+}
+
+
+void ci_tcp_cong_avoid(ci_netif* ni, ci_tcp_state* ts)
+{
+  ci_tcp_cong_ops(ts)->cong_avoid(ni, ts);
+}
+
+
+void ci_tcp_cong_acked(ci_netif* ni, ci_tcp_state* ts, ci_uint32 acked,
+                       int ece)
+{
+  const struct ci_tcp_cong_ops* ops = ci_tcp_cong_ops(ts);
+  if( ops->acked != NULL ) {
+    ops->acked(ni, ts, acked, ece);
+  }
+  else if( ece && ci_tcp_cong_ecn_may_reduce(ts, tcp_snd_una(ts) + acked) ) {
+    ci_tcp_cong_ecn_reduce(ni, ts, ops->ssthresh(ni, ts));
+    LOG_TL(log(LNT_FMT "ECN: ECE cwnd=%u ssthresh=%u",
+               LNT_PRI_ARGS(ni, ts), ts->cwnd, ts->ssthresh));
+  }
+}
+
+
+ci_uint32 ci_tcp_cong_ssthresh(ci_netif* ni, ci_tcp_state* ts)
+{
+  return ci_tcp_cong_ops(ts)->ssthresh(ni, ts);
+}
+
+
+int ci_tcp_cong_algo_from_name(const char* name)
+{
+  int i;
+  for( i = 0; i < CI_ARRAY_SIZE(cong_ops); ++i )
+    if( ! strcmp(name, cong_ops[i].name) )
+      return i;
+  return -ENOENT;
+}
+
+
+const char* ci_tcp_cong_algo_name(unsigned algo)
+{
+  if( algo >= CI_ARRAY_SIZE(cong_ops) )
+    return "unknown";
+  return cong_ops[algo].name;
+}
+
+
+/**********************************************************************
+ * Pacing.
+ *
+ * As Linux, a paced socket sends at 200% of cwnd/srtt in slow start, so
+ * that pacing does not hold back the doubling of the window, and at 120%
+ * of it afterwards.  Rates are in bytes per timer tick: segments held
+ * back are released by [ts->pace_tid], so finer spacing is not possible.
+ */
+
+#define CI_TCP_PACING_SS_RATIO  200
+#define CI_TCP_PACING_CA_RATIO  120
+
+
+ci_uint32 ci_tcp_pacing_rate(ci_netif* ni, ci_tcp_state* ts)
+{
+  ci_uint32 ratio = ts->cwnd < ts->ssthresh ? CI_TCP_PACING_SS_RATIO :
+                                              CI_TCP_PACING_CA_RATIO;
+  ci_uint32 srtt = CI_MAX(tcp_srtt(ts), 1u);
+  ci_uint64 rate;
+
+  rate = (ci_uint64) CI_MAX(ts->cwnd, ci_tcp_inflight(ts)) * ratio;
+  rate /= 100 * srtt;
+  if( ts->c.max_pacing_rate != CI_TCP_PACING_RATE_UNLIMITED )
+    rate = CI_MIN(rate, ts->c.max_pacing_rate /
+                        ci_ip_time_ms2ticks(ni, 1000));
+  return CI_MAX(CI_MIN(rate, CI_TCP_PACING_RATE_MAX), 1);
+}
+
+
+/* Replenish the pacing credit for the time elapsed since it was last
+ * replenished, and return it.  Credit not used within a tick or so is
+ * lost, so that a socket that has been idle cannot save up a burst; but
+ * at least two segments may always be sent together, as Linux allows. */
+ci_int32 ci_tcp_pacing_credit(ci_netif* ni, ci_tcp_state* ts,
+                              ci_uint32 rate)
+{
+  ci_iptime_t now = ci_tcp_time_now(ni);
+  ci_uint64 refill = (ci_uint64) (now - ts->pace_stamp) * rate;
+  ci_int32 cap = CI_MAX(rate, 2u * tcp_eff_mss(ts));
+
+  ci_assert_le(rate, CI_TCP_PACING_RATE_MAX);
+  if( ts->pace_credit >= cap ||
+      refill >= (ci_uint64) (cap - ts->pace_credit) )
+    ts->pace_credit = cap;
+  else
+    ts->pace_credit += refill;
+  ts->pace_stamp = now;
+  return ts->pace_credit;
+}
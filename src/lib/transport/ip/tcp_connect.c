@@ -1118,6 +1118,18 @@ static int ci_tcp_connect_ul_start(ci_netif *ni, ci_tcp_state* ts, ci_fd_t fd,
     }
   }
 
+  /* The last connection on this four-tuple may have been moved from
+   * TIME_WAIT into the timewait table.  Its final sequence number is the
+   * most recent one we know of, so prefer it. */
+  if( ipcache_af(&ts->s.pkt) == AF_INET ) {
+    ci_uint32 tw_seq = ci_netif_timewait_reuse(ni, tcp_laddr_be32(ts),
+                                               tcp_lport_be16(ts),
+                                               tcp_raddr_be32(ts),
+                                               tcp_rport_be16(ts));
+    if( tw_seq != 0 )
+      prev_seq = tw_seq;
+  }
+
   if( prev_seq )
     /* We're reusing a TIME_WAIT.  We do the same as Linux, and choose the new
      * sequence number a little way from the old.
@@ -1134,9 +1146,13 @@ static int ci_tcp_connect_ul_start(ci_netif *ni, ci_tcp_state* ts, ci_fd_t fd,
 
   /* Must be after initialising snd_una. */
   ci_tcp_clear_rtt_timing(ts);
-  ci_tcp_set_flags(ts, CI_TCP_FLAG_SYN);
   ts->tcpflags &=~ CI_TCPT_FLAG_OPT_MASK;
   ts->tcpflags |= NI_OPTS(ni).syn_opts;
+  if( ts->tcpflags & CI_TCPT_FLAG_ECN )
+    /* ECN-setup SYN (RFC3168 6.1.1) */
+    ci_tcp_set_flags(ts, CI_TCP_FLAG_SYN | CI_TCP_FLAG_ECE | CI_TCP_FLAG_CWR);
+  else
+    ci_tcp_set_flags(ts, CI_TCP_FLAG_SYN);
 
   if( (ts->tcpflags & CI_TCPT_FLAG_WSCL) ) {
     if( NI_OPTS(ni).tcp_rcvbuf_mode == 1 )
@@ -1184,6 +1200,29 @@ static int ci_tcp_connect_ul_start(ci_netif *ni, ci_tcp_state* ts, ci_fd_t fd,
   ci_assert(ts->snd_max == tcp_snd_nxt(ts) + 1);
   ts->s.rx_errno = 0;
   ts->s.tx_errno = 0; 
+
+  /* TCP Fast Open (RFC7413): if we hold a cookie for the peer then the
+   * SYN waits for the first send() so that it can carry data, and
+   * connect() succeeds at once.  Otherwise the SYN requests a cookie.
+   */
+  if( (NI_OPTS(ni).tcp_fastopen & EF_TCP_FASTOPEN_CLIENT) &&
+      ((ts->tcpflags & CI_TCPT_FLAG_FASTOPEN) ||
+       (ts->s.s_aflags & CI_SOCK_AFLAG_FASTOPEN_CONNECT)) &&
+      ! (ts->s.pkt.flags & CI_IP_CACHE_IS_LOCALROUTE) ) {
+    ci_uint8 cookie[CI_TCP_FASTOPEN_COOKIE_MAX];
+    ts->tcpflags |= CI_TCPT_FLAG_FASTOPEN;
+    if( ci_tcp_fastopen_cache_get(ni, tcp_ipx_raddr(ts), cookie) > 0 ) {
+      ts->tcpflags |= CI_TCPT_FLAG_FASTOPEN_DEFER;
+      ci_netif_pkt_release(ni, pkt);
+      LOG_TC(log(LNT_FMT "TFO connect deferred until send",
+                 LNT_PRI_ARGS(ni, ts)));
+      return CI_CONNECT_UL_OK;
+    }
+  }
+  else {
+    ts->tcpflags &=~ CI_TCPT_FLAG_FASTOPEN;
+  }
+
   /* If ARP resolution fails, we have to drop the connection, so we store
    * the socket id in the SYN packet. */
   pkt->pf.tcp_tx.sock_id = ts->s.b.bufid;
@@ -1500,7 +1539,10 @@ int ci_tcp_connect(citp_socket* ep, const struct sockaddr* serv_addr,
     else {
       /* Socket is in SYN-SENT state. Let's block for receiving SYN-ACK */
       ci_assert_equal(s->b.state, CI_TCP_SYN_SENT);
-      if( s->b.sb_aflags & (CI_SB_AFLAG_O_NONBLOCK | CI_SB_AFLAG_O_NDELAY) )
+      if( ts->tcpflags & CI_TCPT_FLAG_FASTOPEN_DEFER )
+        /* connect() already succeeded; the SYN waits for data */
+        CI_SET_ERROR(rc, EISCONN);
+      else if( s->b.sb_aflags & (CI_SB_AFLAG_O_NONBLOCK | CI_SB_AFLAG_O_NDELAY) )
         CI_SET_ERROR(rc, EALREADY);
       else
         goto syn_sent;
@@ -1597,6 +1639,8 @@ int ci_tcp_connect(citp_socket* ep, const struct sockaddr* serv_addr,
     }
   }
   CI_TCP_STATS_INC_ACTIVE_OPENS( ep->netif );
+  if( ts->tcpflags & CI_TCPT_FLAG_FASTOPEN_DEFER )
+    goto unlock_out;
 
  syn_sent:
   rc = ci_tcp_connect_ul_syn_sent(ep->netif, ts);
@@ -1629,8 +1673,19 @@ int ci_tcp_listen_init(ci_netif *ni, ci_tcp_socket_listen *tls)
   tls->acceptq_n_in = tls->acceptq_n_out = 0;
   tls->acceptq_put = CI_ILL_END;
   tls->acceptq_get = OO_SP_NULL;
+#if CI_CFG_TCP_ACCEPT_SHARDS
+  for( i = 0; i < CI_CFG_TCP_ACCEPT_SHARDS; ++i ) {
+    tls->acceptq_shards[i].put = CI_ILL_END;
+    tls->acceptq_shards[i].get = OO_SP_NULL;
+    tls->acceptq_shards[i].n_in = tls->acceptq_shards[i].n_out = 0;
+    tls->acceptq_shards[i].owner = 0;
+    tls->acceptq_shards[i].busy = 0;
+  }
+#endif
   tls->n_listenq = 0;
   tls->n_listenq_new = 0;
+  tls->syncookie_tmpl.amss = 0;
+  tls->syncookie_tmpl.flood = 0;
 
   /* Allocate and initialise the listen bucket */
   tls->bucket = ci_ni_aux_alloc_bucket(ni);
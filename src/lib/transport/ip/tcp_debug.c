@@ -100,7 +100,12 @@ void ci_tcp_state_listen_assert_valid(ci_netif* netif,
 
   verify(ci_to_int(ci_tcp_acceptq_n(tsl)) >= 0);
   if( ci_tcp_acceptq_n(tsl) )
+#if CI_CFG_TCP_ACCEPT_SHARDS
+    verify(ci_tcp_acceptq_not_empty(tsl) ||
+           ci_tcp_acceptq_shards_not_empty(netif, tsl));
+#else
     verify(ci_tcp_acceptq_not_empty(tsl));
+#endif
 
   /*
    * This verification can be failed because of next listen()
@@ -676,6 +681,10 @@ void ci_tcp_socket_listen_dump(ci_netif* ni, ci_tcp_socket_listen* tls,
 			       const char* pf,
                                oo_dump_log_fn_t logger, void* log_arg)
 {
+#if CI_CFG_TCP_ACCEPT_SHARDS
+  int i;
+#endif
+
   ci_tcp_socket_cmn_dump(ni, &tls->c, pf, logger, log_arg);
 
   logger(log_arg, "%s  listenq: max=%d n=%d new=%d buckets=%d", pf, 
@@ -683,6 +692,14 @@ void ci_tcp_socket_listen_dump(ci_netif* ni, ci_tcp_socket_listen* tls,
          tls->n_buckets);
   logger(log_arg, "%s  acceptq: max=%d n=%d accepted=%d", pf,
          tls->acceptq_max, ci_tcp_acceptq_n(tls), tls->acceptq_n_out);
+#if CI_CFG_TCP_ACCEPT_SHARDS
+  for( i = 0; i < CI_CFG_TCP_ACCEPT_SHARDS; ++i )
+    if( tls->acceptq_shards[i].owner != 0 )
+      logger(log_arg, "%s  acceptq shard %d: owner=%u n=%u accepted=%u", pf, i,
+             tls->acceptq_shards[i].owner,
+             tls->acceptq_shards[i].n_in - tls->acceptq_shards[i].n_out,
+             tls->acceptq_shards[i].n_out);
+#endif
   logger(log_arg, "%s  defer_accept=%d", pf, tls->c.tcp_defer_accept);
 #if CI_CFG_FD_CACHING
   logger(log_arg, "%s  sockcache: n=%d sock_n=%d cache=%s pending=%s connected=%s",
@@ -716,6 +733,10 @@ void ci_tcp_socket_listen_dump(ci_netif* ni, ci_tcp_socket_listen* tls,
              s->n_syncookie_ack_answ);
       logger(log_arg, "%s  syncookies rejected: timestamp=%u crypto_hash=%u",
              pf, s->n_syncookie_ack_ts_rej, s->n_syncookie_ack_hash_rej);
+      logger(log_arg, "%s  syncookies flood: now=%d floods=%u "
+             "tmpl_synacks=%u tmpl_amss=%u",
+             pf, tls->syncookie_tmpl.flood, s->n_syncookie_flood,
+             s->n_syncookie_synack_tmpl, tls->syncookie_tmpl.amss);
     }
   }
 #endif
@@ -795,6 +816,10 @@ void ci_tcp_state_dump(ci_netif* ni, ci_tcp_state* ts,
   logger(log_arg, "%s  snd: limited rwnd=%d cwnd=%d nagle=%d more=%d app=%d",
          pf, stats.tx_stop_rwnd, stats.tx_stop_cwnd, stats.tx_stop_nagle,
          stats.tx_stop_more, stats.tx_stop_app);
+  if( ci_tcp_is_paced(ni, ts) )
+    logger(log_arg, "%s  snd: paced rate=%u/tick max=%"CI_PRIu64" credit=%d "
+           "limited=%d", pf, ci_tcp_pacing_rate(ni, ts),
+           ts->c.max_pacing_rate, ts->pace_credit, stats.tx_stop_pace);
 #if CI_CFG_TAIL_DROP_PROBE
   if( ts->tcpflags & CI_TCPT_FLAG_TAIL_DROP_MARKED )
     logger(log_arg, "%s  snd: tail loss probe at %x", pf, ts->taildrop_mark);
@@ -44,6 +44,8 @@ static void ci_tcp_state_setup_timers(ci_netif* ni, ci_tcp_state* ts)
   ci_tcp_setup_timer(stats,    CI_IP_TIMER_TCP_STATS,  "stat");
 #endif
   ci_tcp_setup_timer(cork,     CI_IP_TIMER_TCP_CORK,   "cork");
+  ci_tcp_setup_timer(pace,     CI_IP_TIMER_TCP_PACE,   "pace");
+  ci_tcp_setup_timer(coalesce, CI_IP_TIMER_TCP_COALESCE, "coal");
 
 #undef ci_tcp_setup_timer
 }
@@ -180,6 +182,9 @@ static void ci_tcp_state_tcb_reinit(ci_netif* netif, ci_tcp_state* ts,
   if( ts->tcpflags & CI_TCPT_FLAG_TSO )  ts->outgoing_hdrs_len += 12;
   ts->incoming_tcp_hdr_len = (ci_uint8)sizeof(ci_tcp_hdr);
   ts->c.tcp_defer_accept = OO_TCP_DEFER_ACCEPT_OFF;
+  ts->c.cong_algo = NI_OPTS(netif).tcp_cong_algo;
+  ts->c.fastopen_qlen = 0;
+  ts->c.max_pacing_rate = CI_TCP_PACING_RATE_UNLIMITED;
 
   ci_tcp_state_connected_opts_init(netif, ts);
 
@@ -188,6 +193,7 @@ static void ci_tcp_state_tcb_reinit(ci_netif* netif, ci_tcp_state* ts,
   tcp_enq_nxt(ts) = tcp_snd_una(ts) = tcp_snd_nxt(ts) = tcp_snd_up(ts) = 0;
   ts->snd_delegated = 0;
   ts->snd_max = tcp_snd_nxt(ts) + 1;
+  memset(&ts->zc, 0, sizeof(ts->zc));
   /* ?? snd_nxt, snd_max, should be set as SYN is sent */
 
   /* WSCL option variables RFC1323 */
@@ -188,6 +188,8 @@ void ci_tcp_state_verify_no_timers(ci_netif *ni, ci_tcp_state *ts)
   chk(zwin_tid);
   chk(kalive_tid);
   chk(cork_tid);
+  chk(pace_tid);
+  chk(coalesce_tid);
 #if CI_CFG_TCP_SOCK_STATS
   chk(stats_tid);
 #endif
@@ -531,6 +533,21 @@ int ci_tcp_parse_options(ci_netif* ni, ciip_tcp_rx_pkt* rxp,
       }
       if( topts )  topts->flags |= CI_TCPT_FLAG_SACK;
       break;
+    case CI_TCP_OPT_FASTOPEN:
+      /* Empty option is a cookie request; otherwise an even-length cookie
+       * of 4 to 16 bytes.  Anything else is ignored, as Linux does. */
+      if( topts == NULL )
+        break;
+      if( len != 2 && (len - 2 < CI_TCP_FASTOPEN_COOKIE_MIN ||
+                       len - 2 > CI_TCP_FASTOPEN_COOKIE_MAX ||
+                       (len & 1)) ) {
+        LOG_U(log(LPF "TFO(bad length %d)", len));
+        break;
+      }
+      rxp->flags |= CI_TCPT_FLAG_FASTOPEN;
+      rxp->fastopen_cookie = opt + 2;
+      rxp->fastopen_len = len - 2;
+      break;
     default:
 #if CI_CFG_PORT_STRIPING
       if( opt[0] == NI_OPTS(ni).stripe_tcp_opt ) {
@@ -574,6 +591,8 @@ void ci_tcp_stop_timers(ci_netif* netif, ci_tcp_state* ts)
   ci_ip_timer_clear_ool(netif, &ts->zwin_tid);
   ci_ip_timer_clear_ool(netif, &ts->kalive_tid);
   ci_ip_timer_clear_ool(netif, &ts->cork_tid);
+  ci_ip_timer_clear_ool(netif, &ts->pace_tid);
+  ci_ip_timer_clear_ool(netif, &ts->coalesce_tid);
   if( OO_PP_NOT_NULL(ts->pmtus) ) {
     ci_pmtu_state_t* pmtus = ci_ni_aux_p2pmtus(netif, ts->pmtus);
     ci_ip_timer_clear_ool(netif, &pmtus->tid);
@@ -621,6 +640,9 @@ static void ci_tcp_tx_drop_queues(ci_netif* ni, ci_tcp_state* ts)
   ci_tcp_sendmsg_enqueue_prequeue(ni, ts, CI_TRUE);
   ci_tcp_sendq_drop(ni, ts);
 
+  /* The data will never be acked, but it is no longer in use either. */
+  ts->zc.acked = ts->zc.queued = OO_ACCESS_ONCE(ts->zc.next_id);
+
   /* Maintain invariants. */
   tcp_snd_nxt(ts) = tcp_enq_nxt(ts) = tcp_snd_una(ts);
   ts->congstate = CI_TCP_CONG_OPEN;
@@ -1319,6 +1341,8 @@ void ci_tcp_perform_deferred_socket_work(ci_netif* ni, ci_tcp_state* ts)
   aflags = ts->s.s_aflags & interesting;
   ci_rmb();
   ci_tcp_sendmsg_enqueue_prequeue_deferred(ni, ts);
+  if( ts->zc.queued != OO_ACCESS_ONCE(ts->zc.next_id) )
+    ci_tcp_zc_record(ni, ts);
 
   if( aflags ) {
     ci_atomic32_and(&ts->s.s_aflags, ~aflags);
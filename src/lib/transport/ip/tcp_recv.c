@@ -45,6 +45,7 @@ struct tcp_recv_info {
 
 #ifndef __KERNEL__
 static int ci_tcp_recvmsg_urg(struct tcp_recv_info *rinf);
+static int ci_tcp_recvmsg_zc_compl(struct tcp_recv_info *rinf);
 #endif
 
 static int ci_tcp_recvmsg_recv2(struct tcp_recv_info *rinf);
@@ -542,6 +543,8 @@ static int ci_tcp_recvmsg_spin(ci_netif* ni, ci_tcp_state* ts,
       future = ci_netif_intf_rx_future(ni, intf_i, &poison);
   } while( now_frc - start_frc < max_spin );
 
+  if(CI_UNLIKELY( NI_OPTS(ni).lat_hist ))
+    CI_LAT_HIST_RECORD(ni, spin, now_frc - start_frc);
   rc = spin_limit_by_so ? -EAGAIN : 0;
  out:
   ni->state->is_spinner = 0;
@@ -598,6 +601,8 @@ static inline int ci_tcp_recvmsg_impl(const ci_tcp_recvmsg_args* a,
   ci_uint64             start_frc = 0; /* suppress compiler warning */
 #ifndef __KERNEL__
   unsigned              tcp_recv_spin = 0;
+  struct oo_spin_adapt* spin_adapt = NULL;
+  int                   spin_adapt_outcome = OO_SPIN_ADAPT_SKIP;
 #endif
   ci_uint32             timeout = ts->s.so.rcvtimeo_msec;
   struct tcp_recv_info  rinf;
@@ -736,6 +741,11 @@ static inline int ci_tcp_recvmsg_impl(const ci_tcp_recvmsg_args* a,
   /* Spin (if enabled) until timeout, or something happens, or we get
   ** contention on the netif lock.
   */
+  if( tcp_recv_spin && NI_OPTS(ni).spin_adaptive && spin_adapt == NULL ) {
+    spin_adapt = &S_TO_EPS(ni, ts)->spin_adapt;
+    if( ! oo_spin_adapt_should_spin(spin_adapt, ts->s.b.spin_cycles) )
+      tcp_recv_spin = 0;
+  }
   if( tcp_recv_spin ) {
     int rc2;
 
@@ -745,10 +755,17 @@ static inline int ci_tcp_recvmsg_impl(const ci_tcp_recvmsg_args* a,
         rinf.rc = rc2;
         goto unlock_out;
       }
+      if( spin_adapt != NULL ) {
+        oo_spin_adapt_wait_done(ni, spin_adapt, ts->s.b.spin_cycles,
+                                ci_frc64_get() - start_frc,
+                                OO_SPIN_ADAPT_HIT);
+        spin_adapt = NULL;
+      }
       goto poll_recv_queue;
     }
 
     tcp_recv_spin = 0;
+    spin_adapt_outcome = OO_SPIN_ADAPT_MISS;
     if( timeout ) {
       ci_uint32 spin_ms = NI_OPTS(ni).spin_usec >> 10;
       if( spin_ms < timeout )
@@ -796,6 +813,13 @@ static inline int ci_tcp_recvmsg_impl(const ci_tcp_recvmsg_args* a,
       goto out;
     }
   }
+#ifndef __KERNEL__
+  if( spin_adapt != NULL ) {
+    oo_spin_adapt_wait_done(ni, spin_adapt, ts->s.b.spin_cycles,
+                            ci_frc64_get() - start_frc, spin_adapt_outcome);
+    spin_adapt = NULL;
+  }
+#endif
   ci_assert(have_polled);
   goto poll_recv_queue;
 
@@ -807,7 +831,14 @@ static inline int ci_tcp_recvmsg_impl(const ci_tcp_recvmsg_args* a,
 #if CI_CFG_TIMESTAMPING
     ci_ip_pkt_fmt* pkt;
     int rc3 = 0;
+#endif
 
+    if( ci_tcp_zc_compl_pending(ts) ) {
+      rinf.rc = ci_tcp_recvmsg_zc_compl(&rinf);
+      goto unlock_out;
+    }
+
+#if CI_CFG_TIMESTAMPING
   timestamp_q_check:
 
     /* The timestamp is stored at TX complete event.  We should not read it
@@ -1014,6 +1045,52 @@ static void move_from_recv2_to_recv1(ci_netif* ni, ci_tcp_state* ts,
 
 
 #ifndef __KERNEL__
+/* Report the range of MSG_ZEROCOPY sends completed since the last call.
+ * Onload always copied their data, so say so in ee_code. */
+static int ci_tcp_recvmsg_zc_compl(struct tcp_recv_info *rinf)
+{
+  ci_netif* ni = rinf->a->ni;
+  ci_tcp_state* ts = rinf->a->ts;
+  struct msghdr* msg = rinf->a->msg;
+  ci_uint32 acked = OO_ACCESS_ONCE(ts->zc.acked);
+  struct cmsg_state cmsg_state;
+  struct {
+    struct oo_sock_extended_err ee;
+    union {
+      struct sockaddr_in        offender;
+#if CI_CFG_IPV6
+      struct sockaddr_in6       offender6;
+#endif
+    };
+  } __attribute__((packed, aligned(sizeof(ci_uint32)))) errhdr;
+
+  memset(&errhdr, 0, sizeof(errhdr));
+  errhdr.ee.ee_origin = SO_EE_ORIGIN_ZEROCOPY;
+  errhdr.ee.ee_code = SO_EE_CODE_ZEROCOPY_COPIED;
+  errhdr.ee.ee_info = ts->zc.reported;
+  errhdr.ee.ee_data = acked - 1;
+  ts->zc.reported = acked;
+  CITP_STATS_NETIF_INC(ni, tcp_zerocopy_notify);
+
+  msg->msg_controllen = rinf->controllen;
+  cmsg_state.msg = msg;
+  cmsg_state.cm = CMSG_FIRSTHDR(msg);
+  cmsg_state.cmsg_bytes_used = 0;
+  cmsg_state.p_msg_flags = &rinf->msg_flags;
+#if CI_CFG_IPV6
+  if( IS_AF_INET6(ts->s.domain) )
+    ci_put_cmsg(&cmsg_state, SOL_IPV6, IPV6_RECVERR,
+                sizeof(errhdr.ee) + sizeof(errhdr.offender6), &errhdr);
+  else
+#endif
+    ci_put_cmsg(&cmsg_state, SOL_IP, IP_RECVERR,
+                sizeof(errhdr.ee) + sizeof(errhdr.offender), &errhdr);
+  ci_ip_cmsg_finish(&cmsg_state);
+  rinf->msg_flags |= MSG_ERRQUEUE;
+  return 0;
+}
+
+
 static int ci_tcp_recvmsg_urg(struct tcp_recv_info *rinf)
 {
   ci_netif* ni = rinf->a->ni;
@@ -343,6 +343,78 @@ static void ci_tcp_rx_enqueue_packet(ci_netif *netif, ci_tcp_state *ts,
 }
 
 
+/* Alternative to ci_tcp_rx_enqueue_packet() for the fast path when
+** EF_TCP_RX_COALESCE is set.  If the payload of [pkt] fits in the last
+** packet on recv1 then it is copied there and [pkt] is freed.  Two
+** full-sized segments do not fit in one buffer, so for bulk transfers this
+** relies on the data already read from the last packet being squeezed out
+** to make room; a receiver that keeps up leaves it (nearly) empty.
+** The receive path may be reading that packet concurrently, so we only do
+** this if we can get the sock-lock, and make the new bytes available to
+** the receive path before dropping it.  See also ci_tcp_rx_pkt_coalesce().
+**
+** The caller must not touch [pkt] after this returns true.
+*/
+int ci_tcp_rx_enqueue_coalesce(ci_netif* netif, ci_tcp_state* ts,
+                               ci_ip_pkt_fmt* pkt)
+{
+  ci_ip_pkt_fmt* tail;
+  ci_tcp_hdr* tail_tcp;
+  char* tail_payload;
+  char* tail_buf_end;
+  int bytes = oo_offbuf_left(&pkt->buf);
+
+  ci_assert(ci_netif_is_locked(netif));
+  ci_assert_equal(SEQ_SUB(pkt->pf.tcp_rx.end_seq, tcp_rcv_nxt(ts)), bytes);
+
+  if( OO_PP_IS_NULL(ts->recv1.tail) || TS_QUEUE_RX(ts) != &ts->recv1 )
+    return 0;
+#if CI_CFG_TIMESTAMPING
+  if( ts->s.cmsg_flags & CI_IP_CMSG_TIMESTAMP_ANY )
+    return 0;
+#endif
+
+  tail = PKT_CHK(netif, ts->recv1.tail);
+  tail_tcp = PKT_IPX_TCP_HDR(ipcache_af(&ts->s.pkt), tail);
+  tail_payload = CI_TCP_PAYLOAD(tail_tcp);
+  tail_buf_end = (char*) tail + CI_CFG_PKT_BUF_SIZE;
+  if( tail->refcount != 1 ||
+      ! SEQ_EQ(tail->pf.tcp_rx.end_seq, tcp_rcv_nxt(ts)) ||
+      tail_buf_end - tail_payload - oo_offbuf_left(&tail->buf) < bytes )
+    return 0;
+
+  if( ! ci_sock_trylock(netif, &ts->s.b) ) {
+    CITP_STATS_NETIF_INC(netif, tcp_rx_coalesce_busy);
+    return 0;
+  }
+
+  /* Move the unread contents of [tail] to the beginning of the buffer. */
+  if( tail_buf_end - oo_offbuf_end(&tail->buf) < bytes ) {
+    int n = (int)(oo_offbuf_ptr(&tail->buf) - tail_payload);
+    ci_assert_gt(n, 0);
+    memmove(tail_payload, oo_offbuf_ptr(&tail->buf),
+            oo_offbuf_left(&tail->buf));
+    tail->buf.off -= n;
+    tail->buf.end -= n;
+    tail_tcp->tcp_seq_be32 = CI_BSWAP_BE32(
+                                CI_BSWAP_BE32(tail_tcp->tcp_seq_be32) + n);
+  }
+  memcpy(oo_offbuf_end(&tail->buf), oo_offbuf_ptr(&pkt->buf), bytes);
+  tail->buf.end += bytes;
+  tail->pf.tcp_rx.end_seq = pkt->pf.tcp_rx.end_seq;
+  PKT_TCP_RX_BUF_ASSERT_VALID(netif, tail);
+  tcp_rcv_nxt(ts) = pkt->pf.tcp_rx.end_seq;
+  ci_tcp_rx_update_state_on_add(ts, bytes);
+  ci_sock_unlock(netif, &ts->s.b);
+
+  ci_netif_pkt_release_rx(netif, pkt);
+
+  CITP_STATS_NETIF_INC(netif, tcp_rx_coalesce_segs);
+  CITP_STATS_NETIF_ADD(netif, tcp_rx_coalesce_bytes, bytes);
+  return 1;
+}
+
+
 #ifdef NDEBUG
 # define DO_SLOW_CHAIN_LENGTH_CHECK 0
 #else
@@ -779,6 +851,60 @@ ci_inline unsigned ci_tcp_paws_check(ci_netif* netif, ci_uint32 tsval,
 }
 
 
+/* ECN (RFC3168) processing of a segment on a connection that negotiated
+** it: notice congestion experienced by the peer's data, which we must echo
+** with ECE, and the peer's CWR response to our own echo.
+*/
+static void ci_tcp_rx_ecn(ci_netif* ni, ci_tcp_state* ts,
+                          ciip_tcp_rx_pkt* rxp)
+{
+  ci_ip_pkt_fmt* pkt = rxp->pkt;
+  unsigned flags = rxp->tcp->tcp_flags;
+  int ce;
+
+  if( flags & CI_TCP_FLAG_SYN )
+    return;
+
+  ce = (ipx_hdr_tos_tclass(oo_pkt_af(pkt), oo_ipx_hdr(pkt)) &
+        CI_IP_ECN_MASK) == CI_IP_ECN_CE;
+  if( ce )
+    CITP_STATS_NETIF_INC(ni, tcp_ecn_ce_rx);
+  if( flags & CI_TCP_FLAG_CWR )
+    CITP_STATS_NETIF_INC(ni, tcp_ecn_cwr_rx);
+
+  if( ts->c.cong_algo == EF_TCP_CONG_ALGO_DCTCP ) {
+    /* DCTCP estimates the extent of congestion, so ECE must reflect the
+     * latest segment exactly and a change must be reported at once
+     * (RFC8257 3.2). */
+    if( ce != !!(ts->tcpflags & CI_TCPT_FLAG_ECN_ECE) ) {
+      ts->tcpflags ^= CI_TCPT_FLAG_ECN_ECE;
+      TCP_FORCE_ACK(ts);
+    }
+  }
+  else {
+    if( flags & CI_TCP_FLAG_CWR )
+      ts->tcpflags &=~ CI_TCPT_FLAG_ECN_ECE;
+    if( ce ) {
+      ts->tcpflags |= CI_TCPT_FLAG_ECN_ECE;
+      TCP_FORCE_ACK(ts);
+    }
+  }
+}
+
+
+/* Does this ACK carry an ECN congestion signal? */
+ci_inline int ci_tcp_rx_ecn_ece(ci_netif* ni, ci_tcp_state* ts,
+                                ciip_tcp_rx_pkt* rxp)
+{
+  if( ! (ts->tcpflags & CI_TCPT_FLAG_ECN) ||
+      (rxp->tcp->tcp_flags & (CI_TCP_FLAG_ECE | CI_TCP_FLAG_SYN)) !=
+      CI_TCP_FLAG_ECE )
+    return 0;
+  CITP_STATS_NETIF_INC(ni, tcp_ecn_ece_rx);
+  return 1;
+}
+
+
 /* function to open the congestion window following the
 ** reception of an ack for new data. Implements RFC3465 (ABC)
 */
@@ -794,28 +920,9 @@ ci_inline void ci_tcp_opencwnd(ci_netif *ni, ci_tcp_state* ts)
   else
 #endif
   if( ts->cwnd >= ts->ssthresh ) {
-    /* Hack - Increase less aggresively on small round trip times */
-#if CI_CFG_CONG_AVOID_SCALE_BACK
-    unsigned tmp = 0, cwnd_scaled;
-    /* tcp_srtt(ts) would relatively easy exceed 32 for a round trip time
-     * on longer links */
-    if( tcp_srtt(ts) < 32 )
-      tmp = NI_OPTS(ni).cong_avoid_scale_back >> tcp_srtt(ts);
-    cwnd_scaled = CI_MAX(1U, tmp) * ts->cwnd;
-#else
-    unsigned cwnd_scaled = ts->cwnd;
-#endif
-    /* Congestion avoidance.  RFC3465 says: increase the congestion window
-    ** by one segment each RTT.  i.e. wait for bytes_acked to be > cwnd
-    ** (which takes one RTT), then reset bytes_acked by subtracting the
-    ** cwnd from it, and add one segment to cwnd.
-    */
     LOG_TV(log(LPF "%d OPENCWND: CA eff_mss=%u bytes_acked=%u cwnd=%u",
                S_FMT(ts), tcp_eff_mss(ts), ts->bytes_acked, ts->cwnd));
-    if( ts->bytes_acked >= cwnd_scaled ) {
-      ts->bytes_acked -= cwnd_scaled;
-      ts->cwnd += tcp_eff_mss(ts);
-    }
+    ci_tcp_cong_avoid(ni, ts);
   }
   else {
     /* Slow-start. */
@@ -850,7 +957,7 @@ ci_inline void ci_tcp_opencwnd(ci_netif *ni, ci_tcp_state* ts)
 
 static void ci_tcp_reset_cwnd_on_loss(ci_netif* ni, ci_tcp_state* ts)
 {
-  ts->ssthresh = ci_tcp_losswnd(ts);
+  ts->ssthresh = ci_tcp_cong_ssthresh(ni, ts);
   ts->cwnd = ts->ssthresh + ci_tcp_base_dupack_thresh(ts) * tcp_eff_mss(ts);
   ts->cwnd = CI_MAX(ts->cwnd, NI_OPTS(ni).loss_min_cwnd);
   ts->cwnd = CI_MAX(ts->cwnd, NI_OPTS(ni).min_cwnd);
@@ -1526,6 +1633,12 @@ static void ci_tcp_rx_free_acked_bufs(ci_netif* netif, ci_tcp_state* ts,
              (ts->tcpflags & CI_TCPT_FLAG_FIN_PENDING) );
   tcp_snd_una(ts) = rxp->ack;
 
+  if(CI_UNLIKELY( ts->zc.acked != ts->zc.queued ) &&
+     ci_tcp_zc_ack(ts, rxp->ack) ) {
+    ci_netif_put_on_post_poll(netif, &ts->s.b);
+    ci_tcp_wake(netif, ts, CI_SB_FLAG_WAKE_RX);
+  }
+
   /* Wake up TX if necessary */
   if( NI_OPTS(netif).tcp_sndbuf_mode >= 1 &&
       ( ci_tcp_tx_advertise_space(netif, ts) || ts->s.tx_errno ) )
@@ -1640,6 +1753,7 @@ static void ci_tcp_rx_handle_ack(ci_tcp_state* ts, ci_netif* netif,
     }
 
     /* Open the congestion window. */
+    ci_tcp_cong_acked(netif, ts, acked, ci_tcp_rx_ecn_ece(netif, ts, rxp));
     ts->bytes_acked += acked;
     ci_tcp_opencwnd(netif, ts);
 
@@ -2715,6 +2829,113 @@ static void handle_rx_synrecv_ack(ci_netif* netif, ci_tcp_socket_listen* tls,
 ** sends a SYN-ACK, inserts the connection
 ** into the filters, and will be moved to the accept queue when the
 ** SYN-ACK is acknowledged */
+/* Accept a TCP Fast Open connection on receipt of its SYN: the new socket
+** goes straight onto the accept queue with the data from the SYN on its
+** receive queue, and the SYN-ACK on its send queue so that it is
+** retransmitted until acked.  On failure the caller falls back to an
+** ordinary handshake.
+*/
+static int handle_rx_listen_fastopen(ci_netif* netif,
+                                     ci_tcp_socket_listen* tls,
+                                     ci_tcp_state_synrecv* tsr,
+                                     ci_ip_cached_hdrs* ipcache,
+                                     ciip_tcp_rx_pkt* rxp)
+{
+  ci_ip_pkt_fmt* pkt = rxp->pkt;
+  ci_ip_pkt_fmt* tx_pkt;
+  ci_tcp_state* ts;
+  ci_uint32 isn = tsr->snd_isn;
+  unsigned flags = CI_TCP_FLAG_SYN | CI_TCP_FLAG_ACK;
+
+  if( ipcache->status != retrrc_success && ipcache->status != retrrc_nomac )
+    return -EHOSTUNREACH;
+  tx_pkt = ci_netif_pkt_alloc(netif, 0);
+  if( tx_pkt == NULL )
+    return -ENOBUFS;
+  tsr->amss = ci_tcp_amss(netif, &tls->c, ipcache, __func__);
+  if( ci_tcp_listenq_try_promote(netif, tls, tsr, ipcache, pkt, &ts) < 0 ) {
+    ci_netif_pkt_release(netif, tx_pkt);
+    return -ENOSPC;
+  }
+  /* [tsr] is gone now. */
+
+  /* Rewind the send sequence to put the SYN-ACK on the send queue.  The
+   * window in a SYN is never scaled. */
+  tcp_snd_una(ts) = tcp_snd_nxt(ts) = tcp_enq_nxt(ts) = tcp_snd_up(ts) = isn;
+  ts->snd_max = isn + 1 + pkt->pf.tcp_rx.window;
+
+  /* Deliver the data first, so that the SYN-ACK acks it. */
+  rxp->seq += 1;
+  ci_tcp_rx_deliver_to_recvq(ts, netif, rxp);
+
+  if( ts->tcpflags & CI_TCPT_FLAG_ECN )
+    flags |= CI_TCP_FLAG_ECE;
+  ts->tcpflags |= CI_TCPT_FLAG_FASTOPEN;
+  ci_tcp_set_flags(ts, flags);
+  tx_pkt->pf.tcp_tx.sock_id = ts->s.b.bufid;
+  ci_tcp_enqueue_no_data(ts, netif, tx_pkt);
+  ci_tcp_set_flags(ts, CI_TCP_FLAG_ACK);
+  ts->tcpflags &=~ CI_TCPT_FLAG_FASTOPEN;
+
+  CITP_STATS_NETIF_INC(netif, tcp_fastopen_passive);
+  LOG_TC(log(LNTS_FMT "TFO accepted %d bytes", LNTS_PRI_ARGS(netif, ts),
+             pkt->pf.tcp_rx.pay_len));
+  return 0;
+}
+
+
+/* Answer a SYN with a syncookie, without keeping any state.  The SYN-ACK
+ * is built from the listener's template.  Returns -1 without consuming the
+ * packet if the SYN should be answered with a reset.
+ */
+static int handle_rx_listen_syncookie(ci_netif* netif,
+                                      ci_tcp_socket_listen* tls,
+                                      ciip_tcp_rx_pkt* rxp,
+                                      ci_ip_cached_hdrs* ipcache)
+{
+  ci_ip_pkt_fmt* pkt = rxp->pkt;
+  ci_ip_pkt_fmt* tx_pkt;
+  const ci_tcp_syncookie_tmpl* tmpl;
+  ci_tcp_state_synrecv tsr;
+
+  tmpl = ci_tcp_syncookie_tmpl_get(netif, tls, ipcache);
+
+  memset(&tsr.tcpopts, 0, sizeof(tsr.tcpopts));
+  tsr.tcpopts.smss = CI_CFG_TCP_DEFAULT_MSS;
+  if( ci_tcp_parse_options(netif, rxp, &tsr.tcpopts) < 0 ) {
+#if CI_CFG_TCP_INVALID_OPT_RST
+    LOG_U(log(LPF "%d LISTEN bad SYN options will reset", S_FMT(tls)));
+    return -1;
+#endif
+  }
+  tsr.tcpopts.flags |= rxp->flags & CI_TCPT_FLAG_TSO;
+  tsr.tcpopts.flags &= NI_OPTS(netif).syn_opts;
+  if( tsr.tcpopts.flags & CI_TCPT_FLAG_TSO )
+    tsr.tspeer = rxp->timestamp;
+
+  tsr.l_addr = RX_PKT_DADDR(pkt);
+  tsr.r_addr = RX_PKT_SADDR(pkt);
+  tsr.l_port = rxp->tcp->tcp_dest_be16;
+  tsr.r_port = rxp->tcp->tcp_source_be16;
+  tsr.local_peer = OO_SP_NULL;
+  tsr.timest = ci_tcp_time_now(netif);
+  tsr.rcv_nxt = rxp->seq + 1;
+  tsr.amss = tmpl->amss;
+  tsr.rcv_wscl = (tsr.tcpopts.flags & CI_TCPT_FLAG_WSCL) ? tmpl->rcv_wscl : 0;
+  ci_tcp_syncookie_syn(netif, tls, &tsr);
+
+  /* The ACKs are due within the initial RTO. */
+  netif->state->syncookie_flood_until =
+    ci_ip_time_now(netif) + NI_CONF(netif).tconst_rto_initial;
+
+  CI_TCP_STATS_INC_PASSIVE_OPENS( netif );
+  tx_pkt = ci_netif_pkt_rx_to_tx(netif, pkt);
+  if( tx_pkt != NULL )
+    ci_tcp_syncookie_synack_send(netif, tls, &tsr, tx_pkt, ipcache);
+  return 0;
+}
+
+
 static void handle_rx_listen(ci_netif* netif, ci_tcp_socket_listen* tls,
                              ciip_tcp_rx_pkt* rxp, int already_parsed)
 {
@@ -2726,6 +2947,7 @@ static void handle_rx_listen(ci_netif* netif, ci_tcp_socket_listen* tls,
   ci_ip_cached_hdrs ipcache;
   oo_sp local_peer = OO_SP_NULL;
   int do_syncookie = 0;
+  int fastopen_accept = 0;
 #if CI_CFG_IPV6
   int af = oo_pkt_af(pkt);
 #endif
@@ -2820,6 +3042,11 @@ static void handle_rx_listen(ci_netif* netif, ci_tcp_socket_listen* tls,
         goto freepkt_out;
     }
 
+    /* Flood mode lasts until a SYN finds room in the listen queue again. */
+    if( do_syncookie && ! tls->syncookie_tmpl.flood )
+      CITP_STATS_TCP_LISTEN(++tls->stats.n_syncookie_flood);
+    tls->syncookie_tmpl.flood = do_syncookie;
+
     /* If accept queue is full, there is no point accepting a SYN,
      * sending SYNACK, and dropping the following ACK.
      * So drop the SYN. Linux does the same in this case -
@@ -3030,7 +3257,8 @@ static void handle_rx_listen(ci_netif* netif, ci_tcp_socket_listen* tls,
 
   /* It is legal to pass data with a SYN, but it is not desirable to keep
   ** the data because it provides a simple way to do a DOS.  So we bin the
-  ** data, and the other end can retransmit it.
+  ** data, and the other end can retransmit it.  The exception is a SYN
+  ** with a valid TCP Fast Open cookie, see handle_rx_listen_fastopen().
   */
   if( pkt->pf.tcp_rx.pay_len ) {
     LOG_U(log(LPF "%d LISTEN SYN with data (%d bytes)", S_FMT(tls),
@@ -3046,6 +3274,14 @@ static void handle_rx_listen(ci_netif* netif, ci_tcp_socket_listen* tls,
     goto freepkt_out;
   }
 
+  if( do_syncookie && OO_SP_IS_NULL(local_peer) ) {
+    if( handle_rx_listen_syncookie(netif, tls, rxp, &ipcache) < 0 ) {
+      CITP_STATS_NETIF_INC(netif, rst_sent_bad_options);
+      goto reset_out;
+    }
+    return;
+  }
+
   /* Allocate synrecv. */
   if( do_syncookie ) {
     tsr = ci_alloc(sizeof(ci_tcp_state_synrecv));
@@ -3091,6 +3327,36 @@ static void handle_rx_listen(ci_netif* netif, ci_tcp_socket_listen* tls,
     if( ! ci_tcp_can_stripe(netif, ip->ip4.ip_daddr_be32,ip->ip4.ip_saddr_be32) )
       tsr->tcpopts.flags &=~ CI_TCPT_FLAG_STRIPE;
     tsr->tcpopts.flags &= NI_OPTS(netif).syn_opts | CI_TCPT_FLAG_STRIPE;
+    /* ECN-setup SYN has both ECE and CWR (RFC3168 6.1.1).  ECN is not
+     * offered to syncookie connections, as the cookie can't record it. */
+    if( (NI_OPTS(netif).syn_opts & CI_TCPT_FLAG_ECN) &&
+        (tcp->tcp_flags & (CI_TCP_FLAG_ECE | CI_TCP_FLAG_CWR)) ==
+        (CI_TCP_FLAG_ECE | CI_TCP_FLAG_CWR) )
+      tsr->tcpopts.flags |= CI_TCPT_FLAG_ECN;
+
+    /* TCP Fast Open (RFC7413).  A cookie request or an invalid cookie
+     * gets a fresh cookie in the SYN-ACK; a valid cookie lets us accept
+     * the data in the SYN straight away if the queue limit allows. */
+    if( (rxp->flags & CI_TCPT_FLAG_FASTOPEN) &&
+        OO_SP_IS_NULL(local_peer) &&
+        (NI_OPTS(netif).tcp_fastopen & EF_TCP_FASTOPEN_SERVER) &&
+        (tls->c.fastopen_qlen > 0 ||
+         (NI_OPTS(netif).tcp_fastopen & EF_TCP_FASTOPEN_SERVER_NO_QLEN)) ) {
+      tsr->tcpopts.flags |= CI_TCPT_FLAG_FASTOPEN;
+      if( rxp->fastopen_len == 0 ) {
+        CITP_STATS_NETIF_INC(netif, tcp_fastopen_cookie_req);
+      }
+      else if( ci_tcp_fastopen_cookie_check(netif, RX_PKT_DADDR(pkt),
+                                            RX_PKT_SADDR(pkt), rxp) ) {
+        CITP_STATS_NETIF_INC(netif, tcp_fastopen_cookie_hit);
+        fastopen_accept = pkt->pf.tcp_rx.pay_len != 0 &&
+          (tls->c.fastopen_qlen == 0 ||
+           ci_tcp_acceptq_n(tls) < tls->c.fastopen_qlen);
+      }
+      else {
+        CITP_STATS_NETIF_INC(netif, tcp_fastopen_cookie_miss);
+      }
+    }
   }
 
   /* setup synrecv state */
@@ -3140,6 +3406,9 @@ static void handle_rx_listen(ci_netif* netif, ci_tcp_socket_listen* tls,
 
   /* send SYN-ACK packet */
   CI_TCP_STATS_INC_PASSIVE_OPENS( netif );
+  if( fastopen_accept &&
+      handle_rx_listen_fastopen(netif, tls, tsr, &ipcache, rxp) == 0 )
+    return;
   if( OO_SP_NOT_NULL(tsr->local_peer) )
     ci_netif_pkt_hold(netif, pkt);
   tx_pkt = ci_netif_pkt_rx_to_tx(netif, pkt);
@@ -3266,6 +3535,17 @@ static int handle_syn_sent_opts(ci_netif* netif, ci_tcp_state* ts,
     ts->tcpflags &=~ CI_TCPT_FLAG_SACK;
   if( !(tcpopts.flags & CI_TCPT_FLAG_STRIPE) )
     ts->tcpflags &=~ CI_TCPT_FLAG_STRIPE;
+  if( ts->tcpflags & CI_TCPT_FLAG_ECN ) {
+    /* ECN-setup SYN-ACK has ECE but not CWR (RFC3168 6.1.1) */
+    if( (tcp->tcp_flags & (CI_TCP_FLAG_ECE | CI_TCP_FLAG_CWR)) ==
+        CI_TCP_FLAG_ECE ) {
+      CITP_STATS_NETIF_INC(netif, tcp_ecn_active);
+    }
+    else {
+      ts->tcpflags &=~ CI_TCPT_FLAG_ECN;
+      CITP_STATS_NETIF_INC(netif, tcp_ecn_active_refused);
+    }
+  }
 
   ts->outgoing_hdrs_len = CI_IPX_HDR_SIZE(af) + sizeof(ci_tcp_hdr) + optlen;
   ci_tcp_set_hdr_len(ts, sizeof(ci_tcp_hdr) + optlen);
@@ -3306,6 +3586,13 @@ static void handle_rx_syn_sent(ci_netif* netif, ci_tcp_state* ts,
     goto set_isn;
   }
 
+  /* A TCP Fast Open connect may not have sent its SYN yet. */
+  if(CI_UNLIKELY( ts->tcpflags & CI_TCPT_FLAG_FASTOPEN_DEFER )) {
+    LOG_U(log(LPF "%d SYN-SENT segment before TFO SYN (binned)",
+              S_FMT(ts)));
+    goto free_out;
+  }
+
   /* We should have SYN in RTQ. */
   ci_assert(!ci_ip_queue_is_empty(&ts->retrans));
 
@@ -3369,6 +3656,10 @@ static void handle_rx_syn_sent(ci_netif* netif, ci_tcp_state* ts,
   */
 
   if( handle_syn_sent_opts(netif, ts, rxp) < 0 ) return;
+  if( (ts->tcpflags & CI_TCPT_FLAG_FASTOPEN) &&
+      (rxp->flags & CI_TCPT_FLAG_FASTOPEN) && rxp->fastopen_len > 0 )
+    ci_tcp_fastopen_cache_set(netif, tcp_ipx_raddr(ts),
+                              rxp->fastopen_cookie, rxp->fastopen_len);
 
   /* remove SYN (and any sent data) from retransmission queue
   ** and seed RTT */
@@ -3409,6 +3700,20 @@ set_isn:
              S_FMT(ts), RCV_WND_ARGS(ts),
              tcp_snd_una(ts), tcp_snd_nxt(ts), ts->snd_max, tcp_enq_nxt(ts)));
 
+  if( ts->tcpflags & CI_TCPT_FLAG_FASTOPEN ) {
+    /* If the data in our SYN was not acked, send it again without the
+     * SYN.  ci_tcp_retrans_one() does the reformatting. */
+    if( ci_ip_queue_not_empty(&ts->retrans) ) {
+      ci_ip_pkt_fmt* p = PKT_CHK(netif, ts->retrans.head);
+      if( TX_PKT_IPX_TCP(ipcache_af(&ts->s.pkt), p)->tcp_flags &
+          CI_TCP_FLAG_SYN ) {
+        CITP_STATS_NETIF_INC(netif, tcp_fastopen_active_fail);
+        ci_tcp_retrans_one(ts, netif, p);
+      }
+    }
+    ts->tcpflags &=~ CI_TCPT_FLAG_FASTOPEN;
+  }
+
   /* Send any data that was enqueued in advance. */
   if( ci_tcp_sendq_not_empty(ts) ) {
     ci_netif_pkt_release_rx(netif, pkt);
@@ -3953,11 +4258,6 @@ static void handle_rx_slow(ci_tcp_state* ts, ci_netif* netif,
   if(CI_UNLIKELY( tcp->tcp_flags & CI_TCP_FLAG_RST ))
     goto handle_rst;
 
-  /*! \TODO We don't support ECN yet. */
-  LOG_TR(if( tcp->tcp_flags & (CI_TCP_FLAG_ECE|CI_TCP_FLAG_CWR) )
-           log(LNT_FMT "ECN flags=%x not implemented (ignored)",
-               LNT_PRI_ARGS(netif, ts), (unsigned) tcp->tcp_flags));
-
   ci_assert(CI_IPX_ADDR_EQ(RX_PKT_SADDR(pkt),
                              ipcache_raddr(&ts->s.pkt)));
   ci_assert(CI_IPX_ADDR_EQ(RX_PKT_DADDR(pkt),
@@ -4545,6 +4845,9 @@ int ci_tcp_rx_deliver_to_conn(ci_sock_cmn* s, void* opaque_arg)
       ci_tcp_parse_options(ni, rxp, NULL);
   }
 
+  if(CI_UNLIKELY( ts->tcpflags & CI_TCPT_FLAG_ECN ))
+    ci_tcp_rx_ecn(ni, ts, rxp);
+
   /* These calculations assume the fast path.  We'll fix them up later if
    * we can't use the fast path.
    */
@@ -4637,7 +4940,9 @@ int ci_tcp_rx_deliver_to_conn(ci_sock_cmn* s, void* opaque_arg)
 
     oo_offbuf_init(&pkt->buf, (char*) tcp + ts->incoming_tcp_hdr_len,
                    pkt->pf.tcp_rx.pay_len);
-    ci_tcp_rx_enqueue_packet(ni, ts, pkt);
+    if( ! NI_OPTS(ni).tcp_rx_coalesce ||
+        ! ci_tcp_rx_enqueue_coalesce(ni, ts, pkt) )
+      ci_tcp_rx_enqueue_packet(ni, ts, pkt);
 
     rxp->pkt = NULL;
 
@@ -4646,6 +4951,11 @@ int ci_tcp_rx_deliver_to_conn(ci_sock_cmn* s, void* opaque_arg)
 
   handle_rx_slow(ts, ni, rxp);
   rxp->pkt = NULL;
+  /* If this took an orphan into TIME_WAIT, it may be able to give up its
+   * endpoint.  NB. [ts] may have been freed, but not reused for a
+   * connection in TIME_WAIT. */
+  if(CI_UNLIKELY( ts->s.b.state == CI_TCP_TIME_WAIT ))
+    ci_netif_timewait_compact(ni, ts);
   return 1;  /* finished -- don't deliver to any other socket */
 
 #if CI_CFG_TCP_PAWS_ON_FASTPATH
@@ -4678,6 +4988,108 @@ static int ci_tcp_rx_deliver_to_listen(ci_sock_cmn* s, void* opaque_arg)
 }
 
 
+ci_inline void ci_tcp_rx_pkt_init(ciip_tcp_rx_pkt* rxp, ci_netif* netif,
+                                  struct ci_netif_poll_state* ps,
+                                  ci_ip_pkt_fmt* pkt, ci_tcp_hdr* tcp,
+                                  int ip_paylen)
+{
+  rxp->ni = netif;
+  rxp->poll_state = ps;
+  rxp->pkt = pkt;
+  rxp->tcp = tcp;
+  ci_assert_gt(pkt->pay_len, ip_paylen);
+  pkt->pf.tcp_rx.pay_len = ip_paylen;
+
+  rxp->seq = CI_BSWAP_BE32(tcp->tcp_seq_be32);
+  rxp->ack = CI_BSWAP_BE32(tcp->tcp_ack_be32);
+}
+
+
+/* Handles an IPv4 segment for a connection that has been moved into the
+ * timewait table, in the way that handle_rx_slow() does for a socket in
+ * TIME_WAIT.  Returns false if there is no such connection, or if the
+ * segment is a SYN that reopens the connection, in which case it should
+ * be passed to the listening socket.
+ */
+static int handle_rx_timewait_table(ci_netif* ni, ciip_tcp_rx_pkt* rxp)
+{
+  ci_ip_pkt_fmt* pkt = rxp->pkt;
+  ci_ip4_hdr* ip4 = oo_ip_hdr(pkt);
+  ci_tcp_hdr* tcp = rxp->tcp;
+  ci_tcp_timewait_t* tw;
+  int tso;
+
+  tw = ci_netif_timewait_lookup(ni, ip4->ip_daddr_be32, tcp->tcp_dest_be16,
+                                ip4->ip_saddr_be32, tcp->tcp_source_be16);
+  if( tw == NULL )
+    return 0;
+
+  ci_tcp_parse_options(ni, rxp, NULL);
+  tso = (tw->flags & CI_TCP_TIMEWAIT_FLAG_TSO) &&
+        (rxp->flags & CI_TCPT_FLAG_TSO);
+
+  if( tcp->tcp_flags & CI_TCP_FLAG_RST ) {
+    /* Good sequence number, good paws => possible TIME-WAIT assassination.
+     */
+    if( NI_OPTS(ni).time_wait_assassinate &&
+        SEQ_EQ(rxp->seq, tw->rcv_nxt) &&
+        ( ! tso || TIME_GE(rxp->timestamp, tw->tsrecent) ) )
+      ci_netif_timewait_free(ni, tw);
+    else
+      CITP_STATS_NETIF_INC(ni, rst_recv_unacceptable);
+    ci_netif_pkt_release_rx(ni, pkt);
+    return 1;
+  }
+
+  /* RFC 1122 allows a SYN to reopen the connection if its sequence number
+   * is beyond the old one, or (like Linux) if its timestamp is newer. */
+  if( (tcp->tcp_flags & (CI_TCP_FLAG_SYN | CI_TCP_FLAG_ACK))
+      == CI_TCP_FLAG_SYN &&
+      (SEQ_LT(tw->rcv_nxt, rxp->seq) ||
+       (tso && TIME_GE(rxp->timestamp, tw->tsrecent))) ) {
+    oo_sp sock_id = ci_netif_listener_lookup(ni, AF_SPACE_FLAG_IP4,
+                                             RX_PKT_DADDR(pkt),
+                                             tcp->tcp_dest_be16);
+    if( OO_SP_NOT_NULL(sock_id) &&
+        SP_TO_SOCK(ni, sock_id)->b.state == CI_TCP_LISTEN ) {
+      LOG_TV(log(LPF "SYN for timewait table entry, recycling connection"));
+      ci_netif_timewait_free(ni, tw);
+      CITP_STATS_NETIF_INC(ni, tcp_timewait_table_reuses);
+      return 0;
+    }
+  }
+
+  CITP_STATS_NETIF_INC(ni, tcp_timewait_table_hits);
+
+  /* if a retransmission of the FIN then we should restart 2*msl timeout.
+   * The peer needs our ACK to leave LAST_ACK, so it is not rate limited. */
+  if( (tcp->tcp_flags & CI_TCP_FLAG_FIN) &&
+      SEQ_EQ(rxp->seq + 1, tw->rcv_nxt) ) {
+    LOG_TC(log(LPF "dup FIN for timewait table entry restarting 2MSL"));
+    tw->expiry = ci_ip_time_now(ni) + NI_CONF(ni).tconst_2msl_time;
+    if( tso && TIME_GT(rxp->timestamp, tw->tsrecent) )
+      tw->tsrecent = rxp->timestamp;
+    ci_tcp_timewait_send_ack(ni, tw, rxp);
+    return 1;
+  }
+
+  /* Pure ACKs can be generated by the peer if we retransmitted our FIN, so
+   * don't answer those.  Anything else is a stray segment, and as for a
+   * socket in TIME_WAIT our answer is rate limited as in RFC 5961.  The
+   * limit is per bucket of entries, so that a peer can only hold back the
+   * answers to the few others that share its bucket. */
+  if( (pkt->pf.tcp_rx.pay_len > CI_TCP_HDR_LEN(tcp) ||
+       (tcp->tcp_flags & CI_TCP_FLAG_MASK) != CI_TCP_FLAG_ACK) &&
+      ci_tcp_ack_ratelimit(ni, &ni->state->timewait_t_last_invalid_ack
+                           [(tw - ni->timewait_table) &
+                            (CI_TCP_TIMEWAIT_ACK_BUCKETS - 1)]) )
+    ci_tcp_timewait_send_ack(ni, tw, rxp);
+  else
+    ci_netif_pkt_release_rx(ni, pkt);
+  return 1;
+}
+
+
 void ci_tcp_handle_rx(ci_netif* netif, struct ci_netif_poll_state* ps,
                       ci_ip_pkt_fmt* pkt, ci_tcp_hdr* tcp, int ip_paylen)
 {
@@ -4701,15 +5113,7 @@ void ci_tcp_handle_rx(ci_netif* netif, struct ci_netif_poll_state* ps,
   if( OO_PP_NOT_NULL(pkt->frag_next) )
     goto scattered;
 
-  rxp.ni = netif;
-  rxp.poll_state = ps;
-  rxp.pkt = pkt;
-  rxp.tcp = tcp;
-  ci_assert_gt(pkt->pay_len, ip_paylen);
-  pkt->pf.tcp_rx.pay_len = ip_paylen;
-
-  rxp.seq = CI_BSWAP_BE32(tcp->tcp_seq_be32);
-  rxp.ack = CI_BSWAP_BE32(tcp->tcp_ack_be32);
+  ci_tcp_rx_pkt_init(&rxp, netif, ps, pkt, tcp, ip_paylen);
 
   daddr = RX_PKT_DADDR(pkt);
   saddr = RX_PKT_SADDR(pkt);
@@ -4820,6 +5224,10 @@ void ci_tcp_handle_rx(ci_netif* netif, struct ci_netif_poll_state* ps,
     if(CI_LIKELY( rxp.pkt == NULL ))
       return;
 
+    if( netif->state->timewait_table_entries_n != 0 &&
+        handle_rx_timewait_table(netif, &rxp) )
+      return;
+
     ci_netif_filter_for_each_match(netif,
                                    ip4->ip_daddr_be32, tcp->tcp_dest_be16,
                                    0, 0, IPPROTO_TCP, pkt->intf_i, pkt->vlan,
@@ -4863,5 +5271,101 @@ void ci_tcp_handle_rx(ci_netif* netif, struct ci_netif_poll_state* ps,
   ci_netif_pkt_release_rx_1ref(netif, pkt);
 }
 
+
+struct ci_tcp_rx_vec_match {
+  ciip_tcp_rx_pkt* rxp;
+  ci_sock_cmn*     s;
+};
+
+static int ci_tcp_rx_deliver_to_conn_vec(ci_sock_cmn* s, void* opaque_arg)
+{
+  struct ci_tcp_rx_vec_match* m = opaque_arg;
+  m->s = s;
+  return ci_tcp_rx_deliver_to_conn(s, m->rxp);
+}
+
+
+/* Handle [n_pkts] IPv4 segments of one connection, in order.  They have
+ * passed the checks in handle_rx_pkt(), as for ci_tcp_handle_rx().
+ *
+ * The first segment is looked up in the filter table.  If it reaches a
+ * connected socket then the following segments are given straight to that
+ * socket for as long as it remains connected and they arrived on the same
+ * interface and VLAN, which the lookup also depends on (e.g. for
+ * SO_BINDTODEVICE).  Anything else takes the usual path.
+ */
+void ci_tcp_handle_rx_vec(ci_netif* netif, struct ci_netif_poll_state* ps,
+                          ci_ip_pkt_fmt** pkts, int n_pkts)
+{
+  struct ci_tcp_rx_vec_match m;
+  ciip_tcp_rx_pkt rxp;
+  ci_sock_cmn* s = NULL;
+  ci_uint32 hash = 0;
+  int intf_i = -1;
+  int vlan = 0;
+  int i;
+
+  for( i = 0; i < n_pkts; ++i ) {
+    ci_ip_pkt_fmt* pkt = pkts[i];
+    ci_ip4_hdr* ip4 = oo_ip_hdr(pkt);
+    ci_tcp_hdr* tcp = (ci_tcp_hdr*) ((char*) ip4 + CI_IP4_IHL(ip4));
+    int ip_paylen = CI_BSWAP_BE16(ip4->ip_tot_len_be16) - CI_IP4_IHL(ip4);
+
+    ci_assert_equal(oo_pkt_af(pkt), AF_INET);
+
+    if( (ip4->ip_frag_off_be16 != CI_IP4_FRAG_DONT &&
+         ip4->ip_frag_off_be16 != 0) ||
+        OO_PP_NOT_NULL(pkt->frag_next) ) {
+      ci_tcp_handle_rx(netif, ps, pkt, tcp, ip_paylen);
+      s = NULL;
+      continue;
+    }
+
+    if( s != NULL ) {
+      /* An earlier segment may have closed the connection. */
+      if(CI_LIKELY( (s->b.state & CI_TCP_STATE_TCP_CONN) &&
+                    tcp->tcp_dest_be16 ==
+                      S_IPX_TCP_HDR(s)->tcp_source_be16 &&
+                    tcp->tcp_source_be16 ==
+                      S_IPX_TCP_HDR(s)->tcp_dest_be16 &&
+                    pkt->intf_i == intf_i && pkt->vlan == vlan )) {
+        CI_TCP_STATS_INC_IN_SEGS( netif );
+        ci_tcp_rx_pkt_init(&rxp, netif, ps, pkt, tcp, ip_paylen);
+        rxp.hash = hash;
+        ci_tcp_rx_deliver_to_conn(s, &rxp);
+        ci_assert(rxp.pkt == NULL);
+        continue;
+      }
+      CITP_STATS_NETIF_INC(netif, rx_batch_fallback);
+      ci_tcp_handle_rx(netif, ps, pkt, tcp, ip_paylen);
+      s = NULL;
+      continue;
+    }
+
+    if( i != 0 )
+      CITP_STATS_NETIF_INC(netif, rx_batch_fallback);
+    ci_tcp_rx_pkt_init(&rxp, netif, ps, pkt, tcp, ip_paylen);
+    m.rxp = &rxp;
+    m.s = NULL;
+    ci_netif_filter_for_each_match(netif,
+                                   ip4->ip_daddr_be32, tcp->tcp_dest_be16,
+                                   ip4->ip_saddr_be32, tcp->tcp_source_be16,
+                                   IPPROTO_TCP, pkt->intf_i, pkt->vlan,
+                                   ci_tcp_rx_deliver_to_conn_vec, &m,
+                                   &rxp.hash);
+    if(CI_LIKELY( rxp.pkt == NULL )) {
+      CI_TCP_STATS_INC_IN_SEGS( netif );
+      s = m.s;
+      intf_i = pkt->intf_i;
+      vlan = pkt->vlan;
+      hash = rxp.hash;
+    }
+    else {
+      /* No connected socket: repeats the lookup, then tries listeners. */
+      ci_tcp_handle_rx(netif, ps, pkt, tcp, ip_paylen);
+    }
+  }
+}
+
 #endif
 /*! \cidoxg_end */
@@ -56,6 +56,7 @@ struct tcp_send_info {
   ci_uint32 old_burst_window;
 #endif
   ci_uint64 start_frc;
+  ci_uint64 lat_hist_frc;
   int set_errno;
   int stack_locked;
   int total_unsent;
@@ -70,7 +71,11 @@ struct tcp_send_info {
 };
 
 
-static void ci_tcp_tx_advance_nagle(ci_netif* ni, ci_tcp_state* ts)
+/* [lat_hist_frc] is the time at which the send call started, or zero if it
+ * is not to be recorded in the send_doorbell latency histogram.
+ */
+static void ci_tcp_tx_advance_nagle(ci_netif* ni, ci_tcp_state* ts,
+                                    ci_uint64 lat_hist_frc)
 {
   /* Nagle's algorithm (rfc896).  Summary: when user pushes data, don't
   ** send it if there is less than an MSS and we have unacknowledged data
@@ -91,6 +96,11 @@ static void ci_tcp_tx_advance_nagle(ci_netif* ni, ci_tcp_state* ts)
     ci_tcp_tx_advance(ts, ni);
     if(CI_UNLIKELY( ts->tcpflags & CI_TCPT_FLAG_MSG_WARM ))
       return;
+    if(CI_UNLIKELY( lat_hist_frc != 0 )) {
+      ci_uint64 now_frc;
+      ci_frc64(&now_frc);
+      CI_LAT_HIST_RECORD(ni, send_doorbell, now_frc - lat_hist_frc);
+    }
     goto poll_and_out;
   }
 
@@ -640,6 +650,15 @@ int ci_tcp_tmpl_alloc(ci_netif* ni, ci_tcp_state* ts,
     }
   }
 
+  if( ts->tcpflags & CI_TCPT_FLAG_ECN ) {
+    /* The headers of a template are built here but sent later without
+     * passing through ci_tcp_tx_finish(), so ECT and CWR would be stale. */
+    LOG_U(ci_log("%s: templated sends not supported on ECN connections",
+                 __FUNCTION__));
+    rc = -EOPNOTSUPP;
+    goto out;
+  }
+
   if( ipcache->flags & CI_IP_CACHE_IS_LOCALROUTE ) {
    local_route:
     LOG_U(ci_log("%s: templated sends not supported on loopback connections",
@@ -942,10 +961,14 @@ ci_tcp_tmpl_update(ci_netif* ni, ci_tcp_state* ts,
 
   ci_assert_ge(pkt->pio_addr, 0);
 
+  ci_netif_tx_lock(ni, pkt->intf_i);
   if( ci_ip_queue_is_empty(&ts->send) && ef_vi_transmit_space(vi) > 0 &&
-      ci_tcp_inflight(ts) + ts->smss < CI_MIN(ts->cwnd, tcp_snd_wnd(ts)) ) {
-    /* Sendq is empty, TXQ is not full, and send window allows us to
-     * send the requested amount of data, so go ahead and send
+      ci_tcp_inflight(ts) + ts->smss < CI_MIN(ts->cwnd, tcp_snd_wnd(ts)) &&
+      ! ci_tcp_is_paced(ni, ts) ) {
+    /* Sendq is empty, TXQ is not full, send window allows us to send the
+     * requested amount of data and the socket is not paced, so go ahead
+     * and send.  Paced sockets take the normal path, which is gated by
+     * ci_tcp_tx_advance().
      */
 
     if( CI_BSWAP_BE32(tcp->tcp_seq_be32) != tcp_enq_nxt(ts) ) {
@@ -985,6 +1008,7 @@ ci_tcp_tmpl_update(ci_netif* ni, ci_tcp_state* ts,
      * the TXQ */
     rc = ef_vi_transmit_pio(vi, pkt->pio_addr, pkt->pay_len, OO_PKT_ID(pkt));
     ci_assert_equal(rc, 0);
+    ci_netif_tx_unlock(ni, pkt->intf_i);
 
     /* Update tcp state machinery state */
     tcp_snd_nxt(ts) = pkt->pf.tcp_tx.end_seq;
@@ -997,10 +1021,11 @@ ci_tcp_tmpl_update(ci_netif* ni, ci_tcp_state* ts,
     CITP_STATS_NETIF_INC(ni, pio_pkts);
   }
   else {
-    /* Unable to send via pio due to tcp state machinery or full TXQ.
-     * So do a normal send.  __ci_tcp_tmpl_normal_send() releases the
+    /* Unable to send via pio due to tcp state machinery, pacing or full
+     * TXQ.  So do a normal send.  __ci_tcp_tmpl_normal_send() releases the
      * lock.
      */
+    ci_netif_tx_unlock(ni, pkt->intf_i);
     return __ci_tcp_tmpl_normal_send(ni, ts, pkt, sinf, flags);
   }
 
@@ -1322,6 +1347,141 @@ static int ci_tcp_sendmsg_notsynchronised(ci_netif* ni, ci_tcp_state* ts,
 }
 
 
+/* First send on a TCP Fast Open socket whose connect() deferred the SYN:
+ * the SYN goes now, carrying as much data as fits in one segment.  A
+ * blocking send then waits for the handshake and sends the rest as usual.
+ * Returns as ci_tcp_sendmsg().
+ */
+static int ci_tcp_sendmsg_fastopen(ci_netif* ni, ci_tcp_state* ts,
+                                   const ci_iovec* iov, unsigned long iovlen,
+                                   int flags, struct tcp_send_info* sinf
+                                   CI_KERNEL_ARG(ci_addr_spc_t addr_spc))
+{
+  ci_uint8 cookie[CI_TCP_FASTOPEN_COOKIE_MAX];
+  ci_ip_pkt_fmt* pkt;
+  ci_iovec_ptr piov;
+  int n, rc, maxlen;
+
+  if( ! sinf->stack_locked ) {
+    if( (rc = ci_netif_lock(ni)) != 0 )
+      return rc;
+    sinf->stack_locked = 1;
+  }
+  if( ts->s.b.state != CI_TCP_SYN_SENT ||
+      ~ts->tcpflags & CI_TCPT_FLAG_FASTOPEN_DEFER ) {
+    /* Another thread sent the SYN first. */
+    ci_netif_unlock(ni);
+    return ci_tcp_sendmsg(ni, ts, iov, iovlen, flags CI_KERNEL_ARG(addr_spc));
+  }
+
+  pkt = ci_netif_pkt_tx_tcp_alloc(ni, ts);
+  if( pkt == NULL ) {
+    ci_netif_unlock(ni);
+    CI_SET_ERROR(rc, ENOBUFS);
+    return rc;
+  }
+
+  /* Leave room for the largest set of SYN options.  Data without a
+   * cookie would be dropped by the server, so don't send any if the
+   * cookie has been evicted since connect(). */
+  maxlen = ts->amss - CI_TCP_MAX_OPTS_LEN;
+  if( ci_tcp_fastopen_cache_get(ni, tcp_ipx_raddr(ts), cookie) == 0 )
+    maxlen = 0;
+  ci_iovec_ptr_init_nz(&piov, iov, iovlen);
+  n = ci_tcp_enqueue_syn_data(ts, ni, pkt, &piov, maxlen
+                              CI_KERNEL_ARG(addr_spc));
+  if( n < 0 ) {
+    ci_netif_unlock(ni);
+    CI_SET_ERROR(rc, -n);
+    return rc;
+  }
+  ts->tcpflags &=~ CI_TCPT_FLAG_FASTOPEN_DEFER;
+  ci_tcp_set_flags(ts, CI_TCP_FLAG_ACK);
+  CITP_STATS_NETIF_INC(ni, tcp_fastopen_active);
+  ci_netif_unlock(ni);
+
+  if( (flags & MSG_DONTWAIT) || ci_iovec_ptr_is_empty_proper(&piov) )
+    return n;
+
+  /* Rest of the current segment, then any segments that follow it. */
+  rc = ci_tcp_sendmsg(ni, ts, &piov.io, 1,
+                      flags | (piov.iovlen ? MSG_MORE : 0)
+                      CI_KERNEL_ARG(addr_spc));
+  if( rc > 0 && rc == (int) CI_IOVEC_LEN(&piov.io) && piov.iovlen > 0 ) {
+    n += rc;
+    rc = ci_tcp_sendmsg(ni, ts, piov.iov, piov.iovlen, flags
+                        CI_KERNEL_ARG(addr_spc));
+  }
+  if( rc < 0 )
+    return n > 0 ? n : rc;
+  return n + rc;
+}
+
+
+/* Record the ranges of the MSG_ZEROCOPY sends that have taken an id since
+ * the last call, and complete any whose data has been acked already.
+ */
+void ci_tcp_zc_record(ci_netif* ni, ci_tcp_state* ts)
+{
+  ci_uint32 next_id = OO_ACCESS_ONCE(ts->zc.next_id);
+  ci_uint32 acked = ts->zc.acked;
+
+  ci_assert(ci_netif_is_locked(ni));
+  if( next_id == ts->zc.queued )
+    return;
+
+  /* Each send's data was queued before it took its id, but may still be on
+   * the prequeue. */
+  ci_rmb();
+  ci_tcp_sendmsg_enqueue_prequeue_deferred(ni, ts);
+  CITP_STATS_NETIF_ADD(ni, tcp_zerocopy_sends, next_id - ts->zc.queued);
+  ci_tcp_zc_queue(ts, next_id, tcp_enq_nxt(ts));
+
+  /* The peer may have acked the data before we got here, and if the send
+   * queues have been dropped it never will. */
+  if( ts->s.b.state == CI_TCP_CLOSED )
+    ts->zc.acked = ts->zc.queued;
+  else
+    ci_tcp_zc_ack(ts, tcp_snd_una(ts));
+
+  if( ts->zc.acked != acked ) {
+    ci_netif_put_on_post_poll(ni, &ts->s.b);
+    ci_tcp_wake_possibly_not_in_poll(ni, ts, CI_SB_FLAG_WAKE_RX);
+  }
+}
+
+
+/* send(MSG_ZEROCOPY) on a socket with SO_ZEROCOPY.  This is not zero-copy:
+ * there is no path for sending from pinned user pages, so the data is
+ * copied into packet buffers as for any other send.  What is provided is
+ * the API, so that applications written for it work unmodified.  The send
+ * is given a notification id which is posted to the error queue once the
+ * peer has acked it; the notifications always carry
+ * SO_EE_CODE_ZEROCOPY_COPIED, as Linux does when it falls back to copying,
+ * which tells the application that no pages were shared.
+ * As on Linux, the id is only used up if some data is sent.
+ *
+ * The data can be sent and acked as soon as it is queued, so the id is
+ * taken without the stack lock and its range recorded by
+ * ci_tcp_zc_record(), either here or by the lock holder as deferred work.
+ */
+static int ci_tcp_sendmsg_zerocopy(ci_netif* ni, ci_tcp_state* ts,
+                                   const ci_iovec* iov, unsigned long iovlen,
+                                   int flags
+                                   CI_KERNEL_ARG(ci_addr_spc_t addr_spc))
+{
+  int rc = ci_tcp_sendmsg(ni, ts, iov, iovlen, flags & ~MSG_ZEROCOPY
+                          CI_KERNEL_ARG(addr_spc));
+  if( rc <= 0 )
+    return rc;
+
+  ci_atomic32_inc(&ts->zc.next_id);
+  if( ci_netif_lock_or_defer_work(ni, &ts->s.b) )
+    ci_netif_unlock(ni);
+  return rc;
+}
+
+
 static void ci_tcp_sendmsg_handle_rc_or_tx_errno(ci_netif* ni, 
                                                  ci_tcp_state* ts, 
                                                  int flags, 
@@ -1421,7 +1581,7 @@ static int ci_tcp_sendmsg_no_pkt_buf(ci_netif* ni, ci_tcp_state* ts,
 {
   ci_ip_pkt_fmt* pkt;
   do {
-    pkt = ci_netif_pkt_alloc_nonb(ni);
+    pkt = ci_netif_pkt_alloc_nonb_cached(ni);
     if( pkt ) 
       oo_pkt_filler_add_pkt(&sinf->pf, pkt);
     else
@@ -1887,6 +2047,13 @@ int ci_tcp_sendmsg(ci_netif* ni, ci_tcp_state* ts,
   ci_assert(ts);
   ci_assert(ts->s.b.state != CI_TCP_LISTEN);
 
+  if(CI_UNLIKELY( flags & MSG_ZEROCOPY )) {
+    if( ts->s.s_aflags & CI_SOCK_AFLAG_ZEROCOPY )
+      return ci_tcp_sendmsg_zerocopy(ni, ts, iov, iovlen, flags
+                                     CI_KERNEL_ARG(addr_spc));
+    flags &=~ MSG_ZEROCOPY;
+  }
+
   if( ts->snd_delegated ) {
     int rc;
     /* We do not know which seq number to use.  Call
@@ -1902,6 +2069,9 @@ int ci_tcp_sendmsg(ci_netif* ni, ci_tcp_state* ts,
   sinf.pf.alloc_pkt = NULL;
   sinf.timeout = ts->s.so.sndtimeo_msec;
   sinf.sendq_credit = 0;
+  sinf.lat_hist_frc = 0;
+  if(CI_UNLIKELY( NI_OPTS(ni).lat_hist ))
+    ci_frc64(&sinf.lat_hist_frc);
 #ifndef __KERNEL__
   sinf.tcp_send_spin = 
     oo_per_thread_get()->spinstate & (1 << ONLOAD_SPIN_TCP_SEND);
@@ -1987,7 +2157,7 @@ int ci_tcp_sendmsg(ci_netif* ni, ci_tcp_state* ts,
     if( ~flags & MSG_SENDPAGE_NOTLAST ||
         ci_tcp_tx_send_space(ni, ts) <= 0 )
 #endif
-    ci_tcp_tx_advance_nagle(ni, ts);
+    ci_tcp_tx_advance_nagle(ni, ts, sinf.lat_hist_frc);
 
     if( sinf.stack_locked ) ci_netif_unlock(ni);
     return sinf.total_sent;
@@ -2064,7 +2234,7 @@ int ci_tcp_sendmsg(ci_netif* ni, ci_tcp_state* ts,
             ci_tcp_tx_send_space(ni, ts) <= 0 )
 #endif
         {
-        ci_tcp_tx_advance_nagle(ni, ts);
+        ci_tcp_tx_advance_nagle(ni, ts, sinf.lat_hist_frc);
         if(CI_UNLIKELY( flags & ONLOAD_MSG_WARM ))
           unroll_msg_warm(ni, ts, &sinf, 0);
         }
@@ -2212,6 +2382,10 @@ int ci_tcp_sendmsg(ci_netif* ni, ci_tcp_state* ts,
     RET_WITH_ERRNO(EPIPE);
   }
 
+  if( ts->tcpflags & CI_TCPT_FLAG_FASTOPEN_DEFER )
+    return ci_tcp_sendmsg_fastopen(ni, ts, iov, iovlen, flags, &sinf
+                                   CI_KERNEL_ARG(addr_spc));
+
   if( ci_tcp_sendmsg_notsynchronised(ni, ts, flags, &sinf) == -1 ) {
     ci_tcp_sendmsg_handle_rc_or_tx_errno(ni, ts, flags, &sinf);
     if( sinf.set_errno ) CI_SET_ERROR(sinf.rc, sinf.rc);
@@ -2396,7 +2570,7 @@ int ci_tcp_zc_send(ci_netif* ni, ci_tcp_state* ts, struct onload_zc_mmsg* msg,
       TX_PKT_IPX_TCP(af, pkt)->tcp_flags = CI_TCP_FLAG_ACK;
     else
       TX_PKT_IPX_TCP(af, pkt)->tcp_flags = CI_TCP_FLAG_PSH|CI_TCP_FLAG_ACK;
-    ci_tcp_tx_advance_nagle(ni, ts);
+    ci_tcp_tx_advance_nagle(ni, ts, 0);
     if(CI_UNLIKELY( flags & ONLOAD_MSG_WARM )) {
       unroll_msg_warm(ni, ts, &sinf, 1);
     }
@@ -2613,6 +2787,16 @@ ci_tcp_ds_fill_headers(ci_netif* ni, ci_tcp_state* ts, unsigned flags,
   tcp->tcp_seq_be32 = CI_BSWAP_BE32(tcp_snd_nxt(ts));
   tcp->tcp_flags = CI_TCP_FLAG_ACK;
   tcp->tcp_ack_be32 = CI_BSWAP_BE32(tcp_rcv_nxt(ts));
+  if( ts->tcpflags & CI_TCPT_FLAG_ECN ) {
+    /* Delegated data is always new data, so is sent ECN-capable. */
+    tcp->tcp_flags |= ci_tcp_tx_ecn_ack_flags(ts);
+    if( ts->tcpflags & CI_TCPT_FLAG_ECN_CWR ) {
+      tcp->tcp_flags |= CI_TCP_FLAG_CWR;
+      ts->tcpflags &=~ CI_TCPT_FLAG_ECN_CWR;
+      CITP_STATS_NETIF_INC(ni, tcp_ecn_cwr_tx);
+    }
+    ipx_hdr_set_ecn(AF_INET, (ci_ipx_hdr_t*) ip, CI_IP_ECN_ECT0);
+  }
   ci_tcp_calc_rcv_wnd(ts, "ds_fill_headers");
   tcp->tcp_window_be16 = TS_IPX_TCP(ts)->tcp_window_be16;
   if( ts->tcpflags & CI_TCPT_FLAG_TSO ) {
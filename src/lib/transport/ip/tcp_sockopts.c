@@ -46,6 +46,15 @@ static const unsigned char sock_congstate_linux_map[] = {
 #define CI_MAX_TCP_KEEPIDLE 32767
 #define CI_MAX_TCP_KEEPINTVL 32767
 #define CI_MAX_TCP_KEEPCNT 127
+#define CI_TCP_CA_NAME_MAX 16
+
+/* TCP Fast Open, absent from older libc headers */
+#ifndef TCP_FASTOPEN
+# define TCP_FASTOPEN 23
+#endif
+#ifndef TCP_FASTOPEN_CONNECT
+# define TCP_FASTOPEN_CONNECT 30
+#endif
 
 static int
 ci_tcp_info_get(ci_netif* netif, ci_sock_cmn* s, struct ci_tcp_info* uinfo,
@@ -137,11 +146,12 @@ ci_tcp_info_get(ci_netif* netif, ci_sock_cmn* s, struct ci_tcp_info* uinfo,
     }
     info.tcpi_total_retrans = ts->stats.total_retrans;
 
-    /* Starting from linux-3.15, there are tcpi_pacing_rate and
-     * tcpi_max_pacing_rate fields.  However, as Onload does not support
-     * pacing, we might as well pretend that we simulate older kernel
-     * with smaller tcp_info size. */
+    /* As Linux, report the rate the socket would be paced at whether or
+     * not it is actually paced. */
+    info.tcpi_pacing_rate = (ci_uint64) ci_tcp_pacing_rate(netif, ts) *
+                            ci_ip_time_ms2ticks(netif, 1000);
   }
+  info.tcpi_max_pacing_rate = SOCK_TO_WAITABLE_OBJ(s)->tcp.c.max_pacing_rate;
 
   if( *optlen > sizeof(info) )
     *optlen = sizeof(info);
@@ -224,6 +234,21 @@ int ci_get_sol_tcp(ci_netif* netif, ci_sock_cmn* s, int optname, void *optval,
         u = ci_tcp_is_in_faststart(SOCK_TO_TCP(s));
       goto u_out;
     }
+  case TCP_FASTOPEN:
+    u = c->fastopen_qlen;
+    goto u_out;
+  case TCP_FASTOPEN_CONNECT:
+    u = ((s->s_aflags & CI_SOCK_AFLAG_FASTOPEN_CONNECT) != 0);
+    goto u_out;
+  case TCP_CONGESTION:
+    {
+      /* As Linux, return as much of the zero-padded name as fits. */
+      char name[CI_TCP_CA_NAME_MAX] = "";
+      strncpy(name, ci_tcp_cong_algo_name(c->cong_algo), sizeof(name) - 1);
+      *optlen = CI_MIN(*optlen, sizeof(name));
+      memcpy(optval, name, *optlen);
+      return 0;
+    }
   default:
 #ifndef __KERNEL__
     LOG_TC( log(LPF "getsockopt: unimplemented or bad option: %i", 
@@ -270,6 +295,21 @@ int ci_tcp_getsockopt(citp_socket* ep, ci_fd_t fd, int level,
       ci_tcp_state* ts = SOCK_TO_TCP(s);
       ci_tcp_set_sndbuf_from_sndbuf_pkts(netif, ts);
     }
+#ifdef SO_MAX_PACING_RATE
+    if( optname == SO_MAX_PACING_RATE ) {
+      ci_uint64 rate = SOCK_TO_WAITABLE_OBJ(s)->tcp.c.max_pacing_rate;
+      ci_uint32 rate32 = CI_MIN(rate, (ci_uint64) 0xffffffff);
+      /* As Linux, a 64-bit value if there is room for it. */
+      if( *optlen >= sizeof(rate) )
+        return ci_getsockopt_final(optval, optlen, level, &rate, sizeof(rate));
+      return ci_getsockopt_final(optval, optlen, level,
+                                 &rate32, sizeof(rate32));
+    }
+#endif
+    if( optname == SO_ZEROCOPY ) {
+      int val = !!(s->s_aflags & CI_SOCK_AFLAG_ZEROCOPY);
+      return ci_getsockopt_final(optval, optlen, level, &val, sizeof(val));
+    }
 
     /* Common SOL_SOCKET handler */
     return ci_get_sol_socket(netif, s, optname, optval, optlen);
@@ -297,6 +337,33 @@ int ci_tcp_getsockopt(citp_socket* ep, ci_fd_t fd, int level,
 }
 
 
+static int ci_tcp_set_congestion(ci_netif* netif, ci_sock_cmn* s,
+                                 const void* optval, socklen_t optlen)
+{
+  ci_tcp_socket_cmn* c = &(SOCK_TO_WAITABLE_OBJ(s)->tcp.c);
+  char name[CI_TCP_CA_NAME_MAX];
+  int algo;
+
+  if( optlen < 1 )
+    RET_WITH_ERRNO(EINVAL);
+  optlen = CI_MIN(optlen, sizeof(name) - 1);
+  memcpy(name, optval, optlen);
+  name[optlen] = '\0';
+
+  algo = ci_tcp_cong_algo_from_name(name);
+  if( algo < 0 ) {
+    LOG_TC(log("%s: "NSS_FMT" unknown congestion control '%s'",
+               __FUNCTION__, NSS_PRI_ARGS(netif, s), name));
+    RET_WITH_ERRNO(-algo);
+  }
+
+  c->cong_algo = algo;
+  if( s->b.state & CI_TCP_STATE_TCP_CONN )
+    ci_tcp_cong_init(netif, SOCK_TO_TCP(s));
+  return 0;
+}
+
+
 static int ci_tcp_setsockopt_lk(citp_socket* ep, ci_fd_t fd, int level,
 				int optname, const void* optval,
 				socklen_t optlen )
@@ -346,6 +413,41 @@ static int ci_tcp_setsockopt_lk(citp_socket* ep, ci_fd_t fd, int level,
       }
       break;
 
+#ifdef SO_MAX_PACING_RATE
+    case SO_MAX_PACING_RATE:
+      /* Rate in bytes per second, either 32 or 64 bits wide.  Setting it
+       * enables pacing. */
+      if( (rc = opt_not_ok(optval, optlen, ci_uint32)) )
+        goto fail_inval;
+      if( optlen >= sizeof(ci_uint64) )
+        c->max_pacing_rate = *(ci_uint64*) optval;
+      else if( *(ci_uint32*) optval == ~0u )
+        c->max_pacing_rate = CI_TCP_PACING_RATE_UNLIMITED;
+      else
+        c->max_pacing_rate = *(ci_uint32*) optval;
+      break;
+#endif
+
+    case SO_ZEROCOPY:
+      /* Allows MSG_ZEROCOPY sends, with completions on the error queue.
+       * The data is still copied; see ci_tcp_sendmsg_zerocopy(). */
+      if( (rc = opt_not_ok(optval, optlen, int)) )
+        goto fail_inval;
+      if( *(int*) optval < 0 || *(int*) optval > 1 ) {
+        rc = -EINVAL;
+        goto fail_inval;
+      }
+      if( *(int*) optval ) {
+        NI_LOG_ONCE(netif, CONFIG_WARNINGS,
+                    "SO_ZEROCOPY: Onload copies the data of MSG_ZEROCOPY "
+                    "sends; completions are flagged "
+                    "SO_EE_CODE_ZEROCOPY_COPIED.");
+        ci_bit_set(&s->s_aflags, CI_SOCK_AFLAG_ZEROCOPY_BIT);
+      }
+      else
+        ci_bit_clear(&s->s_aflags, CI_SOCK_AFLAG_ZEROCOPY_BIT);
+      break;
+
     default:
       {
         /* Common socket level options */
@@ -362,6 +464,10 @@ static int ci_tcp_setsockopt_lk(citp_socket* ep, ci_fd_t fd, int level,
     return ci_set_sol_ip6(netif, s, optname, optval, optlen);
   }
   else if( level == IPPROTO_TCP ) {
+    /* This one is a string */
+    if( optname == TCP_CONGESTION )
+      return ci_tcp_set_congestion(netif, s, optval, optlen);
+
     /* These are ints values */
     if( (rc = opt_not_ok(optval, optlen, int)) )
       goto fail_inval;
@@ -476,6 +582,26 @@ static int ci_tcp_setsockopt_lk(citp_socket* ep, ci_fd_t fd, int level,
         }
       }
       break;
+    case TCP_FASTOPEN:
+      /* Length of the queue of connections accepted by TCP Fast Open
+       * before completing the handshake; zero disables the server side. */
+      if( *(int*) optval < 0 ||
+          (s->b.state != CI_TCP_CLOSED && s->b.state != CI_TCP_LISTEN) ) {
+        rc = -EINVAL;
+        goto fail_inval;
+      }
+      c->fastopen_qlen = *(int*) optval;
+      break;
+    case TCP_FASTOPEN_CONNECT:
+      if( s->b.state != CI_TCP_CLOSED ) {
+        rc = -EINVAL;
+        goto fail_inval;
+      }
+      if( *(int*) optval )
+        ci_bit_set(&s->s_aflags, CI_SOCK_AFLAG_FASTOPEN_CONNECT_BIT);
+      else
+        ci_bit_clear(&s->s_aflags, CI_SOCK_AFLAG_FASTOPEN_CONNECT_BIT);
+      break;
     default:
       LOG_TC(log("%s: "NSS_FMT" option %i unimplemented (ENOPROTOOPT)", 
              __FUNCTION__, NSS_PRI_ARGS(netif,s), optname));
@@ -696,6 +822,8 @@ static int ci_tcp_sync_so_sockopts(ci_netif* ni, ci_tcp_state* ts,
     ci_tcp_sock_setsockopt(sock, &err, SO_TIMESTAMPNS, &optval, sizeof(optval));
   if( ts->s.s_flags & CI_SOCK_FLAG_REUSEPORT )
     ci_tcp_sock_setsockopt(sock, &err, SO_REUSEPORT, &optval, sizeof(optval));
+  if( ts->s.s_aflags & CI_SOCK_AFLAG_ZEROCOPY )
+    ci_tcp_sock_setsockopt(sock, &err, SO_ZEROCOPY, &optval, sizeof(optval));
 
   return err;
 }
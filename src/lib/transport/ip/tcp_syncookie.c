@@ -58,8 +58,8 @@ sip_round(struct siphash* h, int rounds)
   }
 }
 
-static ci_uint64
-sip_hash(ci_uint64* key, const void* data, int len)
+ci_uint64
+ci_sip_hash(ci_uint64* key, const void* data, int len)
 {
   struct siphash h;
   const unsigned char *p = data, *pe = p + len;
@@ -116,34 +116,180 @@ sip_hash(ci_uint64* key, const void* data, int len)
   return h.v0 ^ h.v1 ^ h.v2  ^ h.v3;
 }
 
+#define SIP_ROUND_LANES(v0, v1, v2, v3, rounds)          \
+  do {                                                  \
+    int _r, _l;                                         \
+    for( _r = 0; _r < (rounds); _r++ )                  \
+      for( _l = 0; _l < CI_SIP_LANES; _l++ ) {          \
+        v0[_l] += v1[_l];                               \
+        v1[_l] = SIP_ROTL(v1[_l], 13);                  \
+        v1[_l] ^= v0[_l];                               \
+        v0[_l] = SIP_ROTL(v0[_l], 32);                  \
+        v2[_l] += v3[_l];                               \
+        v3[_l] = SIP_ROTL(v3[_l], 16);                  \
+        v3[_l] ^= v2[_l];                               \
+        v0[_l] += v3[_l];                               \
+        v3[_l] = SIP_ROTL(v3[_l], 21);                  \
+        v3[_l] ^= v0[_l];                               \
+        v2[_l] += v1[_l];                               \
+        v1[_l] = SIP_ROTL(v1[_l], 17);                  \
+        v1[_l] ^= v2[_l];                               \
+        v2[_l] = SIP_ROTL(v2[_l], 32);                  \
+      }                                                 \
+  } while( 0 )
+
+/* Siphash-2-4 of [CI_SIP_LANES] messages of [CI_SIP_LANES_LEN] bytes,
+ * giving the same results as ci_sip_hash().  The lanes are independent, so
+ * that the compiler can keep each of v0..v3 for all lanes in one vector
+ * register.
+ */
+void
+ci_sip_hash_lanes(ci_uint64* key, ci_uint8 (*data)[CI_SIP_LANES_LEN],
+                  ci_uint64* out)
+{
+  ci_uint64 v0[CI_SIP_LANES], v1[CI_SIP_LANES];
+  ci_uint64 v2[CI_SIP_LANES], v3[CI_SIP_LANES];
+  ci_uint64 m[CI_SIP_LANES], b[CI_SIP_LANES];
+  int i, l;
+
+  for( l = 0; l < CI_SIP_LANES; l++ ) {
+    v0[l] = 0x736f6d6570736575ULL ^ key[0];
+    v1[l] = 0x646f72616e646f6dULL ^ key[1];
+    v2[l] = 0x6c7967656e657261ULL ^ key[0];
+    v3[l] = 0x7465646279746573ULL ^ key[1];
+    /* One whole 8-byte word, then the tail and length */
+    memcpy(&m[l], data[l], sizeof(m[l]));
+    m[l] = CI_BSWAP_LE64(m[l]);
+    b[l] = (ci_uint64) CI_SIP_LANES_LEN << 56;
+    for( i = 8; i < CI_SIP_LANES_LEN; i++ )
+      b[l] |= (ci_uint64) data[l][i] << ((i - 8) * 8);
+  }
+
+  for( l = 0; l < CI_SIP_LANES; l++ )
+    v3[l] ^= m[l];
+  SIP_ROUND_LANES(v0, v1, v2, v3, 2);
+  for( l = 0; l < CI_SIP_LANES; l++ ) {
+    v0[l] ^= m[l];
+    v3[l] ^= b[l];
+  }
+  SIP_ROUND_LANES(v0, v1, v2, v3, 2);
+  for( l = 0; l < CI_SIP_LANES; l++ ) {
+    v0[l] ^= b[l];
+    v2[l] ^= 0xff;
+  }
+  SIP_ROUND_LANES(v0, v1, v2, v3, 4);
+
+  for( l = 0; l < CI_SIP_LANES; l++ )
+    out[l] = v0[l] ^ v1[l] ^ v2[l] ^ v3[l];
+}
+
+static void
+ci_tcp_syncookie_hash_data(ci_uint8* hash_data, ci_uint16 l_port,
+                           ci_uint16 r_port, ci_uint32 l_addr,
+                           ci_uint32 r_addr, int t, int m)
+{
+  hash_data[0] = l_port & 0xff;
+  hash_data[1] = l_port >> 8;
+  hash_data[2] = r_port & 0xff;
+  hash_data[3] = r_port >> 8;
+  hash_data[4] = l_addr & 0xff;
+  hash_data[5] = (l_addr & 0xff00) >> 8;
+  hash_data[6] = (l_addr & 0xff0000) >> 16;
+  hash_data[7] = (l_addr & 0xff000000) >> 24;
+  hash_data[8] = r_addr & 0xff;
+  hash_data[9] = (r_addr & 0xff00) >> 8;
+  hash_data[10] = (r_addr & 0xff0000) >> 16;
+  hash_data[11] = (r_addr & 0xff000000) >> 24;
+  hash_data[12] = t << 3 | m;
+}
+
 static ci_uint32
 ci_tcp_syncookie_hash(ci_netif* netif, ci_tcp_socket_listen* tls,
                       ci_tcp_state_synrecv* tsr, int t, int m)
 {
-  ci_uint8 hash_data[13];
-
-  hash_data[0] = tsr->l_port & 0xff;
-  hash_data[1] = tsr->l_port >> 8;
-  hash_data[2] = tsr->r_port & 0xff;
-  hash_data[3] = tsr->r_port >> 8;
-  hash_data[4] = tsr->l_addr.ip4 & 0xff;
-  hash_data[5] = (tsr->l_addr.ip4 & 0xff00) >> 8;
-  hash_data[6] = (tsr->l_addr.ip4 & 0xff0000) >> 16;
-  hash_data[7] = (tsr->l_addr.ip4 & 0xff000000) >> 24;
-  hash_data[8] = tsr->r_addr.ip4 & 0xff;
-  hash_data[9] = (tsr->r_addr.ip4 & 0xff00) >> 8;
-  hash_data[10] = (tsr->r_addr.ip4 & 0xff0000) >> 16;
-  hash_data[11] = (tsr->r_addr.ip4 & 0xff000000) >> 24;
-  hash_data[12] = t << 3 | m;
+  ci_uint8 hash_data[CI_SIP_LANES_LEN];
+
+  ci_tcp_syncookie_hash_data(hash_data, tsr->l_port, tsr->r_port,
+                             tsr->l_addr.ip4, tsr->r_addr.ip4, t, m);
 
   ci_assert_equal(sizeof(netif->state->hash_salt),
                   2 * sizeof(ci_uint64));
-  return (ci_uint32)sip_hash((void *)netif->state->hash_salt,
+  return (ci_uint32)ci_sip_hash((void *)netif->state->hash_salt,
                              hash_data, sizeof(hash_data));
 }
 
 /* End of siphash implementation */
 
+
+/* TCP Fast Open cookies (RFC7413 section 4.1.2).  The server-side cookie
+ * is a MAC of the client and server addresses, keyed with the stack's
+ * hash_salt just like syncookies.  It is not rotated: the salt lives as
+ * long as the stack does. */
+void
+ci_tcp_fastopen_cookie(ci_netif* netif, ci_addr_t laddr, ci_addr_t raddr,
+                       ci_uint8* cookie)
+{
+  ci_uint8 hash_data[2 * sizeof(ci_addr_t)];
+  ci_uint64 mac;
+  CI_BUILD_ASSERT(sizeof(mac) == CI_TCP_FASTOPEN_COOKIE_LEN);
+
+  memcpy(hash_data, &raddr, sizeof(raddr));
+  memcpy(hash_data + sizeof(raddr), &laddr, sizeof(laddr));
+  mac = ci_sip_hash((void *)netif->state->hash_salt,
+                 hash_data, sizeof(hash_data));
+  memcpy(cookie, &mac, sizeof(mac));
+}
+
+int /*bool*/
+ci_tcp_fastopen_cookie_check(ci_netif* netif, ci_addr_t laddr,
+                             ci_addr_t raddr, ciip_tcp_rx_pkt* rxp)
+{
+  ci_uint8 cookie[CI_TCP_FASTOPEN_COOKIE_LEN];
+
+  if( rxp->fastopen_len != CI_TCP_FASTOPEN_COOKIE_LEN )
+    return 0;
+  ci_tcp_fastopen_cookie(netif, laddr, raddr, cookie);
+  return memcmp(cookie, rxp->fastopen_cookie, sizeof(cookie)) == 0;
+}
+
+
+/* Client-side cookie cache.  Direct mapped, so a colliding peer simply
+ * evicts the previous entry; the cost of a miss is one extra round trip. */
+static unsigned ci_tcp_fastopen_cache_idx(ci_addr_t raddr)
+{
+  const ci_uint8* p = (const ci_uint8*) &raddr;
+  unsigned i, h = 0;
+
+  for( i = 0; i < sizeof(raddr); i++ )
+    h = h * 31 + p[i];
+  return (h ^ (h >> 8)) % CI_TCP_FASTOPEN_CACHE_SIZE;
+}
+
+int
+ci_tcp_fastopen_cache_get(ci_netif* netif, ci_addr_t raddr, ci_uint8* cookie)
+{
+  unsigned i = ci_tcp_fastopen_cache_idx(raddr);
+  int len = netif->state->tcp_fastopen_cache[i].len;
+
+  if( len == 0 ||
+      ! CI_IPX_ADDR_EQ(netif->state->tcp_fastopen_cache[i].addr, raddr) )
+    return 0;
+  memcpy(cookie, netif->state->tcp_fastopen_cache[i].cookie, len);
+  return len;
+}
+
+void
+ci_tcp_fastopen_cache_set(ci_netif* netif, ci_addr_t raddr,
+                          const ci_uint8* cookie, int len)
+{
+  unsigned i = ci_tcp_fastopen_cache_idx(raddr);
+
+  ci_assert_le(len, CI_TCP_FASTOPEN_COOKIE_MAX);
+  netif->state->tcp_fastopen_cache[i].addr = raddr;
+  memcpy(netif->state->tcp_fastopen_cache[i].cookie, cookie, len);
+  netif->state->tcp_fastopen_cache[i].len = len;
+}
+
  
 
 static ci_int16 ci_tcp_syncookie_get_t(ci_netif* netif)
@@ -197,6 +343,75 @@ ci_tcp_syncookie_syn(ci_netif* netif, ci_tcp_socket_listen* tls,
   CITP_STATS_TCP_LISTEN(++tls->stats.n_syncookie_syn);
 }
 
+/* Hash the would-be syncookies of the pure ACKs among [pkts], [CI_SIP_LANES]
+ * at a time.  [pkts] are the IPv4 TCP packets of a burst about to be
+ * delivered that are the only packet of their flow in it.  Every pure ACK
+ * whose acked sequence number carries a current cookie time is hashed,
+ * whether or not it completes a handshake.  The results are left in [ps]
+ * for ci_tcp_syncookie_ack() to pick up.  Many of these ACKs will belong
+ * to established connections, so this is only worth doing while the stack
+ * is answering a flood of SYNs with syncookies.
+ */
+void
+ci_tcp_syncookie_ack_batch(ci_netif* netif, struct ci_netif_poll_state* ps,
+                           ci_ip_pkt_fmt** pkts, int n_pkts)
+{
+  /* Room for the unused lanes of the last group to hash zeros */
+  ci_uint8 hash_data[CI_NETIF_RX_BATCH_MAX + CI_SIP_LANES - 1]
+                    [CI_SIP_LANES_LEN];
+  ci_uint64 hash[CI_SIP_LANES];
+  int i, l, n = 0, t_now = ci_tcp_syncookie_get_t(netif);
+
+  ci_assert_le(n_pkts, CI_NETIF_RX_BATCH_MAX);
+
+  for( i = 0; i < n_pkts; ++i ) {
+    ci_ip4_hdr* ip4 = oo_ip_hdr(pkts[i]);
+    ci_tcp_hdr* tcp = (ci_tcp_hdr*) ((char*) ip4 + CI_IP4_IHL(ip4));
+    ci_uint32 isn = CI_BSWAP_BE32(tcp->tcp_ack_be32) - 1;
+    int t = (isn >> 3) & 0x1f;
+
+    if( (tcp->tcp_flags & (CI_TCP_FLAG_SYN | CI_TCP_FLAG_RST |
+                           CI_TCP_FLAG_ACK)) != CI_TCP_FLAG_ACK ||
+        (t != t_now && t != ((t_now - 1) & 0x1f)) )
+      continue;
+    ci_tcp_syncookie_hash_data(hash_data[n],
+                               tcp->tcp_dest_be16, tcp->tcp_source_be16,
+                               ip4->ip_daddr_be32, ip4->ip_saddr_be32,
+                               t, isn & 7);
+    ps->syncookie_pkt[n++] = OO_PKT_P(pkts[i]);
+  }
+  memset(hash_data[n], 0, (CI_SIP_LANES - 1) * CI_SIP_LANES_LEN);
+
+  for( i = 0; i < n; i += CI_SIP_LANES ) {
+    ci_sip_hash_lanes((void *)netif->state->hash_salt, &hash_data[i], hash);
+    for( l = 0; l < CI_SIP_LANES && i + l < n; ++l )
+      ps->syncookie_hash[i + l] = (ci_uint32) hash[l];
+  }
+  ps->syncookie_n = n;
+  CITP_STATS_NETIF_ADD(netif, syncookie_ack_batched, n);
+}
+
+
+/* Find the hash of the cookie acked by [rxp] if it was computed by
+ * ci_tcp_syncookie_ack_batch().
+ */
+static int
+ci_tcp_syncookie_batched_hash(ciip_tcp_rx_pkt* rxp, ci_uint32* hash)
+{
+  struct ci_netif_poll_state* ps = rxp->poll_state;
+  oo_pkt_p pp = OO_PKT_P(rxp->pkt);
+  int i;
+
+  if( ps == NULL )
+    return 0;
+  for( i = 0; i < ps->syncookie_n; ++i )
+    if( OO_PP_EQ(ps->syncookie_pkt[i], pp) ) {
+      *hash = ps->syncookie_hash[i];
+      return 1;
+    }
+  return 0;
+}
+
 void
 ci_tcp_syncookie_ack(ci_netif* netif, ci_tcp_socket_listen* tls,
                      ciip_tcp_rx_pkt* rxp,
@@ -205,6 +420,7 @@ ci_tcp_syncookie_ack(ci_netif* netif, ci_tcp_socket_listen* tls,
   int t, m, t_now;
   ci_tcp_state_synrecv* tsr;
   ci_uint32 isn = rxp->ack - 1;
+  ci_uint32 hash;
 
   CITP_STATS_TCP_LISTEN(++tls->stats.n_syncookie_ack_recv);
   *tsr_p = NULL;
@@ -233,8 +449,9 @@ ci_tcp_syncookie_ack(ci_netif* netif, ci_tcp_socket_listen* tls,
   tsr->snd_isn = isn;
   tsr->rcv_nxt = rxp->seq;
 
-  if( (isn >> 8) !=
-      (ci_tcp_syncookie_hash(netif, tls, tsr, t, m) & 0xffffff) ) {
+  if( ! ci_tcp_syncookie_batched_hash(rxp, &hash) )
+    hash = ci_tcp_syncookie_hash(netif, tls, tsr, t, m);
+  if( (isn >> 8) != (hash & 0xffffff) ) {
     CITP_STATS_TCP_LISTEN(++tls->stats.n_syncookie_ack_hash_rej);
     ci_free(tsr);
     return;
@@ -648,6 +648,10 @@ static void ci_tcp_inherit_options(ci_netif* ni, ci_sock_cmn* s,
   ts->c.t_ka_intvl         = c->t_ka_intvl;
   ts->c.t_ka_intvl_in_secs = c->t_ka_intvl_in_secs;
   ts->c.ka_probe_th        = c->ka_probe_th;
+  /* TCP_CONGESTION */
+  ts->c.cong_algo          = c->cong_algo;
+  /* SO_MAX_PACING_RATE */
+  ts->c.max_pacing_rate    = c->max_pacing_rate;
   {
     int af = ipcache_af(&ts->s.pkt);
     ci_ipx_hdr_init_fixed(&ts->s.pkt.ipx, af, IPPROTO_TCP,
@@ -911,7 +915,7 @@ int ci_tcp_listenq_try_promote(ci_netif* netif, ci_tcp_socket_listen* tls,
 
     /* options and flags */
     ts->tcpflags = 0;
-    ts->tcpflags |= tsr->tcpopts.flags;
+    ts->tcpflags |= tsr->tcpopts.flags & ~CI_TCPT_FLAG_FASTOPEN;
     ts->tcpflags |= CI_TCPT_FLAG_PASSIVE_OPENED;
     ts->outgoing_hdrs_len = CI_IPX_HDR_SIZE(ipcache_af(&ts->s.pkt)) +
                             sizeof(ci_tcp_hdr);
@@ -945,7 +949,8 @@ int ci_tcp_listenq_try_promote(ci_netif* netif, ci_tcp_socket_listen* tls,
     ts->timed_ts = tsr->timest;
     /* SACK has nothing to be done. */
 
-    /* ?? ECN */
+    if( ts->tcpflags & CI_TCPT_FLAG_ECN )
+      CITP_STATS_NETIF_INC(netif, tcp_ecn_passive);
     ci_tcp_set_hdr_len(ts,
                        ts->outgoing_hdrs_len -
                        CI_IPX_HDR_SIZE(ipcache_af(&ts->s.pkt)));
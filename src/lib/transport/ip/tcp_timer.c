@@ -25,6 +25,8 @@
 */
 void ci_tcp_timer_init(ci_netif* netif)
 {
+  int i;
+
   NI_CONF(netif).tconst_rto_initial = 
     ci_tcp_time_ms2ticks(netif, NI_OPTS(netif).rto_initial);
   /* When converting to ticks we will end up with a rounded down value.  This
@@ -74,6 +76,9 @@ void ci_tcp_timer_init(ci_netif* netif)
   else
     NI_CONF(netif).tconst_invalid_ack_ratelimit =
       ci_tcp_time_ms2ticks(netif, NI_OPTS(netif).oow_ack_ratelimit) + 1;
+  for( i = 0; i < CI_TCP_TIMEWAIT_ACK_BUCKETS; ++i )
+    netif->state->timewait_t_last_invalid_ack[i] =
+      ci_tcp_time_now(netif) - NI_CONF(netif).tconst_invalid_ack_ratelimit;
 
   NI_CONF(netif).tconst_defer_arp =
     ci_tcp_time_ms2ticks(netif, NI_OPTS(netif).defer_arp_timeout * 1000);
@@ -444,6 +449,14 @@ void ci_tcp_timeout_cork(ci_netif* netif, ci_tcp_state* ts)
   ci_tcp_send_corked_packets(netif, ts);
 }
 
+/* Called when pacing allows more of the send queue to go */
+void ci_tcp_timeout_pace(ci_netif* netif, ci_tcp_state* ts)
+{
+  CITP_STATS_NETIF_INC(netif, tcp_pace_timeouts);
+  if( ci_ip_queue_not_empty(&ts->send) )
+    ci_tcp_tx_advance(ts, netif);
+}
+
 
 /* Called as action on a retransmission timer timeout (RTO) */
 void ci_tcp_timeout_rto(ci_netif* netif, ci_tcp_state* ts)
@@ -564,7 +577,7 @@ void ci_tcp_timeout_rto(ci_netif* netif, ci_tcp_state* ts)
       ts->ssthresh = CI_MAX(x, y);
     }
     else
-      ts->ssthresh = ci_tcp_losswnd(ts);
+      ts->ssthresh = ci_tcp_cong_ssthresh(netif, ts);
 
     ts->congstate = CI_TCP_CONG_RTO;
     ts->cwnd_extra = 0;
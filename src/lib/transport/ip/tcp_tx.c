@@ -47,7 +47,7 @@ ci_inline void ci_ip_tcp_list_to_dmaq(ci_netif* ni, ci_tcp_state* ts,
   oo_pktq* dmaq;
   oo_pkt_p pp;
   ef_vi* vi;
-  int n;
+  int n, intf_i = ts->s.pkt.intf_i;
 #if CI_CFG_PIO
   int rc;
   ci_uint8 order;
@@ -55,6 +55,9 @@ ci_inline void ci_ip_tcp_list_to_dmaq(ci_netif* ni, ci_tcp_state* ts,
   ci_pio_buddy_allocator* buddy;
 #endif
 
+  /* The TX counters are updated as packets are queued, so the TX lock
+   * covers this whole function up to the final shove. */
+  ci_netif_tx_lock(ni, intf_i);
   pp = head_id;
   n = 0;
   do {
@@ -87,6 +90,7 @@ ci_inline void ci_ip_tcp_list_to_dmaq(ci_netif* ni, ci_tcp_state* ts,
           __ci_netif_dmaq_insert_prep_pkt_warm_undo(ni, tail_pkt);
           ci_pio_buddy_free(ni, &ni->state->nic[tail_pkt->intf_i].pio_buddy,
                             offset, order);
+          ci_netif_tx_unlock(ni, intf_i);
           return;
         }
         rc = ef_vi_transmit_copy_pio(vi, offset, PKT_START(tail_pkt),
@@ -96,6 +100,7 @@ ci_inline void ci_ip_tcp_list_to_dmaq(ci_netif* ni, ci_tcp_state* ts,
           ci_assert(tail_pkt->pio_addr == -1);
           tail_pkt->pio_addr = offset;
           tail_pkt->pio_order = order;
+          ci_netif_tx_unlock(ni, intf_i);
           return;
         }
         else {
@@ -117,10 +122,12 @@ ci_inline void ci_ip_tcp_list_to_dmaq(ci_netif* ni, ci_tcp_state* ts,
   if(CI_LIKELY( ! (ts->tcpflags & CI_TCPT_FLAG_MSG_WARM) )) {
     int is_fresh = oo_pktq_is_empty(dmaq);
     __oo_pktq_put_list(ni, dmaq, head_id, tail_pkt, n, netif.tx.dmaq_next);
+    ci_netif_tx_unlock(ni, intf_i);
     ci_netif_dmaq_shove2(ni, tail_pkt->intf_i, is_fresh);
   }
   else {
     __ci_netif_dmaq_insert_prep_pkt_warm_undo(ni, tail_pkt);
+    ci_netif_tx_unlock(ni, intf_i);
   }
 }
 
@@ -584,8 +591,14 @@ void ci_tcp_tx_change_mss(ci_netif* ni, ci_tcp_state* ts, bool may_send)
 }
 
 
+/* [used] is the option space already taken by the caller.  A TCP Fast
+ * Open option is added if [tfo_len] is not negative and there is room:
+ * a cookie request when [tfo_len] is zero, otherwise [tfo_cookie].
+ */
 static int ci_tcp_tx_insert_syn_options(ci_netif* ni, ci_uint16 amss,
                                         unsigned optflags, unsigned rcv_wscl,
+                                        const ci_uint8* tfo_cookie,
+                                        int tfo_len, int used,
                                         ci_uint8** opt)
 {
   int optlen = 0;
@@ -610,6 +623,16 @@ static int ci_tcp_tx_insert_syn_options(ci_netif* ni, ci_uint16 amss,
   }
 #endif
 
+  /* TCP Fast Open (RFC7413). */
+  if( tfo_len >= 0 &&
+      CI_ALIGN_FWD(used + optlen + 2 + tfo_len, 4) <= CI_TCP_MAX_OPTS_LEN ) {
+    (*opt)[0] = CI_TCP_OPT_FASTOPEN;
+    (*opt)[1] = 2 + tfo_len;
+    memcpy(*opt + 2, tfo_cookie, tfo_len);
+    *opt += 2 + tfo_len;
+    optlen += 2 + tfo_len;
+  }
+
   /* Pad to dword boundary. */
   while( optlen & 3 ) {
     *(*opt)++ = CI_TCP_OPT_END;
@@ -620,12 +643,30 @@ static int ci_tcp_tx_insert_syn_options(ci_netif* ni, ci_uint16 amss,
 }
 
 
-/*
-** called to enqueue a packet with no data (i.e. SYN/FIN) the segment
-** is placed on the TX queue and so is reliably transmitted
-*/
-void ci_tcp_enqueue_no_data(ci_tcp_state* ts, ci_netif* netif,
-                            ci_ip_pkt_fmt* pkt)
+/* Get the TCP Fast Open option for a SYN or SYN-ACK from [ts]: our own
+ * cookie for a passive open, or the one cached for the peer on an active
+ * open.  Returns the cookie length (zero for a cookie request), or -1 if
+ * the option should not be sent.
+ */
+static int ci_tcp_tx_fastopen_cookie(ci_netif* netif, ci_tcp_state* ts,
+                                     ci_uint8* cookie)
+{
+  if( ~ts->tcpflags & CI_TCPT_FLAG_FASTOPEN )
+    return -1;
+  if( ts->tcpflags & CI_TCPT_FLAG_PASSIVE_OPENED ) {
+    ci_tcp_fastopen_cookie(netif, tcp_ipx_laddr(ts), tcp_ipx_raddr(ts),
+                           cookie);
+    return CI_TCP_FASTOPEN_COOKIE_LEN;
+  }
+  return ci_tcp_fastopen_cache_get(netif, tcp_ipx_raddr(ts), cookie);
+}
+
+
+/* Lay out the headers of a SYN or FIN for [ts] in [pkt], leaving the
+ * payload empty.
+ */
+static void ci_tcp_tx_prep_no_data(ci_tcp_state* ts, ci_netif* netif,
+                                   ci_ip_pkt_fmt* pkt)
 {
   ci_tcp_hdr* thdr;
   int af = ipcache_af(&ts->s.pkt);
@@ -646,9 +687,12 @@ void ci_tcp_enqueue_no_data(ci_tcp_state* ts, ci_netif* netif,
   thdr = PKT_IPX_TCP_HDR(af, pkt);
   if( TS_IPX_TCP(ts)->tcp_flags & CI_TCP_FLAG_SYN ) {
     ci_uint8* opt = CI_TCP_HDR_OPTS(thdr);
+    ci_uint8 cookie[CI_TCP_FASTOPEN_COOKIE_MAX];
+    int tfo_len = ci_tcp_tx_fastopen_cookie(netif, ts, cookie);
     opt += optlen;
     optlen += ci_tcp_tx_insert_syn_options(netif, ts->amss,
-                                           ts->tcpflags, ts->rcv_wscl, &opt);
+                                           ts->tcpflags, ts->rcv_wscl,
+                                           cookie, tfo_len, optlen, &opt);
 
     /* If we don't get timestamps, we'll need to calculate RTT without
      * them.  Let's prepare: */
@@ -663,9 +707,19 @@ void ci_tcp_enqueue_no_data(ci_tcp_state* ts, ci_netif* netif,
   oo_offbuf_init(&pkt->buf, PKT_START(pkt) + pkt->buf_len, 0);
   pkt->flags &= CI_PKT_FLAG_NONB_POOL;
   ASSERT_VALID_PKT(netif, pkt);
+}
+
+
+/* Put a SYN or FIN prepared by ci_tcp_tx_prep_no_data() on the send queue,
+ * with [paylen] bytes of data following it in the SYN case.
+ */
+static void ci_tcp_tx_enqueue_ctl(ci_tcp_state* ts, ci_netif* netif,
+                                  ci_ip_pkt_fmt* pkt, int paylen)
+{
+  int af = ipcache_af(&ts->s.pkt);
 
   pkt->pf.tcp_tx.start_seq = tcp_enq_nxt(ts);
-  tcp_enq_nxt(ts) += 1;
+  tcp_enq_nxt(ts) += 1 + paylen;
   pkt->pf.tcp_tx.end_seq = tcp_enq_nxt(ts);
   pkt->pf.tcp_tx.block_end = OO_PP_NULL;
 
@@ -675,11 +729,58 @@ void ci_tcp_enqueue_no_data(ci_tcp_state* ts, ci_netif* netif,
   LOG_TC(log(LNTS_FMT "enqueue ["CI_TCP_FLAGS_FMT"] seq=%x",
              LNTS_PRI_ARGS(netif, ts),
              CI_TCP_HDR_FLAGS_PRI_ARG(TX_PKT_IPX_TCP(af, pkt)),
-             tcp_enq_nxt(ts) - 1));
+             pkt->pf.tcp_tx.start_seq));
 
   ci_tcp_tx_advance(ts, netif);
 }
 
+
+/*
+** called to enqueue a packet with no data (i.e. SYN/FIN) the segment
+** is placed on the TX queue and so is reliably transmitted
+*/
+void ci_tcp_enqueue_no_data(ci_tcp_state* ts, ci_netif* netif,
+                            ci_ip_pkt_fmt* pkt)
+{
+  ci_tcp_tx_prep_no_data(ts, netif, pkt);
+  ci_tcp_tx_enqueue_ctl(ts, netif, pkt, 0);
+}
+
+
+/* Enqueue and send a SYN carrying up to [maxlen] bytes from [piov]
+ * (TCP Fast Open, RFC7413).  The send window is opened to cover the data
+ * in the SYN only.  Returns the number of bytes sent, or -EFAULT.
+ */
+int ci_tcp_enqueue_syn_data(ci_tcp_state* ts, ci_netif* netif,
+                            ci_ip_pkt_fmt* pkt, ci_iovec_ptr* piov,
+                            int maxlen CI_KERNEL_ARG(ci_addr_spc_t addr_spc))
+{
+  int n = 0;
+
+  ci_assert_equal(ts->s.b.state, CI_TCP_SYN_SENT);
+  ci_assert(TS_IPX_TCP(ts)->tcp_flags & CI_TCP_FLAG_SYN);
+
+  ci_tcp_tx_prep_no_data(ts, netif, pkt);
+  /* Data may not go past the end of a single buffer. */
+  maxlen = CI_MIN(maxlen, (int) ((char*) pkt + CI_CFG_PKT_BUF_SIZE -
+                                 oo_offbuf_ptr(&pkt->buf)));
+  if( maxlen > 0 && ! ci_iovec_ptr_is_empty_proper(piov) ) {
+    oo_offbuf_init(&pkt->buf, oo_offbuf_ptr(&pkt->buf), maxlen);
+    n = __ci_copy_iovec_to_pkt(netif, pkt, piov CI_KERNEL_ARG(addr_spc));
+    if(CI_UNLIKELY( n < 0 )) {
+      ci_netif_pkt_release(netif, pkt);
+      return n;
+    }
+    oo_offbuf_init(&pkt->buf, oo_offbuf_ptr(&pkt->buf), 0);
+    TX_PKT_IPX_TCP(ipcache_af(&ts->s.pkt), pkt)->tcp_flags |= CI_TCP_FLAG_PSH;
+  }
+
+  ts->snd_max = tcp_enq_nxt(ts) + 1 + n;
+  ci_tcp_tx_enqueue_ctl(ts, netif, pkt, n);
+  return n;
+}
+
+
 /* Rewrite the first SYN packet as a SYNACK for simultaneous open */
 int ci_tcp_send_sim_synack(ci_netif* netif, ci_tcp_state *ts)
 {
@@ -720,7 +821,8 @@ int ci_tcp_send_sim_synack(ci_netif* netif, ci_tcp_state *ts)
     optlen += ci_tcp_tx_opt_tso(&opt, ci_tcp_time_now(netif), 0);
 
   optlen += ci_tcp_tx_insert_syn_options(netif, ts->amss,
-                                         ts->tcpflags, ts->rcv_wscl, &opt);
+                                         ts->tcpflags, ts->rcv_wscl,
+                                         NULL, -1, optlen, &opt);
 
   CI_TCP_HDR_SET_LEN(tcp, sizeof(*tcp) + optlen);
   tcp->tcp_flags |= CI_TCP_FLAG_ACK;
@@ -820,6 +922,10 @@ int ci_tcp_synrecv_send(ci_netif* netif, ci_tcp_socket_listen* tls,
   thdr->tcp_seq_be32    = CI_BSWAP_BE32(seq);
   thdr->tcp_ack_be32    = CI_BSWAP_BE32(tsr->rcv_nxt);
   thdr->tcp_flags       = tcp_flags;
+  /* ECN-setup SYN-ACK (RFC3168 6.1.1) */
+  if( (tcp_flags & CI_TCP_FLAG_SYN) &&
+      (tsr->tcpopts.flags & CI_TCPT_FLAG_ECN) )
+    thdr->tcp_flags |= CI_TCP_FLAG_ECE;
 
   /* options */
   opt = CI_TCP_HDR_OPTS(thdr);
@@ -856,10 +962,17 @@ int ci_tcp_synrecv_send(ci_netif* netif, ci_tcp_socket_listen* tls,
       (ipcache->status == retrrc_success ||
        ipcache->status == retrrc_nomac ||
        OO_SP_NOT_NULL(tsr->local_peer)) ) {
+    ci_uint8 cookie[CI_TCP_FASTOPEN_COOKIE_LEN];
+    int tfo_len = -1;
+    if( tsr->tcpopts.flags & CI_TCPT_FLAG_FASTOPEN ) {
+      ci_tcp_fastopen_cookie(netif, tsr->l_addr, tsr->r_addr, cookie);
+      tfo_len = sizeof(cookie);
+    }
     tsr->amss = ci_tcp_amss(netif, &tls->c, ipcache, __func__);
     optlen += ci_tcp_tx_insert_syn_options(netif, tsr->amss,
                                            tsr->tcpopts.flags,
-                                           tsr->rcv_wscl, &opt);
+                                           tsr->rcv_wscl, cookie, tfo_len,
+                                           optlen, &opt);
     pkt->pf.tcp_tx.sock_id = OO_SP_NULL;
   }
   /* NB. If [ipcache->status] has some other value, then packet won't be
@@ -894,6 +1007,148 @@ int ci_tcp_synrecv_send(ci_netif* netif, ci_tcp_socket_listen* tls,
 }
 
 
+/* Get the SYN-ACK template that [tls] uses while answering SYNs with
+ * syncookies, building it first if the MSS we advertise on this route or
+ * the receive buffer has changed.
+ */
+const ci_tcp_syncookie_tmpl*
+ci_tcp_syncookie_tmpl_get(ci_netif* netif, ci_tcp_socket_listen* tls,
+                          ci_ip_cached_hdrs* ipcache)
+{
+  ci_tcp_syncookie_tmpl* tmpl = &tls->syncookie_tmpl;
+  ci_tcp_hdr* thdr = (ci_tcp_hdr*) tmpl->hdr;
+  ci_uint8* opt = CI_TCP_HDR_OPTS(thdr);
+  unsigned amss = ci_tcp_amss(netif, &tls->c, ipcache, __func__);
+  ci_int32 rcvbuf;
+
+  if(CI_LIKELY( tmpl->amss == amss && tmpl->rcvbuf == tls->s.so.rcvbuf ))
+    return tmpl;
+
+  CITP_STATS_NETIF_INC(netif, syncookie_tmpl_builds);
+  tmpl->amss = amss;
+  tmpl->rcvbuf = tls->s.so.rcvbuf;
+  if( NI_OPTS(netif).tcp_rcvbuf_mode == 1 )
+    rcvbuf = ci_tcp_max_rcvbuf(netif, netif->state->max_mss);
+  else
+    rcvbuf = ci_tcp_rcvbuf_established(netif, &tls->s);
+  tmpl->rcv_wscl = (ci_uint8) ci_tcp_wscl_by_buff(netif, rcvbuf);
+
+  memset(tmpl->hdr, 0, sizeof(tmpl->hdr));
+  thdr->tcp_flags = CI_TCP_FLAG_SYN | CI_TCP_FLAG_ACK;
+  thdr->tcp_window_be16 =
+    CI_BSWAP_BE16(ci_tcp_calc_rcv_wnd_syn(tls->s.so.rcvbuf, tmpl->amss,
+                                          tmpl->rcv_wscl));
+  /* Options in the order that ci_tcp_syncookie_synack_send() trims them.
+   * The last two bytes are left as CI_TCP_OPT_END. */
+  ci_tcp_tx_opt_mss(&opt, tmpl->amss);
+  ci_tcp_tx_opt_tso(&opt, 0, 0);
+  ci_tcp_tx_opt_wscl(&opt, tmpl->rcv_wscl);
+  ci_tcp_tx_opt_sack_perm(&opt);
+  ci_assert_equal(opt + 2 - CI_TCP_HDR_OPTS(thdr),
+                  CI_TCP_SYNCOOKIE_TMPL_OPTS);
+  return tmpl;
+}
+
+
+/* Send a SYN-ACK carrying a syncookie, copied from the listener's template
+ * with the fields from [tsr] filled in.  This is the cheap alternative to
+ * ci_tcp_synrecv_send() used when answering a flood of SYNs.  [tsr] is
+ * not kept, and must have been set up by ci_tcp_syncookie_syn() with
+ * [amss] and [rcv_wscl] from ci_tcp_syncookie_tmpl_get().
+ */
+int ci_tcp_syncookie_synack_send(ci_netif* netif, ci_tcp_socket_listen* tls,
+                                 ci_tcp_state_synrecv* tsr,
+                                 ci_ip_pkt_fmt* pkt,
+                                 ci_ip_cached_hdrs* ipcache)
+{
+  const ci_tcp_syncookie_tmpl* tmpl = &tls->syncookie_tmpl;
+  int af = CI_IS_ADDR_IP6(tsr->l_addr) ? AF_INET6 : AF_INET;
+  ci_ipx_hdr_t* iphdr;
+  ci_tcp_hdr* thdr;
+  ci_uint8* opt;
+  int rc, optlen;
+
+  ci_assert(tsr->tcpopts.flags & CI_TCPT_FLAG_SYNCOOKIE);
+  ci_assert_equal(tsr->amss, tmpl->amss);
+  ci_assert(OO_SP_IS_NULL(tsr->local_peer));
+  ci_assert(ipcache->status == retrrc_success ||
+            ipcache->status == retrrc_nomac);
+
+  oo_tx_pkt_layout_init(pkt);
+  iphdr = oo_tx_ipx_hdr(af, pkt);
+#if CI_CFG_IPV6
+  if( IS_AF_INET6(af) ) {
+    oo_tx_ether_type_set(pkt, CI_ETHERTYPE_IP6);
+  }
+  else
+#endif
+  {
+    oo_tx_ether_type_set(pkt, CI_ETHERTYPE_IP);
+    iphdr->ip4.ip_check_be16 = 0;
+    iphdr->ip4.ip_id_be16 = 0;
+  }
+  ci_ipx_hdr_init_fixed(iphdr, af, IPPROTO_TCP,
+                        sock_cp_ttl_hoplimit(af, &tls->s.cp),
+                        sock_tos_tclass(af, &tls->s.cp));
+  TX_PKT_SET_SADDR(af, pkt, tsr->l_addr);
+  TX_PKT_SET_DADDR(af, pkt, tsr->r_addr);
+  TX_PKT_TTL(af, pkt) = ipcache_ttl(ipcache);
+
+  thdr = PKT_IPX_TCP_HDR(af, pkt);
+  memcpy(thdr, tmpl->hdr, sizeof(tmpl->hdr));
+  thdr->tcp_source_be16 = tsr->l_port;
+  thdr->tcp_dest_be16   = tsr->r_port;
+  thdr->tcp_seq_be32    = CI_BSWAP_BE32(tsr->snd_isn);
+  thdr->tcp_ack_be32    = CI_BSWAP_BE32(tsr->rcv_nxt);
+
+  /* Keep the options that the peer offered.  Without timestamps the
+   * cookie has nowhere to record the others, so only MSS is sent. */
+  opt = CI_TCP_HDR_OPTS(thdr);
+  if( tsr->tcpopts.flags & CI_TCPT_FLAG_TSO ) {
+    *(ci_uint32*)(opt + 8) = CI_BSWAP_BE32(tsr->timest);
+    *(ci_uint32*)(opt + 12) = CI_BSWAP_BE32(tsr->tspeer);
+    optlen = CI_TCP_SYNCOOKIE_TMPL_OPTS;
+    if( ~tsr->tcpopts.flags & CI_TCPT_FLAG_WSCL ) {
+      memcpy(opt + 16, opt + 20, 4);
+      optlen -= 4;
+    }
+    if( ~tsr->tcpopts.flags & CI_TCPT_FLAG_SACK )
+      optlen -= 4;
+  }
+  else {
+    optlen = 4;
+  }
+
+#if CI_CFG_IPV6
+  if( IS_AF_INET6(af) && tls->s.s_flags & CI_SOCK_FLAG_AUTOFLOWLABEL_REQ ) {
+    ci_uint32 flowlabel = ci_make_flowlabel(netif, tsr->l_addr,
+        thdr->tcp_source_be16, tsr->r_addr, thdr->tcp_dest_be16, IPPROTO_TCP);
+    ci_ip6_set_flowlabel_be32(&ipcache->ipx.ip6, flowlabel);
+    TX_PKT_SET_FLOWLABEL(af, pkt, flowlabel);
+  }
+#endif
+
+  ci_tcp_ipx_hdr_init(af, iphdr,
+                      CI_IPX_HDR_SIZE(af) + sizeof(ci_tcp_hdr) + optlen);
+  CI_TCP_HDR_SET_LEN(thdr, sizeof(*thdr) + optlen);
+  pkt->buf_len = ( oo_tx_ether_hdr_size(pkt) + CI_IPX_HDR_SIZE(af)
+                   + sizeof(ci_tcp_hdr) + optlen );
+  pkt->pay_len = pkt->buf_len;
+  pkt->pf.tcp_tx.sock_id = OO_SP_NULL;
+
+  rc = ci_ip_send_pkt_send(netif, &tls->s.cp, pkt, ipcache);
+  ci_netif_pkt_release(netif, pkt);
+  if(CI_UNLIKELY( rc != 0 )) {
+    CITP_STATS_NETIF(++netif->state->stats.synrecv_send_fails);
+  }
+  else {
+    CI_TCP_STATS_INC_OUT_SEGS(netif);
+    CITP_STATS_TCP_LISTEN(++tls->stats.n_syncookie_synack_tmpl);
+  }
+  return rc;
+}
+
+
 /* Retransmit the indicated packet, returns 0 on success, 1 if packet
    tx in progress */
 int ci_tcp_retrans_one(ci_tcp_state* ts, ci_netif* netif, ci_ip_pkt_fmt* pkt)
@@ -922,6 +1177,11 @@ int ci_tcp_retrans_one(ci_tcp_state* ts, ci_netif* netif, ci_ip_pkt_fmt* pkt)
 
   tcp = TX_PKT_IPX_TCP(af, pkt);
 
+  /* TCP Fast Open: the peer acked our SYN but not the data it carried. */
+  if(CI_UNLIKELY( (tcp->tcp_flags & CI_TCP_FLAG_SYN) &&
+                  SEQ_LT(pkt->pf.tcp_tx.start_seq, tcp_snd_una(ts)) ))
+    ci_tcp_tx_strip_syn(netif, ts, pkt);
+
   /* To retransmit a packet it has to have already been sent.  And we
   ** should only retransmit segments that consume sequence space.
   */
@@ -1272,10 +1532,48 @@ static void ci_tcp_tx_advance_too_long(ci_netif* ni, ci_tcp_state* ts,
 }
 
 
+/* Send what pacing allows of what ci_tcp_tx_advance() would otherwise
+ * send, and arm the pacing timer to release the rest.
+ */
+static void ci_tcp_tx_advance_paced(ci_netif* ni, ci_tcp_state* ts,
+                                    unsigned right_edge,
+                                    ci_uint32* p_stop_cntr)
+{
+  ci_uint32 rate = ci_tcp_pacing_rate(ni, ts);
+  ci_int32 credit = ci_tcp_pacing_credit(ni, ts, rate);
+  unsigned snd_nxt = tcp_snd_nxt(ts);
+
+  if( credit > 0 ) {
+    /* Whole segments are sent while there is any credit left, so the
+     * credit may be overdrawn by up to one segment. */
+    unsigned pace_right_edge = snd_nxt + credit + tcp_eff_mss(ts) - 1;
+    if( SEQ_LT(pace_right_edge, right_edge) ) {
+      p_stop_cntr = &ts->stats.tx_stop_pace;
+      right_edge = pace_right_edge;
+    }
+    ci_tcp_tx_advance_to(ni, ts, right_edge, p_stop_cntr);
+    ts->pace_credit -= SEQ_SUB(tcp_snd_nxt(ts), snd_nxt);
+    CITP_STATS_NETIF_ADD(ni, tcp_paced_bytes,
+                         SEQ_SUB(tcp_snd_nxt(ts), snd_nxt));
+  }
+  else {
+    ++ts->stats.tx_stop_pace;
+  }
+
+  if( ts->pace_credit <= 0 && ci_ip_queue_not_empty(&ts->send) ) {
+    CITP_STATS_NETIF_INC(ni, tcp_pace_deferred);
+    if( ! ci_ip_timer_pending(ni, &ts->pace_tid) )
+      ci_ip_timer_set(ni, &ts->pace_tid, ci_tcp_time_now(ni) + 1 +
+                      (ci_uint32) -ts->pace_credit / rate);
+  }
+}
+
+
 void ci_tcp_tx_advance(ci_tcp_state* ts, ci_netif* ni)
 {
   unsigned cwnd_right_edge, right_edge;
   ci_uint32* p_stop_cntr;
+  unsigned snd_nxt;
 
   ci_assert(ci_netif_is_locked(ni));
   ci_assert(ci_ip_queue_not_empty(&ts->send));
@@ -1328,7 +1626,15 @@ void ci_tcp_tx_advance(ci_tcp_state* ts, ci_netif* ni)
   }
 #endif
 
+  if( ci_tcp_is_paced(ni, ts) ) {
+    ci_tcp_tx_advance_paced(ni, ts, right_edge, p_stop_cntr);
+    return;
+  }
+
+  snd_nxt = tcp_snd_nxt(ts);
   ci_tcp_tx_advance_to(ni, ts, right_edge, p_stop_cntr);
+  CITP_STATS_NETIF_ADD(ni, tcp_unpaced_bytes,
+                       SEQ_SUB(tcp_snd_nxt(ts), snd_nxt));
 }
 
 
@@ -1799,6 +2105,72 @@ ci_tcp_reply_with_rst(ci_netif* netif, const struct oo_sock_cplane* sock_cp,
 }
 
 
+/* Answers [rxp] with an ACK on behalf of the connection in the timewait
+ * table entry [tw].  The packet is consumed.  We advertise a zero window,
+ * as no more data will be accepted on this connection.
+ */
+void ci_tcp_timewait_send_ack(ci_netif* netif, const ci_tcp_timewait_t* tw,
+                              ciip_tcp_rx_pkt* rxp)
+{
+  ci_ip_pkt_fmt* pkt = rxp->pkt;
+  ci_ip_cached_hdrs ipcache;
+  ci_ipx_hdr_t* ip;
+  ci_tcp_hdr* tcp;
+  ci_uint8* opt;
+  int optlen = 0;
+
+  ci_assert(netif);
+  ASSERT_VALID_PKT(netif, pkt);
+  ci_assert_equal(oo_pkt_af(pkt), AF_INET);
+
+  if( (pkt = ci_netif_pkt_rx_to_tx(netif, pkt)) == NULL )
+    return;
+
+  oo_tx_pkt_layout_init(pkt);
+  oo_tx_ether_type_set(pkt, CI_ETHERTYPE_IP);
+  ip = oo_tx_ipx_hdr(AF_INET, pkt);
+  ci_ipx_hdr_init_fixed(ip, AF_INET, IPPROTO_TCP,
+                        CI_IPX_DFLT_TTL_HOPLIMIT(AF_INET),
+                        CI_IPX_DFLT_TOS_TCLASS(AF_INET));
+  ip->ip4.ip_saddr_be32 = tw->laddr_be32;
+  ip->ip4.ip_daddr_be32 = tw->raddr_be32;
+
+  tcp = ipx_hdr_data(AF_INET, ip);
+  tcp->tcp_source_be16 = tw->lport_be16;
+  tcp->tcp_dest_be16 = tw->rport_be16;
+  tcp->tcp_seq_be32 = CI_BSWAP_BE32(tw->snd_nxt);
+  tcp->tcp_ack_be32 = CI_BSWAP_BE32(tw->rcv_nxt);
+  tcp->tcp_flags = CI_TCP_FLAG_ACK;
+  tcp->tcp_window_be16 = 0;
+  tcp->tcp_urg_ptr_be16 = 0;
+  tcp->tcp_check_be16 = 0;
+
+  opt = CI_TCP_HDR_OPTS(tcp);
+  if( tw->flags & CI_TCP_TIMEWAIT_FLAG_TSO )
+    optlen += ci_tcp_tx_opt_tso(&opt, ci_tcp_time_now(netif), tw->tsrecent);
+  CI_TCP_HDR_SET_LEN(tcp, sizeof(ci_tcp_hdr) + optlen);
+  ci_tcp_ipx_hdr_init(AF_INET, ip,
+                      CI_IPX_HDR_SIZE(AF_INET) + sizeof(ci_tcp_hdr) + optlen);
+
+  LOG_TT(log(LN_FMT "TIMEWAIT ACK "CI_IP_PRINTF_FORMAT":%u->"
+             CI_IP_PRINTF_FORMAT":%u s=%08x a=%08x",
+             LN_PRI_ARGS(netif), CI_IP_PRINTF_ARGS(&tw->laddr_be32),
+             (unsigned) CI_BSWAP_BE16(tw->lport_be16),
+             CI_IP_PRINTF_ARGS(&tw->raddr_be32),
+             (unsigned) CI_BSWAP_BE16(tw->rport_be16),
+             tw->snd_nxt, tw->rcv_nxt));
+
+  pkt->buf_len = pkt->pay_len = ( oo_tx_ether_hdr_size(pkt) +
+                                  CI_IPX_HDR_SIZE(AF_INET) +
+                                  sizeof(ci_tcp_hdr) + optlen );
+  ci_ip_cache_init(&ipcache, AF_INET);
+  ci_ip_send_pkt_lookup(netif, NULL, pkt, &ipcache);
+  ci_ip_send_pkt_send(netif, NULL, pkt, &ipcache);
+  CI_TCP_STATS_INC_OUT_SEGS(netif);
+  ci_netif_pkt_release(netif, pkt);
+}
+
+
 void ci_tcp_send_zwin_probe(ci_netif* netif, ci_tcp_state* ts)
 {
   /*
@@ -1839,7 +2211,7 @@ void ci_tcp_send_zwin_probe(ci_netif* netif, ci_tcp_state* ts)
   if( ts->tcpflags & CI_TCPT_FLAG_SACK )
     optlen += ci_tcp_tx_opt_sack(&opt, optlen, netif, ts);
 
-  tcp->tcp_flags = CI_TCP_FLAG_ACK;
+  tcp->tcp_flags = CI_TCP_FLAG_ACK | ci_tcp_tx_ecn_ack_flags(ts);
   /* SACK option may change pre-computed header length. */
   CI_TCP_HDR_SET_LEN(tcp, sizeof(ci_tcp_hdr) + optlen);
 
@@ -1987,7 +2359,7 @@ void ci_tcp_send_ack_rx(ci_netif* netif, ci_tcp_state* ts, ci_ip_pkt_fmt* pkt,
     optlen += ci_tcp_tx_opt_sack(&opt, optlen, netif, ts);
   }
 
-  tcp->tcp_flags = CI_TCP_FLAG_ACK;
+  tcp->tcp_flags = CI_TCP_FLAG_ACK | ci_tcp_tx_ecn_ack_flags(ts);
   /* SACK option may change pre-computed header length. */
   CI_TCP_HDR_SET_LEN(tcp, sizeof(ci_tcp_hdr) + optlen);
 
@@ -2020,14 +2392,7 @@ void ci_tcp_send_ack_rx(ci_netif* netif, ci_tcp_state* ts, ci_ip_pkt_fmt* pkt,
 int/*bool*/
 ci_tcp_may_send_ack_ratelimited(ci_netif* netif, ci_tcp_state* ts)
 {
-  if( ci_tcp_time_now(netif) - ts->t_last_invalid_ack >=
-      NI_CONF(netif).tconst_invalid_ack_ratelimit ) {
-    ts->t_last_invalid_ack = ci_tcp_time_now(netif);
-    return 1;
-  }
-
-  CITP_STATS_NETIF_INC(netif, invalid_ack_limited);
-  return 0;
+  return ci_tcp_ack_ratelimit(netif, &ts->t_last_invalid_ack);
 }
 
 /* Return 1 if the packet have been consumed. */
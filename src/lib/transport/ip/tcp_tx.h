@@ -18,10 +18,59 @@ ci_inline int ci_tcp_tx_opt_tso(ci_uint8** opt,
 }
 
 
+/* ECN flags for a segment that carries no data */
+ci_inline ci_uint8 ci_tcp_tx_ecn_ack_flags(const ci_tcp_state* ts)
+{
+  return (ts->tcpflags & CI_TCPT_FLAG_ECN_ECE) ? CI_TCP_FLAG_ECE : 0;
+}
+
+
+/* ECN marking of a transmitted segment (RFC3168).  Only new data is
+** ECN-capable, so that a congestion mark can't hide the loss of a
+** retransmission.  Retransmitted segments may carry stale ECE and CWR from
+** the first time round.
+**
+** This covers segments sent through ci_tcp_tx_finish().  Delegated sends
+** are marked in ci_tcp_ds_fill_headers(), and templated sends are refused
+** on ECN connections because their headers are built ahead of time.
+*/
+ci_inline void ci_tcp_tx_ecn(ci_netif* netif, ci_tcp_state* ts,
+                             ci_ip_pkt_fmt* pkt, ci_tcp_hdr* tcp,
+                             ci_uint32 seq)
+{
+  int af = ipcache_af(&ts->s.pkt);
+  int is_new = SEQ_GE(seq, tcp_snd_nxt(ts));
+  ci_uint8 ecn = CI_IP_ECN_NOT_ECT;
+
+  if(CI_UNLIKELY( tcp->tcp_flags & CI_TCP_FLAG_SYN )) {
+    /* An ECN-setup SYN may have been dropped because of its flags, so
+     * retransmit it without them, as Linux does. */
+    if( ! is_new ) {
+      tcp->tcp_flags &=~ (CI_TCP_FLAG_ECE | CI_TCP_FLAG_CWR);
+      ts->tcpflags &=~ CI_TCPT_FLAG_ECN;
+      CITP_STATS_NETIF_INC(netif, tcp_ecn_active_refused);
+    }
+    return;
+  }
+
+  tcp->tcp_flags &=~ (CI_TCP_FLAG_ECE | CI_TCP_FLAG_CWR);
+  tcp->tcp_flags |= ci_tcp_tx_ecn_ack_flags(ts);
+  if( is_new && ci_tx_pkt_ipx_tcp_payload_len(af, pkt) != 0 ) {
+    ecn = CI_IP_ECN_ECT0;
+    if( ts->tcpflags & CI_TCPT_FLAG_ECN_CWR ) {
+      tcp->tcp_flags |= CI_TCP_FLAG_CWR;
+      ts->tcpflags &=~ CI_TCPT_FLAG_ECN_CWR;
+      CITP_STATS_NETIF_INC(netif, tcp_ecn_cwr_tx);
+    }
+  }
+  ipx_hdr_set_ecn(af, oo_tx_ipx_hdr(af, pkt), ecn);
+}
+
+
 /* finish off a transmitted data segment by:
 **   - snarfing a timestamp for RTT measurement
 **   - timestamps
-** could be a place to deal with ECN.
+**   - ECN
 ** We could not deal with outgoing SACK here, because it will change packet
 ** length.
 */
@@ -61,6 +110,9 @@ ci_inline void ci_tcp_tx_finish(ci_netif* netif, ci_tcp_state* ts,
     }
   }
 
+  if( ts->tcpflags & CI_TCPT_FLAG_ECN )
+    ci_tcp_tx_ecn(netif, ts, pkt, tcp, seq);
+
   tcp->tcp_seq_be32 = CI_BSWAP_BE32(seq);
 }
 
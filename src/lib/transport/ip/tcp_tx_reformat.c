@@ -439,6 +439,40 @@ void ci_tcp_tx_insert_option_space(ci_netif* ni, ci_tcp_state* ts,
 }
 
 
+/* Turn a SYN carrying data (TCP Fast Open) into an ordinary data segment
+** once the peer has acked the SYN but not the data.  The SYN options are
+** dropped, so the header matches that of the established connection.
+*/
+void ci_tcp_tx_strip_syn(ci_netif* ni, ci_tcp_state* ts, ci_ip_pkt_fmt* pkt)
+{
+  int af = ipcache_af(&ts->s.pkt);
+  ci_tcp_hdr* tcp = TX_PKT_IPX_TCP(af, pkt);
+  int optlen = tcp_ipx_outgoing_opts_len(af, ts);
+  char* old_start = (char*) CI_TCP_PAYLOAD(tcp);
+  char* new_start = (char*) CI_TCP_HDR_OPTS(tcp) + optlen;
+  int paylen = oo_offbuf_ptr(&pkt->buf) - old_start;
+
+  ci_assert(tcp->tcp_flags & CI_TCP_FLAG_SYN);
+  ci_assert_equal(pkt->n_buffers, 1);
+  ci_assert(~pkt->flags & CI_PKT_FLAG_TX_PENDING);
+  ci_assert_le(new_start, old_start);
+
+  LOG_U(ci_log(LNT_FMT "packet %d (%x-%x) - stripping SYN from %d bytes",
+               LNT_PRI_ARGS(ni,ts), OO_PKT_FMT(pkt), pkt->pf.tcp_tx.start_seq,
+               pkt->pf.tcp_tx.end_seq, paylen));
+
+  memmove(new_start, old_start, paylen);
+  CI_TCP_HDR_SET_LEN(tcp, sizeof(*tcp) + optlen);
+  tcp->tcp_flags = CI_TCP_FLAG_ACK | CI_TCP_FLAG_PSH;
+  pkt->buf_len -= old_start - new_start;
+  pkt->pay_len = pkt->buf_len;
+  pkt->pf.tcp_tx.start_seq += 1;
+  oo_offbuf_init(&pkt->buf, new_start + paylen, 0);
+
+  ASSERT_VALID_PKT(ni, pkt);
+}
+
+
 void ci_tcp_retrans_coalesce_block(ci_netif* ni, ci_tcp_state* ts,
                                    ci_ip_pkt_fmt* pkt)
 {
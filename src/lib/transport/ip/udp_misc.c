@@ -54,6 +54,12 @@ void ci_udp_perform_deferred_socket_work(ci_netif* ni, ci_udp_state* us)
 {
   ci_assert(us->s.b.state == CI_TCP_STATE_UDP);
 
+  if( us->tx_direct_count != 0 ) {
+    ci_uint32 n = ci_xchg32(&us->tx_direct_count, 0);
+    us->stats.n_tx_onload_c += n;
+    CITP_STATS_NETIF_ADD(ni, tx_dma_doorbells, n);
+    CITP_STATS_NETIF_ADD(ni, udp_tx_direct, n);
+  }
   ci_udp_sendmsg_send_async_q(ni, us);
 }
 #endif
@@ -527,6 +527,10 @@ struct recvmsg_spinstate {
   uint32_t poison;
   const volatile uint32_t* future;
   citp_signal_info* si;
+  /* With EF_SPIN_ADAPTIVE, the socket's wait history and how the wait is
+   * going to end if it does not end while spinning. */
+  struct oo_spin_adapt* adapt;
+  int adapt_outcome;
 #endif
 };
 
@@ -644,6 +648,8 @@ ci_udp_recvmsg_socklocked_spin(ci_netif* ni, ci_udp_state* us,
                                            &us->s.b, spin_state->si);
   }
   else {
+    if(CI_UNLIKELY( NI_OPTS(ni).lat_hist ))
+      CI_LAT_HIST_RECORD(ni, spin, now_frc - spin_state->start_frc);
     if( spin_state->spin_limit_by_so ) {
       ++us->stats.n_rx_eagain;
       return -EAGAIN;
@@ -788,6 +794,15 @@ ci_udp_recvmsg_common(ci_udp_recv_info *rinf
           spin_state.spin_limit_by_so = 1;
         }
       }
+      if( NI_OPTS(ni).spin_adaptive ) {
+        spin_state.adapt = &S_TO_EPS(ni, us)->spin_adapt;
+        spin_state.adapt_outcome = OO_SPIN_ADAPT_MISS;
+        if( ! oo_spin_adapt_should_spin(spin_state.adapt,
+                                        us->s.b.spin_cycles) ) {
+          spin_state.do_spin = 0;
+          spin_state.adapt_outcome = OO_SPIN_ADAPT_SKIP;
+        }
+      }
     }
   }
 
@@ -817,6 +832,13 @@ ci_udp_recvmsg_common(ci_udp_recv_info *rinf
 
  out:
   ni->state->is_spinner = 0;
+#ifndef __KERNEL__
+  if( spin_state.adapt != NULL && rc >= 0 )
+    oo_spin_adapt_wait_done(ni, spin_state.adapt, us->s.b.spin_cycles,
+                            ci_frc64_get() - spin_state.start_frc,
+                            spin_state.do_spin ? OO_SPIN_ADAPT_HIT :
+                                                 spin_state.adapt_outcome);
+#endif
   return rc;
 
  slow_path:
@@ -866,6 +888,39 @@ int ci_udp_recvmsg(ci_udp_iomsg_args *a, ci_msghdr* msg, int flags
 
 
 #ifndef __KERNEL__
+/* Takes the next datagram of a recvmmsg() batch while we still hold the
+ * socket lock from the previous one, skipping the set-up that
+ * ci_udp_recvmsg_common() does for each call.  Returns -EAGAIN if the
+ * caller must take the full path instead: for example because the receive
+ * queue is empty or the socket needs attention.
+ */
+static int ci_udp_recvmmsg_get(ci_udp_recv_info* rinf)
+{
+  ci_netif* ni = rinf->a->ni;
+  ci_udp_state* us = rinf->a->us;
+  ci_iovec_ptr piov;
+
+  ci_assert(rinf->sock_locked);
+
+  if( (rinf->flags & (MSG_OOB_CHK | MSG_ERRQUEUE_CHK)) |
+      (rinf->msg->msg_iovlen == 0                  ) |
+      (rinf->msg->msg_iov == NULL                  ) |
+      (ni->state->rxq_low                          ) |
+#if CI_CFG_POSIX_RECV
+      (udp_lport_be16(us) == 0                     ) |
+#endif
+      (us->s.so_error                              ) |
+      (us->udpflags & CI_UDPF_PEEK_FROM_OS         ) )
+    return -EAGAIN;
+
+#if HAVE_MSG_FLAGS
+  rinf->msg_flags = 0;
+#endif
+  ci_iovec_ptr_init_nz(&piov, rinf->msg->msg_iov, rinf->msg->msg_iovlen);
+  return ci_udp_recvmsg_get(rinf, &piov);
+}
+
+
 int ci_udp_recvmmsg(ci_udp_iomsg_args *a, struct mmsghdr* mmsg, 
                     unsigned int vlen, int flags, 
                     const struct timespec* timeout)
@@ -889,7 +944,10 @@ int ci_udp_recvmmsg(ci_udp_iomsg_args *a, struct mmsghdr* mmsg,
   i = 0;
   while( i < vlen ) {
     rinf.msg = &mmsg[i].msg_hdr;
-    rc = ci_udp_recvmsg_common(&rinf);
+    /* Datagrams already queued are dequeued under the socket lock taken
+     * for the first one. */
+    if( ! rinf.sock_locked || (rc = ci_udp_recvmmsg_get(&rinf)) < 0 )
+      rc = ci_udp_recvmsg_common(&rinf);
     if( rc >= 0 ) {
       mmsg[i].msg_len = rc;
 #if HAVE_MSG_FLAGS
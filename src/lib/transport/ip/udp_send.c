@@ -13,6 +13,7 @@
   
 /*! \cidoxg_lib_transport_ip */
   
+#define _GNU_SOURCE  /* for sendmmsg */
 #include "ip_internal.h"
 #include "udp_internal.h"
 #include "ip_tx.h"
@@ -23,6 +24,7 @@
 #include <etherfabric/checksum.h>
 
 #ifndef __KERNEL__
+#include <sys/socket.h>
 #include <ci/internal/efabcfg.h>
 #endif
 
@@ -77,6 +79,8 @@ struct udp_send_info {
   int                   stack_locked;
   ci_uint32             timeout;
   int                   old_ipcache_updated;
+  /* Queue the datagram for ci_netif_send_batch_post(). */
+  int                   tx_batch;
 #ifdef __KERNEL__
   ci_addr_spc_t addr_spc;
 #endif
@@ -330,19 +334,34 @@ static void ci_udp_sendmsg_mcast(ci_netif* ni, ci_udp_state* us,
 }
 
 
-/* Pass prepared packet to ip_send(), release our ref & and update stats */
+/* Pass prepared packet to ip_send(), release our ref & and update stats.
+ * [stack_locked] is false only for sends made under the interface TX lock
+ * (EF_TX_LOCK_DOMAINS).
+ */
 ci_inline void prep_send_pkt(ci_netif* ni, ci_udp_state* us,
-                             ci_ip_pkt_fmt* pkt, ci_ip_cached_hdrs* ipcache)
+                             ci_ip_pkt_fmt* pkt, ci_ip_cached_hdrs* ipcache,
+                             int stack_locked)
 {
   int af = ipcache_af(&us->s.pkt);
   ci_ipx_hdr_t* ipx = oo_tx_ipx_hdr(af, pkt);
-  ni->state->n_async_pkts -= pkt->n_buffers;
+
+  if( stack_locked ) {
+    ni->state->n_async_pkts -= pkt->n_buffers;
+  }
+  else {
+    /* Merged into [n_async_pkts] by the lock holder. */
+    ci_int32 val;
+    do
+      val = ni->state->atomic_n_async_pkts;
+    while( ci_cas32_fail(&ni->state->atomic_n_async_pkts,
+                         val, val - pkt->n_buffers) );
+  }
 
   TX_PKT_SET_SADDR(af, pkt, ipcache_laddr(ipcache));
   TX_PKT_SET_DADDR(af, pkt, ipcache_raddr(ipcache));
   TX_PKT_TTL(af, pkt) = ipcache_ttl(ipcache);
   ci_ip_set_mac_and_port(ni, ipcache, pkt);
-  us->tx_count += pkt->pf.udp.tx_length;
+  ci_udp_add_tx_count(ni, us, pkt->pf.udp.tx_length);
   pkt->flags |= CI_PKT_FLAG_UDP;
   pkt->pf.udp.tx_sock_id = S_SP(us);
   CI_UDP_STATS_INC_OUT_DGRAMS( ni );
@@ -820,12 +839,19 @@ static void ci_udp_sendmsg_send(ci_netif* ni, ci_udp_state* us,
   /* Linux allows sending IPv6 packets with zero Hop Limit field */
   if( ipcache_ttl(ipcache) || ipcache_is_ipv6(ipcache) ) {
     if(CI_LIKELY( ipcache_onloadable )) {
+      int tx_batch = sinf != NULL && sinf->tx_batch;
       /* TODO: Hit the doorbell just once. */
       while( 1 ) {
         oo_pkt_p next = pkt->next;
-        prep_send_pkt(ni, us, pkt, ipcache);
+        prep_send_pkt(ni, us, pkt, ipcache, 1);
         /* We've called ci_netif_pkt_hold() in ci_udp_sendmsg_fill(). */
-        ci_netif_send(ni, pkt);
+        if( tx_batch ) {
+          ci_netif_send_batched(ni, pkt);
+          CITP_STATS_NETIF_INC(ni, udp_tx_batched);
+        }
+        else {
+          ci_netif_send(ni, pkt);
+        }
         if( OO_PP_IS_NULL(next) )
           break;
         pkt = PKT_CHK(ni, next);
@@ -860,7 +886,7 @@ static void ci_udp_sendmsg_send(ci_netif* ni, ci_udp_state* us,
       us->udpflags |= CI_UDPF_LAST_SEND_NOMAC;
       while( 1 ) {
         oo_pkt_p next = pkt->next;
-        prep_send_pkt(ni, us, pkt, ipcache);
+        prep_send_pkt(ni, us, pkt, ipcache, 1);
         ci_ip_send_udp_slow(ni, &us->s.cp, pkt, ipcache);
         if( OO_PP_IS_NULL(next) )
           break;
@@ -981,6 +1007,8 @@ void ci_udp_sendmsg_send_async_q(ci_netif* ni, ci_udp_state* us)
     else
       flags = 0;
     ++us->stats.n_tx_lock_defer;
+    if( NI_OPTS(ni).tx_lock_domains )
+      CITP_STATS_NETIF_INC(ni, udp_tx_direct_fallbacks);
     ci_udp_sendmsg_send(ni, us, pkt, flags, false/*don't poll*/, NULL);
     ci_netif_pkt_release(ni, pkt);
     if( OO_PP_IS_NULL(pp) )  break;
@@ -1007,6 +1035,124 @@ static void ci_udp_sendmsg_async_q_enqueue(ci_netif* ni, ci_udp_state* us,
 }
 
 
+#ifndef __KERNEL__
+/* Called with EF_TX_LOCK_DOMAINS when the stack lock is busy.  Rather than
+ * deferring the datagram to the lock holder, post it to the TX ring here
+ * under the interface's TX lock.  Only the common case is handled: a
+ * connected send to a unicast destination over a good route, by plain DMA,
+ * with nothing else queued for this socket or interface.
+ *
+ * Returns false, having changed nothing, if the caller should defer the
+ * datagram instead.  On success the caller's reference to [first_pkt] has
+ * been dropped.  Stats are left to the stack lock holder: see
+ * [tx_direct_count] and ci_udp_sendmsg_send_async_q().
+ */
+static bool ci_udp_sendmsg_tx_domain(ci_netif* ni, ci_udp_state* us,
+                                     ci_ip_pkt_fmt* first_pkt, int flags)
+{
+  int af = ipcache_af(&us->s.pkt);
+  ci_ip_cached_hdrs ipcache;
+  ci_netif_state_nic_t* nsn;
+  ci_ip_pkt_fmt* pkt;
+  oo_pkt_p next;
+  int intf_i, n_pkts;
+  ef_vi* vi;
+
+  if( ! NI_OPTS(ni).tx_lock_domains )
+    return false;
+
+  /* Unconnected sends, and anything that might need to be ordered after
+   * datagrams already deferred to the lock holder, take the usual path.
+   */
+  if( (flags & MSG_CONFIRM) ||
+      ! CI_IPX_ADDR_IS_ANY(TX_PKT_DADDR(af, first_pkt)) ||
+      CI_IPX_ADDR_IS_ANY(udp_ipx_raddr(us)) ||
+      (us->udpflags & CI_UDPF_LAST_SEND_NOMAC) ||
+      us->tx_async_q != OO_PP_ID_NULL )
+    return false;
+#if CI_CFG_TIMESTAMPING
+  if( onload_timestamping_want_tx_nic(us->s.timestamping_flags) )
+    return false;
+#endif
+
+  /* Work from a private copy of the route, which must be up to date both
+   * before and after we take it.  As elsewhere on the unlocked send path, a
+   * concurrent connect() on this socket can race with us.
+   */
+  if( us->s.pkt.status != retrrc_success ||
+      ! oo_cp_ipcache_is_valid(ni, &us->s.pkt) )
+    return false;
+  memcpy(&ipcache, &us->s.pkt, sizeof(ipcache));
+  ci_rmb();
+  if( ! oo_cp_ipcache_is_valid(ni, &us->s.pkt) ||
+      ipcache.status != retrrc_success ||
+      CI_IPX_IS_MULTICAST(ipcache_raddr(&ipcache)) ||
+      ! (ipcache_ttl(&ipcache) || ipcache_is_ipv6(&ipcache)) ||
+      ipx_hdr_tot_len(af, oo_tx_ipx_hdr(af, first_pkt)) > ipcache.mtu )
+    return false;
+
+  intf_i = ipcache.intf_i;
+  nsn = &ni->state->nic[intf_i];
+  vi = ci_netif_vi(ni, intf_i);
+  if( (nsn->oo_vi_flags & OO_VI_FLAGS_TX_CTPIO_ONLY) ||
+      vi->nic_type.arch == EF_VI_ARCH_AF_XDP )
+    return false;
+
+  for( n_pkts = 1, pkt = first_pkt; OO_PP_NOT_NULL(pkt->next); ++n_pkts )
+    pkt = PKT(ni, pkt->next);
+
+  /* Never wait for the TX lock: whoever has it may be waiting for us. */
+  if( ! ci_netif_tx_trylock(ni, intf_i, getpid()) )
+    return false;
+  /* The dump queue belongs to the stack lock holder, so leave packets that
+   * tcpdump wants to it.  onload_tcpdump waits for senders holding the TX
+   * lock after turning dumping on, so this stays true until we unlock.
+   */
+  if( ni->state->dump_intf[intf_i] == OO_INTF_I_DUMP_ALL ||
+      ci_netif_dmaq_not_empty(ni, intf_i) ||
+      ef_vi_transmit_space(vi) < n_pkts * CI_IP_PKT_SEGMENTS_MAX ) {
+    ci_netif_tx_unlock(ni, intf_i);
+    return false;
+  }
+
+  /* Completions can't be processed until we drop the TX lock, so the
+   * packets are still ours.  Drop the caller's reference now, as the lock
+   * holder would have done after sending.
+   */
+  ci_assert_gt(first_pkt->refcount, 1);
+  --first_pkt->refcount;
+
+  TX_PKT_IPX_UDP(af, first_pkt,
+                 ci_ipx_is_frag(af, TX_PKT_IPX_HDR(af, first_pkt)))->
+    udp_dest_be16 = udp_rport_be16(us);
+  pkt = first_pkt;
+  while( 1 ) {
+    next = pkt->next;
+    prep_send_pkt(ni, us, pkt, &ipcache, 0);
+    ci_assert_equal(pkt->intf_i, intf_i);
+    ci_netif_tx_post_unlocked(ni, pkt);
+    if( OO_PP_IS_NULL(next) )
+      break;
+    pkt = PKT(ni, next);
+  }
+  ef_vi_transmit_push(vi);
+  ci_netif_ctpio_desist(ni, intf_i);
+  ci_netif_tx_unlock(ni, intf_i);
+
+  /* Have the lock holder fold our change to [n_async_pkts] in, and count
+   * the send.
+   */
+  ci_netif_set_merge_atomic_flag(ni);
+  ci_atomic32_inc(&us->tx_direct_count);
+  if( ci_netif_lock_or_defer_work(ni, &us->s.b) )
+    ci_netif_unlock(ni);
+  return true;
+}
+#else
+# define ci_udp_sendmsg_tx_domain(ni, us, first_pkt, flags)  false
+#endif
+
+
 #ifndef __KERNEL__
 /* Check if provided address struct/content is OK for us. */
 static int ci_udp_name_is_ok(int af, ci_udp_state* us, const struct msghdr* msg)
@@ -1521,7 +1667,7 @@ void ci_udp_sendmsg_onload(ci_netif* ni, ci_udp_state* us,
       ci_netif_unlock(ni);
       sinf->stack_locked = 0;
     }
-    else {
+    else if( ! ci_udp_sendmsg_tx_domain(ni, us, pf.pkt, flags) ) {
       ci_udp_sendmsg_async_q_enqueue(ni, us, pf.pkt, flags);
     }
   }
@@ -1581,9 +1727,9 @@ static int ci_udp_sendmsg_control_os(ci_fd_t fd, ci_udp_state *us,
 }
 #endif
 
-int ci_udp_sendmsg(ci_udp_iomsg_args *a,
-                   const ci_msghdr* msg, int flags
-                   CI_KERNEL_ARG(ci_addr_spc_t addr_spc))
+static int __ci_udp_sendmsg(ci_udp_iomsg_args *a,
+                            const ci_msghdr* msg, int flags, int tx_batch
+                            CI_KERNEL_ARG(ci_addr_spc_t addr_spc))
 {
   ci_netif *ni = a->ni;
   ci_udp_state *us = a->us;
@@ -1600,6 +1746,7 @@ int ci_udp_sendmsg(ci_udp_iomsg_args *a,
   sinf.used_ipcache = 0;
   sinf.old_ipcache_updated = 0;
   sinf.timeout = us->s.so.sndtimeo_msec;
+  sinf.tx_batch = tx_batch;
 #ifdef __KERNEL__
   sinf.addr_spc = addr_spc;
 #endif
@@ -1871,5 +2018,44 @@ int ci_udp_sendmsg(ci_udp_iomsg_args *a,
     RET_WITH_ERRNO(-rc);
 }
 
+
+int ci_udp_sendmsg(ci_udp_iomsg_args *a,
+                   const ci_msghdr* msg, int flags
+                   CI_KERNEL_ARG(ci_addr_spc_t addr_spc))
+{
+  return __ci_udp_sendmsg(a, msg, flags, 0 CI_KERNEL_ARG(addr_spc));
+}
+
+
+#ifndef __KERNEL__
+int ci_udp_sendmmsg(ci_udp_iomsg_args *a, struct mmsghdr* mmsg,
+                    unsigned int vlen, int flags)
+{
+  ci_netif* ni = a->ni;
+  int tx_batch = NI_OPTS(ni).udp_sendmmsg_batch && vlen > 1;
+  int rc, i;
+
+  /* When batching, each datagram is built and queued as usual but not
+   * posted, and the whole batch goes to the NIC at the end.  Anything that
+   * can't be sent by the stack lock holder (async or via the OS) is sent
+   * as it would have been without batching.
+   */
+  i = 0;
+  do {
+    rc = __ci_udp_sendmsg(a, &mmsg[i].msg_hdr, flags, tx_batch);
+    if(CI_LIKELY( rc >= 0 ) )
+      mmsg[i].msg_len = rc;
+    ++i;
+  } while( rc >= 0 && i < vlen );
+
+  if( tx_batch ) {
+    ci_netif_lock(ni);
+    ci_netif_send_batch_post(ni);
+    ci_netif_unlock(ni);
+  }
+  return (rc>=0) ? i : rc;
+}
+#endif
+
 #endif
 /*! \cidoxg_end */
@@ -473,11 +473,7 @@ citp_waitable_wake_epoll3_not_in_poll(ci_netif* ni, citp_waitable* sb)
     ci_uint32 tmp, i;
 
     CI_READY_LIST_EACH(sb->ready_lists_in_use, tmp, i) {
-      struct oo_p_dllink_state link = ci_sb_epoll_ready_link(ni, epoll, i);
-      oo_p_dllink_del(ni, link);
-      oo_p_dllink_add_tail(ni,
-                           oo_p_dllink_ptr(ni, &ni->state->ready_lists[i]),
-                           link);
+      ci_netif_ready_list_put(ni, epoll, i);
 
       /* Wake the ready list too, if that's requested it. */
       if( ni->state->ready_list_flags[i] & CI_NI_READY_LIST_FLAG_WAKE )
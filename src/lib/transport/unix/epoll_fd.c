@@ -179,6 +179,44 @@ citp_ul_epoll_member_to_fdi(struct citp_epoll_member* eitem)
 }
 
 
+/* Counts [eitem] against stack [ni] in the set of stacks that we poll,
+ * taking a reference to [ni] if that adds it to the set.
+ */
+static void citp_epoll_poll_set_member_add(struct citp_epoll_fd* ep,
+                                           struct citp_epoll_member* eitem,
+                                           ci_netif* ni)
+{
+  int rc;
+
+  ci_assert(eitem->poll_stack == NULL);
+  if( ! CITP_OPTS.ul_epoll_poll_stacks )
+    return;
+  rc = citp_epoll_poll_set_add(&ep->poll_set, ni,
+                               CITP_OPTS.ul_epoll_poll_stacks);
+  if( rc < 0 )
+    return;
+  if( rc > 0 )
+    citp_netif_add_ref(ni);
+  eitem->poll_stack = ni;
+}
+
+/* Called when [eitem] leaves the epoll set.  If it was the last member in
+ * its stack, the stack is no longer polled and its reference is dropped.
+ */
+static void citp_epoll_poll_set_member_del(struct citp_epoll_fd* ep,
+                                           struct citp_epoll_member* eitem,
+                                           int fdt_locked)
+{
+  ci_netif* ni = eitem->poll_stack;
+
+  if( ni == NULL )
+    return;
+  eitem->poll_stack = NULL;
+  if( citp_epoll_poll_set_del(&ep->poll_set, ni) )
+    citp_netif_release_ref(ni, fdt_locked);
+}
+
+
 #if CI_CFG_EPOLL3
 static void
 citp_epoll_set_home_stack(struct citp_epoll_fd* ep, ci_netif* ni)
@@ -224,6 +262,7 @@ static int citp_epoll_sb_state_alloc(citp_socket* sock)
     sock->s->b.epoll = sp;
     epoll = ci_ni_aux_p2epoll(sock->netif, sp);
     epoll->sock_id = sock->s->b.bufid;
+    epoll->ring_queued = 0;
     for( i = 0; i < CI_EPOLL_SETS_PER_AUX_BUF; i++ ) {
       oo_p_dllink_init(sock->netif,
                        ci_sb_epoll_ready_link(sock->netif, epoll, i));
@@ -360,6 +399,7 @@ static void citp_remove_home_member(struct citp_epoll_fd* epoll_fd,
 
   ci_dllist_remove_safe(&eitem->dllink);
   epoll_fd->oo_stack_sockets_n--;
+  citp_epoll_poll_set_member_del(epoll_fd, eitem, fdt_locked);
 
   sock = fdi_to_socket(fd_fdi);
   ni = sock->netif;
@@ -407,6 +447,7 @@ static void citp_epoll_cleanup_dead_home_socks(struct citp_epoll_fd* ep,
      */
     ci_dllist_remove(&eitem->dllink);
     ci_dllist_remove(&eitem->dead_stack_link);
+    citp_epoll_poll_set_member_del(ep, eitem, fdt_locked);
     CI_FREE_OBJ(eitem);
     ci_assert_gt(ep->oo_stack_sockets_n, 0);
     if( --ep->oo_stack_sockets_n == 0 )
@@ -482,6 +523,7 @@ static void citp_epoll_purge_other_socks(struct citp_epoll_fd* ep)
 static void citp_epoll_dtor(citp_fdinfo* fdi, int fdt_locked)
 {
   struct citp_epoll_fd* ep = fdi_to_epoll(fdi);
+  int i;
 
 #if CI_CFG_EPOLL3
   ci_dllist_remove(&fdi_to_epoll_fdi(fdi)->dllink);
@@ -532,6 +574,9 @@ static void citp_epoll_dtor(citp_fdinfo* fdi, int fdt_locked)
   __citp_fdtable_reserve(ep->epfd_os, 0);
   if( ! fdt_locked )  CITP_FDTABLE_UNLOCK();
 
+  for( i = 0; i < ep->poll_set.n; ++i )
+    citp_netif_release_ref(ep->poll_set.stacks[i], fdt_locked);
+
 #if CI_CFG_TIMESTAMPING
   ci_free(ep->ordering_info);
   ci_free(ep->wait_events);
@@ -687,6 +732,8 @@ int citp_epoll_create(int size, int flags)
   ep->n_woda_events = 0;
 #endif
   ep->avoid_spin_once = 0;
+  memset(&ep->spin_adapt, 0, sizeof(ep->spin_adapt));
+  memset(&ep->poll_set, 0, sizeof(ep->poll_set));
   ep->closing = 0;
   ep->phase = 0;
   citp_fdtable_insert(fdi, fd, 0);
@@ -823,6 +870,7 @@ static void citp_eitem_init(struct citp_epoll_member* eitem,
   citp_eitem_reset_epollet(eitem, fd_fdi);
   eitem->fd = fd_fdi->fd;
   eitem->fdi_seq = fd_fdi->seq;
+  eitem->poll_stack = NULL;
 #if CI_CFG_EPOLL3
   eitem->ready_list_id = -1;
   ci_dllink_self_link(&eitem->dead_stack_link);
@@ -990,6 +1038,7 @@ static int citp_epoll_ctl_onload_add_new(struct citp_epoll_member** eitem_out,
     CITP_STATS_NETIF_INC(ni, epoll_add_non_home);
   }
 
+  citp_epoll_poll_set_member_add(ep, *eitem_out, ni);
   return 0;
 }
 
@@ -1020,6 +1069,8 @@ static void citp_epoll_ctl_onload_readd(struct citp_epoll_member* eitem,
 
   ci_dllist_push(&ep->oo_sockets, &eitem->dllink);
   ep->oo_sockets_n++;
+  if( citp_fdinfo_is_socket(fd_fdi) )
+    citp_epoll_poll_set_member_add(ep, eitem, fdi_to_socket(fd_fdi)->netif);
 
   if( ci_cas32_succeed(&fd_fdi->epoll_fd, -1, epoll_fd) )
     fd_fdi->epoll_fd_seq = epoll_fd_seq;
@@ -1130,6 +1181,7 @@ static int citp_epoll_ctl_onload_del(struct citp_epoll_member* eitem,
     {
       ci_dllist_remove(&eitem->dllink);
       ep->oo_sockets_n--;
+      citp_epoll_poll_set_member_del(ep, eitem, fdt_locked);
       if( eitem->epfd_event.events == EP_NOT_REGISTERED ) {
         *sync_kernel = 0;
         CI_FREE_OBJ(eitem);
@@ -1451,7 +1503,8 @@ static void citp_ul_epoll_ctl_sync_fd(int epfd, struct citp_epoll_fd* ep,
                  rc, errno));
 }
 
-static void citp_ul_epoll_ctl_sync(struct citp_epoll_fd* ep, int epfd)
+static void citp_ul_epoll_ctl_sync(struct citp_epoll_fd* ep, int epfd,
+                                   int fdt_locked)
 {
   struct citp_epoll_member* eitem;
   struct citp_epoll_member* eitem_tmp;
@@ -1489,6 +1542,7 @@ static void citp_ul_epoll_ctl_sync(struct citp_epoll_fd* ep, int epfd)
       else {
         ci_dllist_remove(&eitem->dllink);
         ep->oo_sockets_n--;
+        citp_epoll_poll_set_member_del(ep, eitem, fdt_locked);
         CI_FREE_OBJ(eitem);
       }
       if( --ep->epfd_syncs_needed == 0 )
@@ -1562,6 +1616,7 @@ static int citp_ul_epoll_one(struct oo_ul_epoll_state*__restrict__ eps,
 
     ci_dllist_remove(&eitem->dllink);
     eps->ep->oo_sockets_n--;
+    citp_epoll_poll_set_member_del(eps->ep, eitem, 0);
     CI_FREE_OBJ(eitem);
   }
 
@@ -1570,6 +1625,54 @@ static int citp_ul_epoll_one(struct oo_ul_epoll_state*__restrict__ eps,
 
 
 #if CI_CFG_EPOLL3
+/* Moves the sockets on our ready ring to [oo_stack_sockets], without the
+ * stack lock.  Returns the last one moved, if any.
+ *
+ * The ring holds socket ids, so each one is checked against the socket's
+ * current epoll state before we trust its [eitem]: the socket may have
+ * left the set (or been freed) after it was queued.  That is safe because
+ * the eitem can only be freed by us, under the epoll lock.
+ */
+static struct citp_epoll_member*
+citp_epoll_drain_ready_ring(struct oo_ul_epoll_state* __restrict__ eps)
+{
+  ci_netif* ni = eps->ep->home_stack;
+  int list = eps->ep->ready_list;
+  struct citp_epoll_member* eitem;
+  struct citp_epoll_member* last = NULL;
+  ci_sb_epoll_state* epoll;
+  citp_waitable* w;
+  oo_sp id;
+  oo_p p;
+
+  while( OO_SP_NOT_NULL(id = ci_netif_ready_ring_get(ni, list)) ) {
+    if(CI_UNLIKELY( OO_SP_TO_INT(id) >= (int) ni->state->n_ep_bufs ))
+      continue;
+    w = SP_TO_WAITABLE(ni, id);
+    p = OO_ACCESS_ONCE(w->epoll);
+    if( OO_PP_IS_NULL(p) )
+      continue;
+    epoll = ci_ni_aux_p2epoll(ni, p);
+    if( ! OO_SP_EQ(epoll->sock_id, id) )
+      continue;
+    /* Clear the flag before the caller looks at the socket's state, so
+     * that any later change queues it again. */
+    ci_atomic32_and(&epoll->ring_queued, ~(1u << list));
+    if( ! (w->ready_lists_in_use & (1 << list)) )
+      continue;
+    eitem = CI_USER_PTR_GET(epoll->e[list].eitem);
+    if( eitem == NULL || eitem->ready_list_id != list )
+      continue;
+
+    ci_dllist_remove(&eitem->dllink);
+    eitem->flags &=~ CITP_EITEM_FLAG_POLL_END;
+    ci_dllist_push_tail(&eps->ep->oo_stack_sockets, &eitem->dllink);
+    last = eitem;
+  }
+  return last;
+}
+
+
 static void citp_epoll_get_ready_list(struct oo_ul_epoll_state*
                                       __restrict__ eps)
 {
@@ -1589,6 +1692,13 @@ static void citp_epoll_get_ready_list(struct oo_ul_epoll_state*
     stack_locked = __citp_poll_if_needed(ni, eps->this_poll_frc,
                                          eps->ul_epoll_spin);
 
+  if( NI_OPTS(ni).epoll_ready_ring ) {
+    eitem = citp_epoll_drain_ready_ring(eps);
+    /* The list only holds sockets that did not fit in the ring. */
+    if( ! stack_locked && oo_p_dllink_is_empty(ni, ready_list) )
+      goto out;
+  }
+
   if( ! stack_locked )
     ci_netif_lock(ni);
   oo_p_dllink_for_each_safe(ni, lnk, tmp, ready_list) {
@@ -1610,12 +1720,13 @@ static void citp_epoll_get_ready_list(struct oo_ul_epoll_state*
     ci_dllist_push_tail(&eps->ep->oo_stack_sockets,
                         &((struct citp_epoll_member*)eitem)->dllink);
   }
+  ci_netif_unlock(ni);
+ out:
   if( eitem ) {
     /* mark that when we remove this item from ready list we shall poll
      * other as well as os fds */
     eitem->flags |= CITP_EITEM_FLAG_POLL_END;
   }
-  ci_netif_unlock(ni);
 }
 
 
@@ -1712,8 +1823,44 @@ static void citp_epoll_poll_ul_other(struct oo_ul_epoll_state* __restrict__ eps)
 }
 
 
+/* Polls the stacks that this epoll set polls itself (EF_EPOLL_POLL_STACKS),
+ * giving each its turns in order, until a round is done or the time budget
+ * is used up.  The next call carries on from where this one stopped, so
+ * that each stack gets its share over time.
+ */
+static void citp_epoll_poll_stacks(struct oo_ul_epoll_state*
+                                   __restrict__ eps)
+{
+  struct citp_epoll_poll_set* ps = &eps->ep->poll_set;
+  int weight = CITP_OPTS.ul_epoll_home_weight;
+  ci_netif* home = NULL;
+  ci_uint64 start_frc;
+  ci_netif* ni;
+  int n;
+
+#if CI_CFG_EPOLL3
+  home = eps->ep->home_stack;
+#endif
+  ci_frc64(&start_frc);
+  n = citp_epoll_poll_set_round(ps, home, weight);
+  while( n-- > 0 ) {
+    ni = citp_epoll_poll_set_next(ps, home, weight);
+    citp_poll_if_needed(ni, eps->this_poll_frc, eps->ul_epoll_spin);
+    if( n > 0 && citp.epoll_poll_budget_cycles != 0 &&
+        ci_frc64_get() - start_frc >= citp.epoll_poll_budget_cycles ) {
+      CITP_STATS_NETIF_INC(ni, epoll_poll_budget_stops);
+      break;
+    }
+  }
+}
+
+
 static void citp_epoll_poll_ul(struct oo_ul_epoll_state*__restrict__ eps)
 {
+  /* When ordering, the caller has already polled the stack it orders on. */
+  if( eps->ep->poll_set.n != 0 && eps->ordering_info == NULL )
+    citp_epoll_poll_stacks(eps);
+
 #if CI_CFG_EPOLL3
   /* First check any sockets in our home stack */
   if( eps->ep->home_stack )
@@ -1789,7 +1936,24 @@ citp_epoll_ctl_try_sync(struct citp_epoll_fd* ep, citp_fdinfo* fdi,
 {
   if( ep->epfd_syncs_needed &&
       ( ! CITP_OPTS.ul_epoll_ctl_fast || (rc == 0 && timeout_hr != 0) ) )
-    citp_ul_epoll_ctl_sync(ep, fdi->fd);
+    citp_ul_epoll_ctl_sync(ep, fdi->fd, 0);
+}
+
+
+/* Records the end of an epoll_wait() call that had to wait, for
+ * EF_SPIN_ADAPTIVE.  Statistics go to the home stack, if any.
+ *
+ * Caller must lock ep.
+ */
+static void citp_epoll_spin_adapt_done(struct citp_epoll_fd* ep,
+                                       ci_uint64 start_frc, int outcome)
+{
+  ci_netif* ni = NULL;
+#if CI_CFG_EPOLL3
+  ni = ep->home_stack;
+#endif
+  oo_spin_adapt_wait_done(ni, &ep->spin_adapt, citp.spin_cycles,
+                          ci_frc64_get() - start_frc, outcome);
 }
 
 
@@ -1805,6 +1969,9 @@ int citp_epoll_wait(citp_fdinfo* fdi, struct epoll_event*__restrict__ events,
   sigset_t sigsaved;
   int pwait_was_spinning = 0;
   int have_spin = 0;
+  /* With EF_SPIN_ADAPTIVE, how this call's wait ends if it does not end
+   * while spinning, or -1 if it has not waited. */
+  int spin_adapt_outcome = -1;
 
   ci_assert_ge(timeout_hr, 0);
   ci_assert_le(timeout_hr, OO_EPOLL_MAX_TIMEOUT_FRC);
@@ -1840,7 +2007,7 @@ int citp_epoll_wait(citp_fdinfo* fdi, struct epoll_event*__restrict__ events,
       maxevents <= 0 || events == NULL ) {
     /* No accelerated fds or invalid parameters). */
     if( ep->epfd_syncs_needed )
-      citp_ul_epoll_ctl_sync(ep, fdi->fd);
+      citp_ul_epoll_ctl_sync(ep, fdi->fd, 0);
     CITP_EPOLL_EP_UNLOCK(ep, 0);
     citp_exit_lib(lib_context, FALSE);
     Log_VPOLL(ci_log("%s(%d, ..): passthrough", __FUNCTION__, fdi->fd));
@@ -2032,6 +2199,13 @@ no_events:
   }
 
   /* Blocking.  Shall we spin? */
+  if( CITP_OPTS.ul_spin_adaptive && eps.ul_epoll_spin && ! have_spin ) {
+    spin_adapt_outcome = OO_SPIN_ADAPT_MISS;
+    if( ! oo_spin_adapt_should_spin(&ep->spin_adapt, citp.spin_cycles) ) {
+      eps.ul_epoll_spin = 0;
+      spin_adapt_outcome = OO_SPIN_ADAPT_SKIP;
+    }
+  }
   if( KEEP_POLLING(eps.ul_epoll_spin, eps.this_poll_frc, base_poll_start_frc) ) {
     if( !pwait_was_spinning && sigmask != NULL) {
       if( ep->avoid_spin_once ) {
@@ -2111,6 +2285,12 @@ no_events:
   }
 
  unlock_release_exit_ret:
+  if( spin_adapt_outcome >= 0 && rc > 0 ) {
+    /* Found events while spinning. */
+    citp_epoll_spin_adapt_done(ep, base_poll_start_frc, OO_SPIN_ADAPT_HIT);
+    spin_adapt_outcome = -1;
+  }
+
   /* Synchronise state to kernel (if necessary) and block. */
   citp_epoll_ctl_try_sync(ep, fdi, timeout_hr, rc);
 
@@ -2215,6 +2395,14 @@ no_events:
     }
   }
 
+  if( spin_adapt_outcome >= 0 && rc >= 0 ) {
+    citp_reenter_lib(lib_context);
+    CITP_EPOLL_EP_LOCK(ep);
+    citp_epoll_spin_adapt_done(ep, base_poll_start_frc, spin_adapt_outcome);
+    CITP_EPOLL_EP_UNLOCK(ep, 0);
+    citp_exit_lib(lib_context, FALSE);
+  }
+
   if( rc && ordering ) {
     ordering->poll_again = 1;
     citp_epoll_find_timeout(&timeout_hr, &poll_start_frc);
@@ -2345,6 +2533,7 @@ static void citp_epoll_on_handover_do(citp_fdinfo* epoll_fdi,
   {
     ep->oo_sockets_n--;
     ci_dllist_remove(&eitem->dllink);
+    citp_epoll_poll_set_member_del(ep, eitem, fdt_locked);
   }
 
   if( fd_fdi->protocol->type == CITP_PASSTHROUGH_FD )
@@ -2362,7 +2551,7 @@ static void citp_epoll_on_handover_do(citp_fdinfo* epoll_fdi,
   CI_FREE_OBJ(eitem);
 
   if( ep->epfd_syncs_needed )
-    citp_ul_epoll_ctl_sync(ep, epoll_fdi->fd);
+    citp_ul_epoll_ctl_sync(ep, epoll_fdi->fd, fdt_locked);
 
   /* Now we can free fd_fdi */
   citp_fdinfo_free(fd_fdi);
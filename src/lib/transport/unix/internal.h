@@ -62,6 +62,7 @@ typedef struct {
   ci_uint64             poll_fast_cycles;
   ci_uint64             select_nonblock_fast_cycles;
   ci_uint64             select_fast_cycles;
+  ci_uint64             epoll_poll_budget_cycles;
   ci_uint64             epoll_frc_to_ns_magic;
   ci_uint32             cpu_khz;
 
@@ -1126,6 +1127,22 @@ ci_inline ci_uint64 citp_usec_to_cycles64(unsigned usec)
 
 extern int citp_sock_is_spinning(citp_fdinfo* fdi);
 
+/**********************************************************************
+ * io_uring
+ */
+
+#if CI_CFG_USERSPACE_SYSCALL
+struct io_uring_params;
+extern long citp_uring_setup(unsigned entries,
+                             struct io_uring_params* p) CI_HF;
+extern long citp_uring_enter(int fd, unsigned to_submit,
+                             unsigned min_complete, unsigned flags,
+                             void* argp, size_t argsz) CI_HF;
+/* Called on close() of any fd to tear down ring state, or to cancel
+ * operations pending against a socket. */
+extern void citp_uring_close(int fd) CI_HF;
+#endif
+
 /**********************************************************************
  * Utils
  */
@@ -43,6 +43,7 @@ LIB_SRCS	:=			\
 		wqlock.c		\
 		poll_select.c		\
 		passthrough_fd.c	\
+		uring.c			\
 		utils.c
 
 MMAKE_OBJ_PREFIX := ci_tp_unix_
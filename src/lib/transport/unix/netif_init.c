@@ -98,6 +98,7 @@ static void citp_netif_pre_fork_hook(void)
     citp_netif_cache_warn_on_fork();
 #endif
 
+  oo_pkt_magazine_pre_fork();
   oo_rwlock_lock_write(&citp_dup2_lock);
   pthread_mutex_lock(&citp_pkt_map_lock);
 
@@ -131,6 +132,8 @@ static void citp_netif_parent_fork_hook(void)
   Log_CALL(ci_log("%s()", __FUNCTION__));
   pthread_mutex_unlock(&citp_pkt_map_lock);
   oo_rwlock_unlock_write(&citp_dup2_lock);
+  if( citp.init_level >= CITP_INIT_FDTABLE )
+    oo_pkt_magazine_parent_fork();
 
   if( citp.init_level < CITP_INIT_FDTABLE)
     goto unlock_fork;
@@ -178,6 +181,10 @@ static void citp_netif_child_fork_hook(void)
   oo_rwlock_ctor(&citp_ul_lock);
   oo_rwlock_ctor(&citp_dup2_lock);
   pthread_mutex_init(&citp_pkt_map_lock, NULL);
+  oo_pkt_magazine_child_fork();
+  /* The parent's threads own their claims on accept shards. */
+  oo_per_thread_get()->tid = 0;
+  oo_per_thread_get()->n_accept_shards = 0;
 
   if( citp.init_level < CITP_INIT_FDTABLE)
     return;
@@ -291,6 +298,7 @@ void  citp_netif_ctor_hook(ci_netif* ni, int realloc)
 /* Platform specific code, called proir to netif destruction */
 void  citp_netif_free_hook(ci_netif* ni)
 {
+  oo_pkt_magazine_forget_stack(ni);
 #if CI_CFG_FD_CACHING
   citp_uncache_fds_ul(ni);
 #endif
@@ -1844,6 +1844,9 @@ OO_INTERCEPT(int, close,
   citp_enter_lib(&lib_context);
   Log_CALL(ci_log("%s(%d)", __FUNCTION__, fd));
 
+#if CI_CFG_USERSPACE_SYSCALL
+  citp_uring_close(fd);
+#endif
   rc = citp_ep_close(fd);
 
   citp_exit_lib(&lib_context, rc == 0);
@@ -2795,6 +2798,15 @@ OO_INTERCEPT(long, syscall,
 #if CI_LIBC_HAS_epoll_pwait2
     NR(epoll_pwait2)
 #endif /* CI_LIBC_HAS_epoll_pwait2 */
+#ifdef __NR_io_uring_setup
+    /* There are no libc wrappers for these.  Only callers that use libc's
+     * syscall() get here: liburing normally issues raw system calls and so
+     * bypasses us, unless it was built to go through libc. */
+    case __NR_io_uring_setup:
+      return citp_uring_setup(a, (void*) b);
+    case __NR_io_uring_enter:
+      return citp_uring_enter(a, b, c, d, (void*) e, f);
+#endif
     /* When adding new syscalls here, make sure to check that the libc API
     matches the kernel API. It does for almost everything (on x86-64) but
     there are a few exceptions.  */
@@ -149,6 +149,7 @@ static void citp_dump_opts(citp_opts_t *o)
   DUMP_OPT_INT("EF_UL_POLL",		ul_poll);
   DUMP_OPT_INT("EF_POLL_SPIN",		ul_poll_spin);
   DUMP_OPT_INT("EF_POLL_FAST",		ul_poll_fast);
+  DUMP_OPT_INT("EF_URING",		ul_uring);
   DUMP_OPT_INT("EF_POLL_FAST_USEC",	ul_poll_fast_usec);
   DUMP_OPT_INT("EF_POLL_NONBLOCK_FAST_USEC", ul_poll_nonblock_fast_usec);
   DUMP_OPT_INT("EF_SELECT_FAST_USEC",	ul_select_fast_usec);
@@ -171,9 +172,13 @@ static void citp_dump_opts(citp_opts_t *o)
   DUMP_OPT_INT("EF_EPOLL_CTL_FAST",     ul_epoll_ctl_fast);
   DUMP_OPT_INT("EF_EPOLL_CTL_HANDOFF",  ul_epoll_ctl_handoff);
   DUMP_OPT_INT("EF_EPOLL_MT_SAFE",      ul_epoll_mt_safe);
+  DUMP_OPT_INT("EF_EPOLL_POLL_STACKS",  ul_epoll_poll_stacks);
+  DUMP_OPT_INT("EF_EPOLL_HOME_WEIGHT",  ul_epoll_home_weight);
+  DUMP_OPT_INT("EF_EPOLL_POLL_BUDGET_USEC", ul_epoll_poll_budget_usec);
   DUMP_OPT_INT("EF_FDTABLE_SIZE",	fdtable_size);
   DUMP_OPT_INT("EF_SPIN_USEC",		ul_spin_usec);
   DUMP_OPT_INT("EF_SLEEP_SPIN_USEC",	sleep_spin_usec);
+  DUMP_OPT_INT("EF_SPIN_ADAPTIVE",	ul_spin_adaptive);
   DUMP_OPT_INT("EF_STACK_PER_THREAD",	stack_per_thread);
   DUMP_OPT_INT("EF_DONT_ACCELERATE",	dont_accelerate);
   DUMP_OPT_INT("EF_FDTABLE_STRICT",	fdtable_strict);
@@ -411,6 +416,7 @@ static void citp_opts_getenv(citp_opts_t* opts)
   GET_ENV_OPT_INT("EF_UL_POLL",		ul_poll);
   GET_ENV_OPT_INT("EF_POLL_SPIN",	ul_poll_spin);
   GET_ENV_OPT_INT("EF_POLL_FAST",	ul_poll_fast);
+  GET_ENV_OPT_INT("EF_URING",		ul_uring);
   GET_ENV_OPT_INT("EF_POLL_FAST_USEC",  ul_poll_fast_usec);
   GET_ENV_OPT_INT("EF_POLL_NONBLOCK_FAST_USEC", ul_poll_nonblock_fast_usec);
   GET_ENV_OPT_INT("EF_SELECT_FAST_USEC",  ul_select_fast_usec);
@@ -433,10 +439,14 @@ static void citp_opts_getenv(citp_opts_t* opts)
   GET_ENV_OPT_INT("EF_EPOLL_CTL_FAST",  ul_epoll_ctl_fast);
   GET_ENV_OPT_INT("EF_EPOLL_CTL_HANDOFF",ul_epoll_ctl_handoff);
   GET_ENV_OPT_INT("EF_EPOLL_MT_SAFE",   ul_epoll_mt_safe);
+  GET_ENV_OPT_INT("EF_EPOLL_POLL_STACKS", ul_epoll_poll_stacks);
+  GET_ENV_OPT_INT("EF_EPOLL_HOME_WEIGHT", ul_epoll_home_weight);
+  GET_ENV_OPT_INT("EF_EPOLL_POLL_BUDGET_USEC", ul_epoll_poll_budget_usec);
   GET_ENV_OPT_INT("EF_WODA_SINGLE_INTERFACE", woda_single_if);
   GET_ENV_OPT_INT("EF_FDTABLE_SIZE",	fdtable_size);
   GET_ENV_OPT_INT("EF_SPIN_USEC",	ul_spin_usec);
   GET_ENV_OPT_INT("EF_SLEEP_SPIN_USEC",	sleep_spin_usec);
+  GET_ENV_OPT_INT("EF_SPIN_ADAPTIVE",	ul_spin_adaptive);
   GET_ENV_OPT_INT("EF_STACK_PER_THREAD",stack_per_thread);
   GET_ENV_OPT_INT("EF_DONT_ACCELERATE",	dont_accelerate);
   GET_ENV_OPT_INT("EF_FDTABLE_STRICT",	fdtable_strict);
@@ -602,6 +612,8 @@ citp_transport_init(void)
     citp_usec_to_cycles64(CITP_OPTS.ul_select_nonblock_fast_usec);
   citp.select_fast_cycles = 
     citp_usec_to_cycles64(CITP_OPTS.ul_select_fast_usec);
+  citp.epoll_poll_budget_cycles =
+    citp_usec_to_cycles64(CITP_OPTS.ul_epoll_poll_budget_usec);
   ci_tp_init(__oo_per_thread_init_thread, oo_signal_terminate);
 
   citp_update_and_crosscheck(&ci_cfg_opts.netif_opts, &CITP_OPTS);
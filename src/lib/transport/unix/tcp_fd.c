@@ -19,6 +19,7 @@
 #include "ul_poll.h"
 #include "ul_select.h"
 #include <netinet/in.h>
+#include <sys/syscall.h>
 #include <ci/internal/transport_config_opt.h>
 #include <ci/internal/transport_common.h>
 #include <ci/internal/ip.h>
@@ -746,35 +747,172 @@ fail:
 #endif
 
 
+#if CI_CFG_TCP_ACCEPT_SHARDS
+static pthread_key_t citp_accept_shards_key;
+static pthread_once_t citp_accept_shards_once = PTHREAD_ONCE_INIT;
+
+
+/* Called at thread exit: give up the shards this thread claimed, so that
+ * no more connections are steered to them.
+ */
+static void citp_tcp_accept_shards_release(void* arg)
+{
+  struct oo_per_thread* pt = arg;
+  struct oo_accept_shard_claim* c;
+  ci_tcp_socket_listen* tls;
+  ci_sock_cmn* s;
+  ci_netif* ni;
+  int i;
+
+  CITP_FDTABLE_LOCK();
+  for( i = 0; i < pt->n_accept_shards; ++i ) {
+    c = &pt->accept_shards[i];
+    /* The stack or the listener may have gone since we claimed. */
+    ni = citp_find_ul_netif(c->stack_id, 1);
+    if( ni == NULL || ! IS_VALID_SOCK_ID(ni, c->listener_id) )
+      continue;
+    s = ID_TO_SOCK(ni, c->listener_id);
+    if( s->b.state != CI_TCP_LISTEN )
+      continue;
+    tls = SOCK_TO_TCP_LISTEN(s);
+    ci_cas32u_succeed(&tls->acceptq_shards[c->shard].owner, pt->tid, 0);
+  }
+  pt->n_accept_shards = 0;
+  CITP_FDTABLE_UNLOCK();
+}
+
+
+static void citp_tcp_accept_shards_key_init(void)
+{
+  CI_TRY(pthread_key_create(&citp_accept_shards_key,
+                            citp_tcp_accept_shards_release));
+}
+
+
+/* Claim a free shard of [tls] for the calling thread.  Returns the shard,
+ * or -1 if none is free or the thread can't record any more claims.
+ */
+static int citp_tcp_accept_shard_claim(ci_netif* ni,
+                                       ci_tcp_socket_listen* tls,
+                                       struct oo_per_thread* pt)
+{
+  struct oo_accept_shard_claim* c;
+  int i;
+
+  if( pt->n_accept_shards == OO_PER_THREAD_ACCEPT_SHARDS )
+    return -1;
+  for( i = 0; i < NI_OPTS(ni).tcp_accept_shards; ++i )
+    if( tls->acceptq_shards[i].owner == 0 &&
+        ci_cas32u_succeed(&tls->acceptq_shards[i].owner, 0, pt->tid) )
+      break;
+  if( i == NI_OPTS(ni).tcp_accept_shards )
+    return -1;
+
+  c = &pt->accept_shards[pt->n_accept_shards++];
+  c->stack_id = NI_ID(ni);
+  c->listener_id = S_ID(tls);
+  c->shard = i;
+  pthread_once(&citp_accept_shards_once, citp_tcp_accept_shards_key_init);
+  pthread_setspecific(citp_accept_shards_key, pt);
+  return i;
+}
+
+
+/* Take a connection from the calling thread's accept shard, claiming a
+ * shard first if it has none, or failing that from another thread's.
+ * Returns NULL if the shards are empty, and otherwise the shard that the
+ * connection came from in [shard_out].
+ */
+static citp_waitable* citp_tcp_accept_shard_get(ci_netif* ni,
+                                                ci_tcp_socket_listen* tls,
+                                                int* shard_out)
+{
+  struct oo_per_thread* pt = oo_per_thread_get();
+  int n_shards = NI_OPTS(ni).tcp_accept_shards;
+  int i, j, own = -1;
+  citp_waitable* w;
+
+  if( pt->tid == 0 )
+    pt->tid = syscall(SYS_gettid);
+
+  for( i = 0; i < n_shards && own < 0; ++i )
+    if( tls->acceptq_shards[i].owner == pt->tid )
+      own = i;
+  if( own < 0 )
+    own = citp_tcp_accept_shard_claim(ni, tls, pt);
+
+  while( 1 ) {
+    if( own >= 0 &&
+        (w = ci_tcp_acceptq_shard_try_get(ni, tls,
+                                          &tls->acceptq_shards[own])) ) {
+      CITP_STATS_NETIF_INC(ni, accept_shard_own);
+      *shard_out = own;
+      return w;
+    }
+
+    /* Our own shard is empty, so help with the others.  This also picks
+     * up connections left on the shard of a thread that has stopped
+     * accepting.
+     */
+    for( i = 1; i <= n_shards; ++i ) {
+      j = (own + i + n_shards) % n_shards;
+      if( j != own &&
+          (w = ci_tcp_acceptq_shard_try_get(ni, tls,
+                                            &tls->acceptq_shards[j])) ) {
+        CITP_STATS_NETIF_INC(ni, accept_shard_steals);
+        *shard_out = j;
+        return w;
+      }
+    }
+
+    /* A shard is skipped while another thread is taking from it, which
+     * only takes a moment.  Don't give up while any hold connections, as
+     * [acceptq_n] counts them and the caller would find nothing to wait
+     * for.
+     */
+    if( ! ci_tcp_acceptq_shards_not_empty(ni, tls) )
+      return NULL;
+    ci_spinloop_pause();
+  }
+}
+#endif
+
+
+/* Accept [w], taken from accept shard [shard], or if it is NULL pop a
+ * connection off the listener's accept queue.  The socket lock must be
+ * held if and only if [w] is NULL.
+ */
 static int citp_tcp_accept_ul(citp_fdinfo* fdinfo, ci_netif* ni,
 			      ci_tcp_socket_listen* listener,
 			      struct sockaddr* sa, socklen_t* p_sa_len,
-                              int flags)
+                              int flags, citp_waitable* w, int shard)
 {
   citp_sock_fdi* newepi;
   citp_fdinfo* newfdi;
   ci_tcp_state* ts;
-  citp_waitable* w;
   int newfd;
 #if CI_CFG_FD_CACHING
   int from_cache;
 #endif
-  int unlocked = 0;
+  int unlocked = w != NULL;
 
   Log_VSS(ci_log(LPF "accept(%d:%d, sa, %d)", fdinfo->fd,
                  S_FMT(listener), p_sa_len ? *p_sa_len : -1));
 #if CI_CFG_FD_CACHING
 redo:
 #endif
-  /* Pop the socket off the accept queue. */
-  ci_assert(ci_sock_is_locked(ni, &listener->s.b));
-  ci_assert(ci_tcp_acceptq_not_empty(listener));
-  w = ci_tcp_acceptq_get(ni, listener);
+  if( w == NULL ) {
+    /* Pop the socket off the accept queue. */
+    ci_assert(ci_sock_is_locked(ni, &listener->s.b));
+    ci_assert(ci_tcp_acceptq_not_empty(listener));
+    w = ci_tcp_acceptq_get(ni, listener);
+  }
 
 #if CI_CFG_ENDPOINT_MOVE
   if( w->sb_aflags & CI_SB_AFLAG_MOVED_AWAY ) {
     int rc;
-    ci_sock_unlock(ni, &listener->s.b);
+    if( ! unlocked )
+      ci_sock_unlock(ni, &listener->s.b);
     rc = citp_tcp_accept_alien(ni, listener, sa, p_sa_len, flags, w);
     if( rc != CI_ACCEPT_FAKED_UP )
       return rc;
@@ -797,11 +935,14 @@ redo:
   from_cache = ci_tcp_is_cached(ts);
   if( from_cache ) {
     /* We need a listening socket lock to remove from the epcache list.
-     * But faked-up loopback connection can't be cached, so we are safe
-     * here. */
-    ci_assert(! unlocked);
+     * But faked-up loopback connection can't be cached, so we only get
+     * here unlocked if [ts] came from an accept shard. */
+    if( unlocked )
+      ci_sock_lock(ni, &listener->s.b);
     oo_p_dllink_del_init(ni, oo_p_dllink_sb(ni, &ts->s.b,
                                             &ts->epcache_fd_link));
+    if( unlocked )
+      ci_sock_unlock(ni, &listener->s.b);
   }
 #endif
   if( ! unlocked )
@@ -816,13 +957,30 @@ redo:
     ci_assert(ts->s.b.sb_aflags & CI_SB_AFLAG_TCP_IN_ACCEPTQ);
 #if CI_CFG_FD_CACHING
     if( newfd == -ENOANO ) {
+      CITP_STATS_NETIF_INC(ni, accept_attach_fd_retry);
+#if CI_CFG_TCP_ACCEPT_SHARDS
+      if( shard >= 0 ) {
+        /* Hang on to [ts] rather than give it to another shard's owner. */
+        ci_sock_unlock(ni, &listener->s.b);
+        sched_yield();
+        goto redo;
+      }
+#endif
       Log_EP(ci_log("%s: [%d:%d]. puttint accepted socket back on acceptq",
              __FUNCTION__, NI_ID(ni), S_SP(ts)));
       ci_tcp_acceptq_put_back_tail(ni, listener, &ts->s.b);
-      CITP_STATS_NETIF_INC(ni, accept_attach_fd_retry);
       sched_yield();
+      w = NULL;
+      unlocked = 0;
       goto redo;
     } else
+#endif
+#if CI_CFG_TCP_ACCEPT_SHARDS
+    if( shard >= 0 )
+      ci_tcp_acceptq_shard_put_back(ni, listener,
+                                    &listener->acceptq_shards[shard],
+                                    &ts->s.b);
+    else
 #endif
       ci_tcp_acceptq_put_back(ni, listener, &ts->s.b);
     CITP_STATS_TCP_LISTEN(++listener->stats.n_accept_no_fd);
@@ -922,6 +1080,14 @@ check_ul_accept_q:
   }
 
   if( ci_tcp_acceptq_n(listener) ) {
+#if CI_CFG_TCP_ACCEPT_SHARDS
+      citp_waitable* w;
+      int shard;
+      if( NI_OPTS(ni).tcp_accept_shards && (p_sa_len != NULL || sa == NULL) &&
+          (w = citp_tcp_accept_shard_get(ni, listener, &shard)) != NULL )
+        return citp_tcp_accept_ul(fdinfo, ni, listener, sa, p_sa_len, flags,
+                                  w, shard);
+#endif
       ci_sock_lock(ni, &listener->s.b);
       if( ci_tcp_acceptq_not_empty(listener) ) {
           /* delayed error report (after a connect came) */
@@ -930,7 +1096,8 @@ check_ul_accept_q:
               CI_SET_ERROR(rc, EFAULT);
               return rc;
           }
-          return citp_tcp_accept_ul(fdinfo, ni, listener, sa, p_sa_len, flags);
+          return citp_tcp_accept_ul(fdinfo, ni, listener, sa, p_sa_len, flags,
+                                    NULL, -1);
       }
       ci_sock_unlock(ni, &listener->s.b);
   }
@@ -1749,6 +1916,54 @@ static int citp_tcp_sendmmsg(citp_fdinfo* fdinfo, struct mmsghdr* msg,
   return -1;
 }
 
+#ifndef MSG_FASTOPEN
+# define MSG_FASTOPEN 0x20000000
+#endif
+
+/* sendto(MSG_FASTOPEN) on an unconnected socket: connect, putting the data
+ * in the SYN if we have a TCP Fast Open cookie for the peer.  Connections
+ * that Onload would hand over or move to another stack fail with
+ * EOPNOTSUPP or EINPROGRESS respectively, leaving the data unsent; this is
+ * what Linux reports when it can't use TCP Fast Open.
+ */
+static int citp_tcp_send_fastopen(citp_sock_fdi* epi, int fd,
+                                  const struct msghdr* msg, int flags)
+{
+  ci_netif* ni = epi->sock.netif;
+  ci_tcp_state* ts = SOCK_TO_TCP(epi->sock.s);
+  int rc, moved = 0;
+
+  if( ! (NI_OPTS(ni).tcp_fastopen & EF_TCP_FASTOPEN_CLIENT) ||
+      NI_OPTS(ni).tcp_connect_handover )
+    RET_WITH_ERRNO(EOPNOTSUPP);
+
+  ci_netif_lock(ni);
+  ts->tcpflags |= CI_TCPT_FLAG_FASTOPEN;
+  ci_netif_unlock(ni);
+
+  rc = ci_tcp_connect(&epi->sock, msg->msg_name, msg->msg_namelen, fd,
+                      &moved);
+  if( moved ) {
+    Log_V(ci_log(LPF "send(%d, MSG_FASTOPEN): connection moved", fd));
+    RET_WITH_ERRNO(EINPROGRESS);
+  }
+  if( tcp_rc_means_handover(rc) ) {
+    ci_netif_lock(ni);
+    ts->tcpflags &=~ CI_TCPT_FLAG_FASTOPEN;
+    ci_netif_unlock(ni);
+    RET_WITH_ERRNO(EOPNOTSUPP);
+  }
+  if( rc != 0 )
+    /* EINPROGRESS: the SYN has gone with a cookie request */
+    return rc;
+
+  /* Either connect() was deferred and this send carries the SYN, or a
+   * blocking connect() has completed without TCP Fast Open. */
+  return ci_tcp_sendmsg(ni, ts, msg->msg_iov, msg->msg_iovlen,
+                        flags & ~MSG_FASTOPEN);
+}
+
+
 static int citp_tcp_send(citp_fdinfo* fdinfo, const struct msghdr* msg,
                          int flags)
 {
@@ -1774,8 +1989,12 @@ static int citp_tcp_send(citp_fdinfo* fdinfo, const struct msghdr* msg,
     /* Process CI_TCP_CLOSED without entering ci_tcp_sendmsg() because TCP state
      * can be changed under our feet and we do not want to meet CI_TCP_LISTEN
      * state inside ci_tcp_sendmsg(). */
-    if( CI_UNLIKELY(state == CI_TCP_CLOSED || state == CI_TCP_LISTEN ||
-                    state == CI_TCP_INVALID) ) {
+    if( CI_UNLIKELY(state == CI_TCP_CLOSED && (flags & MSG_FASTOPEN) &&
+                    msg->msg_name != NULL) ) {
+      rc = citp_tcp_send_fastopen(epi, fdinfo->fd, msg, flags);
+    }
+    else if( CI_UNLIKELY(state == CI_TCP_CLOSED || state == CI_TCP_LISTEN ||
+                         state == CI_TCP_INVALID) ) {
       if( CI_UNLIKELY(flags & ONLOAD_MSG_WARM) )
         ++SOCK_TO_TCP(epi->sock.s)->stats.tx_msg_warm_abort;
       if( (rc = ci_get_so_error(epi->sock.s)) != 0 )
@@ -1857,12 +2076,12 @@ static int citp_tcp_select(citp_fdinfo* fdi, int* n, int rd, int wr, int ex,
   if( (s->b.state & CI_TCP_STATE_SYNCHRONISED) && s->tx_errno == 0 ) {
     ci_tcp_state* ts = SOCK_TO_TCP(s);
     if( rd && ( ci_tcp_recv_not_blocked(ts)
-                || ci_tcp_poll_timestamp_q_nonempty(ni, ts) ) ) {
+                || ci_tcp_poll_errqueue_nonempty(ni, ts) ) ) {
         FD_SET(fdi->fd, ss->rdu);
         ++*n;
     }
     if( wr && ( ci_tcp_tx_advertise_space(ni, ts)
-                || ci_tcp_poll_timestamp_q_nonempty(ni, ts) ) ) {
+                || ci_tcp_poll_errqueue_nonempty(ni, ts) ) ) {
         FD_SET(fdi->fd, ss->wru);
         ++*n;
     }
@@ -113,6 +113,7 @@ struct citp_epoll_member {
   struct epoll_event    epfd_event; /*!< event synchronised to kernel */
   ci_uint64             fdi_seq;    /*!< fdi->seq */
   int                   fd;         /*!< Onload fd */
+  ci_netif*             poll_stack; /*!< Counted in poll_set, or NULL */
   ci_sleep_seq_t        reported_sleep_seq;
 
   int                   flags;
@@ -132,6 +133,102 @@ enum {
 
 #define EPOLL_STACK_EITEM 1
 #define EPOLL_NON_STACK_EITEM 2
+
+/* Stacks that an epoll set polls itself, with EF_EPOLL_POLL_STACKS.  They
+ * are polled in weighted round-robin order: the home stack gets
+ * [home_weight] turns in a row, and each other stack one.  A stack stays in
+ * the set while it has members in the epoll set.
+ */
+#define CITP_EPOLL_MAX_POLL_STACKS 8
+struct citp_epoll_poll_set {
+  ci_netif*             stacks[CITP_EPOLL_MAX_POLL_STACKS];
+  /* Number of members of the epoll set in each stack. */
+  int                   n_members[CITP_EPOLL_MAX_POLL_STACKS];
+  int                   n;
+  /* Index of the stack whose turn it is, and turns it has left. */
+  int                   next;
+  int                   credit;
+};
+
+/* Counts a member in [ni], adding [ni] to the set unless it is there
+ * already.  Returns 1 if [ni] was added, 0 if it was already present and
+ * -1, without counting the member, if the set holds [max] stacks.
+ */
+static inline int citp_epoll_poll_set_add(struct citp_epoll_poll_set* ps,
+                                          ci_netif* ni, int max)
+{
+  int i;
+
+  for( i = 0; i < ps->n; ++i )
+    if( ps->stacks[i] == ni ) {
+      ++ps->n_members[i];
+      return 0;
+    }
+  if( ps->n >= CI_MIN(max, CITP_EPOLL_MAX_POLL_STACKS) )
+    return -1;
+  ps->stacks[ps->n] = ni;
+  ps->n_members[ps->n++] = 1;
+  return 1;
+}
+
+/* Uncounts a member in [ni].  Returns 1 if it was the last one, in which
+ * case [ni] has been removed from the set, and 0 otherwise.
+ */
+static inline int citp_epoll_poll_set_del(struct citp_epoll_poll_set* ps,
+                                          ci_netif* ni)
+{
+  int i, j;
+
+  for( i = 0; i < ps->n; ++i )
+    if( ps->stacks[i] == ni )
+      break;
+  ci_assert_lt(i, ps->n);
+  ci_assert_gt(ps->n_members[i], 0);
+  if( --ps->n_members[i] != 0 )
+    return 0;
+
+  /* Close the gap, keeping the order of the others. */
+  for( j = i + 1; j < ps->n; ++j ) {
+    ps->stacks[j - 1] = ps->stacks[j];
+    ps->n_members[j - 1] = ps->n_members[j];
+  }
+  --ps->n;
+  if( i < ps->next )
+    --ps->next;
+  else if( i == ps->next )
+    ps->credit = 0;
+  if( ps->next >= ps->n )
+    ps->next = 0;
+  return 1;
+}
+
+/* Returns the stack to poll next, and uses up one of its turns. */
+static inline ci_netif*
+citp_epoll_poll_set_next(struct citp_epoll_poll_set* ps, ci_netif* home,
+                         int home_weight)
+{
+  ci_netif* ni;
+
+  ci_assert_gt(ps->n, 0);
+  ni = ps->stacks[ps->next];
+  if( ps->credit <= 0 )
+    ps->credit = ni == home ? home_weight : 1;
+  if( --ps->credit == 0 && ++ps->next >= ps->n )
+    ps->next = 0;
+  return ni;
+}
+
+/* Number of turns in one round over the set. */
+static inline int
+citp_epoll_poll_set_round(struct citp_epoll_poll_set* ps, ci_netif* home,
+                          int home_weight)
+{
+  int i, n = 0;
+
+  for( i = 0; i < ps->n; ++i )
+    n += ps->stacks[i] == home ? home_weight : 1;
+  return n;
+}
 /*! Data associated with each epoll epfd.  */
 struct citp_epoll_fd {
   /* epoll_create() parameter */
@@ -185,6 +282,13 @@ struct citp_epoll_fd {
   /* Avoid spinning in next epoll_pwait call */
   int avoid_spin_once;
 
+  /* Recent waits of epoll_wait() calls, for EF_SPIN_ADAPTIVE */
+  struct oo_spin_adapt spin_adapt;
+
+  /* Stacks polled by epoll_wait(), for EF_EPOLL_POLL_STACKS.  The set
+   * holds a reference to each of them. */
+  struct citp_epoll_poll_set poll_set;
+
   /* We've entered the citp_epoll_dtor() function */
   int closing;
 
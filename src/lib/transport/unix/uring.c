@@ -0,0 +1,785 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/**************************************************************************\
+*//*! \file
+**  \brief  Acceleration of io_uring submissions on Onload sockets
+**
+** io_uring_enter() hands SQEs straight to the kernel, which services them
+** on the O/S socket behind an Onload fd and so never sees accelerated
+** traffic.  We intercept io_uring_setup() and io_uring_enter() and, for
+** rings we are able to track, service SEND, RECV, ACCEPT and single-shot
+** POLL_ADD SQEs that target Onload sockets directly from the stack.
+**
+** libc has no wrappers for these calls, so we only see them when they are
+** made through libc's syscall().  A stock liburing issues them as raw
+** system calls and bypasses us entirely; it has to be built with
+** --use-libc for its rings to be accelerated.  See EF_URING.
+**
+** A serviced SQE is rewritten in place as a NOP with
+** IOSQE_CQE_SKIP_SUCCESS so the kernel still consumes it without posting
+** anything, and the real completion is delivered into the application's CQ
+** with IORING_OP_MSG_RING from a small private ring.  This keeps the CQ
+** single-producer (the kernel) so no user-level CQ locking is needed.
+**
+** Operations that cannot complete immediately are parked on a per-ring
+** pending list and progressed on subsequent io_uring_enter() calls, and
+** while waiting for completions on behalf of the application.
+*//*
+\**************************************************************************/
+
+#include "internal.h"
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <limits.h>
+
+#if CI_CFG_USERSPACE_SYSCALL && defined(__NR_io_uring_setup)
+# include <linux/io_uring.h>
+#endif
+
+#if CI_CFG_USERSPACE_SYSCALL && defined(IORING_FEAT_CQE_SKIP)
+
+#define CITP_URING_MAX_RINGS     16
+#define CITP_URING_PRIV_ENTRIES  32
+
+/* SQE flags that stop us servicing a request ourselves. */
+#define CITP_URING_SQE_BAD_FLAGS                                    \
+  (IOSQE_FIXED_FILE | IOSQE_IO_DRAIN | IOSQE_IO_LINK |              \
+   IOSQE_IO_HARDLINK | IOSQE_BUFFER_SELECT | IOSQE_CQE_SKIP_SUCCESS)
+
+#define CITP_URING_SETUP_BAD_FLAGS                                  \
+  (IORING_SETUP_IOPOLL | IORING_SETUP_SQPOLL | IORING_SETUP_SQE128 | \
+   IORING_SETUP_CQE32 | CITP_URING_SETUP_DEFER_TASKRUN |              \
+   CITP_URING_SETUP_NO_SQARRAY)
+
+/* With DEFER_TASKRUN, MSG_RING completions only appear when the owning
+ * task waits in the kernel, which defeats our own waiting. */
+#ifdef IORING_SETUP_DEFER_TASKRUN
+# define CITP_URING_SETUP_DEFER_TASKRUN  IORING_SETUP_DEFER_TASKRUN
+#else
+# define CITP_URING_SETUP_DEFER_TASKRUN  0
+#endif
+#ifdef IORING_SETUP_NO_SQARRAY
+# define CITP_URING_SETUP_NO_SQARRAY  IORING_SETUP_NO_SQARRAY
+#else
+# define CITP_URING_SETUP_NO_SQARRAY  0
+#endif
+
+
+struct citp_uring_map {
+  void*                 sq_ring;
+  size_t                sq_ring_len;
+  void*                 cq_ring;
+  size_t                cq_ring_len;
+  struct io_uring_sqe*  sqes;
+  size_t                sqes_len;
+  unsigned*             sq_head;
+  unsigned*             sq_tail;
+  unsigned*             sq_array;
+  unsigned              sq_mask;
+  unsigned              sq_entries;
+  unsigned*             cq_head;
+  unsigned*             cq_tail;
+  unsigned              cq_mask;
+  struct io_uring_cqe*  cqes;
+};
+
+
+struct citp_uring_op {
+  ci_uint64  user_data;
+  ci_uint64  addr;
+  ci_uint64  addr2;
+  ci_uint32  len;
+  ci_uint32  op_flags;   /* msg_flags, accept_flags or poll events */
+  int        fd;
+  ci_uint8   opcode;
+};
+
+
+struct citp_uring {
+  pthread_mutex_t        lock;
+  int                    fd;       /* application's ring, or -1 */
+  int                    priv_fd;  /* our ring for posting MSG_RING */
+  struct citp_uring_map  app;
+  struct citp_uring_map  priv;
+  unsigned               n_posts;  /* queued on priv, not yet submitted */
+  struct citp_uring_op*  pending;
+  unsigned               n_pending;
+  unsigned               max_pending;
+};
+
+
+static struct citp_uring citp_urings[CITP_URING_MAX_RINGS];
+static pthread_mutex_t citp_uring_table_lock = PTHREAD_MUTEX_INITIALIZER;
+static int citp_uring_n_rings;
+
+
+static long uring_sys_setup(unsigned entries, struct io_uring_params* p)
+{
+  return ci_sys_syscall(__NR_io_uring_setup, entries, p);
+}
+
+
+static long uring_sys_enter(int fd, unsigned to_submit, unsigned min_complete,
+                            unsigned flags, void* argp, size_t argsz)
+{
+  return ci_sys_syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                        flags, argp, argsz);
+}
+
+
+static void uring_unmap(struct citp_uring_map* m)
+{
+  if( m->sqes != NULL )
+    munmap(m->sqes, m->sqes_len);
+  if( m->cq_ring != NULL && m->cq_ring != m->sq_ring )
+    munmap(m->cq_ring, m->cq_ring_len);
+  if( m->sq_ring != NULL )
+    munmap(m->sq_ring, m->sq_ring_len);
+  memset(m, 0, sizeof(*m));
+}
+
+
+static int uring_map(int fd, const struct io_uring_params* p,
+                     struct citp_uring_map* m)
+{
+  memset(m, 0, sizeof(*m));
+  m->sq_ring_len = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+  m->cq_ring_len = p->cq_off.cqes +
+                   p->cq_entries * sizeof(struct io_uring_cqe);
+  if( p->features & IORING_FEAT_SINGLE_MMAP )
+    m->sq_ring_len = m->cq_ring_len = CI_MAX(m->sq_ring_len,
+                                             m->cq_ring_len);
+
+  m->sq_ring = mmap(NULL, m->sq_ring_len, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if( m->sq_ring == MAP_FAILED )
+    goto fail;
+  if( p->features & IORING_FEAT_SINGLE_MMAP ) {
+    m->cq_ring = m->sq_ring;
+  }
+  else {
+    m->cq_ring = mmap(NULL, m->cq_ring_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if( m->cq_ring == MAP_FAILED )
+      goto fail;
+  }
+  m->sqes_len = p->sq_entries * sizeof(struct io_uring_sqe);
+  m->sqes = mmap(NULL, m->sqes_len, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if( m->sqes == MAP_FAILED )
+    goto fail;
+
+  m->sq_head = (void*) ((char*) m->sq_ring + p->sq_off.head);
+  m->sq_tail = (void*) ((char*) m->sq_ring + p->sq_off.tail);
+  m->sq_array = (void*) ((char*) m->sq_ring + p->sq_off.array);
+  m->sq_mask = *(unsigned*) ((char*) m->sq_ring + p->sq_off.ring_mask);
+  m->sq_entries = p->sq_entries;
+  m->cq_head = (void*) ((char*) m->cq_ring + p->cq_off.head);
+  m->cq_tail = (void*) ((char*) m->cq_ring + p->cq_off.tail);
+  m->cq_mask = *(unsigned*) ((char*) m->cq_ring + p->cq_off.ring_mask);
+  m->cqes = (void*) ((char*) m->cq_ring + p->cq_off.cqes);
+  return 0;
+
+ fail:
+  if( m->sq_ring == MAP_FAILED )
+    m->sq_ring = NULL;
+  if( m->cq_ring == MAP_FAILED )
+    m->cq_ring = NULL;
+  if( m->sqes == MAP_FAILED )
+    m->sqes = NULL;
+  uring_unmap(m);
+  return -1;
+}
+
+
+/* Is IORING_OP_MSG_RING available?  Without it we have no way to post a
+ * completion into the application's CQ. */
+static int uring_have_msg_ring(int fd)
+{
+  struct io_uring_probe* probe;
+  size_t len = sizeof(*probe) + 256 * sizeof(struct io_uring_probe_op);
+  int ok = 0;
+
+  if( (probe = calloc(1, len)) == NULL )
+    return 0;
+  if( ci_sys_syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE,
+                     probe, 256) == 0 &&
+      probe->ops_len > IORING_OP_MSG_RING &&
+      (probe->ops[IORING_OP_MSG_RING].flags & IO_URING_OP_SUPPORTED) )
+    ok = 1;
+  free(probe);
+  return ok;
+}
+
+
+static void uring_track(int fd, const struct io_uring_params* app_p)
+{
+  static int logged;
+  struct io_uring_params p;
+  struct citp_uring* r = NULL;
+  int i, priv_fd;
+
+  memset(&p, 0, sizeof(p));
+  priv_fd = uring_sys_setup(CITP_URING_PRIV_ENTRIES, &p);
+  if( priv_fd < 0 )
+    return;
+  if( ! uring_have_msg_ring(priv_fd) ) {
+    if( ! logged++ )
+      Log_U(ci_log("%s: kernel lacks IORING_OP_MSG_RING; io_uring "
+                   "operations on accelerated sockets will not be "
+                   "accelerated", __FUNCTION__));
+    ci_sys_close(priv_fd);
+    return;
+  }
+
+  pthread_mutex_lock(&citp_uring_table_lock);
+  for( i = 0; i < CITP_URING_MAX_RINGS; ++i )
+    if( citp_urings[i].max_pending == 0 ) {
+      r = &citp_urings[i];
+      break;
+    }
+  if( r == NULL ) {
+    pthread_mutex_unlock(&citp_uring_table_lock);
+    Log_V(ci_log("%s: too many rings; ring %d not accelerated",
+                 __FUNCTION__, fd));
+    ci_sys_close(priv_fd);
+    return;
+  }
+
+  if( uring_map(fd, app_p, &r->app) < 0 )
+    goto fail;
+  if( uring_map(priv_fd, &p, &r->priv) < 0 )
+    goto fail_unmap_app;
+  r->pending = malloc(app_p->cq_entries * sizeof(*r->pending));
+  if( r->pending == NULL )
+    goto fail_unmap_priv;
+
+  pthread_mutex_init(&r->lock, NULL);
+  r->fd = fd;
+  r->priv_fd = priv_fd;
+  r->n_posts = 0;
+  r->n_pending = 0;
+  r->max_pending = app_p->cq_entries;
+  ++citp_uring_n_rings;
+  pthread_mutex_unlock(&citp_uring_table_lock);
+  Log_V(ci_log("%s: tracking ring %d", __FUNCTION__, fd));
+  return;
+
+ fail_unmap_priv:
+  uring_unmap(&r->priv);
+ fail_unmap_app:
+  uring_unmap(&r->app);
+ fail:
+  pthread_mutex_unlock(&citp_uring_table_lock);
+  ci_sys_close(priv_fd);
+}
+
+
+/* Returns the ring with its lock held, or NULL. */
+static struct citp_uring* uring_lookup_lock(int fd)
+{
+  int i;
+  for( i = 0; i < CITP_URING_MAX_RINGS; ++i ) {
+    struct citp_uring* r = &citp_urings[i];
+    if( OO_ACCESS_ONCE(r->fd) != fd || r->max_pending == 0 )
+      continue;
+    pthread_mutex_lock(&r->lock);
+    if( r->fd == fd )
+      return r;
+    pthread_mutex_unlock(&r->lock);
+  }
+  return NULL;
+}
+
+
+/**********************************************************************
+ * Posting completions.
+ */
+
+static void uring_flush(struct citp_uring* r)
+{
+  struct citp_uring_map* m = &r->priv;
+  unsigned head, tail;
+
+  if( r->n_posts == 0 )
+    return;
+  if( uring_sys_enter(r->priv_fd, r->n_posts, 0, 0, NULL, 0) < 0 )
+    Log_E(ci_log("%s: ring %d: failed to post %u completions (%d)",
+                 __FUNCTION__, r->fd, r->n_posts, errno));
+  r->n_posts = 0;
+
+  /* Successful MSG_RING SQEs don't generate a CQE on our ring, so anything
+   * here is a failure, most likely a full application CQ. */
+  head = *m->cq_head;
+  tail = OO_ACCESS_ONCE(*m->cq_tail);
+  ci_rmb();
+  for( ; head != tail; ++head )
+    Log_E(ci_log("%s: ring %d: lost completion (%d)", __FUNCTION__, r->fd,
+                 m->cqes[head & m->cq_mask].res));
+  ci_wmb();
+  *m->cq_head = head;
+}
+
+
+static void uring_post(struct citp_uring* r, ci_uint64 user_data, int res)
+{
+  struct citp_uring_map* m = &r->priv;
+  unsigned tail = *m->sq_tail;
+  unsigned idx = tail & m->sq_mask;
+  struct io_uring_sqe* sqe = &m->sqes[idx];
+
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = IORING_OP_MSG_RING;
+  sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+  sqe->fd = r->fd;
+  sqe->addr = IORING_MSG_DATA;
+  sqe->len = (ci_uint32) res;
+  sqe->off = user_data;
+  m->sq_array[idx] = idx;
+  ci_wmb();
+  *m->sq_tail = tail + 1;
+
+  if( ++r->n_posts == m->sq_entries )
+    uring_flush(r);
+}
+
+
+/**********************************************************************
+ * Servicing operations.
+ */
+
+/* Poll [fds] in the same way as onload_poll().  citp_ul_do_poll() exits
+ * the library for us. */
+static int uring_poll(struct pollfd* fds, nfds_t nfds, int timeout_ms)
+{
+  citp_lib_context_t lib_context;
+  ci_uint64 used_ms = 0;
+  int rc;
+
+  citp_enter_lib(&lib_context);
+  rc = citp_ul_do_poll(fds, nfds, timeout_ms < 0 ? -1 : timeout_ms,
+                       &used_ms, &lib_context, NULL);
+  if( rc == 0 && timeout_ms != 0 && (timeout_ms < 0 || used_ms < timeout_ms) )
+    rc = ci_sys_poll(fds, nfds, timeout_ms < 0 ? -1 : timeout_ms - used_ms);
+  return rc;
+}
+
+
+static int uring_fd_is_accelerated(int fd)
+{
+  citp_lib_context_t lib_context;
+  citp_fdinfo* fdi;
+  int rc = 0;
+
+  citp_enter_lib(&lib_context);
+  if( (fdi = citp_fdtable_lookup(fd)) != NULL ) {
+    rc = citp_fdinfo_is_socket(fdi);
+    citp_fdinfo_release_ref(fdi, 0);
+  }
+  citp_exit_lib(&lib_context, 1);
+  return rc;
+}
+
+
+static int uring_sqe_to_op(const struct io_uring_sqe* sqe,
+                           struct citp_uring_op* op)
+{
+  switch( sqe->opcode ) {
+  case IORING_OP_SEND:
+  case IORING_OP_RECV:
+    /* ioprio carries IORING_RECVSEND_* modifiers. */
+    if( sqe->ioprio != 0 || sqe->buf_index != 0 )
+      return 0;
+    op->op_flags = sqe->msg_flags;
+    break;
+  case IORING_OP_ACCEPT:
+    if( sqe->ioprio != 0 || sqe->file_index != 0 )
+      return 0;
+    op->op_flags = sqe->accept_flags;
+    break;
+  case IORING_OP_POLL_ADD:
+    /* len carries multishot and update flags. */
+    if( sqe->len != 0 )
+      return 0;
+    op->op_flags = sqe->poll32_events & 0xffff;
+    break;
+  default:
+    return 0;
+  }
+  if( sqe->flags & CITP_URING_SQE_BAD_FLAGS )
+    return 0;
+
+  op->opcode = sqe->opcode;
+  op->fd = sqe->fd;
+  op->addr = sqe->addr;
+  op->addr2 = sqe->addr2;
+  op->len = sqe->len;
+  op->user_data = sqe->user_data;
+  return uring_fd_is_accelerated(op->fd);
+}
+
+
+/* Attempt [op] without blocking.  Returns true and fills in [*res] if the
+ * operation has completed. */
+static int uring_op_try(const struct citp_uring_op* op, int* res)
+{
+  citp_lib_context_t lib_context;
+  citp_fdinfo* fdi;
+  struct pollfd pfd;
+  struct iovec iov;
+  struct msghdr msg;
+  int rc;
+
+  switch( op->opcode ) {
+  case IORING_OP_POLL_ADD:
+    pfd.fd = op->fd;
+    pfd.events = op->op_flags;
+    pfd.revents = 0;
+    if( (rc = uring_poll(&pfd, 1, 0)) == 0 )
+      return 0;
+    *res = rc < 0 ? -errno : pfd.revents;
+    return 1;
+
+  case IORING_OP_ACCEPT:
+    /* Listening sockets are usually blocking, so make sure there is
+     * something to accept before calling in. */
+    pfd.fd = op->fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if( uring_poll(&pfd, 1, 0) == 0 )
+      return 0;
+    citp_enter_lib(&lib_context);
+    if( (fdi = citp_fdtable_lookup(op->fd)) != NULL ) {
+      rc = citp_fdinfo_get_ops(fdi)->accept(fdi,
+                                  (struct sockaddr*) (uintptr_t) op->addr,
+                                  (socklen_t*) (uintptr_t) op->addr2,
+                                  op->op_flags, &lib_context);
+      citp_fdinfo_release_ref(fdi, 0);
+    }
+    else {
+      rc = ci_sys_accept4(op->fd, (struct sockaddr*) (uintptr_t) op->addr,
+                          (socklen_t*) (uintptr_t) op->addr2, op->op_flags);
+    }
+    citp_exit_lib(&lib_context, rc >= 0);
+    break;
+
+  default:
+    iov.iov_base = (void*) (uintptr_t) op->addr;
+    iov.iov_len = op->len;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    citp_enter_lib(&lib_context);
+    if( (fdi = citp_fdtable_lookup(op->fd)) != NULL ) {
+      if( op->opcode == IORING_OP_SEND )
+        rc = citp_fdinfo_get_ops(fdi)->send(fdi, &msg,
+                                            op->op_flags | MSG_DONTWAIT);
+      else
+        rc = citp_fdinfo_get_ops(fdi)->recv(fdi, &msg,
+                                            op->op_flags | MSG_DONTWAIT);
+      citp_fdinfo_release_ref(fdi, 0);
+    }
+    /* Handed over to the kernel since submission. */
+    else if( op->opcode == IORING_OP_SEND ) {
+      rc = ci_sys_sendmsg(op->fd, &msg, op->op_flags | MSG_DONTWAIT);
+    }
+    else {
+      rc = ci_sys_recvmsg(op->fd, &msg, op->op_flags | MSG_DONTWAIT);
+    }
+    citp_exit_lib(&lib_context, rc >= 0);
+    break;
+  }
+
+  if( rc < 0 ) {
+    rc = -errno;
+    if( rc == -EAGAIN && (op->opcode == IORING_OP_ACCEPT ||
+                          ! (op->op_flags & MSG_DONTWAIT)) )
+      return 0;
+  }
+  *res = rc;
+  return 1;
+}
+
+
+static void uring_progress(struct citp_uring* r)
+{
+  unsigned i, j;
+  int res;
+
+  for( i = j = 0; i < r->n_pending; ++i ) {
+    if( uring_op_try(&r->pending[i], &res) )
+      uring_post(r, r->pending[i].user_data, res);
+    else
+      r->pending[j++] = r->pending[i];
+  }
+  r->n_pending = j;
+}
+
+
+/* Service any eligible SQEs among the next [to_submit].  Serviced SQEs are
+ * turned into NOPs that complete silently. */
+static void uring_scan_sq(struct citp_uring* r, unsigned to_submit)
+{
+  struct citp_uring_map* m = &r->app;
+  struct citp_uring_op op;
+  unsigned head, tail, i, idx;
+  int in_chain = 0, chained, res;
+
+  head = OO_ACCESS_ONCE(*m->sq_head);
+  tail = OO_ACCESS_ONCE(*m->sq_tail);
+  ci_rmb();
+  to_submit = CI_MIN(to_submit, tail - head);
+
+  for( i = 0; i < to_submit; ++i ) {
+    struct io_uring_sqe* sqe;
+    idx = m->sq_array[(head + i) & m->sq_mask];
+    if( idx >= m->sq_entries )
+      continue;
+    sqe = &m->sqes[idx];
+
+    /* Don't disturb the ordering of linked requests. */
+    chained = in_chain;
+    in_chain = sqe->flags & (IOSQE_IO_LINK | IOSQE_IO_HARDLINK);
+    if( chained || in_chain || ! uring_sqe_to_op(sqe, &op) )
+      continue;
+
+    if( uring_op_try(&op, &res) )
+      uring_post(r, op.user_data, res);
+    else if( r->n_pending < r->max_pending )
+      r->pending[r->n_pending++] = op;
+    else
+      uring_post(r, op.user_data, -ENOBUFS);
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_NOP;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe->user_data = op.user_data;
+  }
+}
+
+
+static unsigned uring_cq_ready(struct citp_uring* r)
+{
+  return OO_ACCESS_ONCE(*r->app.cq_tail) - OO_ACCESS_ONCE(*r->app.cq_head);
+}
+
+
+/* Wait until the CQ has [min_complete] entries, progressing our pending
+ * operations as we go.  Returns 0 or -1 with errno set. */
+static int uring_wait(int fd, unsigned min_complete, unsigned flags,
+                      void* argp, size_t argsz)
+{
+  struct citp_uring* r;
+  struct pollfd* pfds = NULL;
+  ci_uint64 start_frc, now_frc;
+  int timeout_ms = -1, tmo, rc;
+  unsigned i, n, ready;
+
+  if( (flags & IORING_ENTER_EXT_ARG) && argp != NULL ) {
+    const struct io_uring_getevents_arg* ga = argp;
+    const struct __kernel_timespec* ts = (void*) (uintptr_t) ga->ts;
+    if( ts != NULL )
+      timeout_ms = CI_MIN(ts->tv_sec * 1000 +
+                          (ts->tv_nsec + 999999) / 1000000, (ci_int64) INT_MAX);
+  }
+  ci_frc64(&start_frc);
+
+  while( 1 ) {
+    if( (r = uring_lookup_lock(fd)) == NULL ) {
+      errno = EBADF;
+      return -1;
+    }
+    uring_progress(r);
+    uring_flush(r);
+    ready = uring_cq_ready(r);
+    n = r->n_pending;
+    if( ready < min_complete && n != 0 ) {
+      if( pfds == NULL )
+        pfds = malloc((r->max_pending + 1) * sizeof(*pfds));
+      for( i = 0; pfds != NULL && i < n; ++i ) {
+        pfds[i].fd = r->pending[i].fd;
+        pfds[i].events = r->pending[i].opcode == IORING_OP_SEND ?
+                         POLLOUT : POLLIN;
+        if( r->pending[i].opcode == IORING_OP_POLL_ADD )
+          pfds[i].events = r->pending[i].op_flags;
+      }
+    }
+    pthread_mutex_unlock(&r->lock);
+
+    if( ready >= min_complete ) {
+      rc = 0;
+      break;
+    }
+    if( n == 0 || pfds == NULL ) {
+      /* Only the kernel can complete what remains. */
+      rc = uring_sys_enter(fd, 0, min_complete,
+                           flags & (IORING_ENTER_GETEVENTS |
+                                    IORING_ENTER_EXT_ARG), argp, argsz);
+      rc = rc < 0 ? -1 : 0;
+      break;
+    }
+
+    ci_frc64(&now_frc);
+    tmo = timeout_ms;
+    if( timeout_ms >= 0 ) {
+      tmo -= (now_frc - start_frc) / citp.cpu_khz;
+      if( tmo <= 0 ) {
+        errno = ETIME;
+        rc = -1;
+        break;
+      }
+    }
+    /* The ring fd is readable while its CQ is non-empty, so it only tells
+     * us something when the CQ is empty.  Otherwise recheck periodically
+     * for kernel completions. */
+    if( ready == 0 ) {
+      pfds[n].fd = fd;
+      pfds[n].events = POLLIN;
+      ++n;
+    }
+    else if( tmo < 0 || tmo > 1 ) {
+      tmo = 1;
+    }
+    if( uring_poll(pfds, n, tmo) < 0 && errno == EINTR ) {
+      rc = -1;
+      break;
+    }
+  }
+
+  free(pfds);
+  return rc;
+}
+
+
+/**********************************************************************
+ * Entry points.
+ */
+
+long citp_uring_setup(unsigned entries, struct io_uring_params* p)
+{
+  int fd;
+
+  Log_CALL(ci_log("%s(%u, %p)", __FUNCTION__, entries, p));
+
+  if( CI_UNLIKELY(citp.init_level < CITP_INIT_ALL) ) {
+    citp_do_init(CITP_INIT_SYSCALLS);
+    return uring_sys_setup(entries, p);
+  }
+
+  fd = uring_sys_setup(entries, p);
+  if( fd >= 0 && CITP_OPTS.ul_uring &&
+      ! (p->flags & CITP_URING_SETUP_BAD_FLAGS) &&
+      (p->features & IORING_FEAT_CQE_SKIP) )
+    uring_track(fd, p);
+
+  Log_CALL_RESULT(fd);
+  return fd;
+}
+
+
+long citp_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                      unsigned flags, void* argp, size_t argsz)
+{
+  struct citp_uring* r;
+  long rc;
+
+  if( CI_UNLIKELY(citp.init_level < CITP_INIT_ALL) )
+    citp_do_init(CITP_INIT_SYSCALLS);
+
+  if( OO_ACCESS_ONCE(citp_uring_n_rings) == 0 ||
+      (flags & IORING_ENTER_REGISTERED_RING) ||
+      (r = uring_lookup_lock(fd)) == NULL )
+    return uring_sys_enter(fd, to_submit, min_complete, flags, argp, argsz);
+
+  uring_progress(r);
+  if( to_submit != 0 )
+    uring_scan_sq(r, to_submit);
+  uring_flush(r);
+
+  if( ! (flags & IORING_ENTER_GETEVENTS) || min_complete == 0 ||
+      r->n_pending == 0 ) {
+    pthread_mutex_unlock(&r->lock);
+    return uring_sys_enter(fd, to_submit, min_complete, flags, argp, argsz);
+  }
+
+  /* Blocking in the kernel would starve our pending operations, so submit
+   * without waiting and do the waiting ourselves. */
+  rc = uring_sys_enter(fd, to_submit, 0,
+                       flags & ~(IORING_ENTER_GETEVENTS |
+                                 IORING_ENTER_EXT_ARG), NULL, 0);
+  pthread_mutex_unlock(&r->lock);
+  if( rc < 0 )
+    return rc;
+
+  if( uring_wait(fd, min_complete, flags, argp, argsz) < 0 && rc == 0 )
+    return -1;
+  return rc;
+}
+
+
+void citp_uring_close(int fd)
+{
+  struct citp_uring* r;
+  unsigned i, j;
+  int k;
+
+  if( OO_ACCESS_ONCE(citp_uring_n_rings) == 0 )
+    return;
+
+  if( (r = uring_lookup_lock(fd)) != NULL ) {
+    pthread_mutex_lock(&citp_uring_table_lock);
+    uring_unmap(&r->app);
+    uring_unmap(&r->priv);
+    ci_sys_close(r->priv_fd);
+    free(r->pending);
+    r->pending = NULL;
+    r->fd = -1;
+    r->max_pending = 0;
+    --citp_uring_n_rings;
+    pthread_mutex_unlock(&citp_uring_table_lock);
+    pthread_mutex_unlock(&r->lock);
+    return;
+  }
+
+  /* Cancel operations outstanding against the socket being closed. */
+  for( k = 0; k < CITP_URING_MAX_RINGS; ++k ) {
+    r = &citp_urings[k];
+    if( OO_ACCESS_ONCE(r->max_pending) == 0 )
+      continue;
+    pthread_mutex_lock(&r->lock);
+    if( r->max_pending == 0 ) {
+      pthread_mutex_unlock(&r->lock);
+      continue;
+    }
+    for( i = j = 0; i < r->n_pending; ++i ) {
+      if( r->pending[i].fd == fd )
+        uring_post(r, r->pending[i].user_data, -ECANCELED);
+      else
+        r->pending[j++] = r->pending[i];
+    }
+    r->n_pending = j;
+    uring_flush(r);
+    pthread_mutex_unlock(&r->lock);
+  }
+}
+
+#elif CI_CFG_USERSPACE_SYSCALL && defined(__NR_io_uring_setup)
+
+long citp_uring_setup(unsigned entries, struct io_uring_params* p)
+{
+  return ci_sys_syscall(__NR_io_uring_setup, entries, p);
+}
+
+long citp_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                      unsigned flags, void* argp, size_t argsz)
+{
+  return ci_sys_syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                        flags, argp, argsz);
+}
+
+void citp_uring_close(int fd)
+{
+}
+
+#endif
@@ -0,0 +1,194 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/* Measures the rate at which several threads can accept() connections
+ * from one listening socket, with and without EF_TCP_ACCEPT_SHARDS.
+ *
+ * Each acceptor thread calls accept() on the shared listening socket and
+ * closes each connection straight away.  For each mode we report the
+ * accept rate and the time spent in each accept() call.  Run with -c on
+ * another host to open connections to it as fast as possible.
+ *
+ * Usage: onload ./accept_bench [-t threads] [-s seconds] [-p port]
+ *        ./accept_bench -c [-t threads] [-p port] <server-ip>
+ *
+ * The server must be reached through an accelerated interface.  Run
+ * enough connecting threads to keep the accept queue from running dry.
+ */
+#include "bench.h"
+
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+
+static int cfg_threads = 4;
+static int cfg_seconds = 5;
+static int cfg_port = 8085;
+static int cfg_connect;
+static struct in_addr cfg_dest;
+
+static volatile int stop;
+
+struct acceptor {
+  pthread_t thread;
+  int listener;
+  uint64_t n_accepted;
+  struct bench_hist hist;
+};
+
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: accept_bench [-t threads] [-s seconds] "
+          "[-p port]\n"
+          "       accept_bench -c [-t threads] [-p port] <server-ip>\n");
+  exit(1);
+}
+
+
+static void* connect_fn(void* arg)
+{
+  struct sockaddr_in sa;
+  struct linger l = { .l_onoff = 1, .l_linger = 0 };
+  int sock;
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr = cfg_dest;
+  sa.sin_port = htons(cfg_port);
+  while( 1 ) {
+    TRY(sock = socket(AF_INET, SOCK_STREAM, 0));
+    /* Reset rather than leave TIME_WAIT behind, so we don't run out of
+     * ports. */
+    TRY(setsockopt(sock, SOL_SOCKET, SO_LINGER, &l, sizeof(l)));
+    if( connect(sock, (struct sockaddr*) &sa, sizeof(sa)) < 0 )
+      usleep(1000);
+    close(sock);
+  }
+  return NULL;
+}
+
+
+static void run_connect(void)
+{
+  pthread_t thread;
+  int i;
+
+  for( i = 0; i < cfg_threads; ++i )
+    TRY(-pthread_create(&thread, NULL, connect_fn, NULL));
+  pause();
+}
+
+
+static void* acceptor_fn(void* arg)
+{
+  struct acceptor* a = arg;
+  uint64_t t0, t1;
+  int sock;
+
+  while( ! stop ) {
+    t0 = bench_now_ns();
+    /* Times out every 100ms so that we notice [stop]. */
+    sock = accept(a->listener, NULL, NULL);
+    t1 = bench_now_ns();
+    if( sock >= 0 ) {
+      ++a->n_accepted;
+      bench_hist_add(&a->hist, t1 - t0);
+      close(sock);
+    }
+  }
+  return NULL;
+}
+
+
+static void run_accept(const char* mode)
+{
+  struct sockaddr_in sa;
+  struct timeval tv = { .tv_sec = 0, .tv_usec = 100000 };
+  struct bench_hist all;
+  struct acceptor* acceptors;
+  uint64_t start, end, n_accepted = 0;
+  int i, listener, one = 1;
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl(INADDR_ANY);
+  sa.sin_port = htons(cfg_port);
+  TRY(listener = socket(AF_INET, SOCK_STREAM, 0));
+  TRY(setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)));
+  TRY(setsockopt(listener, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)));
+  TRY(bind(listener, (struct sockaddr*) &sa, sizeof(sa)));
+  TRY(listen(listener, 1024));
+
+  acceptors = calloc(cfg_threads, sizeof(acceptors[0]));
+  start = bench_now_ns();
+  for( i = 0; i < cfg_threads; ++i ) {
+    acceptors[i].listener = listener;
+    TRY(-pthread_create(&acceptors[i].thread, NULL, acceptor_fn,
+                        &acceptors[i]));
+  }
+  sleep(cfg_seconds);
+  stop = 1;
+  end = bench_now_ns();
+  for( i = 0; i < cfg_threads; ++i )
+    TRY(-pthread_join(acceptors[i].thread, NULL));
+
+  memset(&all, 0, sizeof(all));
+  for( i = 0; i < cfg_threads; ++i ) {
+    n_accepted += acceptors[i].n_accepted;
+    bench_hist_merge(&all, &acceptors[i].hist);
+  }
+  close(listener);
+  free(acceptors);
+
+  printf("EF_TCP_ACCEPT_SHARDS=%s threads=%d\n", mode, cfg_threads);
+  printf("  rate: %.0f conns/sec\n", n_accepted * 1e9 / (end - start));
+  bench_hist_print("accept", &all);
+}
+
+
+int main(int argc, char* argv[])
+{
+  char shards[8];
+  const char* modes[] = { "0", shards };
+  const char* mode;
+  int c;
+
+  while( (c = getopt(argc, argv, "ct:s:p:M:")) != -1 )
+    switch( c ) {
+    case 'c':
+      cfg_connect = 1;
+      break;
+    case 't':
+      cfg_threads = atoi(optarg);
+      break;
+    case 's':
+      cfg_seconds = atoi(optarg);
+      break;
+    case 'p':
+      cfg_port = atoi(optarg);
+      break;
+    case 'M':
+      break;
+    default:
+      usage();
+    }
+  if( cfg_threads < 1 )
+    usage();
+
+  if( cfg_connect ) {
+    if( optind != argc - 1 || ! inet_aton(argv[optind], &cfg_dest) )
+      usage();
+    run_connect();
+    return 0;
+  }
+
+  if( optind != argc )
+    usage();
+  /* One shard per thread, up to the limit Onload enforces. */
+  snprintf(shards, sizeof(shards), "%d", cfg_threads < 8 ? cfg_threads : 8);
+  if( bench_run_modes(argc, argv, "EF_TCP_ACCEPT_SHARDS", modes, 2, &mode) )
+    run_accept(mode);
+  return 0;
+}
@@ -0,0 +1,142 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/* Helpers shared by the Onload microbenchmarks in this directory.
+ *
+ * Each benchmark compares a stack option turned off and on.  Onload reads
+ * its options when a stack is created, so bench_run_modes() runs the
+ * benchmark once per setting in a fresh copy of the process, with the
+ * option set in the environment.  Run the benchmark itself under onload.
+ */
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+
+#define TRY(x)                                                  \
+  do {                                                          \
+    int __rc = (x);                                             \
+    if( __rc < 0 ) {                                            \
+      fprintf(stderr, "ERROR: '%s' failed\n", #x);              \
+      fprintf(stderr, "ERROR: at %s:%d\n", __FILE__, __LINE__); \
+      fprintf(stderr, "ERROR: rc=%d errno=%d (%s)\n",           \
+              __rc, errno, strerror(errno));                    \
+      exit(1);                                                  \
+    }                                                           \
+  } while( 0 )
+
+
+static inline uint64_t bench_now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+/* Latency histogram with 10ns buckets up to 100us.  Anything longer goes
+ * in the last bucket.
+ */
+#define BENCH_HIST_NS       10
+#define BENCH_HIST_BUCKETS  10000
+
+struct bench_hist {
+  uint64_t bucket[BENCH_HIST_BUCKETS];
+  uint64_t n;
+};
+
+static inline void bench_hist_add(struct bench_hist* h, uint64_t ns)
+{
+  uint64_t b = ns / BENCH_HIST_NS;
+  ++h->bucket[b < BENCH_HIST_BUCKETS ? b : BENCH_HIST_BUCKETS - 1];
+  ++h->n;
+}
+
+static inline void bench_hist_merge(struct bench_hist* to,
+                                    const struct bench_hist* from)
+{
+  int i;
+  for( i = 0; i < BENCH_HIST_BUCKETS; ++i )
+    to->bucket[i] += from->bucket[i];
+  to->n += from->n;
+}
+
+/* Returns the upper bound in ns of the bucket holding the given
+ * percentile, expressed in parts per million.
+ */
+static inline uint64_t bench_hist_pct(const struct bench_hist* h,
+                                      unsigned ppm)
+{
+  uint64_t rank = (h->n * ppm + 999999) / 1000000, seen = 0;
+  int i;
+
+  if( h->n == 0 )
+    return 0;
+  for( i = 0; i < BENCH_HIST_BUCKETS - 1; ++i )
+    if( (seen += h->bucket[i]) >= rank )
+      break;
+  return (uint64_t) (i + 1) * BENCH_HIST_NS;
+}
+
+static inline void bench_hist_print(const char* what,
+                                    const struct bench_hist* h)
+{
+  printf("  %s: n=%llu p50=%lluns p99=%lluns p99.9=%lluns\n", what,
+         (unsigned long long) h->n,
+         (unsigned long long) bench_hist_pct(h, 500000),
+         (unsigned long long) bench_hist_pct(h, 990000),
+         (unsigned long long) bench_hist_pct(h, 999000));
+}
+
+
+/* If [argv] contains "-M <value>" this is a child run: sets *mode_out and
+ * returns 1.  Otherwise reruns this program with "-M <value>" appended
+ * and [opt] set in the environment, once for each of [values], and
+ * returns 0.
+ */
+static inline int bench_run_modes(int argc, char** argv, const char* opt,
+                                  const char* const* values, int n_values,
+                                  const char** mode_out)
+{
+  char** child_argv;
+  pid_t pid;
+  int i, status;
+
+  for( i = 1; i < argc - 1; ++i )
+    if( ! strcmp(argv[i], "-M") ) {
+      *mode_out = argv[i + 1];
+      return 1;
+    }
+
+  child_argv = calloc(argc + 3, sizeof(child_argv[0]));
+  memcpy(child_argv, argv, argc * sizeof(child_argv[0]));
+  child_argv[argc] = "-M";
+  for( i = 0; i < n_values; ++i ) {
+    child_argv[argc + 1] = (char*) values[i];
+    fflush(stdout);
+    TRY(pid = fork());
+    if( pid == 0 ) {
+      TRY(setenv(opt, values[i], 1));
+      execv("/proc/self/exe", child_argv);
+      fprintf(stderr, "ERROR: exec failed: %s\n", strerror(errno));
+      _exit(1);
+    }
+    TRY(waitpid(pid, &status, 0));
+    if( ! WIFEXITED(status) || WEXITSTATUS(status) != 0 ) {
+      fprintf(stderr, "ERROR: run with %s=%s failed\n", opt, values[i]);
+      exit(1);
+    }
+  }
+  free(child_argv);
+  return 0;
+}
+
+#endif  /* __BENCH_H__ */
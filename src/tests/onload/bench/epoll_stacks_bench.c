@@ -0,0 +1,151 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/* Measures round-trip latency through an epoll set whose sockets are spread
+ * over several Onload stacks, with and without EF_EPOLL_POLL_STACKS.
+ *
+ * Each of the sockets is created by its own thread, so with
+ * EF_STACK_PER_THREAD=1 (set by this program) each is in its own stack.
+ * The main thread sends a timestamped datagram on each socket in turn to
+ * a UDP echo service, and waits in epoll_wait() for the reply.  For each
+ * mode we report the round-trip time percentiles.
+ *
+ * Usage: onload ./epoll_stacks_bench [-n stacks] [-s seconds] [-l bytes]
+ *                                    [-p port] <echo-ip>
+ *
+ * The echo service must be reached through an accelerated interface, for
+ * example "socat UDP-RECVFROM:<port>,fork PIPE" on another host.
+ */
+#include "bench.h"
+
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+
+#define MAX_STACKS 8
+
+static int cfg_stacks = 4;
+static int cfg_seconds = 5;
+static int cfg_len = 64;
+static int cfg_port = 7;
+static struct in_addr cfg_dest;
+
+static int socks[MAX_STACKS];
+
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: epoll_stacks_bench [-n stacks] [-s seconds] "
+          "[-l bytes] [-p port] <echo-ip>\n");
+  exit(1);
+}
+
+
+static void* create_fn(void* arg)
+{
+  int* sock = arg;
+  struct sockaddr_in sa;
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr = cfg_dest;
+  sa.sin_port = htons(cfg_port);
+  TRY(*sock = socket(AF_INET, SOCK_DGRAM, 0));
+  TRY(connect(*sock, (struct sockaddr*) &sa, sizeof(sa)));
+  return NULL;
+}
+
+
+static void run(const char* mode)
+{
+  struct epoll_event ev;
+  struct bench_hist* hist = calloc(1, sizeof(*hist));
+  char buf[2048];
+  uint64_t end, t0, t1, n_lost = 0;
+  pthread_t thread;
+  int i, ep, rc;
+
+  /* Threads are only used to put the sockets in separate stacks. */
+  for( i = 0; i < cfg_stacks; ++i ) {
+    TRY(-pthread_create(&thread, NULL, create_fn, &socks[i]));
+    TRY(-pthread_join(thread, NULL));
+  }
+
+  TRY(ep = epoll_create(cfg_stacks));
+  for( i = 0; i < cfg_stacks; ++i ) {
+    ev.events = EPOLLIN;
+    ev.data.u32 = i;
+    TRY(epoll_ctl(ep, EPOLL_CTL_ADD, socks[i], &ev));
+  }
+
+  memset(buf, 0, sizeof(buf));
+  end = bench_now_ns() + (uint64_t) cfg_seconds * 1000000000;
+  for( i = 0; (t0 = bench_now_ns()) < end; i = (i + 1) % cfg_stacks ) {
+    memcpy(buf, &t0, sizeof(t0));
+    TRY(send(socks[i], buf, cfg_len, 0));
+    /* Anything that arrives on another socket is a late reply. */
+    do {
+      TRY(rc = epoll_wait(ep, &ev, 1, 100));
+      if( rc == 0 ) {
+        ++n_lost;
+        break;
+      }
+      recv(socks[ev.data.u32], buf, sizeof(buf), MSG_DONTWAIT);
+    } while( ev.data.u32 != i );
+    if( rc > 0 ) {
+      t1 = bench_now_ns();
+      bench_hist_add(hist, t1 - t0);
+    }
+  }
+
+  close(ep);
+  for( i = 0; i < cfg_stacks; ++i )
+    close(socks[i]);
+
+  printf("EF_EPOLL_POLL_STACKS=%s stacks=%d len=%d\n",
+         mode, cfg_stacks, cfg_len);
+  printf("  lost: %llu\n", (unsigned long long) n_lost);
+  bench_hist_print("rtt", hist);
+  free(hist);
+}
+
+
+int main(int argc, char* argv[])
+{
+  static const char* const modes[] = { "0", "8" };
+  const char* mode;
+  int c;
+
+  while( (c = getopt(argc, argv, "n:s:l:p:M:")) != -1 )
+    switch( c ) {
+    case 'n':
+      cfg_stacks = atoi(optarg);
+      break;
+    case 's':
+      cfg_seconds = atoi(optarg);
+      break;
+    case 'l':
+      cfg_len = atoi(optarg);
+      break;
+    case 'p':
+      cfg_port = atoi(optarg);
+      break;
+    case 'M':
+      break;
+    default:
+      usage();
+    }
+  if( optind != argc - 1 || cfg_stacks < 1 || cfg_stacks > MAX_STACKS ||
+      cfg_len < (int) sizeof(uint64_t) || cfg_len > 1472 ||
+      ! inet_aton(argv[optind], &cfg_dest) )
+    usage();
+
+  setenv("EF_STACK_PER_THREAD", "1", 1);
+  setenv("EF_UL_EPOLL", "3", 0);
+  setenv("EF_EPOLL_SPIN", "1", 0);
+  if( bench_run_modes(argc, argv, "EF_EPOLL_POLL_STACKS", modes, 2, &mode) )
+    run(mode);
+  return 0;
+}
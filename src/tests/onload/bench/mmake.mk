@@ -0,0 +1,12 @@
+# SPDX-License-Identifier: BSD-2-Clause
+# X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc.
+TARGETS	:= tx_lock_bench epoll_stacks_bench mmsg_bench xdp_pps_bench \
+	   accept_bench
+
+all: $(TARGETS)
+
+targets:
+	@echo $(TARGETS)
+
+clean:
+	@$(MakeClean)
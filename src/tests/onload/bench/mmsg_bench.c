@@ -0,0 +1,169 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/* Measures the UDP message rate of sendmmsg() and recvmmsg(), with and
+ * without EF_UDP_SENDMMSG_BATCH.
+ *
+ * The sender sends batches of small datagrams on a connected socket with
+ * sendmmsg() as fast as it can, and reports the send rate and the time
+ * spent in each call.  Run with -r on another host to receive them with
+ * recvmmsg() and report the receive rate once a second.
+ *
+ * Usage: onload ./mmsg_bench [-b batch] [-s seconds] [-l bytes]
+ *                            [-p port] <dest-ip>
+ *        onload ./mmsg_bench -r [-b batch] [-p port]
+ *
+ * The destination must be reached through an accelerated interface.
+ */
+#define _GNU_SOURCE
+#include "bench.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+
+#define MAX_BATCH 1024
+
+static int cfg_batch = 32;
+static int cfg_seconds = 5;
+static int cfg_len = 64;
+static int cfg_port = 8085;
+static int cfg_recv;
+static struct in_addr cfg_dest;
+
+static char bufs[MAX_BATCH][2048];
+static struct iovec iovs[MAX_BATCH];
+static struct mmsghdr msgs[MAX_BATCH];
+
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: mmsg_bench [-b batch] [-s seconds] [-l bytes] "
+          "[-p port] <dest-ip>\n"
+          "       mmsg_bench -r [-b batch] [-p port]\n");
+  exit(1);
+}
+
+
+static void init_msgs(int len)
+{
+  int i;
+
+  memset(msgs, 0, sizeof(msgs));
+  for( i = 0; i < cfg_batch; ++i ) {
+    iovs[i].iov_base = bufs[i];
+    iovs[i].iov_len = len;
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+}
+
+
+static void run_recv(void)
+{
+  struct sockaddr_in sa;
+  uint64_t t0, t1, n_recv = 0;
+  int sock, rc;
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl(INADDR_ANY);
+  sa.sin_port = htons(cfg_port);
+  TRY(sock = socket(AF_INET, SOCK_DGRAM, 0));
+  TRY(bind(sock, (struct sockaddr*) &sa, sizeof(sa)));
+
+  init_msgs(sizeof(bufs[0]));
+  t0 = bench_now_ns();
+  while( 1 ) {
+    TRY(rc = recvmmsg(sock, msgs, cfg_batch, MSG_WAITFORONE, NULL));
+    n_recv += rc;
+    if( (t1 = bench_now_ns()) - t0 >= 1000000000 ) {
+      printf("recv: %.0f msgs/sec\n", n_recv * 1e9 / (t1 - t0));
+      fflush(stdout);
+      n_recv = 0;
+      t0 = t1;
+    }
+  }
+}
+
+
+static void run_send(const char* mode)
+{
+  struct sockaddr_in sa;
+  struct bench_hist* hist = calloc(1, sizeof(*hist));
+  uint64_t start, end, t0, t1, n_sent = 0;
+  int sock, rc;
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr = cfg_dest;
+  sa.sin_port = htons(cfg_port);
+  TRY(sock = socket(AF_INET, SOCK_DGRAM, 0));
+  TRY(connect(sock, (struct sockaddr*) &sa, sizeof(sa)));
+
+  init_msgs(cfg_len);
+  start = bench_now_ns();
+  end = start + (uint64_t) cfg_seconds * 1000000000;
+  while( (t0 = bench_now_ns()) < end ) {
+    rc = sendmmsg(sock, msgs, cfg_batch, 0);
+    t1 = bench_now_ns();
+    if( rc > 0 )
+      n_sent += rc;
+    bench_hist_add(hist, t1 - t0);
+  }
+  end = bench_now_ns();
+  close(sock);
+
+  printf("EF_UDP_SENDMMSG_BATCH=%s batch=%d len=%d\n",
+         mode, cfg_batch, cfg_len);
+  printf("  rate: %.0f msgs/sec\n", n_sent * 1e9 / (end - start));
+  bench_hist_print("sendmmsg", hist);
+  free(hist);
+}
+
+
+int main(int argc, char* argv[])
+{
+  static const char* const modes[] = { "0", "1" };
+  const char* mode;
+  int c;
+
+  while( (c = getopt(argc, argv, "rb:s:l:p:M:")) != -1 )
+    switch( c ) {
+    case 'r':
+      cfg_recv = 1;
+      break;
+    case 'b':
+      cfg_batch = atoi(optarg);
+      break;
+    case 's':
+      cfg_seconds = atoi(optarg);
+      break;
+    case 'l':
+      cfg_len = atoi(optarg);
+      break;
+    case 'p':
+      cfg_port = atoi(optarg);
+      break;
+    case 'M':
+      break;
+    default:
+      usage();
+    }
+  if( cfg_batch < 1 || cfg_batch > MAX_BATCH || cfg_len < 0 ||
+      cfg_len > 1472 )
+    usage();
+
+  if( cfg_recv ) {
+    if( optind != argc )
+      usage();
+    run_recv();
+    return 0;
+  }
+
+  if( optind != argc - 1 || ! inet_aton(argv[optind], &cfg_dest) )
+    usage();
+  if( bench_run_modes(argc, argv, "EF_UDP_SENDMMSG_BATCH", modes, 2, &mode) )
+    run_send(mode);
+  return 0;
+}
@@ -0,0 +1,166 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/* Measures contention between UDP senders and a polling thread that share
+ * one Onload stack, with and without EF_TX_LOCK_DOMAINS.
+ *
+ * One thread spins in recv() on an idle socket, so keeps taking the stack
+ * lock to poll.  The sender threads each send datagrams on a connected
+ * socket as fast as they can.  For each mode we report the send rate and
+ * the time spent in each send() call.
+ *
+ * Usage: onload ./tx_lock_bench [-t senders] [-s seconds] [-l bytes]
+ *                               [-p port] <dest-ip>
+ *
+ * The destination must be reached through an accelerated interface.
+ * Nothing needs to receive the datagrams.
+ */
+#include "bench.h"
+
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+
+static int cfg_senders = 1;
+static int cfg_seconds = 5;
+static int cfg_len = 64;
+static int cfg_port = 8085;
+static struct in_addr cfg_dest;
+
+static volatile int stop;
+
+struct sender {
+  pthread_t thread;
+  int sock;
+  uint64_t n_sent;
+  struct bench_hist hist;
+};
+
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: tx_lock_bench [-t senders] [-s seconds] "
+          "[-l bytes] [-p port] <dest-ip>\n");
+  exit(1);
+}
+
+
+static void* poller_fn(void* arg)
+{
+  int sock = *(int*) arg;
+  char buf[2048];
+
+  while( ! stop )
+    /* Times out every 100ms so that we notice [stop]. */
+    recv(sock, buf, sizeof(buf), 0);
+  return NULL;
+}
+
+
+static void* sender_fn(void* arg)
+{
+  struct sender* s = arg;
+  char buf[2048];
+  uint64_t t0, t1;
+
+  memset(buf, 0, sizeof(buf));
+  while( ! stop ) {
+    t0 = bench_now_ns();
+    if( send(s->sock, buf, cfg_len, 0) == cfg_len )
+      ++s->n_sent;
+    t1 = bench_now_ns();
+    bench_hist_add(&s->hist, t1 - t0);
+  }
+  return NULL;
+}
+
+
+static void run(const char* mode)
+{
+  struct sockaddr_in sa;
+  struct timeval tv = { .tv_sec = 0, .tv_usec = 100000 };
+  struct bench_hist all;
+  struct sender* senders;
+  pthread_t poller;
+  uint64_t start, end, n_sent = 0;
+  int i, poll_sock;
+
+  /* The polling socket must be in the same stack as the senders. */
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl(INADDR_ANY);
+  sa.sin_port = htons(cfg_port);
+  TRY(poll_sock = socket(AF_INET, SOCK_DGRAM, 0));
+  TRY(setsockopt(poll_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)));
+  TRY(bind(poll_sock, (struct sockaddr*) &sa, sizeof(sa)));
+
+  senders = calloc(cfg_senders, sizeof(senders[0]));
+  sa.sin_addr = cfg_dest;
+  for( i = 0; i < cfg_senders; ++i ) {
+    TRY(senders[i].sock = socket(AF_INET, SOCK_DGRAM, 0));
+    TRY(connect(senders[i].sock, (struct sockaddr*) &sa, sizeof(sa)));
+  }
+
+  TRY(-pthread_create(&poller, NULL, poller_fn, &poll_sock));
+  start = bench_now_ns();
+  for( i = 0; i < cfg_senders; ++i )
+    TRY(-pthread_create(&senders[i].thread, NULL, sender_fn, &senders[i]));
+  sleep(cfg_seconds);
+  stop = 1;
+  for( i = 0; i < cfg_senders; ++i )
+    TRY(-pthread_join(senders[i].thread, NULL));
+  end = bench_now_ns();
+  TRY(-pthread_join(poller, NULL));
+
+  memset(&all, 0, sizeof(all));
+  for( i = 0; i < cfg_senders; ++i ) {
+    n_sent += senders[i].n_sent;
+    bench_hist_merge(&all, &senders[i].hist);
+    close(senders[i].sock);
+  }
+  close(poll_sock);
+  free(senders);
+
+  printf("EF_TX_LOCK_DOMAINS=%s senders=%d len=%d\n",
+         mode, cfg_senders, cfg_len);
+  printf("  rate: %.0f msgs/sec\n", n_sent * 1e9 / (end - start));
+  bench_hist_print("send", &all);
+}
+
+
+int main(int argc, char* argv[])
+{
+  static const char* const modes[] = { "0", "1" };
+  const char* mode;
+  int c;
+
+  while( (c = getopt(argc, argv, "t:s:l:p:M:")) != -1 )
+    switch( c ) {
+    case 't':
+      cfg_senders = atoi(optarg);
+      break;
+    case 's':
+      cfg_seconds = atoi(optarg);
+      break;
+    case 'l':
+      cfg_len = atoi(optarg);
+      break;
+    case 'p':
+      cfg_port = atoi(optarg);
+      break;
+    case 'M':
+      break;
+    default:
+      usage();
+    }
+  if( optind != argc - 1 || cfg_senders < 1 || cfg_len < 0 ||
+      cfg_len > 1472 || ! inet_aton(argv[optind], &cfg_dest) )
+    usage();
+
+  /* Keep the poller in user space, polling the stack. */
+  setenv("EF_UDP_RECV_SPIN", "1", 0);
+  if( bench_run_modes(argc, argv, "EF_TX_LOCK_DOMAINS", modes, 2, &mode) )
+    run(mode);
+  return 0;
+}
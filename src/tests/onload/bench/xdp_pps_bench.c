@@ -0,0 +1,170 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/* Measures the packet rate of Onload over AF_XDP, with and without
+ * EF_AF_XDP_BUSY_POLL.
+ *
+ * Keeps a window of small datagrams in flight to a UDP echo service, and
+ * reports the rate at which replies come back.  Both the sends and the
+ * replies cross the AF_XDP interface, so this exercises TX kicks, fill
+ * ring wake-ups and busy polling.
+ *
+ * Usage: onload ./xdp_pps_bench [-w window] [-s seconds] [-l bytes]
+ *                               [-p port] [-u usec] <echo-ip>
+ *
+ * -u gives the EF_AF_XDP_BUSY_POLL value to compare with 0.  The busy
+ * polling run fails unless onload_stackdump shows that the stack made use
+ * of it, as the option is quietly ignored where the kernel refuses it.  A
+ * pair of
+ * veth interfaces is enough to run it on one host, for example:
+ *
+ *   ip netns add echo
+ *   ip link add veth0 type veth peer name veth1 netns echo
+ *   ip addr add 10.0.0.1/24 dev veth0; ip link set veth0 up
+ *   ip -n echo addr add 10.0.0.2/24 dev veth1; ip -n echo link set veth1 up
+ *   echo veth0 > /sys/module/sfc_resource/afxdp/register
+ *   ip netns exec echo socat UDP-RECVFROM:7,fork PIPE &
+ *   onload ./xdp_pps_bench -p 7 10.0.0.2
+ */
+#include "bench.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+
+static int cfg_window = 64;
+static int cfg_seconds = 5;
+static int cfg_len = 64;
+static int cfg_port = 7;
+static const char* cfg_usec = "50";
+static struct in_addr cfg_dest;
+
+
+/* Returns the af_xdp_busy_polls stat of the stack that [sock] is in, or -1
+ * if it can't be found. */
+static long long busy_polls(int sock)
+{
+  char path[64], link[64], cmd[64], line[256];
+  long long n = -1;
+  ssize_t len;
+  int stack_id;
+  FILE* f;
+
+  snprintf(path, sizeof(path), "/proc/self/fd/%d", sock);
+  if( (len = readlink(path, link, sizeof(link) - 1)) < 0 )
+    return -1;
+  link[len] = '\0';
+  if( sscanf(link, "onload:[%*[^:]:%d:", &stack_id) != 1 )
+    return -1;
+
+  snprintf(cmd, sizeof(cmd), "onload_stackdump %d stats", stack_id);
+  if( (f = popen(cmd, "r")) == NULL )
+    return -1;
+  while( fgets(line, sizeof(line), f) != NULL )
+    if( sscanf(line, " af_xdp_busy_polls: %lld", &n) == 1 )
+      break;
+  pclose(f);
+  return n;
+}
+
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: xdp_pps_bench [-w window] [-s seconds] "
+          "[-l bytes] [-p port] [-u usec] <echo-ip>\n");
+  exit(1);
+}
+
+
+static void run(const char* mode)
+{
+  struct sockaddr_in sa;
+  char buf[2048];
+  uint64_t start, end, now, last_reply;
+  uint64_t n_sent = 0, n_recv = 0, n_stalls = 0;
+  long long n_busy_polls;
+  int sock, in_flight = 0;
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr = cfg_dest;
+  sa.sin_port = htons(cfg_port);
+  TRY(sock = socket(AF_INET, SOCK_DGRAM, 0));
+  TRY(connect(sock, (struct sockaddr*) &sa, sizeof(sa)));
+
+  memset(buf, 0, sizeof(buf));
+  start = last_reply = bench_now_ns();
+  end = start + (uint64_t) cfg_seconds * 1000000000;
+  while( (now = bench_now_ns()) < end ) {
+    while( in_flight < cfg_window &&
+           send(sock, buf, cfg_len, MSG_DONTWAIT) == cfg_len ) {
+      ++in_flight;
+      ++n_sent;
+    }
+    while( recv(sock, buf, sizeof(buf), MSG_DONTWAIT) > 0 ) {
+      --in_flight;
+      ++n_recv;
+      last_reply = now;
+    }
+    /* Anything outstanding after 10ms is assumed lost. */
+    if( now - last_reply > 10000000 ) {
+      in_flight = 0;
+      last_reply = now;
+      ++n_stalls;
+    }
+  }
+  end = bench_now_ns();
+  n_busy_polls = busy_polls(sock);
+  close(sock);
+
+  printf("EF_AF_XDP_BUSY_POLL=%s window=%d len=%d\n",
+         mode, cfg_window, cfg_len);
+  printf("  rate: %.0f pkts/sec (sent %.0f pkts/sec)\n",
+         n_recv * 1e9 / (end - start), n_sent * 1e9 / (end - start));
+  printf("  stalls: %llu\n", (unsigned long long) n_stalls);
+  printf("  busy polls: %lld\n", n_busy_polls);
+  if( atoi(mode) != 0 && n_busy_polls <= 0 ) {
+    fprintf(stderr, "ERROR: busy polling is not in effect\n");
+    exit(1);
+  }
+}
+
+
+int main(int argc, char* argv[])
+{
+  const char* modes[2] = { "0", NULL };
+  const char* mode;
+  int c;
+
+  while( (c = getopt(argc, argv, "w:s:l:p:u:M:")) != -1 )
+    switch( c ) {
+    case 'w':
+      cfg_window = atoi(optarg);
+      break;
+    case 's':
+      cfg_seconds = atoi(optarg);
+      break;
+    case 'l':
+      cfg_len = atoi(optarg);
+      break;
+    case 'p':
+      cfg_port = atoi(optarg);
+      break;
+    case 'u':
+      cfg_usec = optarg;
+      break;
+    case 'M':
+      break;
+    default:
+      usage();
+    }
+  if( optind != argc - 1 || cfg_window < 1 || cfg_len < 0 ||
+      cfg_len > 1472 || atoi(cfg_usec) <= 0 ||
+      ! inet_aton(argv[optind], &cfg_dest) )
+    usage();
+
+  modes[1] = cfg_usec;
+  if( bench_run_modes(argc, argv, "EF_AF_XDP_BUSY_POLL", modes, 2, &mode) )
+    run(mode);
+  return 0;
+}
@@ -0,0 +1,109 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/* Functions under test */
+#include <ci/internal/ip.h>
+
+/* Test infrastructure */
+#include "unit_test.h"
+
+#define LIST 2
+
+static ci_netif* ni;
+static ci_sb_epoll_state* epoll;
+
+static void setup(void)
+{
+  ni = calloc(1, sizeof(*ni));
+  ni->state = calloc(1, sizeof(*ni->state));
+  epoll = calloc(CI_NI_READY_RING_SIZE + 1, sizeof(*epoll));
+}
+
+static void teardown(void)
+{
+  free(epoll);
+  free(ni->state);
+  free(ni);
+}
+
+static void test_empty(void)
+{
+  setup();
+  CHECK(ci_netif_ready_ring_get(ni, LIST), ==, OO_SP_NULL);
+  teardown();
+}
+
+static void test_fifo(void)
+{
+  int i;
+
+  setup();
+  for( i = 0; i < 3; ++i ) {
+    epoll[i].sock_id = 10 + i;
+    CHECK(ci_netif_ready_ring_put(ni, &epoll[i], LIST), ==, 1);
+    CHECK(epoll[i].ring_queued, ==, 1u << LIST);
+  }
+  CHECK(ni->state->stats.epoll_ring_pushes, ==, 3);
+  for( i = 0; i < 3; ++i )
+    CHECK(ci_netif_ready_ring_get(ni, LIST), ==, 10 + i);
+  CHECK(ci_netif_ready_ring_get(ni, LIST), ==, OO_SP_NULL);
+
+  /* Other rings are untouched */
+  CHECK(ni->state->ready_rings[0].added, ==, 0);
+  teardown();
+}
+
+/* A socket that is already queued is not queued again until the consumer
+ * clears its flag. */
+static void test_queued_once(void)
+{
+  setup();
+  epoll[0].sock_id = 7;
+  CHECK(ci_netif_ready_ring_put(ni, &epoll[0], LIST), ==, 1);
+  CHECK(ci_netif_ready_ring_put(ni, &epoll[0], LIST), ==, 1);
+  CHECK(ni->state->stats.epoll_ring_pushes, ==, 1);
+  CHECK(ci_netif_ready_ring_get(ni, LIST), ==, 7);
+  CHECK(ci_netif_ready_ring_get(ni, LIST), ==, OO_SP_NULL);
+
+  /* Queued on another set's ring independently */
+  CHECK(ci_netif_ready_ring_put(ni, &epoll[0], 0), ==, 1);
+  CHECK(epoll[0].ring_queued, ==, (1u << LIST) | 1u);
+
+  epoll[0].ring_queued &= ~(1u << LIST);
+  CHECK(ci_netif_ready_ring_put(ni, &epoll[0], LIST), ==, 1);
+  CHECK(ci_netif_ready_ring_get(ni, LIST), ==, 7);
+  teardown();
+}
+
+static void test_full(void)
+{
+  int i;
+
+  setup();
+  for( i = 0; i <= CI_NI_READY_RING_SIZE; ++i )
+    epoll[i].sock_id = i;
+  for( i = 0; i < CI_NI_READY_RING_SIZE; ++i )
+    CHECK(ci_netif_ready_ring_put(ni, &epoll[i], LIST), ==, 1);
+
+  /* The caller must fall back to the ready list */
+  CHECK(ci_netif_ready_ring_put(ni, &epoll[i], LIST), ==, 0);
+  CHECK(epoll[i].ring_queued, ==, 0);
+  CHECK(ni->state->stats.epoll_ring_overflows, ==, 1);
+
+  /* Space is reused once the consumer catches up, across the wrap */
+  CHECK(ci_netif_ready_ring_get(ni, LIST), ==, 0);
+  CHECK(ci_netif_ready_ring_put(ni, &epoll[i], LIST), ==, 1);
+  for( i = 1; i <= CI_NI_READY_RING_SIZE; ++i )
+    CHECK(ci_netif_ready_ring_get(ni, LIST), ==, i);
+  CHECK(ci_netif_ready_ring_get(ni, LIST), ==, OO_SP_NULL);
+  teardown();
+}
+
+int main(void)
+{
+  TEST_RUN(test_empty);
+  TEST_RUN(test_fifo);
+  TEST_RUN(test_queued_once);
+  TEST_RUN(test_full);
+  TEST_END();
+}
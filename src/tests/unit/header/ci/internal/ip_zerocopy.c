@@ -0,0 +1,125 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/* Functions under test */
+#include <ci/internal/ip.h>
+
+/* Test infrastructure */
+#include "unit_test.h"
+
+static ci_tcp_state* ts;
+static ci_uint32 enq_nxt;
+
+static void setup(ci_uint32 isn)
+{
+  ts = calloc(1, sizeof(*ts));
+  enq_nxt = isn;
+}
+
+static void teardown(void)
+{
+  free(ts);
+}
+
+/* A MSG_ZEROCOPY send: queue the data, then take an id without the lock */
+static void zc_send(ci_uint32 len)
+{
+  enq_nxt += len;
+  ++ts->zc.next_id;
+}
+
+/* What ci_tcp_zc_record() does under the stack lock */
+static int zc_record(ci_uint32 snd_una)
+{
+  ci_uint32 acked = ts->zc.acked;
+  ci_tcp_zc_queue(ts, ts->zc.next_id, enq_nxt);
+  ci_tcp_zc_ack(ts, snd_una);
+  return ts->zc.acked != acked;
+}
+
+/* The ACK for the whole send arrives before its range is recorded */
+static void test_ack_before_record(void)
+{
+  setup(1000);
+  zc_send(100);
+  CHECK(ci_tcp_zc_ack(ts, 1100), ==, 0);
+  CHECK(ts->zc.acked, ==, 0);
+  CHECK_TRUE(zc_record(1100));
+  CHECK(ts->zc.acked, ==, 1);
+  CHECK(ts->zc.queued, ==, 1);
+  teardown();
+}
+
+static void test_record_before_ack(void)
+{
+  setup(1000);
+  zc_send(100);
+  CHECK_FALSE(zc_record(1000));
+  CHECK(ci_tcp_zc_ack(ts, 1050), ==, 0);
+  CHECK(ts->zc.acked, ==, 0);
+  CHECK(ci_tcp_zc_ack(ts, 1100), ==, 1);
+  CHECK(ts->zc.acked, ==, 1);
+  CHECK(ci_tcp_zc_ack(ts, 1200), ==, 0);
+  teardown();
+}
+
+/* Sends behind the oldest unacked one are merged and complete together */
+static void test_merge(void)
+{
+  setup(1000);
+  zc_send(100);
+  CHECK_FALSE(zc_record(1000));
+  zc_send(100);
+  zc_send(100);
+  CHECK_FALSE(zc_record(1000));
+  CHECK(ts->zc.first_id, ==, 0);
+  CHECK(ts->zc.first_seq, ==, 1100);
+  CHECK(ts->zc.last_seq, ==, 1300);
+
+  CHECK(ci_tcp_zc_ack(ts, 1150), ==, 1);
+  CHECK(ts->zc.acked, ==, 1);
+  CHECK(ts->zc.first_id, ==, 2);
+  CHECK(ts->zc.first_seq, ==, 1300);
+  CHECK(ci_tcp_zc_ack(ts, 1250), ==, 0);
+  CHECK(ci_tcp_zc_ack(ts, 1300), ==, 1);
+  CHECK(ts->zc.acked, ==, 3);
+  teardown();
+}
+
+/* Several sends take ids before one of them gets the lock */
+static void test_batched_record(void)
+{
+  setup(1000);
+  zc_send(100);
+  zc_send(100);
+  CHECK_TRUE(zc_record(1200));
+  CHECK(ts->zc.acked, ==, 2);
+
+  zc_send(100);
+  zc_send(100);
+  CHECK_FALSE(zc_record(1200));
+  CHECK(ci_tcp_zc_ack(ts, 1400), ==, 1);
+  CHECK(ts->zc.acked, ==, 4);
+  teardown();
+}
+
+static void test_seq_wrap(void)
+{
+  setup(0xffffffc0);
+  zc_send(0x80);
+  CHECK_FALSE(zc_record(0xffffffc0));
+  CHECK(ci_tcp_zc_ack(ts, 0xfffffff0), ==, 0);
+  CHECK(ci_tcp_zc_ack(ts, 0x40), ==, 1);
+  CHECK(ts->zc.acked, ==, 1);
+  teardown();
+}
+
+int main(void)
+{
+  TEST_RUN(test_ack_before_record);
+  TEST_RUN(test_record_before_ack);
+  TEST_RUN(test_merge);
+  TEST_RUN(test_batched_record);
+  TEST_RUN(test_seq_wrap);
+  TEST_END();
+}
@@ -124,6 +124,96 @@ static void test_oo_epoll_frc_to_ns(void)
   test_frc_to_ns(0);
 }
 
+/* Stand-ins for stacks; only their addresses are used */
+static ci_netif stacks[CITP_EPOLL_MAX_POLL_STACKS + 1];
+
+static void test_poll_set_add(void)
+{
+  struct citp_epoll_poll_set ps = {};
+  int i;
+
+  CHECK(citp_epoll_poll_set_add(&ps, &stacks[0], 2), ==, 1);
+  CHECK(citp_epoll_poll_set_add(&ps, &stacks[0], 2), ==, 0);
+  CHECK(citp_epoll_poll_set_add(&ps, &stacks[1], 2), ==, 1);
+  CHECK(citp_epoll_poll_set_add(&ps, &stacks[2], 2), ==, -1);
+  CHECK(ps.n, ==, 2);
+
+  /* The limit is capped by the size of the set */
+  for( i = 2; i < CITP_EPOLL_MAX_POLL_STACKS; ++i )
+    CHECK(citp_epoll_poll_set_add(&ps, &stacks[i], 100), ==, 1);
+  CHECK(citp_epoll_poll_set_add(&ps, &stacks[i], 100), ==, -1);
+}
+
+static void test_poll_set_order(void)
+{
+  struct citp_epoll_poll_set ps = {};
+  ci_netif* home = &stacks[1];
+  /* Three turns for the home stack, one each for the others */
+  ci_netif* expect[] = { &stacks[0], home, home, home, &stacks[2],
+                         &stacks[0], home };
+  int i;
+
+  for( i = 0; i < 3; ++i )
+    citp_epoll_poll_set_add(&ps, &stacks[i], 4);
+  CHECK(citp_epoll_poll_set_round(&ps, home, 3), ==, 5);
+  CHECK(citp_epoll_poll_set_round(&ps, NULL, 3), ==, 3);
+  for( i = 0; i < sizeof(expect) / sizeof(expect[0]); ++i )
+    CHECK(citp_epoll_poll_set_next(&ps, home, 3), ==, expect[i]);
+
+  /* A stack added later joins the rotation */
+  citp_epoll_poll_set_add(&ps, &stacks[3], 4);
+  CHECK(citp_epoll_poll_set_next(&ps, home, 3), ==, home);
+  CHECK(citp_epoll_poll_set_next(&ps, home, 3), ==, home);
+  CHECK(citp_epoll_poll_set_next(&ps, home, 3), ==, &stacks[2]);
+  CHECK(citp_epoll_poll_set_next(&ps, home, 3), ==, &stacks[3]);
+  CHECK(citp_epoll_poll_set_next(&ps, home, 3), ==, &stacks[0]);
+}
+
+static void test_poll_set_del(void)
+{
+  struct citp_epoll_poll_set ps = {};
+  ci_netif* home = &stacks[1];
+  int i;
+
+  /* Two members in stacks[0], one in each of the others */
+  for( i = 0; i < CITP_EPOLL_MAX_POLL_STACKS; ++i )
+    citp_epoll_poll_set_add(&ps, &stacks[i], 100);
+  CHECK(citp_epoll_poll_set_add(&ps, &stacks[0], 100), ==, 0);
+  CHECK(ps.n_members[0], ==, 2);
+
+  CHECK(citp_epoll_poll_set_del(&ps, &stacks[0]), ==, 0);
+  CHECK(ps.n, ==, CITP_EPOLL_MAX_POLL_STACKS);
+  CHECK(citp_epoll_poll_set_del(&ps, &stacks[0]), ==, 1);
+  CHECK(ps.n, ==, CITP_EPOLL_MAX_POLL_STACKS - 1);
+
+  /* The freed slot can be used by another stack */
+  CHECK(citp_epoll_poll_set_add(&ps, &stacks[CITP_EPOLL_MAX_POLL_STACKS],
+                                100), ==, 1);
+  CHECK(citp_epoll_poll_set_add(&ps, &stacks[0], 100), ==, -1);
+  CHECK(ps.stacks[CITP_EPOLL_MAX_POLL_STACKS - 1], ==,
+        &stacks[CITP_EPOLL_MAX_POLL_STACKS]);
+
+  /* Removing the stack whose turn it is passes the turn on */
+  CHECK(citp_epoll_poll_set_next(&ps, home, 3), ==, home);
+  CHECK(citp_epoll_poll_set_del(&ps, home), ==, 1);
+  CHECK(citp_epoll_poll_set_next(&ps, NULL, 3), ==, &stacks[2]);
+
+  /* Removing one that has had its turn keeps the rotation going */
+  CHECK(citp_epoll_poll_set_del(&ps, &stacks[2]), ==, 1);
+  CHECK(citp_epoll_poll_set_next(&ps, NULL, 3), ==, &stacks[3]);
+
+  /* Removing the last in the set wraps round to the first */
+  for( i = 4; i < CITP_EPOLL_MAX_POLL_STACKS; ++i )
+    CHECK(citp_epoll_poll_set_next(&ps, NULL, 3), ==, &stacks[i]);
+  CHECK(citp_epoll_poll_set_del(&ps, &stacks[CITP_EPOLL_MAX_POLL_STACKS]),
+        ==, 1);
+  CHECK(citp_epoll_poll_set_next(&ps, NULL, 3), ==, &stacks[3]);
+
+  for( i = 3; i < CITP_EPOLL_MAX_POLL_STACKS; ++i )
+    CHECK(citp_epoll_poll_set_del(&ps, &stacks[i]), ==, 1);
+  CHECK(ps.n, ==, 0);
+}
+
 static void run_tests(unsigned cpu_khz)
 {
   oo_timesync_cpu_khz = cpu_khz;
@@ -160,6 +250,9 @@ int main(void)
   unsigned seed = time(NULL);
   int i;
   fprintf(stderr, "Running unit test ul_epoll.c with random seed: %u\n", seed);
+  TEST_RUN(test_poll_set_add);
+  TEST_RUN(test_poll_set_order);
+  TEST_RUN(test_poll_set_del);
   run_tests_with_seed(seed);
   for(i = 0; i < sizeof(regression_seeds)/sizeof(*regression_seeds); i++) {
     fprintf(stderr, "Testing for regressions with previously failing seed:%u\n",
@@ -0,0 +1,137 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/* Functions under test */
+#include <ci/tools.h>
+#include <ci/tools/crc32c.h>
+
+/* Test infrastructure */
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "unit_test.h"
+
+#define MAX_LEN   16384
+#define MAX_MISAL 16
+
+static ci_uint8* src_buf;
+static ci_uint8* dst_buf;
+
+
+/* Reference implementation: one bit at a time */
+static ci_uint32 ref_crc32c(const ci_uint8* buf, ci_uint32 len, ci_uint32 crc)
+{
+  int i;
+
+  while( len-- ) {
+    crc ^= *buf++;
+    for( i = 0; i < 8; ++i )
+      crc = (crc & 1) ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+  }
+  return crc;
+}
+
+
+static void setup(void)
+{
+  ci_uint32 seed = 1;
+  int i;
+
+  src_buf = malloc(MAX_LEN + MAX_MISAL);
+  dst_buf = malloc(MAX_LEN + MAX_MISAL);
+  for( i = 0; i < MAX_LEN + MAX_MISAL; ++i ) {
+    seed = seed * 1103515245 + 12345;
+    src_buf[i] = seed >> 16;
+  }
+}
+
+static void teardown(void)
+{
+  free(src_buf);
+  free(dst_buf);
+}
+
+
+static void test_check_value(void)
+{
+  /* The standard check value for CRC-32C */
+  CHECK(ci_crc32c((const ci_uint8*) "123456789", 9), ==, 0xe3069283);
+}
+
+
+/* Lengths either side of each of the stream block sizes */
+static void test_crc32c_partial(void)
+{
+  static const ci_uint32 seeds[] = { 0, 0xffffffff, 0x12345678 };
+  ci_uint32 len, misal;
+  int i;
+
+  setup();
+  for( len = 0; len <= MAX_LEN; len += len < 512 ? 1 : 61 )
+    for( misal = 0; misal < MAX_MISAL; misal += 3 )
+      for( i = 0; i < CI_ARRAY_SIZE(seeds); ++i )
+        CHECK(ci_crc32c_partial(src_buf + misal, len, seeds[i]), ==,
+              ref_crc32c(src_buf + misal, len, seeds[i]));
+
+  /* Feeding the buffer in pieces gives the same answer */
+  CHECK(ci_crc32c_partial(src_buf + 5000, MAX_LEN - 5000,
+                          ci_crc32c_partial(src_buf, 5000, 0xffffffff)), ==,
+        ci_crc32c_partial(src_buf, MAX_LEN, 0xffffffff));
+  teardown();
+}
+
+
+static void test_crc32c_partial_copy(void)
+{
+  ci_uint32 len;
+
+  setup();
+  for( len = 0; len <= MAX_LEN; len = len * 3 / 2 + 1 ) {
+    memset(dst_buf, 0, MAX_LEN + MAX_MISAL);
+    CHECK(ci_crc32c_partial_copy(dst_buf + 1, src_buf + 3, len, 0xffffffff),
+          ==, ref_crc32c(src_buf + 3, len, 0xffffffff));
+    CHECK_MEM(dst_buf + 1, src_buf + 3, len);
+    CHECK(dst_buf[len + 1], ==, 0);
+  }
+  teardown();
+}
+
+
+static ci_uint64 nsecs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void bench_crc32c(void)
+{
+  static const int sizes[] = { 64, 256, 1500, 9000 };
+  int i;
+
+  setup();
+  for( i = 0; i < CI_ARRAY_SIZE(sizes); ++i ) {
+    int len = sizes[i], iters = (64 << 20) / len, j;
+    volatile ci_uint32 sink = 0;
+    ci_uint64 t0, t1;
+
+    t0 = nsecs();
+    for( j = 0; j < iters; ++j )
+      sink += ci_crc32c_partial(src_buf + 1, len, j);
+    t1 = nsecs();
+    (void) sink;
+    printf("crc32c %5d bytes: %6.2f GB/s\n", len,
+           (double) len * iters / (t1 - t0));
+  }
+  teardown();
+}
+
+
+int main(void)
+{
+  TEST_RUN(test_check_value);
+  TEST_RUN(test_crc32c_partial);
+  TEST_RUN(test_crc32c_partial_copy);
+  TEST_RUN(bench_crc32c);
+  TEST_END();
+}
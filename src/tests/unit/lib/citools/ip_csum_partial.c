@@ -0,0 +1,228 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/* Functions under test */
+#include <ci/tools.h>
+#include <ci/tools/ipcsum_base.h>
+
+/* Test infrastructure */
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "unit_test.h"
+
+#define MAX_LEN   65536
+#define MAX_MISAL 64
+
+static const char* const impl_name[] = { "scalar", "avx2", "avx512" };
+static int max_impl;
+
+static ci_uint8* src_buf;
+static ci_uint8* dst_buf;
+static ci_uint8* ref_buf;
+
+
+/* Reference implementations: the original scalar loops */
+static unsigned ref_csum_partial(unsigned sum, const void* in_buf, int bytes)
+{
+  const ci_uint16* buf = in_buf;
+
+  while( bytes > 1 ) {
+    sum += *buf++;
+    bytes -= 2;
+  }
+  sum += bytes ? CI_BSWAP_LE16(*(ci_uint8*) buf) : 0;
+  return sum;
+}
+
+static unsigned ref_csum_copy2(void* dest, const void* src, int n,
+                               unsigned sum)
+{
+  ci_uint32* d4 = dest;
+  const ci_uint32* s4 = src;
+  ci_uint32 v;
+  int i;
+
+  for( i = 0; i < n >> 2; ++i ) {
+    *d4++ = v = *s4++;
+    ci_add_carry32(sum, v);
+  }
+  if( n & 2 ) {
+    v = *(const ci_uint16*) s4;
+    ci_add_carry32(sum, v);
+    *(ci_uint16*) d4 = v;
+  }
+  return sum;
+}
+
+
+static void setup(void)
+{
+  ci_uint32 seed = 1;
+  int i;
+
+  max_impl = ci_ip_csum_simd_level();
+  src_buf = malloc(MAX_LEN + MAX_MISAL);
+  dst_buf = malloc(MAX_LEN + MAX_MISAL);
+  ref_buf = malloc(MAX_LEN + MAX_MISAL);
+  for( i = 0; i < MAX_LEN + MAX_MISAL; ++i ) {
+    seed = seed * 1103515245 + 12345;
+    src_buf[i] = seed >> 16;
+  }
+}
+
+static void teardown(void)
+{
+  ci_ip_csum_simd = max_impl;
+  free(src_buf);
+  free(dst_buf);
+  free(ref_buf);
+}
+
+/* Lengths worth checking: everything around the vector widths, then a
+ * spread up to 64KB. */
+static int next_len(int len)
+{
+  if( len < 300 )
+    return len + 1;
+  return len * 5 / 4 + 1;
+}
+
+
+static void test_csum_partial(void)
+{
+  static const unsigned sums[] = { 0, 0x1234, 0xffff0000, 0xffffffff };
+  int impl, len, misal, i;
+
+  setup();
+  for( impl = CI_IP_CSUM_SCALAR; impl <= max_impl; ++impl ) {
+    ci_ip_csum_simd = impl;
+    for( len = 0; len <= MAX_LEN; len = next_len(len) )
+      for( misal = 0; misal < MAX_MISAL; misal += 7 )
+        for( i = 0; i < CI_ARRAY_SIZE(sums); ++i )
+          CHECK(ci_ip_csum_partial(sums[i], src_buf + misal, len), ==,
+                ref_csum_partial(sums[i], src_buf + misal, len));
+    /* All-ones data exercises the lane wrap-around. */
+    memset(ref_buf, 0xff, MAX_LEN);
+    CHECK(ci_ip_csum_partial(0, ref_buf, MAX_LEN), ==,
+          ref_csum_partial(0, ref_buf, MAX_LEN));
+  }
+  teardown();
+}
+
+
+static void test_csum_copy2(void)
+{
+  static const unsigned sums[] = { 0, 0x1234, 0xfffffffe, 0xffffffff };
+  int impl, len, smis, dmis, i;
+
+  setup();
+  for( impl = CI_IP_CSUM_SCALAR; impl <= max_impl; ++impl ) {
+    ci_ip_csum_simd = impl;
+    for( len = 0; len <= MAX_LEN; len = next_len(len + 1) & ~1 )
+      for( smis = 0; smis < MAX_MISAL; smis += 13 )
+        for( dmis = 0; dmis < 4; ++dmis )
+          for( i = 0; i < CI_ARRAY_SIZE(sums); ++i ) {
+            memset(dst_buf, 0, len + 8);
+            CHECK(ci_ip_csum_copy2(dst_buf + dmis, src_buf + smis, len,
+                                   sums[i]), ==,
+                  ref_csum_copy2(ref_buf, src_buf + smis, len, sums[i]));
+            CHECK_MEM(dst_buf + dmis, ref_buf, len);
+            CHECK(dst_buf[dmis + len], ==, 0);
+          }
+
+    /* Zero data and zero initial sum is the one case giving zero rather
+     * than 0xffffffff. */
+    memset(ref_buf, 0, MAX_LEN);
+    CHECK(ci_ip_csum_copy2(dst_buf, ref_buf, MAX_LEN, 0), ==, 0);
+    memset(ref_buf, 0xff, MAX_LEN);
+    CHECK(ci_ip_csum_copy2(dst_buf, ref_buf, MAX_LEN, 0), ==, 0xffffffff);
+  }
+  teardown();
+}
+
+
+/* Scatter the source over several uneven segments, and check the result
+ * matches a checksum of the linear copy. */
+static void test_csum_copy_iovec(void)
+{
+  static const int seg_lens[] = { 1, 3, 100, 0, 255, 4096, 7, 9000 };
+  struct iovec iov[CI_ARRAY_SIZE(seg_lens)];
+  int impl, i, off, total;
+
+  setup();
+  for( impl = CI_IP_CSUM_SCALAR; impl <= max_impl; ++impl ) {
+    ci_iovec_ptr piov;
+    unsigned sum = 0;
+
+    ci_ip_csum_simd = impl;
+    for( i = 0, off = 0; i < CI_ARRAY_SIZE(seg_lens); ++i ) {
+      iov[i].iov_base = src_buf + off;
+      iov[i].iov_len = seg_lens[i];
+      off += seg_lens[i] + 5;
+    }
+    for( i = 0, total = 0; i < CI_ARRAY_SIZE(seg_lens); ++i ) {
+      memcpy(ref_buf + total, iov[i].iov_base, seg_lens[i]);
+      total += seg_lens[i];
+    }
+
+    ci_iovec_ptr_init(&piov, iov, CI_ARRAY_SIZE(iov));
+    memset(dst_buf, 0, total);
+    CHECK(ci_ip_csum_copy_iovec(dst_buf, total, 0, &piov, &sum), ==, total);
+    CHECK_MEM(dst_buf, ref_buf, total);
+    CHECK(ci_ip_csum_fold(ci_ip_csum_fold(sum)), ==,
+          ci_ip_csum_fold(ci_ip_csum_fold(ci_ip_csum_aligned_c(ref_buf,
+                                                               total, 0))));
+  }
+  teardown();
+}
+
+
+static ci_uint64 nsecs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Throughput of each implementation at a few sizes, from an odd source
+ * address so the vector loads are all unaligned. */
+static void bench_csum(void)
+{
+  static const int sizes[] = { 64, 256, 1500, 9000, 65536 };
+  int impl, i;
+
+  setup();
+  printf("%-8s %6s %12s %12s\n", "", "bytes", "partial", "copy2");
+  for( impl = CI_IP_CSUM_SCALAR; impl <= max_impl; ++impl ) {
+    ci_ip_csum_simd = impl;
+    for( i = 0; i < CI_ARRAY_SIZE(sizes); ++i ) {
+      int len = sizes[i], iters = (64 << 20) / len, j;
+      volatile unsigned sink = 0;
+      ci_uint64 t0, t1, t2;
+
+      t0 = nsecs();
+      for( j = 0; j < iters; ++j )
+        sink += ci_ip_csum_partial(j, src_buf + 1, len);
+      t1 = nsecs();
+      for( j = 0; j < iters; ++j )
+        sink += ci_ip_csum_copy2(dst_buf + 2, src_buf + 1, len, j);
+      t2 = nsecs();
+      (void) sink;
+      printf("%-8s %6d %8.2f GB/s %8.2f GB/s\n", impl_name[impl], len,
+             (double) len * iters / (t1 - t0),
+             (double) len * iters / (t2 - t1));
+    }
+  }
+  teardown();
+}
+
+
+int main(void)
+{
+  TEST_RUN(test_csum_partial);
+  TEST_RUN(test_csum_copy2);
+  TEST_RUN(test_csum_copy_iovec);
+  TEST_RUN(bench_csum);
+  TEST_END();
+}
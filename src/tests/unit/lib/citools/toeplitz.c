@@ -0,0 +1,132 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/* Functions under test */
+#include <ci/internal/transport_config_opt.h>
+#include <ci/tools.h>
+
+/* Test infrastructure */
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "unit_test.h"
+
+#define N_TUPLES 4099
+#define MAX_TUPLE 36
+
+/* The key used by Onload, and its transformed form for the SSE hash */
+static const ci_uint8 key[40] = {
+  0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+  0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+  0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+  0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+  0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+};
+__attribute__((aligned(sizeof(ci_uint32))))
+static const ci_uint8 sse_key[40] = {
+  0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c,
+  0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c,
+  0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c,
+  0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c,
+  0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c, 0xb5, 0x6c,
+};
+
+static ci_uint32* tuples;
+static ci_uint32 hashes[N_TUPLES];
+
+
+static void setup(void)
+{
+  ci_uint32 seed = 1;
+  int i;
+
+  tuples = malloc(N_TUPLES * MAX_TUPLE);
+  for( i = 0; i < N_TUPLES * MAX_TUPLE / 4; ++i ) {
+    seed = seed * 1103515245 + 12345;
+    tuples[i] = seed ^ (seed >> 16);
+  }
+}
+
+static void teardown(void)
+{
+  free(tuples);
+}
+
+
+/* Every batch size up to a few vectors, plus one large odd-sized batch;
+ * the least significant byte must match the reference hash. */
+static void check_batch(int n)
+{
+  const ci_uint8* in = (const ci_uint8*) tuples;
+  int n_inputs, i;
+
+  for( n_inputs = 0; n_inputs <= N_TUPLES;
+       n_inputs += n_inputs < 40 ? 1 : N_TUPLES - 40 ) {
+    memset(hashes, 0xa5, sizeof(hashes));
+    ci_toeplitz_hash_batch(key, sse_key, in, n, n_inputs, hashes);
+    for( i = 0; i < n_inputs; ++i )
+      CHECK(hashes[i] & 0xff, ==, ci_toeplitz_hash(key, in + i * n, n) & 0xff);
+    if( n_inputs < N_TUPLES )
+      CHECK(hashes[n_inputs], ==, 0xa5a5a5a5);
+  }
+}
+
+static void test_batch_ip4(void)
+{
+  setup();
+  check_batch(12);
+  teardown();
+}
+
+static void test_batch_ip6(void)
+{
+#if CI_CFG_IPV6
+  setup();
+  check_batch(36);
+  teardown();
+#endif
+}
+
+
+static ci_uint64 nsecs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void bench_batch(void)
+{
+  const ci_uint8* in;
+  volatile ci_uint32 sink = 0;
+  ci_uint64 t0, t1, t2;
+  int iters = 256, i, j;
+
+  setup();
+  in = (const ci_uint8*) tuples;
+
+  t0 = nsecs();
+  for( j = 0; j < iters; ++j )
+    for( i = 0; i < N_TUPLES; ++i )
+      sink += ci_toeplitz_hash_ul(key, sse_key, in + i * 12, 12);
+  t1 = nsecs();
+  for( j = 0; j < iters; ++j ) {
+    ci_toeplitz_hash_batch(key, sse_key, in, 12, N_TUPLES, hashes);
+    sink += hashes[j];
+  }
+  t2 = nsecs();
+  (void) sink;
+  printf("toeplitz ip4: single %.2f ns/tuple, batch %.2f ns/tuple\n",
+         (double) (t1 - t0) / (iters * N_TUPLES),
+         (double) (t2 - t1) / (iters * N_TUPLES));
+  teardown();
+}
+
+
+int main(void)
+{
+  TEST_RUN(test_batch_ip4);
+  TEST_RUN(test_batch_ip6);
+  TEST_RUN(bench_batch);
+  TEST_END();
+}
@@ -0,0 +1,339 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/* Functions under test */
+#include <ci/internal/ip.h>
+
+/* Test infrastructure */
+#include "unit_test.h"
+#include <string.h>
+#include <time.h>
+
+#define N_SOCKS      4
+#define BENCH_TIMERS (1u << 20)
+
+static ci_netif* ni;
+static ci_pmtu_state_t* timers;
+static ci_iptime_t* expect;
+static unsigned n_timers;
+
+/* Results of timer callbacks */
+static unsigned fired, early, max_late;
+static int tcp_fired[CI_IP_TIMER_TCP_COALESCE];
+static ci_iptime_t tcp_fired_at[CI_IP_TIMER_TCP_COALESCE];
+
+
+/* Generic timers are disguised as PMTU timers so that the callback can tell
+ * which one fired. */
+void ci_pmtu_timeout_pmtu(ci_netif* netif, ci_pmtu_state_t* pmtus)
+{
+  ci_iptime_t now = IPTIMER_STATE(netif)->sched_ticks;
+  ci_iptime_t t = expect[pmtus - timers];
+
+  ++fired;
+  if( TIME_LT(now, t) )
+    ++early;
+  else if( now - t > max_late )
+    max_late = now - t;
+}
+
+static void tcp_fire(ci_tcp_state* ts, int fn)
+{
+  ++tcp_fired[fn];
+  tcp_fired_at[fn] = IPTIMER_STATE(ni)->sched_ticks;
+}
+
+/* Have the RTO callback free the socket, as ci_tcp_drop() does for an
+ * orphan.  The rest of the buffer is left as it was, so that any further
+ * use of it shows up. */
+static int drop_on_rto;
+
+void ci_tcp_timeout_rto(ci_netif* netif, ci_tcp_state* ts)
+{
+  tcp_fire(ts, CI_IP_TIMER_TCP_RTO);
+  if( drop_on_rto )
+    ts->s.b.state = CI_TCP_STATE_FREE;
+}
+void ci_tcp_timeout_delack(ci_netif* netif, ci_tcp_state* ts)
+{ tcp_fire(ts, CI_IP_TIMER_TCP_DELACK); }
+void ci_tcp_timeout_kalive(ci_netif* netif, ci_tcp_state* ts)
+{ tcp_fire(ts, CI_IP_TIMER_TCP_KALIVE); }
+
+
+static ci_tcp_state* sock(int i)
+{
+  return (ci_tcp_state*) ((char*) ni->state + ni->state->ep_ofs +
+                          i * EP_BUF_SIZE);
+}
+
+static void init_timer(ci_ip_timer* t, int fn)
+{
+  ci_ip_timer_init(ni, t, oo_state_ptr_to_statep(ni, t), "test");
+  t->fn = fn;
+}
+
+/* Lay out the state as [ci_netif_state][sockets][timers], and initialise
+ * the wheel as ci_ip_timer_state_init() does. */
+static void setup(unsigned n, unsigned budget, int coalesce)
+{
+  size_t ep_ofs = CI_ROUND_UP(sizeof(ci_netif_state), EP_BUF_SIZE);
+  size_t len = ep_ofs + N_SOCKS * EP_BUF_SIZE + n * sizeof(ci_pmtu_state_t);
+  ci_ip_timer_state* ipts;
+  unsigned i;
+
+  ni = calloc(1, sizeof(*ni));
+  ni->state = calloc(1, len);
+  *(ci_uint32*) &ni->state->ep_ofs = ep_ofs;
+  *(ci_uint32*) &ni->state->n_ep_bufs = N_SOCKS;
+  NI_OPTS(ni).timer_cascade_budget = budget;
+  NI_OPTS(ni).tcp_timer_coalesce = coalesce;
+
+  ipts = IPTIMER_STATE(ni);
+  ipts->closest_timer = 2 * CI_IPTIME_BUCKETS;
+  oo_p_dllink_init(ni, oo_p_dllink_ptr(ni, &ipts->fire_list));
+  oo_p_dllink_init(ni, oo_p_dllink_ptr(ni, &ipts->cascade_list));
+  oo_p_dllink_init(ni, oo_p_dllink_ptr(ni, &ipts->coalesce_list));
+  for( i = 0; i < CI_IPTIME_WHEELSIZE; i++ )
+    oo_p_dllink_init(ni, oo_p_dllink_ptr(ni, &ipts->warray[i]));
+
+  for( i = 0; i < N_SOCKS; ++i ) {
+    ci_tcp_state* ts = sock(i);
+    init_timer(&ts->rto_tid, CI_IP_TIMER_TCP_RTO);
+    init_timer(&ts->delack_tid, CI_IP_TIMER_TCP_DELACK);
+    init_timer(&ts->zwin_tid, CI_IP_TIMER_TCP_ZWIN);
+    init_timer(&ts->kalive_tid, CI_IP_TIMER_TCP_KALIVE);
+    init_timer(&ts->cork_tid, CI_IP_TIMER_TCP_CORK);
+    init_timer(&ts->pace_tid, CI_IP_TIMER_TCP_PACE);
+    init_timer(&ts->coalesce_tid, CI_IP_TIMER_TCP_COALESCE);
+  }
+
+  n_timers = n;
+  timers = (void*) ((char*) ni->state + ep_ofs + N_SOCKS * EP_BUF_SIZE);
+  expect = calloc(n, sizeof(*expect));
+  for( i = 0; i < n; ++i )
+    init_timer(&timers[i].tid, CI_IP_TIMER_PMTU_DISCOVER);
+
+  fired = early = max_late = 0;
+  memset(tcp_fired, 0, sizeof(tcp_fired));
+  drop_on_rto = 0;
+}
+
+static void teardown(void)
+{
+  free(expect);
+  free(ni->state);
+  free(ni);
+}
+
+static void set(unsigned i, ci_iptime_t t)
+{
+  expect[i] = t;
+  ci_ip_timer_set(ni, &timers[i].tid, t);
+}
+
+/* Advance time by one tick and poll */
+static void tick(void)
+{
+  ++IPTIMER_STATE(ni)->ci_ip_time_real_ticks;
+  ci_ip_timer_poll(ni);
+}
+
+static ci_iptime_t now(void)
+{
+  return IPTIMER_STATE(ni)->sched_ticks;
+}
+
+
+/* Timers at the edges of each wheel fire exactly on time. */
+static void test_wheel_exact(void)
+{
+  static const ci_iptime_t times[] = {
+    1, 2, 255, 256, 257, 300, 511, 65535, 65536, 65537, 70000, 131072 + 3,
+  };
+  unsigned i;
+
+  setup(CI_ARRAY_SIZE(times), 0, 0);
+  for( i = 0; i < CI_ARRAY_SIZE(times); ++i )
+    set(i, times[i]);
+  while( fired < n_timers && now() < 200000 )
+    tick();
+
+  CHECK(fired, ==, n_timers);
+  CHECK(early, ==, 0);
+  CHECK(max_late, ==, 0);
+  teardown();
+}
+
+
+/* With a cascade budget, a large bucket is redistributed over several
+ * polls; every timer still fires, none early, and late ones are bounded by
+ * the time taken to drain the bucket. */
+static void test_cascade_budget(void)
+{
+  const unsigned n = 1000, budget = 64;
+  unsigned i;
+
+  setup(n, budget, 0);
+  /* All in the same wheel1 bucket, cascaded at tick 512. */
+  for( i = 0; i < n; ++i )
+    set(i, 512 + (i % 256));
+  while( now() < 511 )
+    tick();
+  CHECK(fired, ==, 0);
+
+  tick();
+  /* The first poll after the boundary moves only [budget] timers. */
+  CHECK(IPTIMER_STATE(ni)->closest_timer, ==, now() + 1);
+
+  while( fired < n && now() < 2000 )
+    tick();
+  CHECK(fired, ==, n);
+  CHECK(early, ==, 0);
+  CHECK(max_late, <=, (n + budget - 1) / budget);
+  teardown();
+}
+
+
+/* With coalescing, a socket has a single wheel entry at its earliest
+ * deadline. */
+static void test_coalesce(void)
+{
+  ci_tcp_state* ts;
+
+  setup(0, 0, 1);
+  ts = sock(1);
+
+  ci_ip_timer_set(ni, &ts->rto_tid, 100);
+  ci_ip_timer_set(ni, &ts->kalive_tid, 1000);
+  ci_ip_timer_set(ni, &ts->delack_tid, 10);
+  CHECK_TRUE(ci_ip_timer_pending(ni, &ts->rto_tid));
+  CHECK_TRUE(ci_ip_timer_pending(ni, &ts->delack_tid));
+  CHECK_TRUE(ci_ip_timer_pending(ni, &ts->coalesce_tid));
+  CHECK(ts->coalesce_tid.time, ==, 10);
+  CHECK(IPTIMER_STATE(ni)->closest_timer, ==, 10);
+
+  while( now() < 10 )
+    tick();
+  CHECK(tcp_fired[CI_IP_TIMER_TCP_DELACK], ==, 1);
+  CHECK(tcp_fired_at[CI_IP_TIMER_TCP_DELACK], ==, 10);
+  CHECK_FALSE(ci_ip_timer_pending(ni, &ts->delack_tid));
+  CHECK(ts->coalesce_tid.time, ==, 100);
+
+  /* Moving a timer earlier pulls the socket's entry in. */
+  ci_ip_timer_modify(ni, &ts->kalive_tid, 50);
+  CHECK(ts->coalesce_tid.time, ==, 50);
+  while( now() < 100 )
+    tick();
+  CHECK(tcp_fired[CI_IP_TIMER_TCP_KALIVE], ==, 1);
+  CHECK(tcp_fired_at[CI_IP_TIMER_TCP_KALIVE], ==, 50);
+  CHECK(tcp_fired[CI_IP_TIMER_TCP_RTO], ==, 1);
+  CHECK(tcp_fired_at[CI_IP_TIMER_TCP_RTO], ==, 100);
+  CHECK_FALSE(ci_ip_timer_pending(ni, &ts->coalesce_tid));
+
+  /* Clearing is lazy: the entry fires with nothing to do. */
+  ci_ip_timer_set(ni, &ts->rto_tid, 200);
+  ci_ip_timer_clear(ni, &ts->rto_tid);
+  while( now() < 300 )
+    tick();
+  CHECK(tcp_fired[CI_IP_TIMER_TCP_RTO], ==, 1);
+  CHECK_FALSE(ci_ip_timer_pending(ni, &ts->coalesce_tid));
+  teardown();
+}
+
+/* Once a callback has freed the socket, none of its other timers are run
+ * or rearmed. */
+static void test_coalesce_drop(void)
+{
+  ci_tcp_state* ts;
+
+  setup(0, 0, 1);
+  ts = sock(2);
+  drop_on_rto = 1;
+
+  ci_ip_timer_set(ni, &ts->rto_tid, 10);
+  ci_ip_timer_set(ni, &ts->delack_tid, 10);
+  ci_ip_timer_set(ni, &ts->kalive_tid, 1000);
+  while( now() < 1100 )
+    tick();
+  CHECK(tcp_fired[CI_IP_TIMER_TCP_RTO], ==, 1);
+  CHECK(tcp_fired[CI_IP_TIMER_TCP_DELACK], ==, 0);
+  CHECK(tcp_fired[CI_IP_TIMER_TCP_KALIVE], ==, 0);
+  CHECK_FALSE(ci_ip_timer_pending(ni, &ts->coalesce_tid));
+  teardown();
+}
+
+
+static ci_uint64 nsecs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Microbenchmark: set, clear and expire a million timers spread over the
+ * first three wheels, and report the worst single poll. */
+static void bench(unsigned budget)
+{
+  ci_uint64 t0, t1, worst = 0;
+  ci_uint32 seed = 1;
+  ci_iptime_t end = 0;
+  unsigned i, n = BENCH_TIMERS;
+
+  setup(n, budget, 0);
+
+  t0 = nsecs();
+  for( i = 0; i < n; ++i ) {
+    seed = seed * 1103515245 + 12345;
+    set(i, 1 + (seed >> 8) % (1u << 17));
+  }
+  t1 = nsecs();
+  printf("  budget=%u: set %.1f ns/timer\n", budget, (double) (t1 - t0) / n);
+
+  t0 = nsecs();
+  for( i = 0; i < n; i += 2 )
+    ci_ip_timer_clear(ni, &timers[i].tid);
+  t1 = nsecs();
+  printf("  budget=%u: clear %.1f ns/timer\n", budget,
+         (double) (t1 - t0) / (n / 2));
+
+  for( i = 1; i < n; i += 2 )
+    if( TIME_GT(expect[i], end) )
+      end = expect[i];
+
+  t0 = nsecs();
+  while( TIME_LT(now(), end) || fired < n / 2 ) {
+    ci_uint64 p0 = nsecs(), p1;
+    tick();
+    p1 = nsecs();
+    if( p1 - p0 > worst )
+      worst = p1 - p0;
+    if( TIME_GT(now(), end + 1000) )
+      break;
+  }
+  t1 = nsecs();
+  printf("  budget=%u: expire %.1f ns/timer, worst poll %.1f us, "
+         "max late %u ticks\n", budget, (double) (t1 - t0) / (n / 2),
+         worst / 1000.0, max_late);
+
+  CHECK(fired, ==, n / 2);
+  CHECK(early, ==, 0);
+  teardown();
+}
+
+static void bench_1m_timers(void)
+{
+  printf("%u timers:\n", BENCH_TIMERS);
+  bench(0);
+  bench(1024);
+}
+
+
+int main(void)
+{
+  TEST_RUN(test_wheel_exact);
+  TEST_RUN(test_cascade_budget);
+  TEST_RUN(test_coalesce);
+  TEST_RUN(test_coalesce_drop);
+  TEST_RUN(bench_1m_timers);
+  TEST_END();
+}
@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/* Functions under test */
+#include <ci/internal/ip.h>
+
+/* Test infrastructure */
+#include "unit_test.h"
+#include <string.h>
+
+
+/* Each bucket's lower bound maps back to the bucket, the value below it to
+ * the previous bucket, and buckets are no wider than 1/8 of their bound. */
+static void test_bucket_bounds(void)
+{
+  unsigned b;
+
+  CHECK(ci_lat_hist_bucket(0), ==, 0);
+  CHECK(ci_lat_hist_bucket_min(0), ==, 0);
+  for( b = 1; b < CI_LAT_HIST_BUCKETS; ++b ) {
+    ci_uint64 lo = ci_lat_hist_bucket_min(b);
+    ci_uint64 prev = ci_lat_hist_bucket_min(b - 1);
+    CHECK(ci_lat_hist_bucket(lo), ==, b);
+    CHECK(ci_lat_hist_bucket(lo - 1), ==, b - 1);
+    CHECK(lo, >, prev);
+    if( prev >= 8 )
+      CHECK((lo - prev) * 8, <=, prev);
+  }
+
+  CHECK(ci_lat_hist_bucket((1ull << CI_LAT_HIST_MAX_ORDER) - 1), ==,
+        CI_LAT_HIST_BUCKETS - 1);
+  CHECK(ci_lat_hist_bucket(1ull << CI_LAT_HIST_MAX_ORDER), ==,
+        CI_LAT_HIST_BUCKETS - 1);
+  CHECK(ci_lat_hist_bucket(~0ull), ==, CI_LAT_HIST_BUCKETS - 1);
+}
+
+
+static void test_record(void)
+{
+  static ci_lat_hist h;
+  unsigned i;
+
+  memset(&h, 0, sizeof(h));
+  CHECK(ci_lat_hist_count(&h), ==, 0);
+  CHECK(ci_lat_hist_percentile(&h, 0, 500000), ==, 0);
+
+  /* 1..1000 cycles, once each */
+  for( i = 1; i <= 1000; ++i )
+    ci_lat_hist_record(&h, i);
+  CHECK(ci_lat_hist_count(&h), ==, 1000);
+  CHECK(h.sum, ==, 500500);
+  CHECK(h.max, ==, 1000);
+
+  /* Percentiles are rounded up to the top of the bucket, so are within
+   * 1/8 above the exact value. */
+  CHECK(ci_lat_hist_percentile(&h, 1000, 500000), >=, 500);
+  CHECK(ci_lat_hist_percentile(&h, 1000, 500000), <=, 500 + 500 / 8);
+  CHECK(ci_lat_hist_percentile(&h, 1000, 990000), >=, 990);
+  CHECK(ci_lat_hist_percentile(&h, 1000, 990000), <=, 1000);
+  CHECK(ci_lat_hist_percentile(&h, 1000, 1000000), ==, 1000);
+  CHECK(ci_lat_hist_percentile(&h, 1000, 0), ==, 1);
+
+  /* A single outlier shows at the tail only. */
+  ci_lat_hist_record(&h, 1ull << 30);
+  CHECK(h.max, ==, 1ull << 30);
+  CHECK(ci_lat_hist_percentile(&h, 1001, 999000), <, 1024);
+  CHECK(ci_lat_hist_percentile(&h, 1001, 1000000), ==, 1ull << 30);
+}
+
+
+int main(void)
+{
+  TEST_RUN(test_bucket_bounds);
+  TEST_RUN(test_record);
+  TEST_END();
+}
@@ -0,0 +1,188 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/* Functions under test */
+#include <ci/internal/ip.h>
+
+/* Test infrastructure */
+#include "unit_test.h"
+#include <string.h>
+
+#define N_SETS 4
+
+static ci_netif* ni;
+
+/* Fields that are read-only at user level */
+#define SET_ULCONST(lval, type, val)  (*(type*) &(lval) = (val))
+
+/* Sets on nodes 0, 1, 0, 1 with the given numbers of free packets */
+static void setup(int local, int f0, int f1, int f2, int f3)
+{
+  int n_free[N_SETS] = { f0, f1, f2, f3 };
+  int i;
+
+  ni = calloc(1, sizeof(*ni));
+  ni->state = calloc(1, sizeof(*ni->state));
+  ni->packets = calloc(1, sizeof(*ni->packets) +
+                          N_SETS * sizeof(ni->packets->set[0]));
+  NI_OPTS(ni).packet_numa_local = local;
+  SET_ULCONST(ni->state->pkt_numa_node, ci_int32, 0);
+  SET_ULCONST(ni->packets->sets_n, ci_uint32, N_SETS);
+  SET_ULCONST(ni->packets->sets_max, ci_uint32, N_SETS);
+  for( i = 0; i < N_SETS; ++i ) {
+    SET_ULCONST(ni->packets->set[i].numa_node, ci_int8, i & 1);
+    ni->packets->set[i].n_free = n_free[i];
+    ni->packets->n_free += n_free[i];
+  }
+}
+
+static void teardown(void)
+{
+  free(ni->packets);
+  free(ni->state);
+  free(ni);
+}
+
+static void test_any_node(void)
+{
+  setup(0, 10, 20, 5, 0);
+  CHECK(ci_netif_pktset_best(ni), ==, 1);
+  teardown();
+
+  setup(0, 0, 0, 0, 0);
+  CHECK(ci_netif_pktset_best(ni), ==, -1);
+  teardown();
+}
+
+static void test_local_first(void)
+{
+  /* The fullest local set wins over a fuller remote one */
+  setup(1, 10, 200, 30, 0);
+  CHECK(ci_netif_pktset_best(ni), ==, 2);
+  CHECK(ni->state->stats.pkt_numa_remote_picks, ==, 0);
+  teardown();
+
+  /* Remote sets are used once local ones are empty */
+  setup(1, 0, 20, 0, 40);
+  CHECK(ci_netif_pktset_best(ni), ==, 3);
+  CHECK(ni->state->stats.pkt_numa_remote_picks, ==, 1);
+  teardown();
+
+  /* No preference when the node is unknown */
+  setup(1, 10, 200, 30, 0);
+  SET_ULCONST(ni->state->pkt_numa_node, ci_int32, -1);
+  CHECK(ci_netif_pktset_best(ni), ==, 1);
+  teardown();
+}
+
+static void test_high_water(void)
+{
+  /* An almost-free local set is taken without looking further */
+  setup(1, CI_CFG_PKT_SET_HIGH_WATER, 0, CI_CFG_PKT_SET_HIGH_WATER + 1, 0);
+  CHECK(ci_netif_pktset_best(ni), ==, 0);
+  teardown();
+}
+
+/* A stack with one set of packets, N_NONB of which are in the nonb pool */
+#define N_NONB 10
+
+static void setup_nonb(void)
+{
+  ci_ip_pkt_fmt* pkt;
+  int i;
+
+  setup(0, 0, 0, 0, 0);
+  SET_ULCONST(ni->packets->n_pkts_allocated, ci_int32, PKTS_PER_SET);
+  ni->pkt_bufs = calloc(1, sizeof(ni->pkt_bufs[0]));
+  ni->pkt_bufs[0] = calloc(PKTS_PER_SET, CI_CFG_PKT_BUF_SIZE);
+  ni->state->nonb_pkt_pool = CI_ILL_END;
+  for( i = 0; i < N_NONB; ++i ) {
+    pkt = (ci_ip_pkt_fmt*) (ni->pkt_bufs[0] + i * CI_CFG_PKT_BUF_SIZE);
+    OO_PKT_PP_INIT(pkt, i);
+    pkt->flags = CI_PKT_FLAG_NONB_POOL;
+    ci_netif_pkt_free_nonb_list(ni, OO_PKT_P(pkt), pkt);
+  }
+}
+
+static void teardown_nonb(void)
+{
+  free(ni->pkt_bufs[0]);
+  free(ni->pkt_bufs);
+  teardown();
+}
+
+static int nonb_pool_len(void)
+{
+  unsigned id = ni->state->nonb_pkt_pool & 0xffffffff;
+  oo_pkt_p pp;
+  int n = 0;
+
+  while( id != 0xffffffff ) {
+    OO_PP_INIT(ni, pp, id);
+    id = OO_PP_ID(PKT(ni, pp)->next);
+    ++n;
+  }
+  return n;
+}
+
+static void test_magazine_refill(void)
+{
+  static struct oo_pkt_magazine mag;
+  ci_uint64 tag;
+
+  setup_nonb();
+  memset(&mag, 0, sizeof(mag));
+
+  /* Buffers come off the top of the pool, most recently freed first */
+  CHECK(oo_pkt_magazine_refill(ni, &mag, 4), ==, 4);
+  CHECK(mag.n, ==, 4);
+  CHECK(OO_PP_ID(mag.pkts[0]), ==, N_NONB - 1);
+  CHECK(OO_PP_ID(mag.pkts[3]), ==, N_NONB - 4);
+  CHECK(nonb_pool_len(), ==, N_NONB - 4);
+  CHECK(ni->state->nonb_pkt_pool & 0xffffffff, ==, N_NONB - 5);
+
+  /* Returning them is a single push, which bumps the tag */
+  tag = ni->state->nonb_pkt_pool >> 32;
+  mag.hits = 3;
+  oo_pkt_magazine_flush(ni, &mag);
+  CHECK(mag.n, ==, 0);
+  CHECK(mag.hits, ==, 0);
+  CHECK(ni->state->stats.pkt_mag_hits, ==, 3);
+  CHECK(ni->state->stats.pkt_mag_flushes, ==, 1);
+  CHECK(ni->state->nonb_pkt_pool >> 32, ==, tag + 1);
+  CHECK(nonb_pool_len(), ==, N_NONB);
+
+  /* A short pool is emptied */
+  CHECK(oo_pkt_magazine_refill(ni, &mag, OO_PKT_MAGAZINE_MAX), ==, N_NONB);
+  CHECK(ni->state->nonb_pkt_pool & 0xffffffff, ==, 0xffffffff);
+  oo_pkt_magazine_flush(ni, &mag);
+
+  teardown_nonb();
+}
+
+static void test_magazine_empty(void)
+{
+  static struct oo_pkt_magazine mag;
+
+  setup_nonb();
+  memset(&mag, 0, sizeof(mag));
+  ni->state->nonb_pkt_pool = CI_ILL_END;
+  CHECK(oo_pkt_magazine_refill(ni, &mag, 8), ==, 0);
+  CHECK(ni->state->stats.pkt_mag_empty, ==, 1);
+
+  /* Flushing an empty magazine is a no-op */
+  oo_pkt_magazine_flush(ni, &mag);
+  CHECK(ni->state->stats.pkt_mag_flushes, ==, 0);
+  CHECK(ni->state->nonb_pkt_pool, ==, CI_ILL_END);
+  teardown_nonb();
+}
+
+int main(void)
+{
+  TEST_RUN(test_any_node);
+  TEST_RUN(test_local_first);
+  TEST_RUN(test_high_water);
+  TEST_RUN(test_magazine_refill);
+  TEST_RUN(test_magazine_empty);
+  TEST_END();
+}
@@ -0,0 +1,336 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/* Functions under test */
+#include <ci/internal/ip.h>
+
+/* Test infrastructure */
+#include "unit_test.h"
+#include <string.h>
+#include <time.h>
+
+#define N_SOCKS       1024
+#define SMALL_LG2     16
+#define BENCH_LG2     21
+#define BENCH_ENTRIES (1u << 20)
+#define BENCH_CHURN   4
+
+static ci_netif* ni;
+static void* mem;
+
+
+/* Socket [i] is connected to a distinct remote address and port, apart from
+ * the last few which are unconnected, so as to allow duplicate tuples. */
+#define N_WILD 16
+#define SOCK_WILD(i) ((i) >= N_SOCKS - N_WILD)
+
+static ci_sock_cmn* sock(int i)
+{
+  return (ci_sock_cmn*) ((char*) ni->state + ni->state->ep_ofs +
+                         i * EP_BUF_SIZE);
+}
+
+/* Filter [j] belongs to socket [j % N_SOCKS] and has a unique laddr, as a
+ * socket may only hold several filters with different local addresses. */
+static unsigned key_sock(unsigned j)   { return j % (N_SOCKS - N_WILD); }
+static unsigned key_laddr(unsigned j)  { return CI_BSWAP_BE32(0xac100000 + j); }
+static unsigned key_lport(unsigned j)
+{ return CI_BSWAP_BE16(1024 + (j * 2654435761u >> 17)); }
+
+static ci_addr_t addr4(unsigned ip)
+{
+  return CI_ADDR_FROM_IP4(ip);
+}
+
+static int insert(unsigned j)
+{
+  ci_sock_cmn* s = sock(key_sock(j));
+  return ci_netif_filter_insert(ni, OO_SP_FROM_INT(ni, key_sock(j)),
+                                AF_SPACE_FLAG_IP4,
+                                addr4(key_laddr(j)), key_lport(j),
+                                addr4(sock_raddr_be32(s)), sock_rport_be16(s),
+                                IPPROTO_TCP);
+}
+
+static void remove_key(unsigned j)
+{
+  ci_sock_cmn* s = sock(key_sock(j));
+  ci_netif_filter_remove(ni, OO_SP_FROM_INT(ni, key_sock(j)),
+                         AF_SPACE_FLAG_IP4,
+                         addr4(key_laddr(j)), key_lport(j),
+                         addr4(sock_raddr_be32(s)), sock_rport_be16(s),
+                         IPPROTO_TCP);
+}
+
+static oo_sp lookup(unsigned j)
+{
+  ci_sock_cmn* s = sock(key_sock(j));
+  return ci_netif_filter_lookup(ni, AF_SPACE_FLAG_IP4,
+                                addr4(key_laddr(j)), key_lport(j),
+                                addr4(sock_raddr_be32(s)), sock_rport_be16(s),
+                                IPPROTO_TCP);
+}
+
+
+/* Lay out the state as [ci_netif_state][sockets][table][table ext] and
+ * initialise the table as ci_netif_filter_init() does. */
+static void setup(int size_lg2, int cuckoo)
+{
+  size_t ep_ofs = CI_ROUND_UP(sizeof(ci_netif_state), EP_BUF_SIZE);
+  size_t table_ofs = ep_ofs + N_SOCKS * EP_BUF_SIZE;
+  size_t size = 1u << size_lg2;
+  size_t ext_ofs = table_ofs + sizeof(ci_netif_filter_table) +
+                   sizeof(ci_netif_filter_table_entry_fast) * size;
+  size_t len = ext_ofs + sizeof(ci_netif_filter_table_entry_ext) * size;
+  unsigned i;
+
+  ni = calloc(1, sizeof(*ni));
+  mem = aligned_alloc(CI_CACHE_LINE_SIZE, CI_ROUND_UP(len, CI_CACHE_LINE_SIZE));
+  memset(mem, 0, len);
+  ni->state = mem;
+  *(ci_uint32*) &ni->state->ep_ofs = ep_ofs;
+  *(ci_uint32*) &ni->state->n_ep_bufs = N_SOCKS;
+  ni->state->lock.lock = CI_EPLOCK_LOCKED;
+  NI_OPTS(ni).filter_table_cuckoo = cuckoo;
+
+  for( i = 0; i < N_SOCKS; ++i ) {
+    ci_sock_cmn* s = sock(i);
+    s->pkt.ether_type = CI_ETHERTYPE_IP;
+    s->pkt.ipx.ip4.ip_protocol = IPPROTO_TCP;
+    s->rx_bind2dev_ifindex = CI_IFID_BAD;
+    if( ! SOCK_WILD(i) ) {
+      sock_raddr_be32(s) = CI_BSWAP_BE32(0x0a000000 + i * 77);
+      sock_rport_be16(s) = CI_BSWAP_BE16(5000 + i);
+    }
+  }
+
+  ni->filter_table = (void*) ((char*) mem + table_ofs);
+  ni->filter_table_ext = (void*) ((char*) mem + ext_ofs);
+  CHECK((ci_uintptr_t) ni->filter_table->table % CI_CACHE_LINE_SIZE, ==, 0);
+  *(unsigned*) &ni->filter_table->table_size_mask = size - 1;
+  /* Empty entries are all-zero in the cuckoo layout, and have the EMPTY
+   * state in the high bits in the open-addressed one. */
+  if( ! cuckoo )
+    for( i = 0; i < size; ++i )
+      ni->filter_table->table[i].__id_and_state = 2u << 30;
+}
+
+static void teardown(void)
+{
+  free(mem);
+  free(ni);
+}
+
+
+/* Filters are found once inserted and not after removal, and removing a
+ * filter twice is harmless. */
+static void test_basic_(int cuckoo)
+{
+  const unsigned n = 20000;
+  unsigned j;
+
+  setup(SMALL_LG2, cuckoo);
+  for( j = 0; j < n; ++j )
+    CHECK(insert(j), ==, 0);
+  CHECK(ni->state->stats.table_n_entries, ==, n);
+
+  for( j = 0; j < n; ++j )
+    CHECK(OO_SP_TO_INT(lookup(j)), ==, key_sock(j));
+  for( j = n; j < 2 * n; ++j )
+    CHECK_TRUE(OO_SP_IS_NULL(lookup(j)));
+
+  for( j = 0; j < n; j += 2 )
+    remove_key(j);
+  for( j = 0; j < n; j += 2 )
+    remove_key(j);
+  CHECK(ni->state->stats.table_n_entries, ==, n / 2);
+  for( j = 0; j < n; ++j ) {
+    if( j & 1 )
+      CHECK(OO_SP_TO_INT(lookup(j)), ==, key_sock(j));
+    else
+      CHECK_TRUE(OO_SP_IS_NULL(lookup(j)));
+  }
+  teardown();
+}
+
+static void test_basic(void)
+{
+  test_basic_(0);
+  test_basic_(1);
+}
+
+
+static int count_cb(ci_sock_cmn* s, void* arg)
+{
+  ++*(int*) arg;
+  return 0;
+}
+
+/* Several sockets with the same tuple are all visited by
+ * ci_netif_filter_for_each_match(), and the hash is reported. */
+static void test_duplicates_(int cuckoo)
+{
+  unsigned laddr = CI_BSWAP_BE32(0xc0a80001), lport = CI_BSWAP_BE16(80);
+  ci_uint32 hash = 0;
+  int i, count = 0;
+
+  setup(SMALL_LG2, cuckoo);
+  for( i = N_SOCKS - N_WILD; i < N_SOCKS - 2; ++i )
+    CHECK(ci_netif_filter_insert(ni, OO_SP_FROM_INT(ni, i), AF_SPACE_FLAG_IP4,
+                                 addr4(laddr), lport, addr_any, 0,
+                                 IPPROTO_UDP), ==, 0);
+  for( i = N_SOCKS - N_WILD; i < N_SOCKS; ++i )
+    sock(i)->pkt.ipx.ip4.ip_protocol = IPPROTO_UDP;
+
+  ci_netif_filter_for_each_match(ni, laddr, lport, 0, 0, IPPROTO_UDP,
+                                 0, 0, count_cb, &count, &hash);
+  CHECK(count, ==, N_WILD - 2);
+  CHECK(hash, ==, onload_hash3(addr4(laddr), lport, addr_any, 0,
+                               IPPROTO_UDP));
+  teardown();
+}
+
+static void test_duplicates(void)
+{
+  test_duplicates_(0);
+  test_duplicates_(1);
+}
+
+
+/* The cuckoo layout accepts entries to a high load by displacing others,
+ * and removing everything leaves the table empty. */
+static void test_cuckoo_load(void)
+{
+  const unsigned n = (1u << SMALL_LG2) * 7 / 8 * 9 / 10;
+  unsigned j, i, failed = 0;
+
+  setup(SMALL_LG2, 1);
+  for( j = 0; j < n; ++j )
+    failed += insert(j) != 0;
+  CHECK(failed, ==, 0);
+  CHECK(ni->state->stats.table_max_hops, >, 1);
+  for( j = 0; j < n; ++j )
+    failed += OO_SP_TO_INT(lookup(j)) != key_sock(j);
+  CHECK(failed, ==, 0);
+
+  for( j = 0; j < n; ++j )
+    remove_key(j);
+  CHECK(ni->state->stats.table_n_entries, ==, 0);
+  for( i = 0; i < 1u << SMALL_LG2; ++i )
+    failed += ni->filter_table->table[i].__id_and_state != 0 ||
+              ni->filter_table->table[i].laddr != 0;
+  CHECK(failed, ==, 0);
+  teardown();
+}
+
+
+static ci_uint64 nsecs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void shuffle(unsigned* a, unsigned n, ci_uint32* seed)
+{
+  unsigned i, j, t;
+  for( i = n - 1; i > 0; --i ) {
+    *seed = *seed * 1103515245 + 12345;
+    j = (*seed >> 4) % (i + 1);
+    t = a[i]; a[i] = a[j]; a[j] = t;
+  }
+}
+
+static void report(const char* layout, const char* op,
+                   ci_uint64 t0, ci_uint64 t1, unsigned n)
+{
+  printf("  %-6s %-16s %6.1f ns/op\n", layout, op, (double) (t1 - t0) / n);
+}
+
+/* Microbenchmark: replay a trace of inserts, lookups and churn (removal
+ * of every filter and insertion of a fresh one) at 1M filters in a table
+ * sized as for 1M endpoints, against both layouts. */
+static void bench(int cuckoo)
+{
+  const char* layout = cuckoo ? "cuckoo" : "open";
+  const unsigned n = BENCH_ENTRIES;
+  unsigned* live = malloc(n * sizeof(*live));
+  unsigned* order = malloc(n * sizeof(*order));
+  unsigned next = n, i, round, found;
+  ci_uint32 seed = 1;
+  ci_uint64 t0, t1;
+
+  setup(BENCH_LG2, cuckoo);
+  for( i = 0; i < n; ++i )
+    live[i] = order[i] = i;
+  shuffle(order, n, &seed);
+
+  t0 = nsecs();
+  for( i = 0; i < n; ++i )
+    insert(live[i]);
+  t1 = nsecs();
+  report(layout, "insert", t0, t1, n);
+
+  t0 = nsecs();
+  for( i = 0, found = 0; i < n; ++i )
+    found += OO_SP_NOT_NULL(lookup(live[order[i]]));
+  t1 = nsecs();
+  report(layout, "lookup", t0, t1, n);
+  CHECK(found, ==, n);
+
+  t0 = nsecs();
+  for( i = 0, found = 0; i < n; ++i )
+    found += OO_SP_NOT_NULL(lookup(next + order[i]));
+  t1 = nsecs();
+  report(layout, "lookup miss", t0, t1, n);
+  CHECK(found, ==, 0);
+
+  t0 = nsecs();
+  for( round = 0; round < BENCH_CHURN; ++round ) {
+    shuffle(order, n, &seed);
+    for( i = 0; i < n; ++i ) {
+      remove_key(live[order[i]]);
+      live[order[i]] = next++;
+      insert(live[order[i]]);
+    }
+  }
+  t1 = nsecs();
+  report(layout, "remove+insert", t0, t1, n * BENCH_CHURN);
+
+  t0 = nsecs();
+  for( i = 0, found = 0; i < n; ++i )
+    found += OO_SP_NOT_NULL(lookup(live[order[i]]));
+  t1 = nsecs();
+  report(layout, "lookup (churned)", t0, t1, n);
+  CHECK(found, ==, n);
+
+  t0 = nsecs();
+  for( i = 0, found = 0; i < n; ++i )
+    found += OO_SP_NOT_NULL(lookup(next + order[i]));
+  t1 = nsecs();
+  report(layout, "miss (churned)", t0, t1, n);
+  CHECK(found, ==, 0);
+
+  printf("  %-6s max hops %u, mean hops %u\n", layout,
+         ni->state->stats.table_max_hops, ni->state->stats.table_mean_hops);
+  teardown();
+  free(live);
+  free(order);
+}
+
+static void bench_1m_filters(void)
+{
+  printf("%u filters in %u entries:\n", BENCH_ENTRIES, 1u << BENCH_LG2);
+  bench(0);
+  bench(1);
+}
+
+
+int main(void)
+{
+  TEST_RUN(test_basic);
+  TEST_RUN(test_duplicates);
+  TEST_RUN(test_cuckoo_load);
+  TEST_RUN(bench_1m_filters);
+  TEST_END();
+}
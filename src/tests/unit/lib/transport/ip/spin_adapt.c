@@ -0,0 +1,126 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/* Functions under test */
+#include <ci/internal/ip.h>
+
+/* Test infrastructure */
+#include "unit_test.h"
+#include <string.h>
+
+/* One cycle per nanosecond keeps the arithmetic readable */
+#define KHZ       1000000
+#define MAX_SPIN  10000
+
+static ci_netif* ni;
+static struct oo_spin_adapt sa;
+
+static void setup(void)
+{
+  ni = calloc(1, sizeof(*ni));
+  ni->state = calloc(1, sizeof(*ni->state));
+  IPTIMER_STATE(ni)->khz = KHZ;
+  memset(&sa, 0, sizeof(sa));
+}
+
+static void teardown(void)
+{
+  free(ni->state);
+  free(ni);
+}
+
+static void test_short_waits_spin(void)
+{
+  int i;
+
+  setup();
+  CHECK(oo_spin_adapt_should_spin(&sa, MAX_SPIN), ==, 1);
+  for( i = 0; i < 100; ++i ) {
+    CHECK(oo_spin_adapt_should_spin(&sa, MAX_SPIN), ==, 1);
+    oo_spin_adapt_wait_done(ni, &sa, MAX_SPIN, MAX_SPIN / 4,
+                            OO_SPIN_ADAPT_HIT);
+  }
+  CHECK(sa.wait_avg, ==, MAX_SPIN / 4);
+  CHECK(ni->state->stats.spin_adapt_hits, ==, 100);
+  CHECK(ni->state->stats.spin_adapt_misses, ==, 0);
+  CHECK(ni->state->stats.spin_adapt_skips, ==, 0);
+  teardown();
+}
+
+/* Once waits are longer than the spin timeout spinning stops, except for
+ * a probe every OO_SPIN_ADAPT_PROBE_INTERVAL waits. */
+static void test_long_waits_skip(void)
+{
+  int i, spins = 0;
+
+  setup();
+  oo_spin_adapt_wait_done(ni, &sa, MAX_SPIN, 1000 * MAX_SPIN,
+                          OO_SPIN_ADAPT_MISS);
+  CHECK(ni->state->stats.spin_adapt_misses, ==, 1);
+  /* Samples are clamped to twice the spin timeout */
+  CHECK(sa.wait_avg, ==, 2 * MAX_SPIN);
+
+  for( i = 0; i < 4 * OO_SPIN_ADAPT_PROBE_INTERVAL; ++i ) {
+    int spin = oo_spin_adapt_should_spin(&sa, MAX_SPIN);
+    spins += spin;
+    oo_spin_adapt_wait_done(ni, &sa, MAX_SPIN, 1000 * MAX_SPIN,
+                            spin ? OO_SPIN_ADAPT_MISS : OO_SPIN_ADAPT_SKIP);
+  }
+  CHECK(spins, ==, 4);
+  CHECK(ni->state->stats.spin_adapt_skips, ==,
+        4 * (OO_SPIN_ADAPT_PROBE_INTERVAL - 1));
+  /* Each skip saves a whole spin timeout: 10us */
+  CHECK(ni->state->stats.spin_adapt_saved_usec, ==,
+        4 * (OO_SPIN_ADAPT_PROBE_INTERVAL - 1) * MAX_SPIN * 1000 / KHZ);
+  teardown();
+}
+
+/* A skipped wait that ends quickly saves only the time it took. */
+static void test_saved_time(void)
+{
+  setup();
+  sa.wait_avg = 2 * MAX_SPIN;
+  CHECK(oo_spin_adapt_should_spin(&sa, MAX_SPIN), ==, 0);
+  oo_spin_adapt_wait_done(ni, &sa, MAX_SPIN, 3000, OO_SPIN_ADAPT_SKIP);
+  CHECK(ni->state->stats.spin_adapt_saved_usec, ==, 3);
+  teardown();
+}
+
+/* Spinning resumes soon after traffic picks up again. */
+static void test_recovery(void)
+{
+  int i;
+
+  setup();
+  for( i = 0; i < 100; ++i )
+    oo_spin_adapt_wait_done(ni, &sa, MAX_SPIN, ~0ull, OO_SPIN_ADAPT_SKIP);
+  CHECK(oo_spin_adapt_should_spin(&sa, MAX_SPIN), ==, 0);
+  for( i = 0; i < 8; ++i )
+    oo_spin_adapt_wait_done(ni, &sa, MAX_SPIN, 100, OO_SPIN_ADAPT_HIT);
+  CHECK(oo_spin_adapt_should_spin(&sa, MAX_SPIN), ==, 1);
+  CHECK(sa.skips, ==, 0);
+
+  /* Statistics are optional */
+  oo_spin_adapt_wait_done(NULL, &sa, MAX_SPIN, 100, OO_SPIN_ADAPT_HIT);
+  teardown();
+}
+
+/* Spinning forever never skips. */
+static void test_spin_forever(void)
+{
+  setup();
+  oo_spin_adapt_wait_done(ni, &sa, (ci_uint64) -1, ~0ull,
+                          OO_SPIN_ADAPT_HIT);
+  CHECK(oo_spin_adapt_should_spin(&sa, (ci_uint64) -1), ==, 1);
+  teardown();
+}
+
+int main(void)
+{
+  TEST_RUN(test_short_waits_spin);
+  TEST_RUN(test_long_waits_skip);
+  TEST_RUN(test_saved_time);
+  TEST_RUN(test_recovery);
+  TEST_RUN(test_spin_forever);
+  TEST_END();
+}
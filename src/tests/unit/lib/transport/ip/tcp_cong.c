@@ -0,0 +1,358 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/* Functions under test */
+#include <ci/internal/ip.h>
+
+/* Test infrastructure */
+#include "unit_test.h"
+
+#define MSS 1000
+
+static ci_netif* ni;
+static ci_tcp_state* ts;
+
+static void setup(unsigned algo, unsigned cwnd_segs, unsigned srtt_ms)
+{
+  ni = calloc(1, sizeof(*ni));
+  ni->state = calloc(1, sizeof(*ni->state));
+  ts = calloc(1, sizeof(*ts));
+
+  /* One tick per millisecond keeps the arithmetic readable */
+  IPTIMER_STATE(ni)->ci_ip_time_ms2tick_fxp = 1ull << 32;
+  IPTIMER_STATE(ni)->ci_ip_time_real_ticks = 1000;
+  NI_OPTS(ni).min_cwnd = 2 * MSS;
+
+  ts->s.b.state = CI_TCP_CLOSED;
+  ts->c.cong_algo = algo;
+  ts->c.max_pacing_rate = CI_TCP_PACING_RATE_UNLIMITED;
+  ts->eff_mss = MSS;
+  ts->sa = srtt_ms << 3u;
+  ts->snd_una = 0x10000;
+  ts->snd_nxt = ts->snd_una + cwnd_segs * MSS;
+  ts->cwnd = cwnd_segs * MSS;
+  ts->ssthresh = 2 * MSS;
+  ci_tcp_cong_init(ni, ts);
+}
+
+static void teardown(void)
+{
+  free(ts);
+  free(ni->state);
+  free(ni);
+}
+
+/* Receive one ACK, following the path taken by ci_tcp_rx_handle_ack() */
+static void ack(ci_uint32 acked, int ece)
+{
+  ci_tcp_cong_acked(ni, ts, acked, ece);
+  ts->snd_una += acked;
+  ts->bytes_acked += acked;
+  if( ts->cwnd >= ts->ssthresh )
+    ci_tcp_cong_avoid(ni, ts);
+}
+
+/* Acknowledge the segments in flight, sending more as cwnd allows, and let
+ * one round trip pass.  Every [mark]th segment carries ECE if [mark] is
+ * non-zero. */
+static void round_trip(unsigned mark)
+{
+  ci_uint32 end = ts->snd_nxt;
+  unsigned i = 0;
+
+  while( SEQ_LT(ts->snd_una, end) ) {
+    ack(MSS, mark && ++i % mark == 0);
+    if( SEQ_LT(ts->snd_nxt, ts->snd_una + ts->cwnd) )
+      ts->snd_nxt = ts->snd_una + ts->cwnd;
+  }
+  IPTIMER_STATE(ni)->ci_ip_time_real_ticks += tcp_srtt(ts);
+}
+
+/* Loss detected, following ci_tcp_reset_cwnd_on_loss() */
+static void loss(void)
+{
+  ts->ssthresh = ci_tcp_cong_ssthresh(ni, ts);
+  ts->cwnd = ts->ssthresh;
+  ts->bytes_acked = 0;
+}
+
+
+static void test_names(void)
+{
+  CHECK(ci_tcp_cong_algo_from_name("reno"), ==, EF_TCP_CONG_ALGO_RENO);
+  CHECK(ci_tcp_cong_algo_from_name("cubic"), ==, EF_TCP_CONG_ALGO_CUBIC);
+  CHECK(ci_tcp_cong_algo_from_name("dctcp"), ==, EF_TCP_CONG_ALGO_DCTCP);
+  CHECK(ci_tcp_cong_algo_from_name("bbr"), ==, -ENOENT);
+  CHECK(ci_tcp_cong_algo_from_name(""), ==, -ENOENT);
+  CHECK_TRUE(! strcmp(ci_tcp_cong_algo_name(EF_TCP_CONG_ALGO_CUBIC), "cubic"));
+  CHECK_TRUE(! strcmp(ci_tcp_cong_algo_name(99), "unknown"));
+}
+
+
+static void test_reno(void)
+{
+  int i;
+
+  setup(EF_TCP_CONG_ALGO_RENO, 10, 100);
+
+  /* One segment per round trip */
+  for( i = 1; i <= 5; ++i ) {
+    round_trip(0);
+    CHECK(ts->cwnd, ==, (10 + i) * MSS);
+  }
+
+  /* Halve the flight on loss */
+  loss();
+  CHECK(ts->cwnd, ==, 15 * MSS / 2);
+
+  /* ...but no lower than two segments */
+  ts->snd_nxt = ts->snd_una + MSS;
+  CHECK(ci_tcp_cong_ssthresh(ni, ts), ==, 2 * MSS);
+
+  teardown();
+}
+
+
+static void test_reno_ecn(void)
+{
+  setup(EF_TCP_CONG_ALGO_RENO, 20, 1);
+  ts->ssthresh = 1000 * MSS;
+
+  /* ECE is treated as loss */
+  ack(MSS, 1);
+  CHECK(ts->cwnd, ==, 10 * MSS);
+  CHECK(ts->ssthresh, ==, 10 * MSS);
+  CHECK_TRUE(ts->tcpflags & CI_TCPT_FLAG_ECN_CWR);
+  CHECK(ni->state->stats.tcp_ecn_cwnd_reduce, ==, 1);
+
+  /* ...but only once per window, until data sent after the reduction is
+   * acknowledged */
+  ts->tcpflags &=~ CI_TCPT_FLAG_ECN_CWR;
+  round_trip(1);
+  CHECK(ts->cwnd, ==, 11 * MSS);
+  CHECK_TRUE(! (ts->tcpflags & CI_TCPT_FLAG_ECN_CWR));
+
+  round_trip(1);
+  CHECK(ts->cwnd, <, 11 * MSS);
+  CHECK_TRUE(ts->tcpflags & CI_TCPT_FLAG_ECN_CWR);
+  CHECK(ni->state->stats.tcp_ecn_cwnd_reduce, ==, 2);
+
+  teardown();
+}
+
+
+static void test_cubic_loss(void)
+{
+  setup(EF_TCP_CONG_ALGO_CUBIC, 100, 100);
+
+  /* Multiplicative decrease by beta = 0.7 */
+  loss();
+  CHECK(ts->cwnd, ==, 70 * MSS);
+  CHECK(ts->cong.cubic.w_max, ==, 100 * MSS);
+
+  /* Loss again before regaining W_max: fast convergence */
+  ts->cwnd = 80 * MSS;
+  ts->snd_nxt = ts->snd_una + ts->cwnd;
+  loss();
+  CHECK(ts->cwnd, ==, 56 * MSS);
+  CHECK(ts->cong.cubic.w_max, ==, 68 * MSS);
+
+  /* Never below two segments */
+  ts->snd_nxt = ts->snd_una + MSS;
+  CHECK(ci_tcp_cong_ssthresh(ni, ts), ==, 2 * MSS);
+
+  teardown();
+}
+
+
+static void test_cubic_growth(void)
+{
+  unsigned prev, inc, prev_inc = ~0u;
+  int i;
+
+  setup(EF_TCP_CONG_ALGO_CUBIC, 100, 100);
+  loss();
+
+  /* K = cbrt(W_max * (1 - beta) / C) = cbrt(30 / 0.4) = 4.217s */
+  round_trip(0);
+  CHECK(ts->cong.cubic.k_ms, >=, 4200);
+  CHECK(ts->cong.cubic.k_ms, <=, 4230);
+
+  /* Concave region: fast initially, slowing towards W_max */
+  for( i = 1; i < 38; ++i ) {
+    prev = ts->cwnd;
+    round_trip(0);
+    CHECK(ts->cwnd, >=, prev);
+    CHECK(ts->cwnd, <, 100 * MSS);
+    inc = ts->cwnd - prev;
+    if( i > 5 )
+      CHECK(inc, <=, prev_inc + MSS / 4);
+    prev_inc = inc;
+  }
+  CHECK(ts->cwnd, >, 95 * MSS);
+
+  /* Plateau around W_max at t = K */
+  for( ; i < 46; ++i )
+    round_trip(0);
+  CHECK(ts->cwnd, >=, 99 * MSS);
+  CHECK(ts->cwnd, <=, 102 * MSS);
+
+  /* Convex region: probing for more bandwidth, accelerating */
+  prev_inc = 0;
+  for( ; i < 80; ++i ) {
+    prev = ts->cwnd;
+    round_trip(0);
+    inc = ts->cwnd - prev;
+    if( i > 50 )
+      CHECK(inc + MSS / 4, >=, prev_inc);
+    prev_inc = inc;
+  }
+  CHECK(ts->cwnd, >, 115 * MSS);
+
+  teardown();
+}
+
+
+static void test_cubic_reno_friendly(void)
+{
+  int i;
+
+  /* With a short RTT the cubic function grows more slowly than Reno would
+   * and CUBIC must keep up with the Reno estimate. */
+  setup(EF_TCP_CONG_ALGO_CUBIC, 100, 1);
+  loss();
+
+  for( i = 0; i < 100; ++i )
+    round_trip(0);
+  /* 0.53 segments per round trip */
+  CHECK(ts->cwnd, >=, 120 * MSS);
+  CHECK(ts->cwnd, <=, 125 * MSS);
+
+  teardown();
+}
+
+
+static void test_dctcp_alpha(void)
+{
+  unsigned alpha;
+  int i;
+
+  setup(EF_TCP_CONG_ALGO_DCTCP, 20, 1);
+  ts->ssthresh = 1000 * MSS;
+  CHECK(ts->cong.dctcp.alpha, ==, 1024);
+
+  /* Without marks alpha decays by g = 1/16 each window.  A window is what
+   * was in flight when the previous one ended, here one segment short of
+   * a round trip, so 20 round trips see 21 windows. */
+  alpha = 1024;
+  for( i = 0; i < 21; ++i )
+    alpha -= alpha >> 4;
+  for( i = 0; i < 20; ++i )
+    round_trip(0);
+  CHECK(ts->cong.dctcp.alpha, ==, alpha);
+  CHECK(ts->cwnd, ==, 20 * MSS);
+
+  /* With every segment marked it converges back towards one */
+  ts->ecn_recover = ts->snd_nxt + 10000 * MSS;
+  for( i = 0; i < 100; ++i )
+    round_trip(1);
+  CHECK(ts->cong.dctcp.alpha, >=, 1024 - 16);
+
+  /* With a quarter of them marked it settles near a quarter */
+  for( i = 0; i < 100; ++i )
+    round_trip(4);
+  CHECK(ts->cong.dctcp.alpha, >=, 256 - 16);
+  CHECK(ts->cong.dctcp.alpha, <=, 256 + 16);
+
+  teardown();
+}
+
+
+static void test_dctcp_reduce(void)
+{
+  setup(EF_TCP_CONG_ALGO_DCTCP, 40, 1);
+  ts->ssthresh = 1000 * MSS;
+  ts->cong.dctcp.alpha = 512;
+
+  /* cwnd * (1 - alpha / 2) */
+  ack(MSS, 1);
+  CHECK(ts->cwnd, ==, 30 * MSS);
+  CHECK(ts->ssthresh, ==, 30 * MSS);
+
+  /* Only once per window */
+  ack(MSS, 1);
+  ack(MSS, 1);
+  CHECK(ts->cwnd, ==, 30 * MSS);
+
+  /* Not when already recovering from loss */
+  ts->snd_una = ts->snd_nxt;
+  ts->snd_nxt += ts->cwnd;
+  ts->congstate = CI_TCP_CONG_FAST_RECOV;
+  ack(MSS, 1);
+  CHECK(ts->cwnd, ==, 30 * MSS);
+
+  CHECK_TRUE(ts->tcpflags & CI_TCPT_FLAG_ECN_CWR);
+
+  /* Responds to loss as Reno does */
+  ts->congstate = CI_TCP_CONG_OPEN;
+  ts->snd_nxt = ts->snd_una + ts->cwnd;
+  loss();
+  CHECK(ts->cwnd, ==, 15 * MSS);
+
+  teardown();
+}
+
+
+static void test_pacing(void)
+{
+  ci_uint32 rate;
+
+  setup(EF_TCP_CONG_ALGO_RENO, 10, 100);
+
+  /* 120% of cwnd/srtt in congestion avoidance, 200% in slow start */
+  CHECK(ci_tcp_pacing_rate(ni, ts), ==, 10 * MSS * 120 / 100 / 100);
+  ts->ssthresh = 100 * MSS;
+  CHECK(ci_tcp_pacing_rate(ni, ts), ==, 10 * MSS * 200 / 100 / 100);
+
+  /* SO_MAX_PACING_RATE is in bytes per second */
+  ts->c.max_pacing_rate = 50000;
+  CHECK(ci_tcp_pacing_rate(ni, ts), ==, 50);
+  ts->c.max_pacing_rate = 0;
+  CHECK(ci_tcp_pacing_rate(ni, ts), ==, 1);
+  ts->c.max_pacing_rate = CI_TCP_PACING_RATE_UNLIMITED;
+
+  /* Starts with a burst of two segments... */
+  rate = ci_tcp_pacing_rate(ni, ts);
+  CHECK(ci_tcp_pacing_credit(ni, ts, rate), ==, 2 * MSS);
+
+  /* ...which when overdrawn is repaid at the pacing rate... */
+  ts->pace_credit -= 3 * MSS;
+  CHECK(ci_tcp_pacing_credit(ni, ts, rate), ==, -MSS);
+  IPTIMER_STATE(ni)->ci_ip_time_real_ticks += 4;
+  CHECK(ci_tcp_pacing_credit(ni, ts, rate), ==, -MSS + 4 * (int) rate);
+
+  /* ...but cannot be saved up beyond that */
+  IPTIMER_STATE(ni)->ci_ip_time_real_ticks += 1000;
+  CHECK(ci_tcp_pacing_credit(ni, ts, rate), ==, 2 * MSS);
+
+  /* At higher rates, up to one tick's worth */
+  IPTIMER_STATE(ni)->ci_ip_time_real_ticks += 1;
+  CHECK(ci_tcp_pacing_credit(ni, ts, 5 * MSS), ==, 5 * MSS);
+
+  teardown();
+}
+
+
+int main(void)
+{
+  TEST_RUN(test_names);
+  TEST_RUN(test_reno);
+  TEST_RUN(test_reno_ecn);
+  TEST_RUN(test_cubic_loss);
+  TEST_RUN(test_cubic_growth);
+  TEST_RUN(test_cubic_reno_friendly);
+  TEST_RUN(test_dctcp_alpha);
+  TEST_RUN(test_dctcp_reduce);
+  TEST_RUN(test_pacing);
+  TEST_END();
+}
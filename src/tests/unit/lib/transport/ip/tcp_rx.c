@@ -6,6 +6,7 @@
 
 /* Test infrastructure */
 #include "unit_test.h"
+#include <string.h>
 
 /* Expectations */
 static ci_netif* expect_ni;
@@ -26,6 +27,8 @@ void ci_assert_valid_pkt(ci_netif* ni, ci_ip_pkt_fmt* pkt,
 }
 
 static int filter_count;
+/* ci_tcp_handle_rx_vec() repeats the connected lookup on a miss */
+static int filter_vec;
 
 int
 ci_netif_filter_for_each_match(ci_netif* ni,
@@ -35,12 +38,18 @@ ci_netif_filter_for_each_match(ci_netif* ni,
                                int (*callback)(ci_sock_cmn*, void*),
                                void* callback_arg, ci_uint32* hash_out)
 {
+  int attempt;
+
   CHECK(ni, ==, expect_ni);
   CHECK(protocol, ==, RX_PKT_PROTOCOL(expect_pkt));
   CHECK(intf_i, ==, expect_pkt->intf_i);
   CHECK(vlan, ==, expect_pkt->vlan);
 
-  switch( filter_count++ ) {
+  attempt = filter_count++;
+  if( filter_vec )
+    attempt = attempt % 4 == 0 ? 0 : attempt % 4 - 1;
+
+  switch( attempt ) {
   case 0:
     /* First attempt: established connections with src->dest addr/port */
     CHECK(laddr, ==, oo_ip_hdr(expect_pkt)->ip_daddr_be32);
@@ -92,6 +101,7 @@ static void test_ci_tcp_handle_rx(void)
   expect_pkt = pkt;
   expect_tcp = tcp;
   filter_count = 0;
+  filter_vec = 0;
 
   /* pre: netif must have a valid state */
   netif->state = ns;
@@ -130,9 +140,563 @@ static void test_ci_tcp_handle_rx(void)
   STATE_FREE(tcp);
 }
 
+/* A vector of segments with no matching filter: each segment tries the
+ * connected lookup once for the batch, then takes the usual path to the
+ * kernel.  The second segment could not reuse a socket, so it is counted as a
+ * fallback. */
+static void test_ci_tcp_handle_rx_vec(void)
+{
+  STATE_ALLOC(ci_netif, netif);
+  STATE_ALLOC(ci_netif_state, ns);
+  STATE_ALLOC(struct ci_netif_poll_state, ps);
+  STATE_ALLOC(ci_ip_pkt_fmt, pkt);
+  ci_ip_pkt_fmt* pkts[2];
+  ci_ip4_hdr* ip;
+
+  expect_ni = netif;
+  expect_pkt = pkt;
+  filter_count = 0;
+  filter_vec = 1;
+
+  netif->state = ns;
+  STATE_STASH(netif);
+
+  pkt->frag_next = OO_PP_ID_NULL;
+  pkt->pkt_eth_payload_off = 14;
+  pkt->pay_len = 100;
+  ip = oo_ip_hdr(pkt);
+  ip->ip_ihl_version = CI_IP4_IHL_VERSION(sizeof(*ip));
+  ip->ip_tot_len_be16 = CI_BSWAP_BE16(sizeof(*ip) + 42);
+  ip->ip_protocol = IPPROTO_TCP;
+  ip->ip_daddr_be32 = 0x01234567;
+  ip->ip_saddr_be32 = 0x89abcdef;
+  expect_tcp = (ci_tcp_hdr*) (ip + 1);
+  expect_tcp->tcp_dest_be16 = 0x1234;
+  expect_tcp->tcp_source_be16 = 0x5678;
+  STATE_STASH(pkt);
+
+  pkts[0] = pkts[1] = pkt;
+  ci_tcp_handle_rx_vec(netif, ps, pkts, 2);
+
+  STATE_CHECK(ns, stats_snapshot.tcp.tcp_in_segs, 2);
+  STATE_CHECK(ns, stats.no_match_pass_to_kernel_tcp, 2);
+  STATE_CHECK(ns, stats.rx_batch_fallback, 1);
+  STATE_CHECK(pkt, pf.tcp_rx.pay_len, 42);
+  CHECK(filter_count, ==, 8);
+
+  STATE_FREE(netif);
+  STATE_FREE(ns);
+  STATE_FREE(ps);
+  STATE_FREE(pkt);
+}
+
+/* A reader that drains the receive queue as soon as coalescing drops the
+ * socket lock.  Every byte it finds must already be counted in rcv_added. */
+static ci_tcp_state* reader_ts;
+static int reader_drained;
+static int pkts_freed;
+
+void ci_sock_unlock_slow(ci_netif* ni, citp_waitable* w)
+{
+  ci_ip_pkt_fmt* tail = PKT(ni, reader_ts->recv1.tail);
+  int bytes = oo_offbuf_left(&tail->buf);
+
+  w->lock.wl_val = 0;
+  CHECK(tcp_rcv_usr(reader_ts), ==, bytes);
+  oo_offbuf_advance(&tail->buf, bytes);
+  reader_ts->rcv_delivered += bytes;
+  reader_drained += bytes;
+}
+
+void ci_netif_pkt_free(ci_netif* ni, ci_ip_pkt_fmt* pkt)
+{
+  ++pkts_freed;
+}
+
+static ci_ip_pkt_fmt* rx_pkt(ci_netif* netif, int id, ci_uint32 seq, int len)
+{
+  ci_ip_pkt_fmt* pkt = (ci_ip_pkt_fmt*) (netif->pkt_bufs[0] +
+                                         id * CI_CFG_PKT_BUF_SIZE);
+  ci_ip4_hdr* ip;
+  ci_tcp_hdr* tcp;
+
+  OO_PKT_PP_INIT(pkt, id);
+  pkt->refcount = 1;
+  pkt->next = OO_PP_NULL;
+  pkt->pkt_eth_payload_off = 14;
+  ip = oo_ip_hdr(pkt);
+  ip->ip_ihl_version = CI_IP4_IHL_VERSION(sizeof(*ip));
+  tcp = (ci_tcp_hdr*) (ip + 1);
+  tcp->tcp_seq_be32 = CI_BSWAP_BE32(seq);
+  CI_TCP_HDR_SET_LEN(tcp, sizeof(*tcp) + 12);
+  oo_offbuf_init(&pkt->buf, CI_TCP_PAYLOAD(tcp), len);
+  memset(oo_offbuf_ptr(&pkt->buf), id, len);
+  pkt->pf.tcp_rx.end_seq = seq + len;
+  return pkt;
+}
+
+static ci_netif* rx_netif_alloc(void)
+{
+  ci_netif* netif = calloc(1, sizeof(*netif));
+
+  netif->state = calloc(1, sizeof(*netif->state));
+  netif->state->lock.lock = CI_EPLOCK_LOCKED;
+  netif->packets = calloc(1, sizeof(*netif->packets));
+  *(ci_int32*) &netif->packets->n_pkts_allocated = PKTS_PER_SET;
+  netif->pkt_bufs = calloc(1, sizeof(netif->pkt_bufs[0]));
+  netif->pkt_bufs[0] = calloc(PKTS_PER_SET, CI_CFG_PKT_BUF_SIZE);
+  return netif;
+}
+
+static void rx_netif_free(ci_netif* netif)
+{
+  free(netif->pkt_bufs[0]);
+  free(netif->pkt_bufs);
+  free(netif->packets);
+  free(netif->state);
+  free(netif);
+}
+
+/* A segment is appended to the tail of recv1 while a reader is waiting for
+ * the socket lock. */
+static void test_ci_tcp_rx_enqueue_coalesce(void)
+{
+  ci_netif* netif = rx_netif_alloc();
+  ci_tcp_state* ts = calloc(1, sizeof(*ts));
+  ci_ip_pkt_fmt* tail;
+  ci_ip_pkt_fmt* pkt;
+
+  expect_ni = netif;
+  reader_ts = ts;
+  reader_drained = pkts_freed = 0;
+
+  TS_QUEUE_RX_SET(ts, recv1);
+  tail = rx_pkt(netif, 0, 1000, 100);
+  ts->recv1.head = ts->recv1.tail = OO_PKT_P(tail);
+  ts->recv1.num = 1;
+  tcp_rcv_nxt(ts) = 1100;
+  ts->rcv_added = 100;
+  pkt = rx_pkt(netif, 1, 1100, 200);
+  expect_pkt = tail;
+
+  /* The reader is waiting, so unlocking takes the slow path */
+  ts->s.b.lock.wl_val = OO_WAITABLE_LK_NEED_WAKE;
+  CHECK(ci_tcp_rx_enqueue_coalesce(netif, ts, pkt), ==, 1);
+
+  CHECK(reader_drained, ==, 300);
+  CHECK(tcp_rcv_usr(ts), ==, 0);
+  CHECK(tcp_rcv_nxt(ts), ==, 1300);
+  CHECK(tail->pf.tcp_rx.end_seq, ==, 1300);
+  CHECK(pkts_freed, ==, 1);
+  CHECK(netif->state->stats.tcp_rx_coalesce_segs, ==, 1);
+
+  rx_netif_free(netif);
+  free(ts);
+}
+
+#define RX_MSS  1448
+
+/* A bulk transfer of full-sized segments.  Two of them do not fit in one
+ * buffer, so each is merged only once the reader has made room. */
+static void test_ci_tcp_rx_enqueue_coalesce_mss(void)
+{
+  ci_netif* netif = rx_netif_alloc();
+  ci_tcp_state* ts = calloc(1, sizeof(*ts));
+  ci_ip_pkt_fmt* tail;
+  ci_ip_pkt_fmt* pkt;
+  ci_uint32 seq = 1000;
+  int i;
+
+  expect_ni = netif;
+  pkts_freed = 0;
+
+  TS_QUEUE_RX_SET(ts, recv1);
+  tail = rx_pkt(netif, 0, seq, RX_MSS);
+  ts->recv1.head = ts->recv1.tail = OO_PKT_P(tail);
+  ts->recv1.num = 1;
+  seq += RX_MSS;
+  tcp_rcv_nxt(ts) = seq;
+  ts->rcv_added = RX_MSS;
+  expect_pkt = tail;
+
+  /* Nothing has been read, so there is no room */
+  pkt = rx_pkt(netif, 1, seq, RX_MSS);
+  CHECK(ci_tcp_rx_enqueue_coalesce(netif, ts, pkt), ==, 0);
+
+  for( i = 0; i < 10; ++i ) {
+    /* The reader leaves a few bytes behind */
+    oo_offbuf_advance(&tail->buf, oo_offbuf_left(&tail->buf) - 16);
+    pkt = rx_pkt(netif, 1 + i % 2, seq, RX_MSS);
+    CHECK(ci_tcp_rx_enqueue_coalesce(netif, ts, pkt), ==, 1);
+    seq += RX_MSS;
+
+    CHECK(oo_offbuf_left(&tail->buf), ==, 16 + RX_MSS);
+    CHECK(oo_offbuf_ptr(&tail->buf), ==,
+          CI_TCP_PAYLOAD(PKT_IPX_TCP_HDR(AF_INET, tail)));
+    CHECK(PKT_IPX_RX_BUF_SEQ(AF_INET, tail), ==, seq - RX_MSS - 16);
+    CHECK(oo_offbuf_ptr(&tail->buf)[15], ==, i ? 2 - i % 2 : 0);
+    CHECK(oo_offbuf_ptr(&tail->buf)[16], ==, 1 + i % 2);
+    CHECK(oo_offbuf_end(&tail->buf)[-1], ==, 1 + i % 2);
+    CHECK(tail->pf.tcp_rx.end_seq, ==, seq);
+    CHECK(tcp_rcv_nxt(ts), ==, seq);
+    PKT_TCP_RX_BUF_ASSERT_VALID(netif, tail);
+  }
+  CHECK(ts->recv1.num, ==, 1);
+  CHECK(ts->rcv_added, ==, 11 * RX_MSS);
+  CHECK(pkts_freed, ==, 10);
+  CHECK(netif->state->stats.tcp_rx_coalesce_segs, ==, 10);
+  CHECK(netif->state->stats.tcp_rx_coalesce_bytes, ==, 10 * RX_MSS);
+
+  rx_netif_free(netif);
+  free(ts);
+}
+
+/* The timewait table, from netif.c, with the rest of the stack stubbed out.
+ * Segments from the peer arrive through ci_tcp_handle_rx(). */
+#define TW_LADDR  CI_BSWAPC_BE32(0x0a000001)
+#define TW_RADDR  CI_BSWAPC_BE32(0x0a000002)
+#define TW_LPORT  CI_BSWAPC_BE16(80)
+#define TW_RPORT  CI_BSWAPC_BE16(12345)
+#define TW_SND_NXT  5000
+#define TW_RCV_NXT  9000
+#define TW_2MSL     1000
+#define TW_ACK_RATELIMIT  10
+#define TW_LISTENER  1
+
+static ci_tcp_state* tw_dropped;
+static int tw_acks;
+static ci_uint32 tw_peer_tsval;
+/* The peer's port of the connection used by the helpers below */
+static ci_uint16 tw_rport;
+
+void ci_tcp_drop(ci_netif* ni, ci_tcp_state* ts, int so_error)
+{
+  tw_dropped = ts;
+}
+
+void ci_tcp_timewait_send_ack(ci_netif* netif, const ci_tcp_timewait_t* tw,
+                              ciip_tcp_rx_pkt* rxp)
+{
+  CHECK(tw->rcv_nxt, ==, TW_RCV_NXT);
+  ++tw_acks;
+  ci_netif_pkt_release(netif, rxp->pkt);
+}
+
+int ci_tcp_parse_options(ci_netif* ni, ciip_tcp_rx_pkt* rxp,
+                         ci_tcp_options* topts)
+{
+  if( tw_peer_tsval != 0 ) {
+    rxp->flags |= CI_TCPT_FLAG_TSO;
+    rxp->timestamp = tw_peer_tsval;
+  }
+  return 0;
+}
+
+oo_sp ci_netif_listener_lookup(ci_netif* netif, int af_space,
+                               ci_addr_t laddr, unsigned lport)
+{
+  CHECK(laddr.ip4, ==, TW_LADDR);
+  CHECK(lport, ==, TW_LPORT);
+  return OO_SP_FROM_INT(netif, TW_LISTENER);
+}
+
+static ci_netif* tw_netif_alloc(void)
+{
+  ci_netif* netif = calloc(1, sizeof(*netif));
+  unsigned ep_ofs = CI_ROUND_UP(sizeof(ci_netif_state), EP_BUF_SIZE);
+  ci_netif_state* ns = calloc(1, ep_ofs + 2 * EP_BUF_SIZE);
+  ci_sock_cmn* listener = (void*) ((char*) ns + ep_ofs +
+                                   TW_LISTENER * EP_BUF_SIZE);
+  int i;
+
+  netif->state = ns;
+  *(ci_uint32*) &ns->ep_ofs = ep_ofs;
+  *(ci_uint32*) &ns->n_ep_bufs = 2;
+  listener->b.state = CI_TCP_LISTEN;
+
+  ns->lock.lock = CI_EPLOCK_LOCKED;
+  *(ci_uint32*) &ns->timewait_table_entries_n = 16;
+  netif->timewait_table = calloc(16, sizeof(ci_tcp_timewait_t));
+  NI_OPTS(netif).time_wait_assassinate = 1;
+  NI_CONF(netif).tconst_2msl_time = TW_2MSL;
+  NI_CONF(netif).tconst_invalid_ack_ratelimit = TW_ACK_RATELIMIT;
+  IPTIMER_STATE(netif)->ci_ip_time_real_ticks = 100000;
+  for( i = 0; i < CI_TCP_TIMEWAIT_ACK_BUCKETS; ++i )
+    ns->timewait_t_last_invalid_ack[i] =
+      ci_tcp_time_now(netif) - TW_ACK_RATELIMIT;
+
+  expect_ni = netif;
+  tw_dropped = NULL;
+  tw_acks = pkts_freed = 0;
+  tw_peer_tsval = 0;
+  tw_rport = TW_RPORT;
+  return netif;
+}
+
+static void tw_netif_free(ci_netif* netif)
+{
+  free(netif->timewait_table);
+  free(netif->state);
+  free(netif);
+}
+
+/* A connection in TIME_WAIT whose last fd has gone */
+static ci_tcp_state* tw_sock(ci_netif* netif, ci_uint16 flags)
+{
+  ci_tcp_state* ts = calloc(1, sizeof(*ts));
+
+  ts->s.b.state = CI_TCP_TIME_WAIT;
+  ts->s.b.sb_aflags = CI_SB_AFLAG_ORPHAN;
+  ts->s.pkt.ether_type = CI_ETHERTYPE_IP;
+  ts->s.laddr = CI_ADDR_FROM_IP4(TW_LADDR);
+  ts->s.pkt.ipx.ip4.ip_daddr_be32 = TW_RADDR;
+  TS_TCP(ts)->tcp_source_be16 = TW_LPORT;
+  TS_TCP(ts)->tcp_dest_be16 = tw_rport;
+  ts->local_peer = OO_SP_NULL;
+  ts->snd_nxt = TW_SND_NXT;
+  tcp_rcv_nxt(ts) = TW_RCV_NXT;
+  ts->tsrecent = 700;
+  ts->t_last_sent = ci_ip_time_now(netif) + TW_2MSL;
+  if( flags & CI_TCP_TIMEWAIT_FLAG_TSO )
+    ts->tcpflags |= CI_TCPT_FLAG_TSO;
+  return ts;
+}
+
+/* Moves an orphaned connection in TIME_WAIT into the timewait table */
+static void tw_compact(ci_netif* netif, ci_uint16 flags)
+{
+  ci_tcp_state* ts = tw_sock(netif, flags);
+
+  CHECK_TRUE(ci_netif_timewait_compact(netif, ts));
+  CHECK(tw_dropped, ==, ts);
+  free(ts);
+}
+
+static ci_tcp_timewait_t* tw_lookup(ci_netif* netif)
+{
+  return ci_netif_timewait_lookup(netif, TW_LADDR, TW_LPORT,
+                                  TW_RADDR, tw_rport);
+}
+
+/* Delivers a segment from the peer with [paylen] bytes of data.  Returns
+ * the number of filter lookups it took. */
+static int tw_rx(ci_netif* netif, ci_uint32 seq, ci_uint8 flags, int paylen)
+{
+  ci_ip_pkt_fmt* pkt = calloc(1, CI_CFG_PKT_BUF_SIZE);
+  ci_ip4_hdr* ip;
+  ci_tcp_hdr* tcp;
+
+  pkt->refcount = 1;
+  pkt->frag_next = OO_PP_ID_NULL;
+  pkt->pkt_eth_payload_off = 14;
+  pkt->pay_len = 14 + sizeof(*ip) + sizeof(*tcp) + paylen;
+  ip = oo_ip_hdr(pkt);
+  ip->ip_ihl_version = CI_IP4_IHL_VERSION(sizeof(*ip));
+  ip->ip_protocol = IPPROTO_TCP;
+  ip->ip_daddr_be32 = TW_LADDR;
+  ip->ip_saddr_be32 = TW_RADDR;
+  tcp = (ci_tcp_hdr*) (ip + 1);
+  tcp->tcp_dest_be16 = TW_LPORT;
+  tcp->tcp_source_be16 = tw_rport;
+  tcp->tcp_seq_be32 = CI_BSWAP_BE32(seq);
+  tcp->tcp_ack_be32 = CI_BSWAP_BE32(TW_SND_NXT);
+  tcp->tcp_flags = flags;
+  CI_TCP_HDR_SET_LEN(tcp, sizeof(*tcp));
+
+  expect_pkt = pkt;
+  expect_tcp = tcp;
+  filter_count = 0;
+  filter_vec = 0;
+  ci_tcp_handle_rx(netif, NULL, pkt, tcp, sizeof(*tcp) + paylen);
+  free(pkt);
+  return filter_count;
+}
+
+static void test_timewait_table_compact(void)
+{
+  ci_netif* netif = tw_netif_alloc();
+  ci_tcp_state* ts = calloc(1, sizeof(*ts));
+  ci_tcp_timewait_t* tw;
+
+  /* A socket that the application may still accept keeps its endpoint */
+  ts->s.b.state = CI_TCP_TIME_WAIT;
+  ts->s.b.sb_aflags = CI_SB_AFLAG_ORPHAN | CI_SB_AFLAG_TCP_IN_ACCEPTQ;
+  CHECK_FALSE(ci_netif_timewait_compact(netif, ts));
+  CHECK(tw_dropped, ==, NULL);
+  free(ts);
+
+  tw_compact(netif, CI_TCP_TIMEWAIT_FLAG_TSO);
+  CHECK(netif->state->stats.tcp_timewait_table_insertions, ==, 1);
+  tw = tw_lookup(netif);
+  CHECK(tw, !=, NULL);
+  CHECK(tw->snd_nxt, ==, TW_SND_NXT);
+  CHECK(tw->rcv_nxt, ==, TW_RCV_NXT);
+  CHECK(tw->tsrecent, ==, 700);
+  CHECK(tw->flags, ==, CI_TCP_TIMEWAIT_FLAG_TSO);
+  CHECK(ci_netif_timewait_lookup(netif, TW_LADDR, TW_LPORT, TW_RADDR,
+                                 TW_RPORT + 1), ==, NULL);
+
+  /* The entry is gone once TIME_WAIT would have ended */
+  IPTIMER_STATE(netif)->ci_ip_time_real_ticks += TW_2MSL;
+  CHECK(tw_lookup(netif), ==, NULL);
+  CHECK(netif->state->stats.tcp_timewait_table_expiries, ==, 1);
+  tw_netif_free(netif);
+}
+
+/* A socket that reached TIME_WAIT before its last fd went, as after
+ * shutdown() and draining, is compacted when it is closed. */
+static void test_timewait_table_close(void)
+{
+  ci_netif* netif = tw_netif_alloc();
+  ci_tcp_state* ts = tw_sock(netif, CI_TCP_TIMEWAIT_FLAG_TSO);
+
+  ci_tcp_all_fds_gone(netif, ts, 1);
+  CHECK(tw_dropped, ==, ts);
+  CHECK(netif->state->stats.tcp_timewait_table_insertions, ==, 1);
+  CHECK(tw_lookup(netif), !=, NULL);
+  free(ts);
+  tw_netif_free(netif);
+}
+
+/* The RFC 5961 budget is per bucket of entries, so a peer that keeps
+ * sending stray segments does not silence the others. */
+static void test_timewait_table_ratelimit(void)
+{
+  ci_netif* netif = tw_netif_alloc();
+  ci_tcp_timewait_t* tw;
+
+  tw_compact(netif, 0);
+  tw = tw_lookup(netif);
+  tw_rport = TW_RPORT + 1;
+  tw_compact(netif, 0);
+  CHECK(tw_lookup(netif) - netif->timewait_table, !=,
+        tw - netif->timewait_table);
+
+  tw_rport = TW_RPORT;
+  tw_rx(netif, TW_RCV_NXT + 100, CI_TCP_FLAG_ACK, 10);
+  tw_rx(netif, TW_RCV_NXT + 200, CI_TCP_FLAG_ACK, 10);
+  CHECK(tw_acks, ==, 1);
+  CHECK(netif->state->stats.invalid_ack_limited, ==, 1);
+
+  tw_rport = TW_RPORT + 1;
+  tw_rx(netif, TW_RCV_NXT + 100, CI_TCP_FLAG_ACK, 10);
+  CHECK(tw_acks, ==, 2);
+  tw_rx(netif, TW_RCV_NXT + 200, CI_TCP_FLAG_ACK, 10);
+  CHECK(tw_acks, ==, 2);
+  CHECK(netif->state->stats.invalid_ack_limited, ==, 2);
+
+  IPTIMER_STATE(netif)->ci_ip_time_real_ticks += TW_ACK_RATELIMIT;
+  tw_rport = TW_RPORT;
+  tw_rx(netif, TW_RCV_NXT + 300, CI_TCP_FLAG_ACK, 10);
+  CHECK(tw_acks, ==, 3);
+  CHECK(pkts_freed, ==, 5);
+  tw_netif_free(netif);
+}
+
+/* A retransmitted FIN is always answered and restarts TIME_WAIT.  Other
+ * segments share their bucket's RFC 5961 budget, and pure ACKs are
+ * ignored. */
+static void test_timewait_table_fin(void)
+{
+  ci_netif* netif = tw_netif_alloc();
+  ci_tcp_timewait_t* tw;
+
+  tw_compact(netif, CI_TCP_TIMEWAIT_FLAG_TSO);
+  tw = tw_lookup(netif);
+
+  CHECK(tw_rx(netif, TW_RCV_NXT + 100, CI_TCP_FLAG_ACK, 10), ==, 1);
+  CHECK(tw_acks, ==, 1);
+  CHECK(tw_rx(netif, TW_RCV_NXT + 200, CI_TCP_FLAG_ACK, 10), ==, 1);
+  CHECK(tw_acks, ==, 1);
+  CHECK(netif->state->stats.invalid_ack_limited, ==, 1);
+
+  IPTIMER_STATE(netif)->ci_ip_time_real_ticks += TW_2MSL / 2;
+  tw_peer_tsval = 800;
+  tw_rx(netif, TW_RCV_NXT - 1, CI_TCP_FLAG_FIN | CI_TCP_FLAG_ACK, 0);
+  CHECK(tw_acks, ==, 2);
+  CHECK(tw->expiry, ==, ci_ip_time_now(netif) + TW_2MSL);
+  CHECK(tw->tsrecent, ==, 800);
+  /* Again, within the rate limit */
+  tw_rx(netif, TW_RCV_NXT - 1, CI_TCP_FLAG_FIN | CI_TCP_FLAG_ACK, 0);
+  CHECK(tw_acks, ==, 3);
+  CHECK(netif->state->stats.invalid_ack_limited, ==, 1);
+
+  tw_rx(netif, TW_RCV_NXT, CI_TCP_FLAG_ACK, 0);
+  CHECK(tw_acks, ==, 3);
+
+  /* Past the original expiry, the restarted entry still answers */
+  IPTIMER_STATE(netif)->ci_ip_time_real_ticks += TW_2MSL / 2 + 1;
+  CHECK(tw_lookup(netif), ==, tw);
+  tw_rx(netif, TW_RCV_NXT + 300, CI_TCP_FLAG_ACK, 10);
+  CHECK(tw_acks, ==, 4);
+  CHECK(netif->state->stats.tcp_timewait_table_hits, ==, 6);
+  CHECK(pkts_freed, ==, 6);
+  tw_netif_free(netif);
+}
+
+/* TIME_WAIT assassination needs an exact sequence number and, when
+ * timestamps are in use, one that is not older than the last seen. */
+static void test_timewait_table_rst(void)
+{
+  ci_netif* netif = tw_netif_alloc();
+
+  tw_compact(netif, CI_TCP_TIMEWAIT_FLAG_TSO);
+
+  tw_rx(netif, TW_RCV_NXT + 1, CI_TCP_FLAG_RST, 0);
+  CHECK(tw_lookup(netif), !=, NULL);
+  tw_peer_tsval = 600;
+  tw_rx(netif, TW_RCV_NXT, CI_TCP_FLAG_RST, 0);
+  CHECK(tw_lookup(netif), !=, NULL);
+  CHECK(netif->state->stats.rst_recv_unacceptable, ==, 2);
+
+  tw_peer_tsval = 700;
+  tw_rx(netif, TW_RCV_NXT, CI_TCP_FLAG_RST, 0);
+  CHECK(tw_lookup(netif), ==, NULL);
+  CHECK(tw_acks, ==, 0);
+  CHECK(pkts_freed, ==, 3);
+
+  /* With the entry gone, the next RST takes the usual path to the kernel */
+  CHECK(tw_rx(netif, TW_RCV_NXT, CI_TCP_FLAG_RST, 0), ==, 3);
+  CHECK(netif->state->stats.no_match_pass_to_kernel_tcp, ==, 1);
+  tw_netif_free(netif);
+}
+
+/* A SYN reopens the connection only if it is beyond the old one */
+static void test_timewait_table_syn(void)
+{
+  ci_netif* netif = tw_netif_alloc();
+
+  tw_compact(netif, 0);
+
+  CHECK(tw_rx(netif, TW_RCV_NXT - 10, CI_TCP_FLAG_SYN, 0), ==, 1);
+  CHECK(tw_lookup(netif), !=, NULL);
+  CHECK(tw_acks, ==, 1);
+  CHECK(netif->state->stats.tcp_timewait_table_reuses, ==, 0);
+
+  CHECK(tw_rx(netif, TW_RCV_NXT + 10, CI_TCP_FLAG_SYN, 0), ==, 3);
+  CHECK(tw_lookup(netif), ==, NULL);
+  CHECK(tw_acks, ==, 1);
+  CHECK(netif->state->stats.tcp_timewait_table_reuses, ==, 1);
+  CHECK(netif->state->stats.no_match_pass_to_kernel_tcp, ==, 1);
+
+  /* The freed entry can be reused by the next compaction */
+  tw_compact(netif, 0);
+  CHECK(tw_lookup(netif), !=, NULL);
+  tw_netif_free(netif);
+}
+
 int main(void)
 {
   TEST_RUN(test_ci_tcp_handle_rx);
+  TEST_RUN(test_ci_tcp_handle_rx_vec);
+  TEST_RUN(test_ci_tcp_rx_enqueue_coalesce);
+  TEST_RUN(test_ci_tcp_rx_enqueue_coalesce_mss);
+  TEST_RUN(test_timewait_table_compact);
+  TEST_RUN(test_timewait_table_close);
+  TEST_RUN(test_timewait_table_ratelimit);
+  TEST_RUN(test_timewait_table_fin);
+  TEST_RUN(test_timewait_table_rst);
+  TEST_RUN(test_timewait_table_syn);
   TEST_END();
 }
 
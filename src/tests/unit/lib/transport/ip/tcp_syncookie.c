@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/* Functions under test */
+#include <ci/internal/ip.h>
+
+/* Test infrastructure */
+#include "unit_test.h"
+#include <string.h>
+#include <time.h>
+
+static ci_uint64 rand64(void)
+{
+  return (ci_uint64) rand() << 62 ^ (ci_uint64) rand() << 31 ^ rand();
+}
+
+/* Reference vectors from the SipHash paper: key 00..0f, input 00..len-1 */
+static void test_sip_hash_vectors(void)
+{
+  ci_uint64 key[2] = { 0x0706050403020100ULL, 0x0f0e0d0c0b0a0908ULL };
+  ci_uint8 data[15];
+  int i;
+
+  for( i = 0; i < sizeof(data); ++i )
+    data[i] = i;
+  CHECK(ci_sip_hash(key, data, 0), ==, 0x726fdb47dd0e0e31ULL);
+  CHECK(ci_sip_hash(key, data, 15), ==, 0xa129ca6149be45e5ULL);
+}
+
+/* Each lane must agree with the one-at-a-time hash of the same input */
+static void test_sip_hash_lanes(void)
+{
+  ci_uint8 data[CI_SIP_LANES][CI_SIP_LANES_LEN];
+  ci_uint64 key[2], out[CI_SIP_LANES];
+  int n, l, i;
+
+  for( n = 0; n < 10000; ++n ) {
+    key[0] = rand64();
+    key[1] = rand64();
+    for( l = 0; l < CI_SIP_LANES; ++l )
+      for( i = 0; i < CI_SIP_LANES_LEN; ++i )
+        data[l][i] = rand();
+    ci_sip_hash_lanes(key, data, out);
+    for( l = 0; l < CI_SIP_LANES; ++l )
+      CHECK(out[l], ==, ci_sip_hash(key, data[l], CI_SIP_LANES_LEN));
+  }
+}
+
+/* Identical inputs in different lanes must not affect one another */
+static void test_sip_hash_lanes_equal(void)
+{
+  ci_uint8 data[CI_SIP_LANES][CI_SIP_LANES_LEN];
+  ci_uint64 key[2] = { rand64(), rand64() }, out[CI_SIP_LANES];
+  int l;
+
+  memset(data, 0, sizeof(data));
+  ci_sip_hash_lanes(key, data, out);
+  for( l = 1; l < CI_SIP_LANES; ++l )
+    CHECK(out[l], ==, out[0]);
+  CHECK(out[0], ==, ci_sip_hash(key, data[0], CI_SIP_LANES_LEN));
+}
+
+int main(void)
+{
+  unsigned seed = time(NULL);
+  fprintf(stderr, "Running unit test tcp_syncookie.c with random seed: %u\n",
+          seed);
+  srand(seed);
+  TEST_RUN(test_sip_hash_vectors);
+  TEST_RUN(test_sip_hash_lanes);
+  TEST_RUN(test_sip_hash_lanes_equal);
+  TEST_END();
+}
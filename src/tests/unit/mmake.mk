@@ -22,9 +22,21 @@ UNIT_TEST_WRAPPER ?=
 # the header under test.
 ALL_UNIT_TESTS := \
   header/ci/internal/ip_timestamp \
+  header/ci/internal/ip_ready_ring \
+  header/ci/internal/ip_zerocopy \
   header/transport/unix/ul_epoll \
   lib/transport/ip/netif_init \
   lib/transport/ip/tcp_rx \
+  lib/transport/ip/tcp_cong \
+  lib/transport/ip/iptimer \
+  lib/transport/ip/netif_table \
+  lib/transport/ip/lat_hist \
+  lib/transport/ip/spin_adapt \
+  lib/transport/ip/netif_pkt \
+  lib/transport/ip/tcp_syncookie \
+  lib/citools/ip_csum_partial \
+  lib/citools/crc32c \
+  lib/citools/toeplitz \
   lib/ciul/checksum \
   lib/ciul/efct_vi \
   lib/ciul/efct_ubufs \
@@ -37,7 +49,8 @@ OBJECTS := $(TESTS:%=%.o)
 PASSED := $(TESTS:%=%.passed)
 
 # Library objects names are mangled with a prefix. Deal with that madness here.
-LIB_PREFIXES := lib/transport/common/ci_tp_common_ lib/transport/ip/ci_ip_
+LIB_PREFIXES := lib/transport/common/ci_tp_common_ lib/transport/ip/ci_ip_ \
+                lib/citools/ci_tools_
 
 lib_prefix = $(notdir $(filter $(dir $(1))%,$(LIB_PREFIXES)))
 lib_object = ../../$(dir $(1))$(call lib_prefix,$(1))$(notdir $(1)).o
@@ -81,9 +94,14 @@ $(TARGETS): MMAKE_DIR_CFLAGS += -I$(TOPPATH)/src/lib
 # invididual test without waiting for several seconds of flappery first.
 $(TARGETS): MMAKE_DIR_LINKFLAGS += -Wl,--unresolved-symbols=ignore-all $(NO_PIE)
 $(TARGETS): MMAKE_LIBS += -ldl
+$(filter lib/citools/%, $(TARGETS)): MMAKE_LIBS += ../../lib/citools/libcitools1.a
 $(filter lib/%, $(TARGETS)): $$(call lib_object,$$@)
+# The timewait table tests exercise the table itself along with tcp_rx.c,
+# and closing a socket that is already in TIME_WAIT
+lib/transport/ip/tcp_rx: ../../lib/transport/ip/ci_ip_netif.o \
+                         ../../lib/transport/ip/ci_ip_tcp_close.o
 $(TARGETS): %: %.o stubs.o
-	(libs=$(MMAKE_LIBS); $(MMakeLinkCApp))
+	(libs="$(MMAKE_LIBS)"; $(MMakeLinkCApp))
 
 # The build system relies on a convoluted web of makefiles in subdirectories
 # of both source and build trees to generate the dependencies. Lets do it the
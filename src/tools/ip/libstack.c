@@ -1360,6 +1360,54 @@ static void stack_more_stats_describe(ci_netif* ni)
   ci_dump_stats(more_stats_fields, N_MORE_STATS_FIELDS, &stats, 1, NULL, NULL);
 }
 
+static void lat_hist_dump(ci_netif* ni, const char* name,
+                          const ci_lat_hist* shared)
+{
+  static const unsigned ppm[] = { 500000, 900000, 990000, 999000, 999900 };
+  double ns_per_cycle = 1e6 / IPTIMER_STATE(ni)->khz;
+  ci_lat_hist h;
+  ci_uint64 count;
+  int i;
+
+  memcpy(&h, shared, sizeof(h));
+  count = ci_lat_hist_count(&h);
+  if( count == 0 ) {
+    ci_log("%-14s count=0", name);
+    return;
+  }
+  ci_log("%-14s count=%"CI_PRIu64" mean=%.0f p50=%.0f p90=%.0f p99=%.0f "
+         "p99.9=%.0f p99.99=%.0f max=%.0f", name, count,
+         h.sum * ns_per_cycle / count,
+         ci_lat_hist_percentile(&h, count, ppm[0]) * ns_per_cycle,
+         ci_lat_hist_percentile(&h, count, ppm[1]) * ns_per_cycle,
+         ci_lat_hist_percentile(&h, count, ppm[2]) * ns_per_cycle,
+         ci_lat_hist_percentile(&h, count, ppm[3]) * ns_per_cycle,
+         ci_lat_hist_percentile(&h, count, ppm[4]) * ns_per_cycle,
+         h.max * ns_per_cycle);
+  if( ci_cfg_verbose )
+    for( i = 0; i < CI_LAT_HIST_BUCKETS; ++i )
+      if( h.bucket[i] )
+        ci_log("  >= %12.0f  %"CI_PRIu64,
+               ci_lat_hist_bucket_min(i) * ns_per_cycle, h.bucket[i]);
+}
+
+static void stack_histograms(ci_netif* ni)
+{
+  ci_log("-------------------- latency histograms (ns): %d -----------",
+         NI_ID(ni));
+  if( ! NI_OPTS(ni).lat_hist )
+    ci_log("EF_LATENCY_HIST is not enabled for this stack");
+#define OO_LAT_HIST(name, desc)                         \
+  lat_hist_dump(ni, #name, &ni->state->lat_hist.name);
+#include <ci/internal/lat_hist_def.h>
+#undef OO_LAT_HIST
+}
+
+static void stack_clear_histograms(ci_netif* ni)
+{
+  memset(&ni->state->lat_hist, 0, sizeof(ni->state->lat_hist));
+}
+
 #if CI_CFG_SUPPORT_STATS_COLLECTION
 
 static void stack_ip_stats(ci_netif* ni)
@@ -2359,6 +2407,8 @@ static const stack_op_t stack_ops[] = {
   STACK_OP(clear_stats,        "reset stack statistics"),
   STACK_OP(dstats,             "show derived statistics"),
   STACK_OP(more_stats,         "show more stack statistics"),
+  STACK_OP(histograms,         "show latency histograms (EF_LATENCY_HIST)"),
+  STACK_OP(clear_histograms,   "reset latency histograms"),
 #if CI_CFG_SUPPORT_STATS_COLLECTION
   STACK_OP(ip_stats,           "show IP statistics"),
   STACK_OP(tcp_stats,          "show TCP statistics"),
@@ -322,8 +322,16 @@ static void stack_dump_on(ci_netif *ni)
          hwport_i < CI_CFG_MAX_HWPORTS;
          hwport_i++ ) {
       intf_i = ci_netif_get_hwport_to_intf_i(ni)[hwport_i];
-      if( intf_i >= 0 )
+      if( intf_i >= 0 ) {
         ni->state->dump_intf[intf_i] = dump_hwports[hwport_i];
+        /* With EF_TX_LOCK_DOMAINS, a sender may be posting without the
+         * stack lock, having looked at [dump_intf] before we set it.  Let
+         * it finish, so that it doesn't touch the dump queue under us. */
+        ci_mb();
+        while( ni->state->nic[intf_i].tx_lock != 0 &&
+               ni->state->nic[intf_i].tx_lock != CI_NETIF_TX_LOCK_STACK )
+          ci_spinloop_pause();
+      }
     }
     ni->state->dump_intf[OO_INTF_I_LOOPBACK] = dump_hwports[CI_HWPORT_ID_LO];
   }
@@ -340,6 +340,8 @@ typedef struct oo_p_dllink oo_p_dllink_t;
     FTL_TFIELD_INT(ctx, ci_uint32, ci_ip_time_frc2isn, ORM_OUTPUT_STACK)     \
     FTL_TFIELD_INT(ctx, ci_uint32, khz, ORM_OUTPUT_STACK)                    \
     FTL_TFIELD_STRUCT(ctx, oo_p_dllink_t, fire_list, ORM_OUTPUT_EXTRA)      \
+    FTL_TFIELD_STRUCT(ctx, oo_p_dllink_t, cascade_list, ORM_OUTPUT_EXTRA)   \
+    FTL_TFIELD_STRUCT(ctx, oo_p_dllink_t, coalesce_list, ORM_OUTPUT_EXTRA)  \
     FTL_TFIELD_ARRAYOFSTRUCT(ctx, \
                              oo_p_dllink_t, warray, CI_IPTIME_WHEELSIZE, ORM_OUTPUT_EXTRA, 1)   \
     FTL_TSTRUCT_END(ctx)                                                 
@@ -591,6 +593,7 @@ typedef struct oo_p_dllink oo_p_dllink_t;
   FTL_TFIELD_INT(ctx, ci_uint32, packet_alloc_numa_nodes, ORM_OUTPUT_STACK)\
   FTL_TFIELD_INT(ctx, ci_uint32, sock_alloc_numa_nodes, ORM_OUTPUT_STACK) \
   FTL_TFIELD_INT(ctx, ci_uint32, interrupt_numa_nodes, ORM_OUTPUT_STACK)  \
+  FTL_TFIELD_INT(ctx, ci_int32, pkt_numa_node, ORM_OUTPUT_STACK)          \
   ON_CI_CFG_FD_CACHING(                                                 \
     FTL_TFIELD_STRUCT(ctx, ci_socket_cache_t, active_cache, ORM_OUTPUT_EXTRA)   \
     FTL_TFIELD_INT(ctx, ci_uint32, active_cache_avail_stack, ORM_OUTPUT_STACK)  \
@@ -874,6 +877,7 @@ typedef struct oo_tcp_socket_stats oo_tcp_socket_stats;
   ON_CI_CFG_BURST_CONTROL(                                              \
      FTL_TFIELD_INT(ctx, ci_uint32, tx_stop_burst, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS)) \
                                                                         ) \
+  FTL_TFIELD_INT(ctx, ci_uint32, tx_stop_pace, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))     \
   FTL_TFIELD_INT(ctx, ci_uint32, tx_nomac_defer, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))   \
   FTL_TFIELD_INT(ctx, ci_uint32, tx_defer, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))         \
   FTL_TFIELD_INT(ctx, ci_uint32, tx_msg_warm_abort, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS)) \
@@ -995,6 +999,7 @@ typedef struct oo_tcp_socket_stats oo_tcp_socket_stats;
     FTL_TFIELD_INT(ctx, ci_iptime_t, t_ka_intvl_in_secs, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS)) \
     FTL_TFIELD_INT(ctx, ci_uint16, user_mss, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))               \
     FTL_TFIELD_INT(ctx, ci_uint8, tcp_defer_accept, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))	      \
+    FTL_TFIELD_INT(ctx, ci_uint64, max_pacing_rate, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))        \
     FTL_TSTRUCT_END(ctx)
 
 #define STRUCT_TCP(ctx) \
@@ -1099,6 +1104,10 @@ typedef struct oo_tcp_socket_stats oo_tcp_socket_stats;
       FTL_TFIELD_STRUCT(ctx, ci_ip_timer, stats_tid, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))            \
     )                                                                         \
     FTL_TFIELD_STRUCT(ctx, ci_ip_timer, cork_tid, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))               \
+    FTL_TFIELD_STRUCT(ctx, ci_ip_timer, pace_tid, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))               \
+    FTL_TFIELD_STRUCT(ctx, ci_ip_timer, coalesce_tid, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))           \
+    FTL_TFIELD_INT(ctx, ci_int32, pace_credit, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))                  \
+    FTL_TFIELD_INT(ctx, ci_iptime_t, pace_stamp, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))                \
     ON_CI_CFG_TCP_SOCK_STATS(                                                 \
       FTL_TFIELD_STRUCT(ctx, ci_ip_sock_stats, stats_snapshot, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))  \
       FTL_TFIELD_STRUCT(ctx, ci_ip_sock_stats, stats_cumulative, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))\
@@ -1151,6 +1160,10 @@ typedef struct oo_tcp_socket_stats oo_tcp_socket_stats;
 		   n_syncookie_ack_hash_rej, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))			              \
     FTL_TFIELD_INT(ctx, ci_uint32,                \
 		   n_syncookie_ack_answ, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))			              \
+    FTL_TFIELD_INT(ctx, ci_uint32,                \
+		   n_syncookie_flood, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))			              \
+    FTL_TFIELD_INT(ctx, ci_uint32,                \
+		   n_syncookie_synack_tmpl, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))		              \
     ON_CI_CFG_FD_CACHING(						      \
       FTL_TFIELD_INT(ctx, ci_uint32,              \
   		   n_sockcache_hit, (ORM_OUTPUT_STACK | ORM_OUTPUT_SOCKETS))				              \
@@ -369,6 +369,60 @@ static int orm_oo_opts_dump(ci_netif* ni)
   return 0;
 }
 
+/**********************************************************/
+/* Dump latency histograms */
+/**********************************************************/
+
+/* Times are in nanoseconds.  Each bucket is [lower bound, count]. */
+static void orm_oo_lat_hist_dump(ci_netif* ni, const char* label,
+                                 const ci_lat_hist* shared)
+{
+  double ns_per_cycle = 1e6 / IPTIMER_STATE(ni)->khz;
+  ci_lat_hist h;
+  ci_uint64 count;
+  int i;
+
+  memcpy(&h, shared, sizeof(h));
+  count = ci_lat_hist_count(&h);
+  dump_buf_label("\"", label, "\":{");
+  dump_buf_cat_comma("\"count\":%"CI_PRIu64, count);
+  dump_buf_cat_comma("\"mean\":%.0f",
+                     count ? h.sum * ns_per_cycle / count : 0.0);
+#define ORM_LAT_HIST_PERCENTILE(name, ppm)                               \
+  dump_buf_cat_comma("\"" name "\":%.0f",                                \
+                     ci_lat_hist_percentile(&h, count, ppm) * ns_per_cycle);
+  ORM_LAT_HIST_PERCENTILE("p50", 500000)
+  ORM_LAT_HIST_PERCENTILE("p90", 900000)
+  ORM_LAT_HIST_PERCENTILE("p99", 990000)
+  ORM_LAT_HIST_PERCENTILE("p99.9", 999000)
+  ORM_LAT_HIST_PERCENTILE("p99.99", 999900)
+#undef ORM_LAT_HIST_PERCENTILE
+  dump_buf_cat_comma("\"max\":%.0f", h.max * ns_per_cycle);
+  dump_buf_literal("\"buckets\":[");
+  for( i = 0; i < CI_LAT_HIST_BUCKETS; ++i )
+    if( h.bucket[i] )
+      dump_buf_cat_comma("[%.0f,%"CI_PRIu64"]",
+                         ci_lat_hist_bucket_min(i) * ns_per_cycle,
+                         h.bucket[i]);
+  dump_buf_cleanup();
+  dump_buf_literal_comma("]");
+  dump_buf_cleanup();
+  dump_buf_literal_comma("}");
+}
+
+
+static int orm_oo_lat_hists_dump(ci_netif* ni)
+{
+  dump_buf_literal("\"histograms\":{");
+#define OO_LAT_HIST(name, desc)                                 \
+  orm_oo_lat_hist_dump(ni, #name, &ni->state->lat_hist.name);
+#include <ci/internal/lat_hist_def.h>
+#undef OO_LAT_HIST
+  dump_buf_cleanup();
+  dump_buf_literal_comma("}");
+  return 0;
+}
+
 /**********************************************************/
 /* Dump ci_netif_stats */
 /**********************************************************/
@@ -985,6 +1039,12 @@ static int orm_netif_dump(ci_netif* ni, int id, int output_flags, bool cfg_flat,
       return rc;
     }
   }
+  if (output_flags & ORM_OUTPUT_HISTOGRAMS) {
+    if( (rc = orm_oo_lat_hists_dump(ni)) != 0 ) {
+      LOG("histograms error code %d\n",rc);
+      return rc;
+    }
+  }
   if (output_flags & ORM_OUTPUT_OPTS) {
     if( (rc = orm_oo_opts_dump(ni)) != 0 ) {
       LOG("opts error code %d\n",rc);
@@ -1041,6 +1101,8 @@ int orm_parse_output_flags(int argc, const char* const* argv)
       output_flags |= ORM_OUTPUT_VIS;
     else if ( !strcmp(argv[i], "opts") )
       output_flags |= ORM_OUTPUT_OPTS;
+    else if ( !strcmp(argv[i], "histograms") )
+      output_flags |= ORM_OUTPUT_HISTOGRAMS;
     else if ( !strcmp(argv[i], "lots") )
       output_flags |= ORM_OUTPUT_LOTS;
     else if ( !strcmp(argv[i], "extra") )